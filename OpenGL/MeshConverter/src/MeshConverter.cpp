@@ -0,0 +1,257 @@
+// Offline converter from Wavefront OBJ to the binary .mesh format loaded by MeshFile.
+// usage: MeshConverter <input.obj> <output.mesh> [--lods <count>]
+// Besides the full mesh, up to count - 1 simplified levels of detail are written (all of them by
+// default, --lods 1 for none).
+
+#include <cfloat>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "MeshFile.h"
+#include "MeshSimplifier.h"
+
+// one OBJ vertex is a combination of position/texcoord/normal indices, identical combinations share a vertex
+struct ObjVertexKey
+{
+	int position;
+	int texcoord;
+	int normal;
+
+	bool operator==(const ObjVertexKey& other) const
+	{
+		return position == other.position && texcoord == other.texcoord && normal == other.normal;
+	}
+};
+
+struct ObjVertexKeyHash
+{
+	size_t operator()(const ObjVertexKey& key) const
+	{
+		return ((size_t)key.position * 73856093) ^ ((size_t)key.texcoord * 19349663) ^ ((size_t)key.normal * 83492791);
+	}
+};
+
+struct ObjMesh
+{
+	std::vector<float> positions;
+	std::vector<float> texcoords;
+	std::vector<float> normals;
+	std::vector<ObjVertexKey> corners;
+};
+
+// OBJ indices start at 1 and negative ones count back from the last element read so far
+static int ResolveIndex(const std::string& token, size_t element_count)
+{
+	if (token.empty())
+		return -1;
+	int index = std::atoi(token.c_str());
+	if (index < 0)
+		return (int)element_count + index;
+	return index - 1;
+}
+
+static ObjVertexKey ParseCorner(const std::string& corner, const ObjMesh& mesh)
+{
+	// v, v/vt, v//vn or v/vt/vn
+	std::string parts[3];
+	int part = 0;
+	for (char c : corner)
+	{
+		if (c == '/')
+		{
+			if (++part > 2)
+				break;
+		}
+		else
+		{
+			parts[part] += c;
+		}
+	}
+	return {
+		ResolveIndex(parts[0], mesh.positions.size() / 3),
+		ResolveIndex(parts[1], mesh.texcoords.size() / 2),
+		ResolveIndex(parts[2], mesh.normals.size() / 3)
+	};
+}
+
+static bool ParseObj(const std::string& path, ObjMesh& mesh)
+{
+	std::ifstream stream(path);
+	if (!stream.is_open())
+	{
+		std::cerr << "Error opening the file " << path << std::endl;
+		return false;
+	}
+
+	std::string line;
+	std::vector<ObjVertexKey> face;
+	while (std::getline(stream, line))
+	{
+		std::istringstream tokens(line);
+		std::string keyword;
+		tokens >> keyword;
+
+		if (keyword == "v")
+		{
+			float x = 0, y = 0, z = 0;
+			tokens >> x >> y >> z;
+			mesh.positions.insert(mesh.positions.end(), { x, y, z });
+		}
+		else if (keyword == "vt")
+		{
+			float u = 0, v = 0;
+			tokens >> u >> v;
+			mesh.texcoords.insert(mesh.texcoords.end(), { u, v });
+		}
+		else if (keyword == "vn")
+		{
+			float x = 0, y = 0, z = 0;
+			tokens >> x >> y >> z;
+			mesh.normals.insert(mesh.normals.end(), { x, y, z });
+		}
+		else if (keyword == "f")
+		{
+			face.clear();
+			std::string corner;
+			while (tokens >> corner)
+				face.push_back(ParseCorner(corner, mesh));
+
+			// polygons are split into a fan of triangles
+			for (size_t i = 2; i < face.size(); i++)
+			{
+				mesh.corners.push_back(face[0]);
+				mesh.corners.push_back(face[i - 1]);
+				mesh.corners.push_back(face[i]);
+			}
+		}
+	}
+
+	for (const ObjVertexKey& corner : mesh.corners)
+	{
+		if (corner.position < 0 || corner.position >= (int)(mesh.positions.size() / 3)
+			|| corner.texcoord >= (int)(mesh.texcoords.size() / 2) || corner.normal >= (int)(mesh.normals.size() / 3))
+		{
+			std::cerr << "Face references a vertex that doesn't exist in " << path << std::endl;
+			return false;
+		}
+	}
+	return true;
+}
+
+// each level aims for half the triangles of the one before
+static constexpr float LOD_REDUCTION = 0.5f;
+
+// a level that got less than 10% smaller isn't worth its indices, borders and seams are holding the mesh
+static constexpr float LOD_MIN_GAIN = 0.9f;
+
+// below this there is nothing left worth simplifying
+static constexpr unsigned int LOD_MIN_TRIANGLES = 8;
+
+// Simplify the mesh level after level and put every level's indices after the full mesh's
+static std::vector<MeshLod> BuildLodChain(const std::vector<float>& vertices, unsigned int vertex_count, unsigned int stride,
+	std::vector<unsigned int>& indices, unsigned int max_lods)
+{
+	std::vector<MeshLod> lods;
+	lods.push_back({ 0, (unsigned int)indices.size(), 0.0f });
+
+	std::vector<unsigned int> level = indices;
+	float total_error = 0.0f;
+	while (lods.size() < max_lods)
+	{
+		unsigned int target = (unsigned int)(level.size() / 3 * LOD_REDUCTION) * 3;
+		if (target < LOD_MIN_TRIANGLES * 3)
+			break;
+
+		float error;
+		std::vector<unsigned int> simplified = SimplifyMesh(vertices.data(), vertex_count, stride, level, target, FLT_MAX, error);
+		if (simplified.empty() || simplified.size() > level.size() * LOD_MIN_GAIN)
+			break;
+
+		// each level is simplified from the one before, its distance to the full mesh is at most the sum
+		total_error += error;
+		lods.push_back({ (unsigned int)indices.size(), (unsigned int)simplified.size(), total_error });
+		indices.insert(indices.end(), simplified.begin(), simplified.end());
+		level = std::move(simplified);
+	}
+	return lods;
+}
+
+int main(int argc, char** argv)
+{
+	unsigned int max_lods = MAX_MESH_LODS;
+	if (argc == 5 && std::string(argv[3]) == "--lods")
+		max_lods = (unsigned int)std::atoi(argv[4]);
+	if ((argc != 3 && argc != 5) || max_lods < 1 || max_lods > MAX_MESH_LODS)
+	{
+		std::cerr << "usage: MeshConverter <input.obj> <output.mesh> [--lods <count>], count from 1 to " << MAX_MESH_LODS << std::endl;
+		return 1;
+	}
+
+	ObjMesh obj;
+	if (!ParseObj(argv[1], obj))
+		return 1;
+
+	// only store the attributes the file actually has
+	bool has_texcoords = !obj.texcoords.empty();
+	bool has_normals = !obj.normals.empty();
+
+	VertexBufferLayout layout;
+	layout.Push<float>(3);
+	if (has_texcoords)
+		layout.Push<float>(2);
+	if (has_normals)
+		layout.Push<float>(3);
+
+	std::vector<float> vertices;
+	std::vector<unsigned int> indices;
+	std::unordered_map<ObjVertexKey, unsigned int, ObjVertexKeyHash> vertex_lookup;
+	unsigned int vertex_count = 0;
+
+	for (const ObjVertexKey& corner : obj.corners)
+	{
+		auto found = vertex_lookup.find(corner);
+		if (found != vertex_lookup.end())
+		{
+			indices.push_back(found->second);
+			continue;
+		}
+
+		const float* position = &obj.positions[corner.position * 3];
+		vertices.insert(vertices.end(), position, position + 3);
+		if (has_texcoords)
+		{
+			if (corner.texcoord >= 0)
+				vertices.insert(vertices.end(), &obj.texcoords[corner.texcoord * 2], &obj.texcoords[corner.texcoord * 2] + 2);
+			else
+				vertices.insert(vertices.end(), { 0.0f, 0.0f });
+		}
+		if (has_normals)
+		{
+			if (corner.normal >= 0)
+				vertices.insert(vertices.end(), &obj.normals[corner.normal * 3], &obj.normals[corner.normal * 3] + 3);
+			else
+				vertices.insert(vertices.end(), { 0.0f, 0.0f, 0.0f });
+		}
+
+		vertex_lookup[corner] = vertex_count;
+		indices.push_back(vertex_count++);
+	}
+
+	std::vector<MeshLod> lods = BuildLodChain(vertices, vertex_count, layout.GetStride(), indices, max_lods);
+
+	if (!MeshFile::Write(argv[2], layout, vertices.data(), vertex_count, indices.data(), (unsigned int)indices.size(), lods.data(), (unsigned int)lods.size()))
+	{
+		std::cerr << "Failed to write " << argv[2] << std::endl;
+		return 1;
+	}
+
+	std::cout << argv[2] << ": " << vertex_count << " vertices" << std::endl;
+	for (unsigned int level = 0; level < lods.size(); level++)
+		std::cout << "  level " << level << ": " << lods[level].index_count / 3 << " triangles, error " << lods[level].error << std::endl;
+	return 0;
+}
@@ -0,0 +1,287 @@
+#include "MeshSimplifier.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+
+// Sum of squared distances to a set of planes, weighted by the area of the triangles they came from.
+// Stored as the upper half of the symmetric 4x4 matrix (a, b, c, d)^T (a, b, c, d).
+struct Quadric
+{
+	double aa, ab, ac, ad, bb, bc, bd, cc, cd, dd;
+	double weight;
+};
+
+static void AddPlane(Quadric& q, double a, double b, double c, double d, double weight)
+{
+	q.aa += a * a * weight; q.ab += a * b * weight; q.ac += a * c * weight; q.ad += a * d * weight;
+	q.bb += b * b * weight; q.bc += b * c * weight; q.bd += b * d * weight;
+	q.cc += c * c * weight; q.cd += c * d * weight;
+	q.dd += d * d * weight;
+	q.weight += weight;
+}
+
+static void AddQuadric(Quadric& q, const Quadric& other)
+{
+	q.aa += other.aa; q.ab += other.ab; q.ac += other.ac; q.ad += other.ad;
+	q.bb += other.bb; q.bc += other.bc; q.bd += other.bd;
+	q.cc += other.cc; q.cd += other.cd;
+	q.dd += other.dd;
+	q.weight += other.weight;
+}
+
+// Mean squared distance of p to the planes of both quadrics, orders the collapses
+static double Evaluate(const Quadric& q, const Quadric& r, const double* p)
+{
+	double x = p[0], y = p[1], z = p[2];
+	double sum =
+		(q.aa + r.aa) * x * x + 2 * (q.ab + r.ab) * x * y + 2 * (q.ac + r.ac) * x * z + 2 * (q.ad + r.ad) * x
+		+ (q.bb + r.bb) * y * y + 2 * (q.bc + r.bc) * y * z + 2 * (q.bd + r.bd) * y
+		+ (q.cc + r.cc) * z * z + 2 * (q.cd + r.cd) * z
+		+ (q.dd + r.dd);
+	double weight = q.weight + r.weight;
+	return weight > 0 ? std::max(sum / weight, 0.0) : 0.0;
+}
+
+// Largest distance of p to the planes (a, b, c, d) of the listed triangles
+static double MaxPlaneDistance(const std::vector<double>& planes, const std::vector<unsigned int>& triangles, const double* p)
+{
+	double distance = 0.0;
+	for (unsigned int t : triangles)
+	{
+		const double* plane = &planes[t * 4];
+		distance = std::max(distance, std::abs(plane[0] * p[0] + plane[1] * p[1] + plane[2] * p[2] + plane[3]));
+	}
+	return distance;
+}
+
+static void Normal(const double* p0, const double* p1, const double* p2, double* normal)
+{
+	double e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+	double e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+	normal[0] = e1[1] * e2[2] - e1[2] * e2[1];
+	normal[1] = e1[2] * e2[0] - e1[0] * e2[2];
+	normal[2] = e1[0] * e2[1] - e1[1] * e2[0];
+}
+
+// cosine of the largest turn a triangle may take in a collapse
+static constexpr double MIN_NORMAL_COSINE = 0.25;
+
+struct Collapse
+{
+	unsigned int from;
+	unsigned int to;
+	double cost;
+};
+
+std::vector<unsigned int> SimplifyMesh(const float* positions, unsigned int vertex_count, unsigned int stride,
+	const std::vector<unsigned int>& indices, unsigned int target_index_count, float max_error, float& error)
+{
+	error = 0.0f;
+	std::vector<double> points(vertex_count * 3);
+	for (unsigned int v = 0; v < vertex_count; v++)
+	{
+		const float* position = (const float*)((const char*)positions + (size_t)v * stride);
+		points[v * 3 + 0] = position[0];
+		points[v * 3 + 1] = position[1];
+		points[v * 3 + 2] = position[2];
+	}
+
+	// seams: more than one vertex at a position, moving one of them would tear the surface
+	std::vector<bool> locked(vertex_count, false);
+	{
+		std::unordered_map<uint64_t, unsigned int> first_at;
+		for (unsigned int v = 0; v < vertex_count; v++)
+		{
+			const float* position = (const float*)((const char*)positions + (size_t)v * stride);
+			uint32_t bits[3];
+			std::memcpy(bits, position, sizeof(bits));
+			uint64_t key = ((uint64_t)bits[0] * 73856093u) ^ ((uint64_t)bits[1] * 19349663u << 16) ^ ((uint64_t)bits[2] * 83492791u << 32);
+
+			// a hash collision only locks a vertex that didn't need it, that's harmless
+			auto inserted = first_at.emplace(key, v);
+			if (!inserted.second)
+			{
+				locked[v] = true;
+				locked[inserted.first->second] = true;
+			}
+		}
+	}
+
+	std::vector<unsigned int> triangles(indices.begin(), indices.end() - indices.size() % 3);
+	unsigned int triangle_count = (unsigned int)triangles.size() / 3;
+	std::vector<bool> triangle_live(triangle_count, true);
+	std::vector<std::vector<unsigned int>> vertex_triangles(vertex_count);
+	std::vector<Quadric> quadrics(vertex_count, Quadric{});
+
+	// the original triangles every vertex stands for, grows as vertices are collapsed onto it
+	std::vector<double> planes(triangle_count * 4, 0.0);
+	std::vector<std::vector<unsigned int>> vertex_planes(vertex_count);
+
+	// borders: edges with a single triangle
+	std::unordered_map<uint64_t, unsigned int> edge_uses;
+	for (unsigned int t = 0; t < triangle_count; t++)
+	{
+		const unsigned int* corners = &triangles[t * 3];
+		double normal[3];
+		Normal(&points[corners[0] * 3], &points[corners[1] * 3], &points[corners[2] * 3], normal);
+		double length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+		if (length > 0)
+		{
+			const double* p = &points[corners[0] * 3];
+			planes[t * 4 + 0] = normal[0] / length;
+			planes[t * 4 + 1] = normal[1] / length;
+			planes[t * 4 + 2] = normal[2] / length;
+			planes[t * 4 + 3] = -(normal[0] * p[0] + normal[1] * p[1] + normal[2] * p[2]) / length;
+		}
+
+		for (unsigned int i = 0; i < 3; i++)
+		{
+			vertex_triangles[corners[i]].push_back(t);
+			unsigned int a = std::min(corners[i], corners[(i + 1) % 3]);
+			unsigned int b = std::max(corners[i], corners[(i + 1) % 3]);
+			edge_uses[(uint64_t)a << 32 | b]++;
+
+			if (length > 0)
+			{
+				AddPlane(quadrics[corners[i]], planes[t * 4 + 0], planes[t * 4 + 1], planes[t * 4 + 2], planes[t * 4 + 3], length * 0.5);
+				vertex_planes[corners[i]].push_back(t);
+			}
+		}
+	}
+	for (const auto& edge : edge_uses)
+	{
+		if (edge.second == 1)
+		{
+			locked[(unsigned int)(edge.first >> 32)] = true;
+			locked[(unsigned int)(edge.first & 0xFFFFFFFF)] = true;
+		}
+	}
+
+	// the mean squared distance is never above the largest one squared, past this nothing can pass
+	double max_cost = (double)max_error * max_error;
+	unsigned int index_count = triangle_count * 3;
+	std::vector<Collapse> collapses;
+	std::vector<bool> touched(vertex_count);
+
+	// would moving from onto to turn any of its triangles over (or close to it)
+	auto flips = [&](unsigned int from, unsigned int to)
+	{
+		for (unsigned int t : vertex_triangles[from])
+		{
+			const unsigned int* corners = &triangles[t * 3];
+			if (!triangle_live[t] || corners[0] == to || corners[1] == to || corners[2] == to)
+				continue;
+
+			const double* before[3];
+			const double* after[3];
+			for (unsigned int i = 0; i < 3; i++)
+			{
+				before[i] = &points[corners[i] * 3];
+				after[i] = &points[(corners[i] == from ? to : corners[i]) * 3];
+			}
+			double normal_before[3], normal_after[3];
+			Normal(before[0], before[1], before[2], normal_before);
+			Normal(after[0], after[1], after[2], normal_after);
+			// turning more than ~75 degrees counts too, those triangles end up as fins standing out of the surface
+			double dot = normal_before[0] * normal_after[0] + normal_before[1] * normal_after[1] + normal_before[2] * normal_after[2];
+			double length_before = std::sqrt(normal_before[0] * normal_before[0] + normal_before[1] * normal_before[1] + normal_before[2] * normal_before[2]);
+			double length_after = std::sqrt(normal_after[0] * normal_after[0] + normal_after[1] * normal_after[1] + normal_after[2] * normal_after[2]);
+			if (dot <= MIN_NORMAL_COSINE * length_before * length_after)
+				return true;
+		}
+		return false;
+	};
+
+	// every pass collapses a batch of independent edges, cheapest first, then the costs are worked out again
+	while (index_count > target_index_count)
+	{
+		collapses.clear();
+		for (unsigned int t = 0; t < triangle_count; t++)
+		{
+			if (!triangle_live[t])
+				continue;
+			for (unsigned int i = 0; i < 3; i++)
+			{
+				// every inner edge shows up in two triangles, in opposite directions, one of them is enough
+				unsigned int a = triangles[t * 3 + i];
+				unsigned int b = triangles[t * 3 + (i + 1) % 3];
+				if (a > b || (locked[a] && locked[b]))
+					continue;
+
+				double cost_ab = locked[a] ? HUGE_VAL : Evaluate(quadrics[a], quadrics[b], &points[b * 3]);
+				double cost_ba = locked[b] ? HUGE_VAL : Evaluate(quadrics[a], quadrics[b], &points[a * 3]);
+				if (cost_ab <= cost_ba)
+					collapses.push_back({ a, b, cost_ab });
+				else
+					collapses.push_back({ b, a, cost_ba });
+			}
+		}
+		std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) { return a.cost < b.cost; });
+
+		std::fill(touched.begin(), touched.end(), false);
+		unsigned int collapsed = 0;
+		for (const Collapse& collapse : collapses)
+		{
+			if (index_count <= target_index_count)
+				break;
+			if (collapse.cost > max_cost)
+				break;
+			if (touched[collapse.from] || touched[collapse.to] || flips(collapse.from, collapse.to))
+				continue;
+
+			// the quadric cost is a mean, a few planes much further away than the rest can still be over
+			const double* kept = &points[collapse.to * 3];
+			double distance = std::max(MaxPlaneDistance(planes, vertex_planes[collapse.from], kept), MaxPlaneDistance(planes, vertex_planes[collapse.to], kept));
+			if (distance > max_error)
+				continue;
+
+			// the triangles around from now end at to, the ones along the edge disappear
+			for (unsigned int t : vertex_triangles[collapse.from])
+			{
+				if (!triangle_live[t])
+					continue;
+				unsigned int* corners = &triangles[t * 3];
+				for (unsigned int i = 0; i < 3; i++)
+					touched[corners[i]] = true;
+
+				if (corners[0] == collapse.to || corners[1] == collapse.to || corners[2] == collapse.to)
+				{
+					triangle_live[t] = false;
+					index_count -= 3;
+					continue;
+				}
+				for (unsigned int i = 0; i < 3; i++)
+				{
+					if (corners[i] == collapse.from)
+						corners[i] = collapse.to;
+				}
+				vertex_triangles[collapse.to].push_back(t);
+			}
+			vertex_triangles[collapse.from].clear();
+			AddQuadric(quadrics[collapse.to], quadrics[collapse.from]);
+			std::vector<unsigned int>& merged = vertex_planes[collapse.to];
+			merged.insert(merged.end(), vertex_planes[collapse.from].begin(), vertex_planes[collapse.from].end());
+			std::sort(merged.begin(), merged.end());
+			merged.erase(std::unique(merged.begin(), merged.end()), merged.end());
+			vertex_planes[collapse.from].clear();
+			error = std::max(error, (float)distance);
+			collapsed++;
+		}
+
+		// the cheapest edge that is still free is over the error, or everything left is locked
+		if (collapsed == 0)
+			break;
+	}
+
+	std::vector<unsigned int> result;
+	result.reserve(index_count);
+	for (unsigned int t = 0; t < triangle_count; t++)
+	{
+		if (triangle_live[t])
+			result.insert(result.end(), &triangles[t * 3], &triangles[t * 3] + 3);
+	}
+	return result;
+}
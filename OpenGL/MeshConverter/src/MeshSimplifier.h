@@ -0,0 +1,17 @@
+#pragma once
+
+#include <vector>
+
+// Mesh simplification with quadric error metrics (Garland and Heckbert), used to build the level of detail
+// chains of .mesh files. Edges are collapsed onto one of their own two vertices rather than a new optimal
+// point, so a simplified mesh is only a new index list and every level of a chain shares the vertices of
+// the full mesh. Vertices on a border or a seam (several vertices at the same position with different
+// attributes) are never collapsed, holes and texture seams don't open up, the mesh simplifies less
+// around them instead.
+
+// Simplify the triangles of indices down to target_index_count indices or as close as it gets. The quadrics
+// only order the collapses, the error of one is the largest distance of the vertex it keeps from the planes
+// of the original triangles merged into it, and collapses over max_error (object units) are not done.
+// positions are x, y, z floats stride bytes apart. error gets the largest error of the collapses that were done.
+std::vector<unsigned int> SimplifyMesh(const float* positions, unsigned int vertex_count, unsigned int stride,
+	const std::vector<unsigned int>& indices, unsigned int target_index_count, float max_error, float& error);
@@ -2,10 +2,13 @@
 #version 330 core
 		
 layout(location = 0) in vec4 position;
+
+uniform mat4 u_ViewProjection;
+uniform mat4 u_Model;
 		
 void main()
 {
-	gl_Position = position;
+	gl_Position = u_ViewProjection * u_Model * position;
 };
 
 #shader fragment
@@ -0,0 +1,37 @@
+#shader compute
+#version 430 core
+
+// One level of the depth pyramid. Every texel keeps the farthest depth of what it covers one level down,
+// so a box found behind it is behind everything there.
+layout(local_size_x = 8, local_size_y = 8) in;
+
+// the depth buffer for the first level, the pyramid itself for the others
+layout(binding = 0) uniform sampler2D u_Source;
+uniform int u_SourceLevel;
+uniform ivec2 u_SourceSize;
+
+layout(r32f, binding = 0) uniform writeonly image2D u_Destination;
+
+void main()
+{
+	ivec2 size = imageSize(u_Destination);
+	ivec2 texel = ivec2(gl_GlobalInvocationID.xy);
+	if (texel.x >= size.x || texel.y >= size.y)
+		return;
+
+#ifdef HIZ_FIRST_LEVEL
+	float depth = texelFetch(u_Source, texel, 0).r;
+#else
+	// with an odd source size the last row and column also take the texel that is left over
+	ivec2 first = texel * 2;
+	ivec2 last = min(first + 1 + ivec2(equal(texel, size - 1)) * (u_SourceSize & 1), u_SourceSize - 1);
+	float depth = 0.0;
+	for (int y = first.y; y <= last.y; y++)
+	{
+		for (int x = first.x; x <= last.x; x++)
+			depth = max(depth, texelFetch(u_Source, ivec2(x, y), u_SourceLevel).r);
+	}
+#endif
+
+	imageStore(u_Destination, texel, vec4(depth));
+}
@@ -0,0 +1,25 @@
+#shader vertex
+#version 330 core
+
+// Bounding box of an instance, drawn inside an occlusion query on contexts without compute shaders
+layout(location = 0) in vec3 position;
+
+uniform mat4 u_ViewProjection;
+uniform vec3 u_Center;
+uniform vec3 u_Extents;
+
+void main()
+{
+	gl_Position = u_ViewProjection * vec4(u_Center + position * u_Extents, 1.0);
+}
+
+#shader fragment
+#version 330 core
+
+// color writes are off while the boxes are drawn, only whether any sample passed matters
+layout(location = 0) out vec4 color;
+
+void main()
+{
+	color = vec4(1.0);
+}
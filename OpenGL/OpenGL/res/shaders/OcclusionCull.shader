@@ -0,0 +1,108 @@
+#shader compute
+#version 430 core
+
+// Frustum and occlusion test of every instance, the result goes straight into the instance count of its
+// indirect draw command. The early phase draws what was visible last frame, the late phase tests
+// everything against the depth pyramid of this frame and draws only what the early phase missed.
+layout(local_size_x = 64) in;
+
+struct Instance
+{
+	vec4 center;
+	vec4 extents;
+};
+
+struct DrawCommand
+{
+	uint count;
+	uint instance_count;
+	uint first_index;
+	int base_vertex;
+	uint base_instance;
+};
+
+layout(std430, binding = 0) readonly buffer Instances { Instance instances[]; };
+layout(std430, binding = 1) buffer Visibility { uint visibility[]; };   // 1 if visible at the end of the last frame
+layout(std430, binding = 2) buffer Commands { DrawCommand commands[]; };
+
+uniform uint u_InstanceCount;
+uniform vec4 u_Planes[6];
+
+#ifdef OCCLUSION_LATE_PHASE
+layout(binding = 0) uniform sampler2D u_Pyramid;
+uniform mat4 u_ViewProjection;
+#endif
+
+bool IsInFrustum(Instance instance)
+{
+	for (int i = 0; i < 6; i++)
+	{
+		float distance = dot(u_Planes[i].xyz, instance.center.xyz) + u_Planes[i].w;
+		if (distance < -dot(abs(u_Planes[i].xyz), instance.extents.xyz))
+			return false;
+	}
+	return true;
+}
+
+#ifdef OCCLUSION_LATE_PHASE
+bool IsOccluded(Instance instance)
+{
+	// screen rectangle and nearest depth of the box
+	vec2 uv_min = vec2(1.0);
+	vec2 uv_max = vec2(0.0);
+	float nearest = 1.0;
+	for (int corner = 0; corner < 8; corner++)
+	{
+		vec3 offset = vec3(corner & 1, (corner >> 1) & 1, (corner >> 2) & 1) * 2.0 - 1.0;
+		vec4 clip = u_ViewProjection * vec4(instance.center.xyz + offset * instance.extents.xyz, 1.0);
+
+		// the box reaches behind the camera, its rectangle is unbounded
+		if (clip.w <= 0.0)
+			return false;
+
+		vec3 ndc = clip.xyz / clip.w;
+		uv_min = min(uv_min, ndc.xy * 0.5 + 0.5);
+		uv_max = max(uv_max, ndc.xy * 0.5 + 0.5);
+		nearest = min(nearest, ndc.z * 0.5 + 0.5);
+	}
+	uv_min = clamp(uv_min, 0.0, 1.0);
+	uv_max = clamp(uv_max, 0.0, 1.0);
+
+	// the level where the rectangle is at most a texel wide, so a few texels cover all of it
+	vec2 size = (uv_max - uv_min) * vec2(textureSize(u_Pyramid, 0));
+	int levels = textureQueryLevels(u_Pyramid);
+	int level = clamp(int(ceil(log2(max(max(size.x, size.y), 1.0)))), 0, levels - 1);
+
+	// levels are rounded down in size, one more texel on the far side makes up for it
+	ivec2 level_size = textureSize(u_Pyramid, level);
+	ivec2 first = clamp(ivec2(uv_min * vec2(level_size)), ivec2(0), level_size - 1);
+	ivec2 last = clamp(ivec2(uv_max * vec2(level_size)) + 1, ivec2(0), level_size - 1);
+
+	float farthest = 0.0;
+	for (int y = first.y; y <= last.y; y++)
+	{
+		for (int x = first.x; x <= last.x; x++)
+			farthest = max(farthest, texelFetch(u_Pyramid, ivec2(x, y), level).r);
+	}
+	return nearest > farthest;
+}
+#endif
+
+void main()
+{
+	uint index = gl_GlobalInvocationID.x;
+	if (index >= u_InstanceCount)
+		return;
+
+	Instance instance = instances[index];
+	bool visible = IsInFrustum(instance);
+
+#ifdef OCCLUSION_LATE_PHASE
+	visible = visible && !IsOccluded(instance);
+	// what was visible last frame was drawn by the early phase already
+	commands[index].instance_count = visible && visibility[index] == 0u ? 1u : 0u;
+	visibility[index] = visible ? 1u : 0u;
+#else
+	commands[index].instance_count = visible && visibility[index] != 0u ? 1u : 0u;
+#endif
+}
@@ -5,13 +5,25 @@
 #include <string>
 #include <intrin.h>
 #include <memory>
+#include <vector>
 
 #include "Renderer.h"
-#include "VertexBuffer.h"
-#include "IndexBuffer.h"
-#include "VertexArray.h"
 #include "VertexBufferLayout.h"
 #include "Shader.h"
+#include "ShaderVariantCache.h"
+#include "ShaderHotReload.h"
+#include "GLCapabilities.h"
+#include "GLStateCache.h"
+#include "FramebufferPool.h"
+#include "RenderGraph.h"
+#include "Bvh.h"
+#include "EntityWorld.h"
+#include "GeometryPool.h"
+#include "GpuResources.h"
+#include "Math3D.h"
+#include "RenderComponents.h"
+#include "ThreadPool.h"
+#include "TransformHierarchy.h"
 
 int main(void)
 {
@@ -41,6 +53,12 @@ int main(void)
 
 	glewInit();
 
+	// Pick between the direct state access and the bind-to-edit paths of the buffer wrappers.
+	GLCapabilities::Detect();
+
+	// texture bindings of this context are cached, loader threads get contexts of their own
+	GLStateCache::SetRenderThread();
+
 	// To get the version of opengl being used right now by the computer.
 	std::cout << glGetString(GL_VERSION);
 
@@ -58,39 +76,162 @@ int main(void)
 		1,3,2
 	};
 
+	// every GL object lives in here and is referred to by handle
+	std::unique_ptr<GpuResources> gpu_resources = std::make_unique<GpuResources>();
 
-	// creating our shaders
-	std::string fragment_shader;
-	std::string vertex_shader;
-
-	std::unique_ptr<Shader> shader = std::make_unique<Shader>();
-	ShaderSourceString shader_sources = shader->ParseShader("res/shaders/Basic.shader");
+	// creating our shaders, they go through the preprocessor (#include, defines) and every
+	// combination of features is compiled once, the first time it is asked for
+	std::unique_ptr<ShaderPreprocessor> shader_preprocessor = std::make_unique<ShaderPreprocessor>();
+	shader_preprocessor->AddIncludeDirectory("res/shaders");
+	std::unique_ptr<ShaderVariantCache> basic_shader = std::make_unique<ShaderVariantCache>("res/shaders/Basic.shader", std::vector<std::string>(), *shader_preprocessor, *gpu_resources);
 
-	unsigned int shader_program = shader->CreateShader(shader_sources.vertex_source, shader_sources.fragment_source);
-	GLCALL(glUseProgram(shader_program));
+	// saving a shader file recompiles it in the background, the new program is picked up below once it linked
+	std::unique_ptr<ShaderHotReload> shader_hot_reload = std::make_unique<ShaderHotReload>();
+	shader_hot_reload->Add(*basic_shader);
+	unsigned int shader_program = 0;
+	unsigned int rejected_program = 0;   // didn't match the vertex layout, not looked at again until the next reload
+	int view_projection_location = -1;
+	int model_location = -1;
+	int color_location = -1;
 
-	std::unique_ptr<VertexArray> va = std::make_unique<VertexArray>();
-	std::unique_ptr<VertexBuffer> vertex_buffer = std::make_unique<VertexBuffer>(positions, sizeof(float) * 8);
+	// meshes with the same vertex layout share the buffers of one pool
 	VertexBufferLayout layout;
 	layout.Push<float>(2);
-	va->AddBuffer(*vertex_buffer, layout);
-	
+	std::unique_ptr<GeometryPool> geometry_pool = std::make_unique<GeometryPool>(*gpu_resources, layout, 1024, 4096);
+
+	// every renderable is an entity, the renderer reads its mesh, transform and material components.
+	// its world matrix comes from a node of the transform hierarchy
+	std::unique_ptr<TransformHierarchy> transforms = std::make_unique<TransformHierarchy>();
+	std::unique_ptr<EntityWorld> world = std::make_unique<EntityWorld>();
+	world->Create(
+		MeshComponent{ geometry_pool->Allocate(positions, 4, element_indices, 6), 0 },
+		TransformComponent{ transforms->Create(), Mat4::Identity() },
+		BoundsComponent{ { { 0.0f, 0.0f, 0.0f }, { 0.5f, 0.5f, 0.0f } }, 0 },
+		MaterialComponent{ 0, { 0.5f, 0.5f, 0.5f, 1.0f } });
 
-	std::unique_ptr<IndexBuffer> index_buffer = std::make_unique<IndexBuffer>(element_indices, 6);
+	// every renderable has its bounds in here, only the ones the camera can see get drawn
+	std::unique_ptr<BoundingVolumes> bounds = std::make_unique<BoundingVolumes>();
+	world->ForEach<BoundsComponent>([&](EntityWorld::Entity, BoundsComponent& bounds_component)
+	{
+		bounds_component.volume = bounds->Add(bounds_component.box);
+	});
+	std::unique_ptr<ThreadPool> thread_pool = std::make_unique<ThreadPool>();
+
+	// the scene doesn't move, so its bounds go into a hierarchy once and each frame only walks the
+	// parts of it the camera sees (objects that move every frame would go through a FrustumCuller instead)
+	std::unique_ptr<Bvh> scene_bvh = std::make_unique<Bvh>();
+	scene_bvh->Build(*bounds, thread_pool.get());
+	std::vector<unsigned int> visible;
+	std::vector<bool> is_visible;   // by volume
 
-	// calling the shader variable and passing in a value
-	GLCALL(int location_color = glGetUniformLocation(shader_program, "u_Color"));
-	GLCALL(glUniform4f(location_color, 0.5, 0.5, 0.5, 1.0));
+	// render targets are reused from frame to frame, a resize just makes the pool hand out a new size
+	std::unique_ptr<FramebufferPool> framebuffer_pool = std::make_unique<FramebufferPool>(*gpu_resources);
+	std::unique_ptr<RenderGraph> render_graph = std::make_unique<RenderGraph>(*framebuffer_pool);
 
 	/* Loop until the user closes the window */
 	while (!glfwWindowShouldClose(window))
 	{
+		int width, height;
+		glfwGetFramebufferSize(window, &width, &height);
+
+		// minimized, there is nothing to render into
+		if (width == 0 || height == 0)
+		{
+			glfwWaitEvents();
+			continue;
+		}
+
+		shader_hot_reload->Poll();
+
+		// the program changes after a reload, uniforms belong to the program so they are set again
+		unsigned int program = basic_shader->GetProgram(0);
+		if (program != shader_program && program != rejected_program && program != 0)
+		{
+			// the reflection knows where everything is, and whether the vertex layout matches what the shader reads.
+			// drawing with a mismatch reads garbage attributes, the scene is skipped until a fixed version is saved
+			const ShaderReflection* reflection = basic_shader->GetReflection(0);
+			if (!reflection->ValidateLayout(layout))
+			{
+				std::cerr << "Basic.shader doesn't match the vertex layout, the scene isn't drawn" << std::endl;
+				shader_program = 0;
+				rejected_program = program;
+			}
+			else
+			{
+				shader_program = program;
+				GLCALL(glUseProgram(shader_program));
+
+				view_projection_location = reflection->GetUniformLocation("u_ViewProjection");
+				model_location = reflection->GetUniformLocation("u_Model");
+				color_location = reflection->GetUniformLocation("u_Color");
+			}
+		}
+
+		// the scene is drawn with 4x MSAA offscreen and resolved into the window
+		FramebufferSpec scene_spec(width, height, 4);
+		scene_spec.AddColor(GL_RGBA8, AttachmentType::RENDERBUFFER).SetDepth(GL_DEPTH24_STENCIL8);
+
+		// the entities only keep copies of the world matrices, refreshed when the hierarchy moved something
+		transforms->Update(thread_pool.get());
+		if (!transforms->GetChanged().empty())
+		{
+			world->ForEach<TransformComponent>([&](EntityWorld::Entity, TransformComponent& transform)
+			{
+				transform.world = transforms->GetWorld(transform.node);
+			});
+		}
+
+		// the quad is already in clip space, so the camera is an identity view projection
+		constexpr Mat4 view_projection = Mat4::Identity();
+		visible.clear();
+		scene_bvh->QueryFrustum(Frustum::FromMatrix(view_projection.Data()), visible);
+		is_visible.assign(bounds->GetCount(), false);
+		for (unsigned int volume : visible)
+			is_visible[volume] = true;
+
 		/* Render here */
-		glClear(GL_COLOR_BUFFER_BIT);
+		render_graph->Reset();
+		RenderResource backbuffer = render_graph->ImportBackbuffer("backbuffer", width, height);
+		RenderResource scene = render_graph->CreateTarget("scene", scene_spec);
+
+		render_graph->AddPass("scene", [&](const RenderGraph& graph)
+		{
+			graph.BindTarget(scene);
+			GLCALL(glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT));
+
+			// the shader hasn't compiled yet or doesn't match the vertex layout, nothing to draw with until a fixed version is saved and hot reloaded
+			if (shader_program == 0)
+				return;
+
+			GLCALL(glUniformMatrix4fv(view_projection_location, 1, GL_FALSE, view_projection.Data()));
+
+			// one vertex array for every mesh of the pool, binding it once is enough
+			geometry_pool->Bind();
+			world->ForEachChunk<MeshComponent, TransformComponent, MaterialComponent, BoundsComponent>(
+				[&](unsigned int count, const EntityWorld::Entity*, const MeshComponent* meshes, const TransformComponent* world_transforms,
+					const MaterialComponent* materials, const BoundsComponent* bounds_components)
+			{
+				for (unsigned int i = 0; i < count; i++)
+				{
+					if (!is_visible[bounds_components[i].volume])
+						continue;
+					GLCALL(glUniformMatrix4fv(model_location, 1, GL_FALSE, world_transforms[i].world.Data()));
+					GLCALL(glUniform4fv(color_location, 1, materials[i].color));
+					geometry_pool->Draw(meshes[i].mesh, meshes[i].lod);
+				}
+			});
+		}).Write(scene);
+
+		// the graph invalidates the multisampled target after this, its samples are never looked at again
+		render_graph->AddPass("resolve", [&](const RenderGraph& graph)
+		{
+			graph.GetFramebuffer(scene)->ResolveToDefault(width, height, GL_COLOR_BUFFER_BIT);
+		}).Read(scene).Write(backbuffer);
 
-		va->Bind();
-		index_buffer->Bind();
-		GLCALL(glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, nullptr));
+		if (render_graph->Compile())
+			render_graph->Execute();
+		framebuffer_pool->EndFrame();
+		gpu_resources->EndFrame();
 
 		/* Swap front and back buffers */
 		glfwSwapBuffers(window);
@@ -98,8 +239,17 @@ int main(void)
 		/* Poll for and process events */
 		glfwPollEvents();
 	}
-	index_buffer.release();
-	vertex_buffer.release();
+	shader_hot_reload.reset();
+	basic_shader.reset();
+	render_graph.reset();
+	framebuffer_pool.reset();
+	scene_bvh.reset();
+	thread_pool.reset();
+	bounds.reset();
+	world.reset();
+	transforms.reset();
+	geometry_pool.reset();
+	gpu_resources.reset();
 
 	glfwTerminate();
 	return 0;
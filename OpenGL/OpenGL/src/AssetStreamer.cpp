@@ -0,0 +1,179 @@
+#include "AssetStreamer.h"
+#include "MeshFile.h"
+#include "Renderer.h"
+
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+
+#include <iostream>
+
+AssetStreamer::AssetStreamer(GLFWwindow* main_window, GpuResources& resources)
+	: resources_(resources), loader_window_(nullptr), stopping_(false)
+{
+	// the context hints of the main window are still set, only the visibility has to change
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	loader_window_ = glfwCreateWindow(1, 1, "Asset loader", nullptr, main_window);
+	glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+
+	if (!loader_window_)
+	{
+		std::cerr << "Could not create a shared context, assets will be uploaded on the render thread" << std::endl;
+		return;
+	}
+
+	loader_thread_ = std::thread(&AssetStreamer::LoaderLoop, this);
+}
+
+AssetStreamer::~AssetStreamer()
+{
+	if (loader_thread_.joinable())
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			stopping_ = true;
+		}
+		wake_loader_.notify_one();
+		loader_thread_.join();
+	}
+
+	// whatever was uploaded but never handed over just has its fence dropped, the buffers die with the jobs
+	for (Job& job : uploaded_)
+	{
+		if (job.fence)
+			glDeleteSync(job.fence);
+	}
+
+	if (loader_window_)
+		glfwDestroyWindow(loader_window_);
+}
+
+void AssetStreamer::LoaderLoop()
+{
+	glfwMakeContextCurrent(loader_window_);
+
+	while (true)
+	{
+		Job job;
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+			wake_loader_.wait(lock, [this] { return stopping_ || !queued_.empty(); });
+			if (stopping_)
+				break;
+			job = std::move(queued_.front());
+			queued_.pop_front();
+		}
+
+		job.upload();
+
+		// the fence tells the render thread when the GPU actually has the data, the flush makes sure
+		// the fence is submitted at all, otherwise the other context could wait on it forever
+		job.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		glFlush();
+
+		std::lock_guard<std::mutex> lock(mutex_);
+		uploaded_.push_back(std::move(job));
+	}
+
+	glfwMakeContextCurrent(nullptr);
+}
+
+void AssetStreamer::Enqueue(UploadFunction upload, ReadyFunction ready)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		queued_.push_back({ std::move(upload), std::move(ready), nullptr });
+	}
+	wake_loader_.notify_one();
+}
+
+void AssetStreamer::LoadMesh(const std::string& path, MeshReadyFunction ready)
+{
+	// filled on the loader thread, the GpuResources pools are only touched on the render thread
+	struct LoadedMesh
+	{
+		std::unique_ptr<VertexBuffer> vertex_buffer;
+		std::unique_ptr<IndexBuffer> index_buffer;
+		StreamedMesh mesh;
+	};
+	std::shared_ptr<LoadedMesh> loaded = std::make_shared<LoadedMesh>();
+
+	Enqueue(
+		[loaded, path]()
+		{
+			MeshFile file;
+			if (!file.Open(path))
+				return;
+
+			// the buffers copy straight out of the mapping, nothing is parsed or copied on the CPU
+			loaded->vertex_buffer = std::make_unique<VertexBuffer>(file.GetVertexData(), file.GetVertexDataSize());
+			loaded->index_buffer = std::make_unique<IndexBuffer>(file.GetIndices(), file.GetIndexCount());
+			loaded->mesh.layout = file.GetLayout();
+			for (unsigned int level = 0; level < file.GetLodCount(); level++)
+				loaded->mesh.lods.push_back(file.GetLod(level));
+		},
+		[this, loaded, ready]()
+		{
+			if (!loaded->vertex_buffer)
+				return;
+			loaded->mesh.vertex_buffer = resources_.Create<VertexBuffer>(std::move(*loaded->vertex_buffer));
+			loaded->mesh.index_buffer = resources_.Create<IndexBuffer>(std::move(*loaded->index_buffer));
+			ready(loaded->mesh);
+		});
+}
+
+void AssetStreamer::LoadTexture(const std::string& path, TextureReadyFunction ready)
+{
+	std::shared_ptr<std::unique_ptr<Texture>> texture = std::make_shared<std::unique_ptr<Texture>>();
+
+	Enqueue(
+		[texture, path]()
+		{
+			TextureFile file;
+			if (!file.Open(path))
+				return;
+			*texture = std::make_unique<Texture>(file.GetImage());
+		},
+		[this, texture, ready]()
+		{
+			if (*texture)
+				ready(resources_.Create<Texture>(std::move(**texture)));
+		});
+}
+
+void AssetStreamer::Poll()
+{
+	if (!IsAsynchronous())
+	{
+		// no loader thread, do one job per frame so a big batch of loads is at least spread over frames
+		Job job;
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			if (queued_.empty())
+				return;
+			job = std::move(queued_.front());
+			queued_.pop_front();
+		}
+		job.upload();
+		job.ready();
+		return;
+	}
+
+	std::deque<Job> finished;
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		// the loader thread submits its fences in order, so the first one that hasn't signaled ends the search
+		while (!uploaded_.empty())
+		{
+			GLenum state = glClientWaitSync(uploaded_.front().fence, 0, 0);
+			if (state != GL_ALREADY_SIGNALED && state != GL_CONDITION_SATISFIED)
+				break;
+			glDeleteSync(uploaded_.front().fence);
+			finished.push_back(std::move(uploaded_.front()));
+			uploaded_.pop_front();
+		}
+	}
+
+	// the callbacks run without the lock so they are free to queue more work
+	for (Job& job : finished)
+		job.ready();
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "GpuResources.h"
+#include "LodSelector.h"
+#include "VertexBufferLayout.h"
+
+struct GLFWwindow;
+typedef struct __GLsync* GLsync;
+
+// Buffers of a mesh uploaded by the streamer, in the GpuResources of the streamer by the time the mesh is
+// handed over. Vertex arrays are not shared between contexts, so the render thread creates the VertexArray
+// for it once the mesh is handed over.
+struct StreamedMesh
+{
+	VertexBufferHandle vertex_buffer;
+	IndexBufferHandle index_buffer;
+	VertexBufferLayout layout;
+	std::vector<MeshLod> lods;   // ranges of index_buffer, draw one of them rather than the whole buffer
+};
+
+// Creates GL resources on a loader thread so the render thread never waits on file reads or uploads.
+// The loader thread owns a hidden window whose context shares objects with the main window. After each
+// job it puts a fence in its command stream, and Poll() on the render thread hands the job over only
+// once that fence has signaled, so the render thread never sees a half uploaded buffer.
+// If the shared context can't be created the jobs run on the render thread instead, one per Poll().
+class AssetStreamer
+{
+public:
+	typedef std::function<void()> UploadFunction;
+	typedef std::function<void()> ReadyFunction;
+	typedef std::function<void(StreamedMesh&)> MeshReadyFunction;
+	typedef std::function<void(TextureHandle)> TextureReadyFunction;
+
+private:
+	struct Job
+	{
+		UploadFunction upload;
+		ReadyFunction ready;
+		GLsync fence;
+	};
+
+	GpuResources& resources_;   // render thread only, the loader thread makes plain objects that Poll moves in
+	GLFWwindow* loader_window_;
+	std::thread loader_thread_;
+	std::mutex mutex_;
+	std::condition_variable wake_loader_;
+	bool stopping_;
+
+	std::deque<Job> queued_;
+	std::deque<Job> uploaded_;
+
+	void LoaderLoop();
+
+public:
+	// Has to be created on the main thread after the main window's context was made current. Finished
+	// meshes and textures are adopted into resources before their ready callback runs.
+	AssetStreamer(GLFWwindow* main_window, GpuResources& resources);
+	~AssetStreamer();
+
+	AssetStreamer(const AssetStreamer&) = delete;
+	AssetStreamer& operator=(const AssetStreamer&) = delete;
+
+	// upload runs on the loader thread with a current context, ready runs on the render thread in Poll() once the GPU has the data
+	void Enqueue(UploadFunction upload, ReadyFunction ready);
+
+	// Load a .mesh file and create its buffers in the background
+	void LoadMesh(const std::string& path, MeshReadyFunction ready);
+
+	// Load a DDS/KTX2 file and create its texture in the background
+	void LoadTexture(const std::string& path, TextureReadyFunction ready);
+
+	// Call once per frame on the render thread, runs the ready callbacks of finished jobs without blocking
+	void Poll();
+
+	inline bool IsAsynchronous() const { return loader_window_ != nullptr; }
+};
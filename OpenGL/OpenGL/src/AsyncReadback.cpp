@@ -0,0 +1,173 @@
+#include "AsyncReadback.h"
+#include "GLCapabilities.h"
+#include "Renderer.h"
+
+#include <GL/glew.h>
+
+// Bytes per pixel of a format/type pair as glReadPixels writes them
+static size_t GetPixelSize(unsigned int format, unsigned int type)
+{
+	size_t components;
+	switch (format)
+	{
+		case GL_RED:
+		case GL_DEPTH_COMPONENT:
+		case GL_STENCIL_INDEX:
+			components = 1; break;
+		case GL_RG:
+			components = 2; break;
+		case GL_RGB:
+		case GL_BGR:
+			components = 3; break;
+		case GL_DEPTH_STENCIL:
+			return 4;
+		default:
+			components = 4; break;
+	}
+
+	switch (type)
+	{
+		case GL_UNSIGNED_BYTE:
+		case GL_BYTE:
+			return components;
+		case GL_UNSIGNED_SHORT:
+		case GL_SHORT:
+		case GL_HALF_FLOAT:
+			return components * 2;
+	}
+	return components * 4;
+}
+
+AsyncReadback::AsyncReadback(unsigned int ring_size)
+	: next_slot_(0), oldest_slot_(0), pending_(0), captures_(0)
+{
+	slots_.resize(ring_size);
+	for (Slot& slot : slots_)
+	{
+		slot.capacity = 0;
+		slot.fence = nullptr;
+		if (GLCapabilities::Get().direct_state_access)
+			GLCALL(glCreateBuffers(1, &slot.buffer));
+		else
+			GLCALL(glGenBuffers(1, &slot.buffer));
+	}
+}
+
+AsyncReadback::~AsyncReadback()
+{
+	for (Slot& slot : slots_)
+	{
+		if (slot.fence)
+			glDeleteSync(slot.fence);
+		GLCALL(glDeleteBuffers(1, &slot.buffer));
+	}
+}
+
+void AsyncReadback::Capture(int x, int y, unsigned int width, unsigned int height, ReadyFunction ready, unsigned int format, unsigned int type)
+{
+	// an empty rectangle has nothing to read, and mapping 0 bytes is a GL error
+	size_t size = (size_t)width * height * GetPixelSize(format, type);
+	if (size == 0)
+		return;
+
+	if (pending_ == slots_.size())
+		Complete(true);
+
+	Slot& slot = slots_[next_slot_];
+
+	GLCALL(glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer));
+	if (size > slot.capacity)
+	{
+		// stream read: written by the GPU once, read by the CPU once
+		GLCALL(glBufferData(GL_PIXEL_PACK_BUFFER, size, nullptr, GL_STREAM_READ));
+		slot.capacity = size;
+	}
+
+	// rows tightly packed, and with a pack buffer bound the last argument is an offset into it
+	GLCALL(glPixelStorei(GL_PACK_ALIGNMENT, 1));
+	GLCALL(glReadPixels(x, y, width, height, format, type, nullptr));
+	GLCALL(glBindBuffer(GL_PIXEL_PACK_BUFFER, 0));
+
+	GLCALL(slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+	slot.image = { width, height, format, type, nullptr, size, captures_++ };
+	slot.ready = std::move(ready);
+
+	next_slot_ = (next_slot_ + 1) % slots_.size();
+	pending_++;
+}
+
+bool AsyncReadback::Complete(bool wait)
+{
+	if (pending_ == 0)
+		return false;
+
+	Slot& slot = slots_[oldest_slot_];
+	if (wait)
+	{
+		// flush so the fence is guaranteed to reach the GPU, otherwise this could wait forever
+		GLenum state;
+		do
+		{
+			state = glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+		} while (state == GL_TIMEOUT_EXPIRED);
+	}
+	else
+	{
+		GLenum state = glClientWaitSync(slot.fence, 0, 0);
+		if (state != GL_ALREADY_SIGNALED && state != GL_CONDITION_SATISFIED)
+			return false;
+	}
+	glDeleteSync(slot.fence);
+	slot.fence = nullptr;
+
+	const void* pixels;
+	if (GLCapabilities::Get().direct_state_access)
+	{
+		GLCALL(pixels = glMapNamedBufferRange(slot.buffer, 0, slot.image.size, GL_MAP_READ_BIT));
+	}
+	else
+	{
+		GLCALL(glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer));
+		GLCALL(pixels = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, slot.image.size, GL_MAP_READ_BIT));
+	}
+
+	// a failed map leaves nothing to unmap, unmapping anyway would be another GL error
+	if (pixels)
+	{
+		slot.image.pixels = pixels;
+		slot.ready(slot.image);
+		slot.image.pixels = nullptr;
+
+		if (GLCapabilities::Get().direct_state_access)
+		{
+			GLCALL(glUnmapNamedBuffer(slot.buffer));
+		}
+		else
+		{
+			GLCALL(glUnmapBuffer(GL_PIXEL_PACK_BUFFER));
+		}
+	}
+	if (!GLCapabilities::Get().direct_state_access)
+	{
+		GLCALL(glBindBuffer(GL_PIXEL_PACK_BUFFER, 0));
+	}
+
+	slot.ready = nullptr;
+	oldest_slot_ = (oldest_slot_ + 1) % slots_.size();
+	pending_--;
+	return true;
+}
+
+void AsyncReadback::Poll()
+{
+	while (Complete(false))
+	{
+	}
+}
+
+void AsyncReadback::Flush()
+{
+	while (Complete(true))
+	{
+	}
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+typedef struct __GLsync* GLsync;
+
+// Pixels read back from a framebuffer, only valid during the callback that receives them
+struct ReadbackImage
+{
+	unsigned int width;
+	unsigned int height;
+	unsigned int format;
+	unsigned int type;
+	const void* pixels;
+	size_t size;
+	unsigned long long frame;   // value of the capture counter when Capture() was called
+};
+
+// Reads framebuffer pixels into a ring of pixel pack buffers instead of client memory. glReadPixels then
+// only queues a copy on the GPU and returns, and the buffer is mapped a few frames later once its fence
+// has signaled, by which time the copy is long done and mapping doesn't wait on anything.
+class AsyncReadback
+{
+public:
+	typedef std::function<void(const ReadbackImage&)> ReadyFunction;
+
+private:
+	struct Slot
+	{
+		unsigned int buffer;
+		size_t capacity;
+		GLsync fence;
+		ReadbackImage image;
+		ReadyFunction ready;
+	};
+
+	std::vector<Slot> slots_;
+	unsigned int next_slot_;
+	unsigned int oldest_slot_;
+	unsigned int pending_;
+	unsigned long long captures_;
+
+	// Map the oldest pending slot and hand it to its callback, waiting for its fence if wait is set
+	bool Complete(bool wait);
+
+public:
+	// ring_size is how many captures can be in flight, 3 covers the usual 2 frames of driver latency
+	explicit AsyncReadback(unsigned int ring_size = 3);
+	~AsyncReadback();
+
+	AsyncReadback(const AsyncReadback&) = delete;
+	AsyncReadback& operator=(const AsyncReadback&) = delete;
+
+	// Queue a read of a rectangle of the bound read framebuffer. When every slot is still in flight the
+	// oldest one is waited for, so no capture is ever dropped (make the ring bigger if that shows up in profiles).
+	// An empty rectangle is ignored, its callback never runs.
+	void Capture(int x, int y, unsigned int width, unsigned int height, ReadyFunction ready,
+		unsigned int format = 0x1908 /* GL_RGBA */, unsigned int type = 0x1401 /* GL_UNSIGNED_BYTE */);
+
+	// Once per frame, hands out every capture the GPU has finished without blocking
+	void Poll();
+
+	// Wait for and hand out every capture still in flight, e.g. before shutting down
+	void Flush();
+
+	inline unsigned int GetPendingCount() const { return pending_; }
+};
@@ -0,0 +1,104 @@
+#include "BindlessTextureTable.h"
+#include "GLCapabilities.h"
+#include "Renderer.h"
+
+#include <GL/glew.h>
+
+bool BindlessTextureTable::IsSupported()
+{
+	return GLCapabilities::Get().bindless_texture;
+}
+
+BindlessTextureTable::BindlessTextureTable(DeletionQueue& deletion_queue, unsigned int capacity)
+	: deletion_queue_(deletion_queue), target_(GLCapabilities::Get().shader_storage_buffer ? GL_SHADER_STORAGE_BUFFER : GL_UNIFORM_BUFFER),
+	binding_(-1), dirty_(false)
+{
+	ASSERT(IsSupported());
+
+	handles_.reserve(capacity);
+	buffer_ = std::make_unique<ShaderBuffer>(nullptr, (int)(capacity * sizeof(uint64_t)));
+}
+
+BindlessTextureTable::~BindlessTextureTable()
+{
+	for (uint64_t handle : handles_)
+	{
+		if (handle)
+		{
+			GLCALL(glMakeTextureHandleNonResidentARB(handle));
+		}
+	}
+	buffer_->Release(deletion_queue_);
+}
+
+unsigned int BindlessTextureTable::Add(unsigned int texture)
+{
+	// making a handle resident twice is an error, the second material just shares the index
+	std::unordered_map<unsigned int, unsigned int>::const_iterator found = index_of_texture_.find(texture);
+	if (found != index_of_texture_.end())
+	{
+		references_[found->second]++;
+		return found->second;
+	}
+
+	GLCALL(GLuint64 handle = glGetTextureHandleARB(texture));
+	GLCALL(glMakeTextureHandleResidentARB(handle));
+
+	unsigned int index;
+	if (!free_indices_.empty())
+	{
+		index = free_indices_.back();
+		free_indices_.pop_back();
+		handles_[index] = handle;
+		textures_[index] = texture;
+		references_[index] = 1;
+	}
+	else
+	{
+		index = (unsigned int)handles_.size();
+		handles_.push_back(handle);
+		textures_.push_back(texture);
+		references_.push_back(1);
+	}
+	index_of_texture_[texture] = index;
+	dirty_ = true;
+	return index;
+}
+
+void BindlessTextureTable::Remove(unsigned int index)
+{
+	ASSERT(index < handles_.size() && handles_[index] != 0);
+
+	if (--references_[index] > 0)
+		return;
+	GLCALL(glMakeTextureHandleNonResidentARB(handles_[index]));
+	index_of_texture_.erase(textures_[index]);
+	handles_[index] = 0;
+	textures_[index] = 0;
+	free_indices_.push_back(index);
+	dirty_ = true;
+}
+
+void BindlessTextureTable::Upload()
+{
+	if (!dirty_)
+		return;
+
+	int size = (int)(handles_.size() * sizeof(uint64_t));
+	if (size > buffer_->GetSize())
+	{
+		// the binding still points at the old buffer
+		buffer_->Resize(size * 2, deletion_queue_);
+		if (binding_ >= 0)
+			buffer_->BindBase(target_, binding_);
+	}
+	if (size > 0)
+		buffer_->SubData(0, handles_.data(), size);
+	dirty_ = false;
+}
+
+void BindlessTextureTable::Bind(unsigned int binding)
+{
+	binding_ = (int)binding;
+	buffer_->BindBase(target_, binding);
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "DeletionQueue.h"
+#include "ShaderBuffer.h"
+
+// Resident ARB_bindless_texture handles stored in a buffer, so a material picks its texture by index
+// instead of by binding a texture unit. Shaders read the table like this:
+//
+//   #extension GL_ARB_bindless_texture : require
+//   layout(std430, binding = 0) readonly buffer TextureHandles { uvec2 handles[]; };   // storage buffer
+//   layout(std140, binding = 0) uniform TextureHandles { uvec4 handles[MAX / 2]; };   // uniform buffer
+//   sampler2D tex = sampler2D(handles[index]);                 // storage buffer
+//   sampler2D tex = sampler2D(handles[index / 2].xy or .zw);   // uniform buffer
+//
+// Both layouts have the handles back to back in memory, only the indexing differs.
+// Creating a handle freezes the sampling state of the texture, set filters/wrap modes before Add().
+class BindlessTextureTable
+{
+private:
+	std::vector<uint64_t> handles_;
+	std::vector<unsigned int> textures_;     // by index, the GL texture behind each handle
+	std::vector<unsigned int> references_;   // by index, Add calls not matched by a Remove yet
+	std::unordered_map<unsigned int, unsigned int> index_of_texture_;
+	std::vector<unsigned int> free_indices_;
+	std::unique_ptr<ShaderBuffer> buffer_;
+	DeletionQueue& deletion_queue_;
+	unsigned int target_;
+	int binding_;   // of the last Bind, -1 before the first
+	bool dirty_;
+
+public:
+	// capacity is a starting point, the buffer grows when more textures are added. Outgrown buffers go
+	// to deletion_queue, a draw already issued may still read them.
+	explicit BindlessTextureTable(DeletionQueue& deletion_queue, unsigned int capacity = 256);
+
+	// Makes every handle still in the table non-resident, the buffer goes to the deletion queue
+	~BindlessTextureTable();
+
+	BindlessTextureTable(const BindlessTextureTable&) = delete;
+	BindlessTextureTable& operator=(const BindlessTextureTable&) = delete;
+
+	// Make the texture resident and give back its index in the table. A texture already in the table
+	// (two materials sharing it) gets its index back and one more reference.
+	unsigned int Add(unsigned int texture);
+
+	// Drop a reference to the texture at index, with the last one it becomes non-resident and the index gets reused
+	void Remove(unsigned int index);
+
+	// Push the table to the GPU if it changed, call once per frame before drawing. When the buffer had to
+	// grow the new one is bound to the binding of the last Bind.
+	void Upload();
+
+	// Bind the table to a storage buffer binding when the context has them, otherwise to a uniform block binding
+	void Bind(unsigned int binding);
+
+	// GL_SHADER_STORAGE_BUFFER or GL_UNIFORM_BUFFER, whichever the shader has to declare
+	inline unsigned int GetTarget() const { return target_; }
+
+	static bool IsSupported();
+};
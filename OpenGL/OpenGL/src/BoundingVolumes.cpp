@@ -0,0 +1,99 @@
+#include "BoundingVolumes.h"
+#include "Renderer.h"
+
+#include <cmath>
+
+BoundingVolumes::BoundingVolumes()
+	: count_(0)
+{
+}
+
+void BoundingVolumes::Resize(unsigned int count)
+{
+	// the padding is zero sized at the origin, it's never reported because the culler masks it out
+	unsigned int padded = (count + BATCH - 1) / BATCH * BATCH;
+	center_x_.resize(padded, 0.0f);
+	center_y_.resize(padded, 0.0f);
+	center_z_.resize(padded, 0.0f);
+	extent_x_.resize(padded, 0.0f);
+	extent_y_.resize(padded, 0.0f);
+	extent_z_.resize(padded, 0.0f);
+	radius_.resize(padded, 0.0f);
+	count_ = count;
+}
+
+unsigned int BoundingVolumes::Add(const BoundingBox& box)
+{
+	// the sphere around the box, never tighter than the box itself so the box decides
+	float radius = std::sqrt(box.extents[0] * box.extents[0] + box.extents[1] * box.extents[1] + box.extents[2] * box.extents[2]);
+	return Add(box, radius);
+}
+
+unsigned int BoundingVolumes::Add(const BoundingSphere& sphere)
+{
+	BoundingBox box = { { sphere.center[0], sphere.center[1], sphere.center[2] }, { sphere.radius, sphere.radius, sphere.radius } };
+	return Add(box, sphere.radius);
+}
+
+unsigned int BoundingVolumes::Add(const BoundingBox& box, float radius)
+{
+	unsigned int index = count_;
+	Resize(count_ + 1);
+	Set(index, box, radius);
+	return index;
+}
+
+void BoundingVolumes::Set(unsigned int index, const BoundingBox& box)
+{
+	float radius = std::sqrt(box.extents[0] * box.extents[0] + box.extents[1] * box.extents[1] + box.extents[2] * box.extents[2]);
+	Set(index, box, radius);
+}
+
+void BoundingVolumes::Set(unsigned int index, const BoundingSphere& sphere)
+{
+	BoundingBox box = { { sphere.center[0], sphere.center[1], sphere.center[2] }, { sphere.radius, sphere.radius, sphere.radius } };
+	Set(index, box, sphere.radius);
+}
+
+void BoundingVolumes::Set(unsigned int index, const BoundingBox& box, float radius)
+{
+	ASSERT(index < count_);
+	center_x_[index] = box.center[0];
+	center_y_[index] = box.center[1];
+	center_z_[index] = box.center[2];
+	extent_x_[index] = box.extents[0];
+	extent_y_[index] = box.extents[1];
+	extent_z_[index] = box.extents[2];
+	radius_[index] = radius;
+}
+
+void BoundingVolumes::RemoveSwap(unsigned int index)
+{
+	ASSERT(index < count_);
+	unsigned int last = count_ - 1;
+	center_x_[index] = center_x_[last];
+	center_y_[index] = center_y_[last];
+	center_z_[index] = center_z_[last];
+	extent_x_[index] = extent_x_[last];
+	extent_y_[index] = extent_y_[last];
+	extent_z_[index] = extent_z_[last];
+	radius_[index] = radius_[last];
+
+	// the freed slot becomes padding again
+	center_x_[last] = center_y_[last] = center_z_[last] = 0.0f;
+	extent_x_[last] = extent_y_[last] = extent_z_[last] = 0.0f;
+	radius_[last] = 0.0f;
+	Resize(last);
+}
+
+void BoundingVolumes::Clear()
+{
+	center_x_.clear();
+	center_y_.clear();
+	center_z_.clear();
+	extent_x_.clear();
+	extent_y_.clear();
+	extent_z_.clear();
+	radius_.clear();
+	count_ = 0;
+}
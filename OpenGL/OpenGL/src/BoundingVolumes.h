@@ -0,0 +1,66 @@
+#pragma once
+
+#include <vector>
+
+struct BoundingBox
+{
+	float center[3];
+	float extents[3];   // half size along each axis
+};
+
+struct BoundingSphere
+{
+	float center[3];
+	float radius;
+};
+
+// Bounds of every renderable, one array per component (structure of arrays) so a SIMD register loads the
+// same component of several objects at once. Every object has a box and a sphere around the same center,
+// the culler tests both and keeps the tighter answer. Arrays are padded to a multiple of BATCH with empty
+// bounds so the SIMD loops never need a scalar tail.
+class BoundingVolumes
+{
+private:
+	std::vector<float> center_x_;
+	std::vector<float> center_y_;
+	std::vector<float> center_z_;
+	std::vector<float> extent_x_;
+	std::vector<float> extent_y_;
+	std::vector<float> extent_z_;
+	std::vector<float> radius_;
+	unsigned int count_;
+
+	void Resize(unsigned int count);
+
+public:
+	// widest SIMD batch the culler processes, 8 floats of AVX
+	static constexpr unsigned int BATCH = 8;
+
+	BoundingVolumes();
+
+	// Index of the new object, indices stay the same until Clear or RemoveSwap
+	unsigned int Add(const BoundingBox& box);
+	unsigned int Add(const BoundingSphere& sphere);
+	unsigned int Add(const BoundingBox& box, float radius);
+
+	void Set(unsigned int index, const BoundingBox& box);
+	void Set(unsigned int index, const BoundingSphere& sphere);
+	void Set(unsigned int index, const BoundingBox& box, float radius);
+
+	// Remove index by moving the last object into its place
+	void RemoveSwap(unsigned int index);
+
+	void Clear();
+
+	inline unsigned int GetCount() const { return count_; }
+	// count rounded up to BATCH, how far the arrays can be read
+	inline unsigned int GetPaddedCount() const { return (unsigned int)radius_.size(); }
+
+	inline const float* GetCenterX() const { return center_x_.data(); }
+	inline const float* GetCenterY() const { return center_y_.data(); }
+	inline const float* GetCenterZ() const { return center_z_.data(); }
+	inline const float* GetExtentX() const { return extent_x_.data(); }
+	inline const float* GetExtentY() const { return extent_y_.data(); }
+	inline const float* GetExtentZ() const { return extent_z_.data(); }
+	inline const float* GetRadius() const { return radius_.data(); }
+};
@@ -0,0 +1,483 @@
+#include "Bvh.h"
+#include "Renderer.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cfloat>
+
+// candidate split positions per axis, the centroids are sorted into this many buckets instead of sorted
+static constexpr unsigned int SAH_BINS = 16;
+// cost of visiting a node relative to testing an object
+static constexpr float TRAVERSAL_COST = 1.0f;
+// the tree is never deeper than this, so the queries' fixed size stacks can't overflow
+static constexpr unsigned int MAX_DEPTH = 64;
+static constexpr unsigned int STACK_SIZE = MAX_DEPTH + 1;
+
+BvhBounds BvhBounds::Empty()
+{
+	return { { FLT_MAX, FLT_MAX, FLT_MAX }, { -FLT_MAX, -FLT_MAX, -FLT_MAX } };
+}
+
+BvhBounds BvhBounds::FromBox(const BoundingBox& box)
+{
+	BvhBounds bounds;
+	for (unsigned int i = 0; i < 3; i++)
+	{
+		bounds.min[i] = box.center[i] - box.extents[i];
+		bounds.max[i] = box.center[i] + box.extents[i];
+	}
+	return bounds;
+}
+
+void BvhBounds::Grow(const BvhBounds& other)
+{
+	for (unsigned int i = 0; i < 3; i++)
+	{
+		min[i] = std::min(min[i], other.min[i]);
+		max[i] = std::max(max[i], other.max[i]);
+	}
+}
+
+float BvhBounds::GetSurfaceArea() const
+{
+	float x = max[0] - min[0];
+	float y = max[1] - min[1];
+	float z = max[2] - min[2];
+	if (x < 0.0f || y < 0.0f || z < 0.0f)
+		return 0.0f;
+	return 2.0f * (x * y + y * z + z * x);
+}
+
+bool BvhBounds::Overlaps(const BvhBounds& other) const
+{
+	return min[0] <= other.max[0] && max[0] >= other.min[0] &&
+		min[1] <= other.max[1] && max[1] >= other.min[1] &&
+		min[2] <= other.max[2] && max[2] >= other.min[2];
+}
+
+static BvhBounds NodeBounds(const BvhNode& node)
+{
+	return { { node.min[0], node.min[1], node.min[2] }, { node.max[0], node.max[1], node.max[2] } };
+}
+
+static void SetNodeBounds(BvhNode& node, const BvhBounds& bounds)
+{
+	for (unsigned int i = 0; i < 3; i++)
+	{
+		node.min[i] = bounds.min[i];
+		node.max[i] = bounds.max[i];
+	}
+}
+
+void Bvh::Clear()
+{
+	nodes_.clear();
+	items_.clear();
+	item_bounds_.clear();
+}
+
+void Bvh::Build(const BoundingVolumes& bounds, ThreadPool* pool)
+{
+	Clear();
+	unsigned int count = bounds.GetCount();
+	if (count == 0)
+		return;
+
+	items_.resize(count);
+	item_bounds_.resize(count);
+	centroids_.resize(count * 3);
+	for (unsigned int i = 0; i < count; i++)
+	{
+		BoundingBox box = { { bounds.GetCenterX()[i], bounds.GetCenterY()[i], bounds.GetCenterZ()[i] },
+			{ bounds.GetExtentX()[i], bounds.GetExtentY()[i], bounds.GetExtentZ()[i] } };
+		items_[i] = i;
+		item_bounds_[i] = BvhBounds::FromBox(box);
+		centroids_[i * 3 + 0] = box.center[0];
+		centroids_[i * 3 + 1] = box.center[1];
+		centroids_[i * 3 + 2] = box.center[2];
+	}
+
+	// with one object per leaf a binary tree has 2 * count - 1 nodes, it never gets bigger than that
+	nodes_.reserve(2 * count - 1);
+	BuildNode(0, count, 0, nodes_, pool);
+
+	centroids_.clear();
+	centroids_.shrink_to_fit();
+}
+
+bool Bvh::FindSplit(unsigned int first, unsigned int count, const BvhBounds& bounds, unsigned int& best_axis, float& best_position) const
+{
+	// the centroids decide which side an object goes to, so the bins span the centroids, not the boxes
+	BvhBounds centroid_bounds = BvhBounds::Empty();
+	for (unsigned int i = first; i < first + count; i++)
+	{
+		const float* centroid = &centroids_[items_[i] * 3];
+		BvhBounds point = { { centroid[0], centroid[1], centroid[2] }, { centroid[0], centroid[1], centroid[2] } };
+		centroid_bounds.Grow(point);
+	}
+
+	// cost of not splitting: every object gets tested
+	float best_cost = bounds.GetSurfaceArea() * count;
+	bool found = false;
+
+	for (unsigned int axis = 0; axis < 3; axis++)
+	{
+		float low = centroid_bounds.min[axis];
+		float extent = centroid_bounds.max[axis] - low;
+		if (extent <= 0.0f)
+			continue;
+
+		BvhBounds bin_bounds[SAH_BINS];
+		unsigned int bin_counts[SAH_BINS] = {};
+		for (unsigned int bin = 0; bin < SAH_BINS; bin++)
+			bin_bounds[bin] = BvhBounds::Empty();
+
+		float scale = SAH_BINS / extent;
+		for (unsigned int i = first; i < first + count; i++)
+		{
+			unsigned int item = items_[i];
+			unsigned int bin = std::min(SAH_BINS - 1, (unsigned int)((centroids_[item * 3 + axis] - low) * scale));
+			bin_bounds[bin].Grow(item_bounds_[item]);
+			bin_counts[bin]++;
+		}
+
+		// sweep from the right once to know what is right of every plane, then from the left to price them
+		float right_areas[SAH_BINS];
+		unsigned int right_counts[SAH_BINS];
+		BvhBounds right = BvhBounds::Empty();
+		unsigned int right_count = 0;
+		for (unsigned int bin = SAH_BINS - 1; bin > 0; bin--)
+		{
+			right.Grow(bin_bounds[bin]);
+			right_count += bin_counts[bin];
+			right_areas[bin] = right.GetSurfaceArea();
+			right_counts[bin] = right_count;
+		}
+
+		BvhBounds left = BvhBounds::Empty();
+		unsigned int left_count = 0;
+		for (unsigned int plane = 1; plane < SAH_BINS; plane++)
+		{
+			left.Grow(bin_bounds[plane - 1]);
+			left_count += bin_counts[plane - 1];
+			if (left_count == 0 || right_counts[plane] == 0)
+				continue;
+
+			float cost = TRAVERSAL_COST * bounds.GetSurfaceArea() + left.GetSurfaceArea() * left_count + right_areas[plane] * right_counts[plane];
+			if (cost < best_cost)
+			{
+				best_cost = cost;
+				best_axis = axis;
+				best_position = low + plane / scale;
+				found = true;
+			}
+		}
+	}
+	return found;
+}
+
+void Bvh::BuildNode(unsigned int first, unsigned int count, unsigned int depth, std::vector<BvhNode>& nodes, ThreadPool* pool)
+{
+	BvhBounds bounds = BvhBounds::Empty();
+	for (unsigned int i = first; i < first + count; i++)
+		bounds.Grow(item_bounds_[items_[i]]);
+
+	unsigned int index = (unsigned int)nodes.size();
+	nodes.push_back(BvhNode());
+	SetNodeBounds(nodes[index], bounds);
+
+	unsigned int axis = 0;
+	float position = 0.0f;
+	unsigned int left_count = 0;
+	if (count > 1 && depth < MAX_DEPTH - 1)
+	{
+		if (FindSplit(first, count, bounds, axis, position))
+		{
+			unsigned int* middle = std::partition(&items_[first], &items_[first] + count,
+				[&](unsigned int item) { return centroids_[item * 3 + axis] < position; });
+			left_count = (unsigned int)(middle - &items_[first]);
+
+			// float rounding can put every centroid on one side of the plane the bins chose, split at the median
+			if (left_count == 0 || left_count == count)
+			{
+				std::nth_element(&items_[first], &items_[first] + count / 2, &items_[first] + count,
+					[&](unsigned int a, unsigned int b) { return centroids_[a * 3 + axis] < centroids_[b * 3 + axis]; });
+				left_count = count / 2;
+			}
+		}
+		else if (count > MAX_LEAF_ITEMS)
+		{
+			// a leaf would be cheaper but too big, or every centroid is in the same spot: halve the list
+			left_count = count / 2;
+		}
+	}
+
+	if (left_count == 0 || left_count == count)
+	{
+		nodes[index].right_or_first = first;
+		nodes[index].count = count;
+		return;
+	}
+
+	unsigned int right_count = count - left_count;
+	nodes[index].count = 0;
+
+	if (!pool || count < PARALLEL_BUILD_ITEMS)
+	{
+		BuildNode(first, left_count, depth + 1, nodes, pool);
+		nodes[index].right_or_first = (unsigned int)nodes.size();
+		BuildNode(first + left_count, right_count, depth + 1, nodes, pool);
+		return;
+	}
+
+	// the two halves own disjoint parts of items_, so they can be built at the same time into their own
+	// node lists, which are then appended in depth first order with their child indices moved along
+	std::vector<BvhNode> subtrees[2];
+	pool->ParallelFor(2, 1, [&](size_t begin, size_t end)
+	{
+		for (size_t side = begin; side < end; side++)
+		{
+			if (side == 0)
+				BuildNode(first, left_count, depth + 1, subtrees[0], pool);
+			else
+				BuildNode(first + left_count, right_count, depth + 1, subtrees[1], pool);
+		}
+	});
+
+	for (unsigned int side = 0; side < 2; side++)
+	{
+		unsigned int base = (unsigned int)nodes.size();
+		if (side == 1)
+			nodes[index].right_or_first = base;
+		for (BvhNode node : subtrees[side])
+		{
+			if (!node.IsLeaf())
+				node.right_or_first += base;
+			nodes.push_back(node);
+		}
+	}
+}
+
+void Bvh::Refit(const BoundingVolumes& bounds)
+{
+	ASSERT(bounds.GetCount() == item_bounds_.size());
+	for (unsigned int i = 0; i < bounds.GetCount(); i++)
+	{
+		BoundingBox box = { { bounds.GetCenterX()[i], bounds.GetCenterY()[i], bounds.GetCenterZ()[i] },
+			{ bounds.GetExtentX()[i], bounds.GetExtentY()[i], bounds.GetExtentZ()[i] } };
+		item_bounds_[i] = BvhBounds::FromBox(box);
+	}
+
+	// children come after their parent, walking backwards visits them first
+	for (unsigned int index = (unsigned int)nodes_.size(); index-- > 0;)
+	{
+		BvhNode& node = nodes_[index];
+		BvhBounds node_bounds = BvhBounds::Empty();
+		if (node.IsLeaf())
+		{
+			for (unsigned int i = node.right_or_first; i < node.right_or_first + node.count; i++)
+				node_bounds.Grow(item_bounds_[items_[i]]);
+		}
+		else
+		{
+			node_bounds = NodeBounds(nodes_[index + 1]);
+			node_bounds.Grow(NodeBounds(nodes_[node.right_or_first]));
+		}
+		SetNodeBounds(node, node_bounds);
+	}
+}
+
+void Bvh::CollectSubtree(unsigned int node, std::vector<unsigned int>& items) const
+{
+	// leaves of a subtree are next to each other in items_, the first and the last leaf give the range
+	unsigned int first_leaf = node;
+	while (!nodes_[first_leaf].IsLeaf())
+		first_leaf++;
+	unsigned int last_leaf = node;
+	while (!nodes_[last_leaf].IsLeaf())
+		last_leaf = nodes_[last_leaf].right_or_first;
+
+	unsigned int begin = nodes_[first_leaf].right_or_first;
+	unsigned int end = nodes_[last_leaf].right_or_first + nodes_[last_leaf].count;
+	items.insert(items.end(), items_.begin() + begin, items_.begin() + end);
+}
+
+// Which planes the box is still partly outside of, with bit p set for each of plane_mask's planes it
+// crosses. Returns false when the box is completely outside one of them.
+static bool ClassifyBox(const Frustum& frustum, const float* min, const float* max, unsigned int& plane_mask)
+{
+	unsigned int crossing = 0;
+	for (unsigned int plane = 0; plane < Frustum::PLANE_COUNT; plane++)
+	{
+		if (!(plane_mask & (1u << plane)))
+			continue;
+
+		// the corner furthest along the normal, and the one furthest against it
+		const float* p = frustum.planes[plane];
+		float far_distance = p[3], near_distance = p[3];
+		for (unsigned int i = 0; i < 3; i++)
+		{
+			far_distance += p[i] * (p[i] >= 0.0f ? max[i] : min[i]);
+			near_distance += p[i] * (p[i] >= 0.0f ? min[i] : max[i]);
+		}
+		if (far_distance < 0.0f)
+			return false;
+		if (near_distance < 0.0f)
+			crossing |= 1u << plane;
+	}
+	plane_mask = crossing;
+	return true;
+}
+
+void Bvh::QueryFrustum(const Frustum& frustum, std::vector<unsigned int>& items) const
+{
+	if (nodes_.empty())
+		return;
+
+	// every entry carries the planes its parent wasn't completely inside of, the others needn't be tested again
+	struct Entry
+	{
+		unsigned int node;
+		unsigned int plane_mask;
+	};
+	Entry stack[STACK_SIZE];
+	unsigned int stack_size = 0;
+	stack[stack_size++] = { 0, (1u << Frustum::PLANE_COUNT) - 1 };
+
+	while (stack_size)
+	{
+		Entry entry = stack[--stack_size];
+		const BvhNode& node = nodes_[entry.node];
+		if (!ClassifyBox(frustum, node.min, node.max, entry.plane_mask))
+			continue;
+
+		if (entry.plane_mask == 0)
+		{
+			CollectSubtree(entry.node, items);
+			continue;
+		}
+
+		if (node.IsLeaf())
+		{
+			for (unsigned int i = node.right_or_first; i < node.right_or_first + node.count; i++)
+			{
+				unsigned int item = items_[i];
+				unsigned int plane_mask = entry.plane_mask;
+				if (ClassifyBox(frustum, item_bounds_[item].min, item_bounds_[item].max, plane_mask))
+					items.push_back(item);
+			}
+			continue;
+		}
+
+		stack[stack_size++] = { node.right_or_first, entry.plane_mask };
+		stack[stack_size++] = { entry.node + 1, entry.plane_mask };
+	}
+}
+
+void Bvh::QueryBox(const BoundingBox& box, std::vector<unsigned int>& items) const
+{
+	if (nodes_.empty())
+		return;
+
+	BvhBounds query = BvhBounds::FromBox(box);
+	unsigned int stack[STACK_SIZE];
+	unsigned int stack_size = 0;
+	stack[stack_size++] = 0;
+
+	while (stack_size)
+	{
+		unsigned int index = stack[--stack_size];
+		const BvhNode& node = nodes_[index];
+		if (!query.Overlaps(NodeBounds(node)))
+			continue;
+
+		if (node.IsLeaf())
+		{
+			for (unsigned int i = node.right_or_first; i < node.right_or_first + node.count; i++)
+			{
+				if (query.Overlaps(item_bounds_[items_[i]]))
+					items.push_back(items_[i]);
+			}
+			continue;
+		}
+
+		stack[stack_size++] = node.right_or_first;
+		stack[stack_size++] = index + 1;
+	}
+}
+
+// Distance along the ray to where it enters the box (slab test), FLT_MAX if it misses it or enters after max_distance
+static float IntersectRay(const float* origin, const float* inverse_direction, float max_distance, const float* min, const float* max)
+{
+	float enter = 0.0f;
+	float exit = max_distance;
+	for (unsigned int i = 0; i < 3; i++)
+	{
+		float t0 = (min[i] - origin[i]) * inverse_direction[i];
+		float t1 = (max[i] - origin[i]) * inverse_direction[i];
+		if (t0 > t1)
+			std::swap(t0, t1);
+		enter = std::max(enter, t0);
+		exit = std::min(exit, t1);
+	}
+	return enter <= exit ? enter : FLT_MAX;
+}
+
+bool Bvh::Raycast(const float* origin, const float* direction, float max_distance, BvhHit& hit) const
+{
+	if (nodes_.empty())
+		return false;
+
+	// a huge inverse for a zero component, the ray is then either inside that slab all along or never
+	float inverse_direction[3];
+	for (unsigned int i = 0; i < 3; i++)
+		inverse_direction[i] = direction[i] != 0.0f ? 1.0f / direction[i] : FLT_MAX;
+
+	hit.item = 0;
+	hit.distance = max_distance;
+	bool found = false;
+
+	unsigned int stack[STACK_SIZE];
+	unsigned int stack_size = 0;
+	if (IntersectRay(origin, inverse_direction, hit.distance, nodes_[0].min, nodes_[0].max) != FLT_MAX)
+		stack[stack_size++] = 0;
+
+	while (stack_size)
+	{
+		unsigned int index = stack[--stack_size];
+		const BvhNode& node = nodes_[index];
+
+		if (node.IsLeaf())
+		{
+			for (unsigned int i = node.right_or_first; i < node.right_or_first + node.count; i++)
+			{
+				unsigned int item = items_[i];
+				float distance = IntersectRay(origin, inverse_direction, hit.distance, item_bounds_[item].min, item_bounds_[item].max);
+				if (distance != FLT_MAX && (!found || distance < hit.distance))
+				{
+					hit.item = item;
+					hit.distance = distance;
+					found = true;
+				}
+			}
+			continue;
+		}
+
+		// nearer child last so it is visited first, a hit there shrinks the ray for the other one
+		unsigned int children[2] = { index + 1, node.right_or_first };
+		float distances[2];
+		for (unsigned int i = 0; i < 2; i++)
+			distances[i] = IntersectRay(origin, inverse_direction, hit.distance, nodes_[children[i]].min, nodes_[children[i]].max);
+		if (distances[0] < distances[1])
+		{
+			std::swap(children[0], children[1]);
+			std::swap(distances[0], distances[1]);
+		}
+		for (unsigned int i = 0; i < 2; i++)
+		{
+			if (distances[i] != FLT_MAX)
+				stack[stack_size++] = children[i];
+		}
+	}
+	return found;
+}
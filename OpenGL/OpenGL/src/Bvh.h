@@ -0,0 +1,88 @@
+#pragma once
+
+#include <vector>
+
+#include "BoundingVolumes.h"
+#include "Frustum.h"
+
+class ThreadPool;
+
+struct BvhBounds
+{
+	float min[3];
+	float max[3];
+
+	static BvhBounds Empty();
+	static BvhBounds FromBox(const BoundingBox& box);
+
+	void Grow(const BvhBounds& other);
+	float GetSurfaceArea() const;
+	bool Overlaps(const BvhBounds& other) const;
+};
+
+// 32 bytes, two nodes to a cache line. Nodes are stored depth first, so the left child of an interior node is
+// the node right after it and only the right one needs an index.
+struct BvhNode
+{
+	float min[3];
+	unsigned int right_or_first;   // interior: index of the right child, leaf: first entry in the item list
+	float max[3];
+	unsigned int count;            // leaf: number of items, 0 for interior nodes
+
+	inline bool IsLeaf() const { return count != 0; }
+};
+
+struct BvhHit
+{
+	unsigned int item;
+	float distance;   // along the ray, in units of its direction
+};
+
+// Bounding volume hierarchy over the boxes of a BoundingVolumes, for scenes where most objects don't move.
+// Built top down with the surface area heuristic over binned centroids, the upper levels in parallel on a
+// ThreadPool. Queries walk the tree and drop whole subtrees whose box misses, so they cost about the log of
+// the object count instead of touching every object. Objects that move a little are handled with Refit,
+// which keeps the tree and only recomputes the boxes; after big changes it's better to build again.
+class Bvh
+{
+private:
+	std::vector<BvhNode> nodes_;
+	std::vector<unsigned int> items_;      // object indices, every leaf owns a contiguous range
+	std::vector<BvhBounds> item_bounds_;   // by object index
+	std::vector<float> centroids_;         // x, y, z per object, only during a build
+
+	// Append the subtree over items_[first, first + count) to nodes, depth first
+	void BuildNode(unsigned int first, unsigned int count, unsigned int depth, std::vector<BvhNode>& nodes, ThreadPool* pool);
+
+	// Split axis and position of the cheapest split, false if keeping a leaf is cheaper
+	bool FindSplit(unsigned int first, unsigned int count, const BvhBounds& bounds, unsigned int& axis, float& position) const;
+
+	void CollectSubtree(unsigned int node, std::vector<unsigned int>& items) const;
+
+public:
+	static constexpr unsigned int MAX_LEAF_ITEMS = 4;
+	// subtrees with more objects than this are split among threads while building
+	static constexpr unsigned int PARALLEL_BUILD_ITEMS = 8192;
+
+	// Build over every object of bounds, replacing the old tree
+	void Build(const BoundingVolumes& bounds, ThreadPool* pool = nullptr);
+
+	// Take the new boxes of the same objects and fix the node boxes bottom up, the tree shape stays
+	void Refit(const BoundingVolumes& bounds);
+
+	void Clear();
+
+	// Objects whose box is at least partly inside frustum, in no particular order. Subtrees completely inside
+	// are taken without testing them any further.
+	void QueryFrustum(const Frustum& frustum, std::vector<unsigned int>& items) const;
+
+	// Objects whose box overlaps box
+	void QueryBox(const BoundingBox& box, std::vector<unsigned int>& items) const;
+
+	// Closest object box hit by the ray within max_distance, for picking. false if there is none.
+	bool Raycast(const float* origin, const float* direction, float max_distance, BvhHit& hit) const;
+
+	inline bool IsEmpty() const { return nodes_.empty(); }
+	inline unsigned int GetNodeCount() const { return (unsigned int)nodes_.size(); }
+	inline const std::vector<BvhNode>& GetNodes() const { return nodes_; }
+};
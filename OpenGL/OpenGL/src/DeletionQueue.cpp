@@ -0,0 +1,129 @@
+#include "DeletionQueue.h"
+#include "GLStateCache.h"
+#include "Renderer.h"
+
+#include <GL/glew.h>
+#include <iostream>
+
+DeletionQueue::DeletionQueue()
+	: current_(), frame_(0)
+{
+}
+
+DeletionQueue::~DeletionQueue()
+{
+	Flush();
+}
+
+void DeletionQueue::Delete(GLObjectType type, unsigned int name)
+{
+	if (name != 0)
+		current_.names[(size_t)type].push_back(name);
+}
+
+void DeletionQueue::DeleteNames(Batch& batch)
+{
+	if (batch.fence)
+		glDeleteSync(batch.fence);
+	batch.fence = nullptr;
+
+	for (size_t type = 0; type < batch.names.size(); type++)
+	{
+		std::vector<unsigned int>& names = batch.names[type];
+		if (names.empty())
+			continue;
+
+		GLsizei count = (GLsizei)names.size();
+		switch ((GLObjectType)type)
+		{
+		case GLObjectType::BUFFER:
+			GLCALL(glDeleteBuffers(count, names.data()));
+			break;
+		case GLObjectType::VERTEX_ARRAY:
+			GLCALL(glDeleteVertexArrays(count, names.data()));
+			break;
+		case GLObjectType::PROGRAM:
+			// the only one without a batch version
+			for (unsigned int name : names)
+			{
+				GLCALL(glDeleteProgram(name));
+			}
+			break;
+		case GLObjectType::TEXTURE:
+			for (unsigned int name : names)
+				GLStateCache::ForgetTexture(name);
+			GLCALL(glDeleteTextures(count, names.data()));
+			break;
+		case GLObjectType::FRAMEBUFFER:
+			GLCALL(glDeleteFramebuffers(count, names.data()));
+			break;
+		case GLObjectType::RENDERBUFFER:
+			GLCALL(glDeleteRenderbuffers(count, names.data()));
+			break;
+		default:
+			ASSERT(false);
+		}
+		names.clear();
+	}
+}
+
+void DeletionQueue::EndFrame()
+{
+	bool empty = true;
+	for (const std::vector<unsigned int>& names : current_.names)
+		empty = empty && names.empty();
+
+	if (!empty)
+	{
+		GLCALL(current_.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+		current_.frame = frame_;
+		pending_.push_back(std::move(current_));
+		current_ = Batch();
+	}
+
+	Collect();
+	frame_++;
+}
+
+void DeletionQueue::Collect()
+{
+	// frames finish in order, the first one that isn't done means none after it is either
+	while (!pending_.empty())
+	{
+		Batch& batch = pending_.front();
+		GLenum state = batch.fence ? glClientWaitSync(batch.fence, 0, 0) : GL_WAIT_FAILED;
+		if (state == GL_WAIT_FAILED)
+		{
+			std::cerr << "Fence of the objects deleted in frame " << batch.frame << " can't be waited on, finishing the GPU before deleting them" << std::endl;
+			GLClearErrors();
+			GLCALL(glFinish());
+		}
+		else if (state != GL_ALREADY_SIGNALED && state != GL_CONDITION_SATISFIED)
+		{
+			break;
+		}
+		DeleteNames(batch);
+		pending_.pop_front();
+	}
+}
+
+void DeletionQueue::Flush()
+{
+	for (Batch& batch : pending_)
+		DeleteNames(batch);
+	pending_.clear();
+	DeleteNames(current_);
+}
+
+unsigned int DeletionQueue::GetPendingCount() const
+{
+	size_t count = 0;
+	for (const std::vector<unsigned int>& names : current_.names)
+		count += names.size();
+	for (const Batch& batch : pending_)
+	{
+		for (const std::vector<unsigned int>& names : batch.names)
+			count += names.size();
+	}
+	return (unsigned int)count;
+}
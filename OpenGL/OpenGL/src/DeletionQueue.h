@@ -0,0 +1,68 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <deque>
+#include <vector>
+
+typedef struct __GLsync* GLsync;
+
+enum class GLObjectType
+{
+	BUFFER,
+	VERTEX_ARRAY,
+	PROGRAM,
+	TEXTURE,
+	FRAMEBUFFER,
+	RENDERBUFFER,
+	COUNT
+};
+
+// GL objects the CPU side is done with but that commands still queued on the GPU may read. Deleting one of
+// those right away can make the driver wait for the GPU (or keep a shadow copy alive) in the middle of a frame,
+// so the names are only collected: EndFrame puts a fence behind everything queued during the frame, and once
+// that fence has signaled the whole frame's names go in one glDelete* call per type.
+class DeletionQueue
+{
+private:
+	struct Batch
+	{
+		GLsync fence;
+		unsigned long long frame;   // the frame it was queued in, for reporting a fence that failed
+		std::array<std::vector<unsigned int>, (size_t)GLObjectType::COUNT> names;
+	};
+
+	Batch current_;
+	std::deque<Batch> pending_;
+	unsigned long long frame_;
+
+	static void DeleteNames(Batch& batch);
+
+public:
+	DeletionQueue();
+
+	// Deletes whatever is still queued without waiting, the context is going away anyway
+	~DeletionQueue();
+
+	DeletionQueue(const DeletionQueue&) = delete;
+	DeletionQueue& operator=(const DeletionQueue&) = delete;
+
+	// Delete name once the GPU finished the current frame, 0 is ignored
+	void Delete(GLObjectType type, unsigned int name);
+
+	// Once per frame after the last command that could use the queued objects, fences the frame and
+	// deletes what earlier frames queued if the GPU is done with them
+	void EndFrame();
+
+	// Delete the frames whose fence signaled, never blocks. A fence that can't be waited on (GL_WAIT_FAILED)
+	// is reported and waited out with glFinish, otherwise it would hold up every later frame for good.
+	void Collect();
+
+	// Delete everything queued right now without waiting, for shutdown
+	void Flush();
+
+	// Names queued and not deleted yet
+	unsigned int GetPendingCount() const;
+
+	inline unsigned long long GetFrame() const { return frame_; }
+};
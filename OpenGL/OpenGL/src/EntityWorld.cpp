@@ -0,0 +1,196 @@
+#include "EntityWorld.h"
+
+#include <cstring>
+#include <mutex>
+
+struct ComponentInfo
+{
+	unsigned int size;
+	unsigned int alignment;
+};
+
+// shared by every world, component ids have to mean the same type everywhere
+static std::mutex component_mutex;
+static std::vector<ComponentInfo> component_infos;
+
+unsigned int EntityWorld::RegisterComponent(unsigned int size, unsigned int alignment)
+{
+	std::lock_guard<std::mutex> lock(component_mutex);
+	ASSERT(component_infos.size() < MAX_COMPONENT_TYPES);
+	component_infos.push_back({ size, alignment });
+	return (unsigned int)component_infos.size() - 1;
+}
+
+static unsigned int AlignUp(unsigned int value, unsigned int alignment)
+{
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+EntityWorld::EntityWorld()
+	: entity_count_(0)
+{
+}
+
+EntityWorld::~EntityWorld()
+{
+}
+
+unsigned int EntityWorld::GetArchetype(ComponentMask mask)
+{
+	auto found = archetype_of_mask_.find(mask);
+	if (found != archetype_of_mask_.end())
+		return found->second;
+
+	std::unique_ptr<Archetype> archetype = std::make_unique<Archetype>();
+	archetype->mask = mask;
+	std::memset(archetype->offsets, 0, sizeof(archetype->offsets));
+	std::memset(archetype->sizes, 0, sizeof(archetype->sizes));
+
+	std::vector<ComponentInfo> infos;
+	{
+		std::lock_guard<std::mutex> lock(component_mutex);
+		for (unsigned int id = 0; id < MAX_COMPONENT_TYPES; id++)
+		{
+			if (mask & (ComponentMask(1) << id))
+			{
+				archetype->components.push_back(id);
+				archetype->sizes[id] = component_infos[id].size;
+				infos.push_back(component_infos[id]);
+			}
+		}
+	}
+
+	// as many rows as fit, then fewer until the arrays still fit after padding each to its alignment
+	unsigned int row_size = sizeof(Entity);
+	for (const ComponentInfo& info : infos)
+		row_size += info.size;
+	unsigned int capacity = CHUNK_SIZE / row_size;
+	while (true)
+	{
+		unsigned int offset = capacity * sizeof(Entity);
+		for (unsigned int i = 0; i < infos.size(); i++)
+		{
+			offset = AlignUp(offset, infos[i].alignment);
+			archetype->offsets[archetype->components[i]] = offset;
+			offset += capacity * infos[i].size;
+		}
+		if (offset <= CHUNK_SIZE)
+			break;
+		capacity--;
+	}
+	ASSERT(capacity > 0);
+	archetype->capacity = capacity;
+
+	unsigned int index = (unsigned int)archetypes_.size();
+	archetypes_.push_back(std::move(archetype));
+	archetype_of_mask_[mask] = index;
+	return index;
+}
+
+EntityWorld::Location EntityWorld::AllocateRow(unsigned int archetype_index, Entity entity)
+{
+	Archetype& archetype = *archetypes_[archetype_index];
+	if (archetype.chunks.empty() || archetype.chunks.back()->count == archetype.capacity)
+	{
+		archetype.chunks.push_back(std::make_unique<Chunk>());
+		archetype.chunks.back()->count = 0;
+	}
+
+	Chunk& chunk = *archetype.chunks.back();
+	Location location = { archetype_index, (unsigned int)archetype.chunks.size() - 1, chunk.count++ };
+	GetEntities(chunk)[location.row] = entity;
+	return location;
+}
+
+void EntityWorld::FreeRow(const Location& location)
+{
+	Archetype& archetype = *archetypes_[location.archetype];
+	Chunk& last_chunk = *archetype.chunks.back();
+	unsigned int last_row = last_chunk.count - 1;
+	Chunk& chunk = *archetype.chunks[location.chunk];
+
+	// the last row of the archetype fills the hole, so the chunks stay packed
+	if (&chunk != &last_chunk || location.row != last_row)
+	{
+		Entity moved = GetEntities(last_chunk)[last_row];
+		GetEntities(chunk)[location.row] = moved;
+		for (unsigned int id : archetype.components)
+		{
+			unsigned int size = archetype.sizes[id];
+			std::memcpy(chunk.data + archetype.offsets[id] + location.row * size,
+				last_chunk.data + archetype.offsets[id] + last_row * size, size);
+		}
+		locations_[moved] = location;
+	}
+
+	// an empty chunk is dropped, the archetype keeps the rest of its memory for new rows
+	if (--last_chunk.count == 0)
+		archetype.chunks.pop_back();
+}
+
+void* EntityWorld::GetComponentData(const Location& location, unsigned int component) const
+{
+	const Archetype& archetype = *archetypes_[location.archetype];
+	Chunk& chunk = *archetype.chunks[location.chunk];
+	return chunk.data + archetype.offsets[component] + location.row * archetype.sizes[component];
+}
+
+void EntityWorld::MoveEntity(Entity entity, ComponentMask mask)
+{
+	Location from = locations_[entity];
+	unsigned int target = GetArchetype(mask);
+	Location to = AllocateRow(target, entity);
+
+	// the components both archetypes have come along, a new one is written by the caller
+	ComponentMask shared = archetypes_[from.archetype]->mask & mask;
+	for (unsigned int id : archetypes_[target]->components)
+	{
+		if (shared & (ComponentMask(1) << id))
+			std::memcpy(GetComponentData(to, id), GetComponentData(from, id), archetypes_[target]->sizes[id]);
+	}
+
+	FreeRow(from);
+	locations_[entity] = to;
+}
+
+EntityWorld::Entity EntityWorld::NewId()
+{
+	Entity entity;
+	if (!free_ids_.empty())
+	{
+		entity = free_ids_.back();
+		free_ids_.pop_back();
+	}
+	else
+	{
+		entity = (Entity)locations_.size();
+		locations_.push_back({});
+		alive_.push_back(false);
+	}
+	alive_[entity] = true;
+	entity_count_++;
+	return entity;
+}
+
+void EntityWorld::Destroy(Entity entity)
+{
+	ASSERT(IsAlive(entity));
+	FreeRow(locations_[entity]);
+	alive_[entity] = false;
+	free_ids_.push_back(entity);
+	entity_count_--;
+}
+
+void EntityWorld::CollectChunks(ComponentMask mask, std::vector<std::pair<const Archetype*, Chunk*>>& chunks) const
+{
+	for (const std::unique_ptr<Archetype>& archetype : archetypes_)
+	{
+		if ((archetype->mask & mask) != mask)
+			continue;
+		for (const std::unique_ptr<Chunk>& chunk : archetype->chunks)
+		{
+			if (chunk->count)
+				chunks.push_back({ archetype.get(), chunk.get() });
+		}
+	}
+}
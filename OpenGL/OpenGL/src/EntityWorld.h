@@ -0,0 +1,217 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <memory>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#include "Renderer.h"
+#include "ThreadPool.h"
+
+// Entities and their components, stored by archetype: all entities with exactly the same set of component
+// types share one archetype, which keeps them in 16KB chunks. Inside a chunk every component type has its
+// own array (structure of arrays), so a query touching two components of a million entities reads two
+// dense streams instead of chasing a million objects. Adding or removing a component moves the entity to
+// another archetype, which is a copy of its row; that's the price for iteration being a plain loop.
+// Components have to be trivially copyable (ids, matrices, bounds... not owners of GL objects), they are
+// moved around with memcpy. Don't create, destroy, add or remove while a ForEach is running.
+class EntityWorld
+{
+public:
+	typedef unsigned int Entity;
+	static constexpr Entity INVALID_ENTITY = 0xFFFFFFFF;
+
+	static constexpr unsigned int CHUNK_SIZE = 16 * 1024;
+	static constexpr unsigned int MAX_COMPONENT_TYPES = 64;
+
+	typedef uint64_t ComponentMask;
+
+private:
+	struct alignas(64) Chunk
+	{
+		unsigned char data[CHUNK_SIZE];
+		unsigned int count;
+	};
+
+	struct Archetype
+	{
+		ComponentMask mask;
+		unsigned int capacity;                            // entities per chunk
+		unsigned int offsets[MAX_COMPONENT_TYPES];        // of each component's array in a chunk, by component id
+		unsigned int sizes[MAX_COMPONENT_TYPES];          // by component id, copied so rows move without the registry lock
+		std::vector<unsigned int> components;             // ids in the archetype, increasing
+		std::vector<std::unique_ptr<Chunk>> chunks;       // all full but the last
+		// the entity ids are an array at the start of every chunk
+	};
+
+	struct Location
+	{
+		unsigned int archetype;
+		unsigned int chunk;
+		unsigned int row;
+	};
+
+	std::vector<std::unique_ptr<Archetype>> archetypes_;
+	std::unordered_map<ComponentMask, unsigned int> archetype_of_mask_;
+	std::vector<Location> locations_;   // by entity
+	std::vector<bool> alive_;
+	std::vector<Entity> free_ids_;
+	unsigned int entity_count_;
+
+	// ids are given out the first time a component type is used, the same for every world
+	static unsigned int RegisterComponent(unsigned int size, unsigned int alignment);
+
+	unsigned int GetArchetype(ComponentMask mask);
+
+	// Append a row for entity to the archetype, the components are left uninitialized
+	Location AllocateRow(unsigned int archetype, Entity entity);
+
+	// Remove a row by moving the archetype's last row into it
+	void FreeRow(const Location& location);
+
+	// Move entity to the archetype of mask, copying the components both have
+	void MoveEntity(Entity entity, ComponentMask mask);
+
+	void* GetComponentData(const Location& location, unsigned int component) const;
+
+	static inline Entity* GetEntities(const Chunk& chunk) { return (Entity*)chunk.data; }
+
+	template<typename C>
+	static inline C* GetArray(const Archetype& archetype, const Chunk& chunk)
+	{
+		return (C*)(chunk.data + archetype.offsets[ComponentId<C>()]);
+	}
+
+	// The chunks of every archetype that has all of mask, with something in them
+	void CollectChunks(ComponentMask mask, std::vector<std::pair<const Archetype*, Chunk*>>& chunks) const;
+
+	Entity NewId();
+
+public:
+	EntityWorld();
+	~EntityWorld();
+
+	EntityWorld(const EntityWorld&) = delete;
+	EntityWorld& operator=(const EntityWorld&) = delete;
+
+	template<typename C>
+	static unsigned int ComponentId()
+	{
+		static_assert(std::is_trivially_copyable<C>::value, "components are copied with memcpy");
+		static const unsigned int id = RegisterComponent((unsigned int)sizeof(C), (unsigned int)alignof(C));
+		return id;
+	}
+
+	template<typename... C>
+	static ComponentMask MaskOf()
+	{
+		return (ComponentMask(0) | ... | (ComponentMask(1) << ComponentId<C>()));
+	}
+
+	// New entity with the given components
+	template<typename... C>
+	Entity Create(const C&... components)
+	{
+		Entity entity = NewId();
+		locations_[entity] = AllocateRow(GetArchetype(MaskOf<C...>()), entity);
+		(void)std::initializer_list<int>{ (*(C*)GetComponentData(locations_[entity], ComponentId<C>()) = components, 0)... };
+		return entity;
+	}
+
+	void Destroy(Entity entity);
+
+	inline bool IsAlive(Entity entity) const { return entity < alive_.size() && alive_[entity]; }
+
+	// Give entity a component, or overwrite the one it has
+	template<typename C>
+	void Add(Entity entity, const C& component)
+	{
+		ASSERT(IsAlive(entity));
+		unsigned int id = ComponentId<C>();
+		ComponentMask mask = archetypes_[locations_[entity].archetype]->mask;
+		if (!(mask & (ComponentMask(1) << id)))
+			MoveEntity(entity, mask | (ComponentMask(1) << id));
+		*(C*)GetComponentData(locations_[entity], id) = component;
+	}
+
+	template<typename C>
+	void Remove(Entity entity)
+	{
+		ASSERT(IsAlive(entity));
+		ComponentMask mask = archetypes_[locations_[entity].archetype]->mask;
+		ComponentMask bit = ComponentMask(1) << ComponentId<C>();
+		if (mask & bit)
+			MoveEntity(entity, mask & ~bit);
+	}
+
+	template<typename C>
+	bool Has(Entity entity) const
+	{
+		ASSERT(IsAlive(entity));
+		return (archetypes_[locations_[entity].archetype]->mask & (ComponentMask(1) << ComponentId<C>())) != 0;
+	}
+
+	// nullptr when the entity doesn't have C. Only valid until the entity changes archetype or another
+	// entity of its archetype is destroyed.
+	template<typename C>
+	C* Get(Entity entity)
+	{
+		return Has<C>(entity) ? (C*)GetComponentData(locations_[entity], ComponentId<C>()) : nullptr;
+	}
+
+	// function(count, entities, C* arrays...) once per chunk of every entity that has all of C
+	template<typename... C, typename Function>
+	void ForEachChunk(Function&& function)
+	{
+		ComponentMask mask = MaskOf<C...>();
+		for (const std::unique_ptr<Archetype>& archetype : archetypes_)
+		{
+			if ((archetype->mask & mask) != mask)
+				continue;
+			for (const std::unique_ptr<Chunk>& chunk : archetype->chunks)
+			{
+				if (chunk->count)
+					function(chunk->count, (const Entity*)GetEntities(*chunk), GetArray<C>(*archetype, *chunk)...);
+			}
+		}
+	}
+
+	// function(entity, C&...) for every entity that has all of C
+	template<typename... C, typename Function>
+	void ForEach(Function&& function)
+	{
+		ForEachChunk<C...>([&function](unsigned int count, const Entity* entities, C*... arrays)
+		{
+			for (unsigned int i = 0; i < count; i++)
+				function(entities[i], arrays[i]...);
+		});
+	}
+
+	// ForEach with the chunks spread over the pool, function runs on several threads at once
+	template<typename... C, typename Function>
+	void ParallelForEach(ThreadPool& pool, Function&& function)
+	{
+		std::vector<std::pair<const Archetype*, Chunk*>> chunks;
+		CollectChunks(MaskOf<C...>(), chunks);
+		pool.ParallelFor(chunks.size(), 1, [&chunks, &function](size_t first, size_t last)
+		{
+			for (size_t i = first; i < last; i++)
+			{
+				const Archetype& archetype = *chunks[i].first;
+				Chunk& chunk = *chunks[i].second;
+				const Entity* entities = GetEntities(chunk);
+				unsigned int count = chunk.count;
+				std::tuple<C*...> arrays(GetArray<C>(archetype, chunk)...);
+				for (unsigned int row = 0; row < count; row++)
+					function(entities[row], std::get<C*>(arrays)[row]...);
+			}
+		});
+	}
+
+	inline unsigned int GetEntityCount() const { return entity_count_; }
+	inline unsigned int GetArchetypeCount() const { return (unsigned int)archetypes_.size(); }
+};
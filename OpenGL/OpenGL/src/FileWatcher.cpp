@@ -0,0 +1,240 @@
+#include "FileWatcher.h"
+
+#include <algorithm>
+#include <iostream>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#elif defined(__linux__)
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <errno.h>
+#else
+#include <filesystem>
+#endif
+
+struct WatchedFile
+{
+	std::string name;   // name inside the directory
+	std::string path;   // as passed to Watch()
+#if !defined(_WIN32) && !defined(__linux__)
+	std::filesystem::file_time_type modified;
+#endif
+};
+
+struct FileWatcher::Directory
+{
+	std::string path;
+	std::vector<WatchedFile> files;
+#if defined(_WIN32)
+	HANDLE handle;
+	OVERLAPPED overlapped;
+	DWORD buffer[4096];   // FILE_NOTIFY_INFORMATION records have to be DWORD aligned
+#elif defined(__linux__)
+	int watch_descriptor;
+#endif
+};
+
+static void SplitPath(const std::string& path, std::string& directory, std::string& name)
+{
+	size_t slash = path.find_last_of("/\\");
+	directory = slash == std::string::npos ? "." : path.substr(0, slash);
+	name = slash == std::string::npos ? path : path.substr(slash + 1);
+}
+
+// Lists a change of name in directory, once
+static void AddChange(const std::vector<WatchedFile>& files, const std::string& name, std::vector<std::string>& changed)
+{
+	for (const WatchedFile& file : files)
+	{
+		if (file.name == name && std::find(changed.begin(), changed.end(), file.path) == changed.end())
+			changed.push_back(file.path);
+	}
+}
+
+#if defined(_WIN32)
+
+// Queue the next asynchronous read of changes, the results land in directory.buffer
+static bool IssueRead(HANDLE handle, OVERLAPPED* overlapped, DWORD* buffer, DWORD size)
+{
+	return ReadDirectoryChangesW(handle, buffer, size, FALSE, FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME,
+		nullptr, overlapped, nullptr) != 0;
+}
+
+#endif
+
+FileWatcher::FileWatcher()
+{
+#if defined(__linux__)
+	inotify_descriptor_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (inotify_descriptor_ < 0)
+		std::cerr << "inotify is not available, files won't be watched" << std::endl;
+#endif
+}
+
+FileWatcher::~FileWatcher()
+{
+#if defined(_WIN32)
+	for (std::unique_ptr<Directory>& directory : directories_)
+	{
+		// the read has to be finished before the buffer it writes into goes away
+		DWORD bytes;
+		CancelIoEx(directory->handle, &directory->overlapped);
+		GetOverlappedResult(directory->handle, &directory->overlapped, &bytes, TRUE);
+		CloseHandle(directory->overlapped.hEvent);
+		CloseHandle(directory->handle);
+	}
+#elif defined(__linux__)
+	if (inotify_descriptor_ >= 0)
+		close(inotify_descriptor_);
+#endif
+}
+
+FileWatcher::Directory* FileWatcher::FindDirectory(const std::string& path) const
+{
+	for (const std::unique_ptr<Directory>& directory : directories_)
+	{
+		if (directory->path == path)
+			return directory.get();
+	}
+	return nullptr;
+}
+
+bool FileWatcher::Watch(const std::string& path)
+{
+	std::string directory_path, name;
+	SplitPath(path, directory_path, name);
+
+	Directory* directory = FindDirectory(directory_path);
+	if (!directory)
+	{
+		std::unique_ptr<Directory> created = std::make_unique<Directory>();
+		created->path = directory_path;
+#if defined(_WIN32)
+		created->handle = CreateFileA(directory_path.c_str(), FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+			nullptr, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
+		if (created->handle == INVALID_HANDLE_VALUE)
+		{
+			std::cerr << "Can't watch directory " << directory_path << std::endl;
+			return false;
+		}
+		ZeroMemory(&created->overlapped, sizeof(created->overlapped));
+		created->overlapped.hEvent = CreateEventA(nullptr, TRUE, FALSE, nullptr);
+		if (!IssueRead(created->handle, &created->overlapped, created->buffer, sizeof(created->buffer)))
+		{
+			std::cerr << "Can't watch directory " << directory_path << std::endl;
+			CloseHandle(created->overlapped.hEvent);
+			CloseHandle(created->handle);
+			return false;
+		}
+#elif defined(__linux__)
+		// close-write covers editors saving in place, moved-to the ones writing a temporary file and renaming it
+		created->watch_descriptor = inotify_descriptor_ < 0 ? -1 :
+			inotify_add_watch(inotify_descriptor_, directory_path.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+		if (created->watch_descriptor < 0)
+		{
+			std::cerr << "Can't watch directory " << directory_path << std::endl;
+			return false;
+		}
+#endif
+		directory = created.get();
+		directories_.push_back(std::move(created));
+	}
+
+	for (const WatchedFile& file : directory->files)
+	{
+		if (file.name == name)
+			return true;
+	}
+
+	WatchedFile file;
+	file.name = name;
+	file.path = path;
+#if !defined(_WIN32) && !defined(__linux__)
+	std::error_code error;
+	file.modified = std::filesystem::last_write_time(path, error);
+#endif
+	directory->files.push_back(file);
+	return true;
+}
+
+void FileWatcher::Poll(std::vector<std::string>& changed)
+{
+#if defined(_WIN32)
+	for (std::unique_ptr<Directory>& directory : directories_)
+	{
+		DWORD bytes = 0;
+		if (!GetOverlappedResult(directory->handle, &directory->overlapped, &bytes, FALSE))
+		{
+			if (GetLastError() == ERROR_IO_INCOMPLETE)
+				continue;
+			bytes = 0;
+		}
+
+		if (bytes == 0)
+		{
+			// the buffer overflowed (or the read failed), changes were lost so assume everything changed
+			for (const WatchedFile& file : directory->files)
+				AddChange(directory->files, file.name, changed);
+		}
+		else
+		{
+			const char* record = (const char*)directory->buffer;
+			while (true)
+			{
+				const FILE_NOTIFY_INFORMATION* information = (const FILE_NOTIFY_INFORMATION*)record;
+				int wide_length = (int)(information->FileNameLength / sizeof(WCHAR));
+				int length = WideCharToMultiByte(CP_UTF8, 0, information->FileName, wide_length, nullptr, 0, nullptr, nullptr);
+				std::string name(length, '\0');
+				WideCharToMultiByte(CP_UTF8, 0, information->FileName, wide_length, &name[0], length, nullptr, nullptr);
+				AddChange(directory->files, name, changed);
+
+				if (information->NextEntryOffset == 0)
+					break;
+				record += information->NextEntryOffset;
+			}
+		}
+
+		ResetEvent(directory->overlapped.hEvent);
+		IssueRead(directory->handle, &directory->overlapped, directory->buffer, sizeof(directory->buffer));
+	}
+#elif defined(__linux__)
+	if (inotify_descriptor_ < 0)
+		return;
+
+	alignas(struct inotify_event) char buffer[4096];
+	while (true)
+	{
+		ssize_t length = read(inotify_descriptor_, buffer, sizeof(buffer));
+		if (length <= 0)
+			break;   // EAGAIN, nothing more queued
+
+		for (ssize_t offset = 0; offset < length;)
+		{
+			const struct inotify_event* event = (const struct inotify_event*)(buffer + offset);
+			offset += sizeof(struct inotify_event) + event->len;
+
+			for (const std::unique_ptr<Directory>& directory : directories_)
+			{
+				if (directory->watch_descriptor == event->wd && event->len > 0)
+					AddChange(directory->files, event->name, changed);
+			}
+		}
+	}
+#else
+	for (std::unique_ptr<Directory>& directory : directories_)
+	{
+		for (WatchedFile& file : directory->files)
+		{
+			std::error_code error;
+			std::filesystem::file_time_type modified = std::filesystem::last_write_time(file.path, error);
+			if (!error && modified != file.modified)
+			{
+				file.modified = modified;
+				AddChange(directory->files, file.name, changed);
+			}
+		}
+	}
+#endif
+}
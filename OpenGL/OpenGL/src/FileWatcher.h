@@ -0,0 +1,34 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+// Tells which of a set of files changed on disk, without blocking and without re-reading them.
+// ReadDirectoryChangesW on Windows and inotify on Linux, other platforms compare modification times on every Poll().
+class FileWatcher
+{
+private:
+	struct Directory;
+
+	std::vector<std::unique_ptr<Directory>> directories_;
+#if defined(__linux__)
+	int inotify_descriptor_;
+#endif
+
+	Directory* FindDirectory(const std::string& path) const;
+
+public:
+	FileWatcher();
+	~FileWatcher();
+
+	FileWatcher(const FileWatcher&) = delete;
+	FileWatcher& operator=(const FileWatcher&) = delete;
+
+	// Start watching a file, watching it twice does nothing. Returns false if its directory can't be watched.
+	bool Watch(const std::string& path);
+
+	// Adds the files changed since the last call to changed, spelled the way they were passed to Watch().
+	// Saving a file often shows up as several changes, a file is only listed once per call.
+	void Poll(std::vector<std::string>& changed);
+};
@@ -0,0 +1,342 @@
+#include "Framebuffer.h"
+#include "GLCapabilities.h"
+#include "DeletionQueue.h"
+#include "GLStateCache.h"
+#include "Renderer.h"
+
+#include <GL/glew.h>
+#include <iostream>
+#include <utility>
+
+bool FramebufferSpec::operator==(const FramebufferSpec& other) const
+{
+	if (width != other.width || height != other.height || samples != other.samples || colors.size() != other.colors.size())
+		return false;
+	if (depth.internal_format != other.depth.internal_format || depth.type != other.depth.type)
+		return false;
+	for (unsigned int i = 0; i < colors.size(); i++)
+	{
+		if (colors[i].internal_format != other.colors[i].internal_format || colors[i].type != other.colors[i].type)
+			return false;
+	}
+	return true;
+}
+
+// Depth formats with stencil bits have to go to the combined attachment point or the stencil part is lost
+static unsigned int GetDepthAttachmentPoint(unsigned int internal_format)
+{
+	if (internal_format == GL_DEPTH24_STENCIL8 || internal_format == GL_DEPTH32F_STENCIL8)
+		return GL_DEPTH_STENCIL_ATTACHMENT;
+	return GL_DEPTH_ATTACHMENT;
+}
+
+Framebuffer::Attachment Framebuffer::CreateAttachment(const AttachmentSpec& spec, unsigned int attachment_point)
+{
+	Attachment attachment;
+	attachment.renderer_id = 0;
+	attachment.target = 0;
+	if (spec.internal_format == 0)
+		return attachment;
+
+	bool dsa = GLCapabilities::Get().direct_state_access;
+
+	if (spec.type == AttachmentType::RENDERBUFFER)
+	{
+		// samples 0 gives a normal renderbuffer, so one call covers both cases
+		attachment.target = GL_RENDERBUFFER;
+		if (dsa)
+		{
+			GLCALL(glCreateRenderbuffers(1, &attachment.renderer_id));
+			GLCALL(glNamedRenderbufferStorageMultisample(attachment.renderer_id, spec_.samples, spec.internal_format, spec_.width, spec_.height));
+			GLCALL(glNamedFramebufferRenderbuffer(renderer_id_, attachment_point, GL_RENDERBUFFER, attachment.renderer_id));
+		}
+		else
+		{
+			GLCALL(glGenRenderbuffers(1, &attachment.renderer_id));
+			GLCALL(glBindRenderbuffer(GL_RENDERBUFFER, attachment.renderer_id));
+			GLCALL(glRenderbufferStorageMultisample(GL_RENDERBUFFER, spec_.samples, spec.internal_format, spec_.width, spec_.height));
+			GLCALL(glFramebufferRenderbuffer(GL_FRAMEBUFFER, attachment_point, GL_RENDERBUFFER, attachment.renderer_id));
+			GLCALL(glBindRenderbuffer(GL_RENDERBUFFER, 0));
+		}
+		return attachment;
+	}
+
+	if (spec_.samples == 0)
+	{
+		// single sampled textures are ordinary textures, they get sampled by later passes
+		attachment.texture = std::make_unique<Texture>(spec_.width, spec_.height, spec.internal_format, 1);
+		attachment.texture->SetWrap(GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE);
+		attachment.renderer_id = attachment.texture->GetRendererId();
+		attachment.target = GL_TEXTURE_2D;
+	}
+	else
+	{
+		// fixed sample locations so color and depth resolve the same way
+		attachment.target = GL_TEXTURE_2D_MULTISAMPLE;
+		if (dsa)
+		{
+			GLCALL(glCreateTextures(GL_TEXTURE_2D_MULTISAMPLE, 1, &attachment.renderer_id));
+			GLCALL(glTextureStorage2DMultisample(attachment.renderer_id, spec_.samples, spec.internal_format, spec_.width, spec_.height, GL_TRUE));
+		}
+		else
+		{
+			GLCALL(glGenTextures(1, &attachment.renderer_id));
+			GLStateCache::BindTexture(0, GL_TEXTURE_2D_MULTISAMPLE, attachment.renderer_id);
+			GLCALL(glTexImage2DMultisample(GL_TEXTURE_2D_MULTISAMPLE, spec_.samples, spec.internal_format, spec_.width, spec_.height, GL_TRUE));
+		}
+	}
+
+	if (dsa)
+	{
+		GLCALL(glNamedFramebufferTexture(renderer_id_, attachment_point, attachment.renderer_id, 0));
+	}
+	else
+	{
+		GLCALL(glFramebufferTexture2D(GL_FRAMEBUFFER, attachment_point, attachment.target, attachment.renderer_id, 0));
+	}
+	return attachment;
+}
+
+void Framebuffer::DeleteAttachment(Attachment& attachment)
+{
+	if (attachment.texture)
+	{
+		attachment.texture.reset();
+	}
+	else if (attachment.target == GL_RENDERBUFFER)
+	{
+		GLCALL(glDeleteRenderbuffers(1, &attachment.renderer_id));
+	}
+	else if (attachment.target == GL_TEXTURE_2D_MULTISAMPLE)
+	{
+		GLStateCache::ForgetTexture(attachment.renderer_id);
+		GLCALL(glDeleteTextures(1, &attachment.renderer_id));
+	}
+	attachment.renderer_id = 0;
+}
+
+void Framebuffer::ReleaseAttachment(Attachment& attachment, DeletionQueue& queue)
+{
+	if (attachment.texture)
+	{
+		attachment.texture->Release(queue);
+		attachment.texture.reset();
+	}
+	else if (attachment.target == GL_RENDERBUFFER)
+	{
+		queue.Delete(GLObjectType::RENDERBUFFER, attachment.renderer_id);
+	}
+	else if (attachment.target == GL_TEXTURE_2D_MULTISAMPLE)
+	{
+		queue.Delete(GLObjectType::TEXTURE, attachment.renderer_id);
+	}
+	attachment.renderer_id = 0;
+}
+
+Framebuffer::Framebuffer(const FramebufferSpec& spec)
+	: renderer_id_(0), spec_(spec), complete_(false)
+{
+	bool dsa = GLCapabilities::Get().direct_state_access;
+
+	if (dsa)
+	{
+		GLCALL(glCreateFramebuffers(1, &renderer_id_));
+	}
+	else
+	{
+		GLCALL(glGenFramebuffers(1, &renderer_id_));
+		GLCALL(glBindFramebuffer(GL_FRAMEBUFFER, renderer_id_));
+	}
+
+	std::vector<GLenum> draw_buffers;
+	for (unsigned int i = 0; i < spec_.colors.size(); i++)
+	{
+		colors_.push_back(CreateAttachment(spec_.colors[i], GL_COLOR_ATTACHMENT0 + i));
+		draw_buffers.push_back(GL_COLOR_ATTACHMENT0 + i);
+	}
+	depth_ = CreateAttachment(spec_.depth, GetDepthAttachmentPoint(spec_.depth.internal_format));
+
+	// depth only framebuffers (shadow maps) draw to no color buffer at all
+	GLenum status;
+	if (dsa)
+	{
+		if (draw_buffers.empty())
+		{
+			GLCALL(glNamedFramebufferDrawBuffer(renderer_id_, GL_NONE));
+			GLCALL(glNamedFramebufferReadBuffer(renderer_id_, GL_NONE));
+		}
+		else
+		{
+			GLCALL(glNamedFramebufferDrawBuffers(renderer_id_, (GLsizei)draw_buffers.size(), draw_buffers.data()));
+		}
+		GLCALL(status = glCheckNamedFramebufferStatus(renderer_id_, GL_FRAMEBUFFER));
+	}
+	else
+	{
+		if (draw_buffers.empty())
+		{
+			GLCALL(glDrawBuffer(GL_NONE));
+			GLCALL(glReadBuffer(GL_NONE));
+		}
+		else
+		{
+			GLCALL(glDrawBuffers((GLsizei)draw_buffers.size(), draw_buffers.data()));
+		}
+		GLCALL(status = glCheckFramebufferStatus(GL_FRAMEBUFFER));
+		GLCALL(glBindFramebuffer(GL_FRAMEBUFFER, 0));
+	}
+
+	complete_ = status == GL_FRAMEBUFFER_COMPLETE;
+	if (!complete_)
+		std::cerr << "Framebuffer " << spec_.width << "x" << spec_.height << " is incomplete, status 0x" << std::hex << status << std::dec << std::endl;
+}
+
+Framebuffer::~Framebuffer()
+{
+	if (renderer_id_ == 0)
+		return;
+	for (Attachment& attachment : colors_)
+		DeleteAttachment(attachment);
+	DeleteAttachment(depth_);
+	GLCALL(glDeleteFramebuffers(1, &renderer_id_));
+}
+
+Framebuffer::Framebuffer(Framebuffer&& other) noexcept
+	: renderer_id_(std::exchange(other.renderer_id_, 0)), spec_(std::move(other.spec_)), colors_(std::move(other.colors_)),
+	depth_(std::move(other.depth_)), complete_(other.complete_)
+{
+}
+
+Framebuffer& Framebuffer::operator=(Framebuffer&& other) noexcept
+{
+	// the old objects go with other when it is destroyed
+	std::swap(renderer_id_, other.renderer_id_);
+	std::swap(spec_, other.spec_);
+	std::swap(colors_, other.colors_);
+	std::swap(depth_, other.depth_);
+	std::swap(complete_, other.complete_);
+	return *this;
+}
+
+void Framebuffer::Release(DeletionQueue& queue)
+{
+	for (Attachment& attachment : colors_)
+		ReleaseAttachment(attachment, queue);
+	ReleaseAttachment(depth_, queue);
+	colors_.clear();
+	queue.Delete(GLObjectType::FRAMEBUFFER, std::exchange(renderer_id_, 0));
+	complete_ = false;
+}
+
+void Framebuffer::Bind() const
+{
+	GLCALL(glBindFramebuffer(GL_FRAMEBUFFER, renderer_id_));
+	GLCALL(glViewport(0, 0, spec_.width, spec_.height));
+}
+
+void Framebuffer::BindDefault(unsigned int width, unsigned int height)
+{
+	GLCALL(glBindFramebuffer(GL_FRAMEBUFFER, 0));
+	GLCALL(glViewport(0, 0, width, height));
+}
+
+void Framebuffer::Blit(unsigned int target, unsigned int target_width, unsigned int target_height, unsigned int target_colors,
+	unsigned int mask, unsigned int filter) const
+{
+	// a multisampled blit can't scale, the resolve has to be 1:1
+	ASSERT(spec_.samples == 0 || (spec_.width == target_width && spec_.height == target_height));
+
+	bool dsa = GLCapabilities::Get().direct_state_access;
+	if (!dsa)
+	{
+		GLCALL(glBindFramebuffer(GL_READ_FRAMEBUFFER, renderer_id_));
+		GLCALL(glBindFramebuffer(GL_DRAW_FRAMEBUFFER, target));
+	}
+
+	// depth and stencil can only be copied with nearest filtering
+	unsigned int depth_mask = mask & (GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+	if (depth_mask && depth_.renderer_id)
+	{
+		if (dsa)
+		{
+			GLCALL(glBlitNamedFramebuffer(renderer_id_, target, 0, 0, spec_.width, spec_.height, 0, 0, target_width, target_height, depth_mask, GL_NEAREST));
+		}
+		else
+		{
+			GLCALL(glBlitFramebuffer(0, 0, spec_.width, spec_.height, 0, 0, target_width, target_height, depth_mask, GL_NEAREST));
+		}
+	}
+
+	if (!(mask & GL_COLOR_BUFFER_BIT))
+		return;
+
+	// a blit reads a single color buffer, so every attachment gets its own blit into the matching target attachment
+	unsigned int count = (unsigned int)colors_.size() < target_colors ? (unsigned int)colors_.size() : target_colors;
+	for (unsigned int i = 0; i < count; i++)
+	{
+		GLenum draw_buffer = target ? GL_COLOR_ATTACHMENT0 + i : GL_BACK;
+		if (dsa)
+		{
+			GLCALL(glNamedFramebufferReadBuffer(renderer_id_, GL_COLOR_ATTACHMENT0 + i));
+			GLCALL(glNamedFramebufferDrawBuffer(target, draw_buffer));
+			GLCALL(glBlitNamedFramebuffer(renderer_id_, target, 0, 0, spec_.width, spec_.height, 0, 0, target_width, target_height, GL_COLOR_BUFFER_BIT, filter));
+		}
+		else
+		{
+			GLCALL(glReadBuffer(GL_COLOR_ATTACHMENT0 + i));
+			GLCALL(glDrawBuffer(draw_buffer));
+			GLCALL(glBlitFramebuffer(0, 0, spec_.width, spec_.height, 0, 0, target_width, target_height, GL_COLOR_BUFFER_BIT, filter));
+		}
+	}
+
+	// put the draw buffers of the target back to every attachment
+	if (target && count > 1)
+	{
+		std::vector<GLenum> draw_buffers;
+		for (unsigned int i = 0; i < target_colors; i++)
+			draw_buffers.push_back(GL_COLOR_ATTACHMENT0 + i);
+		if (dsa)
+		{
+			GLCALL(glNamedFramebufferDrawBuffers(target, (GLsizei)draw_buffers.size(), draw_buffers.data()));
+		}
+		else
+		{
+			GLCALL(glDrawBuffers((GLsizei)draw_buffers.size(), draw_buffers.data()));
+		}
+	}
+}
+
+void Framebuffer::Resolve(const Framebuffer& target, unsigned int mask, unsigned int filter) const
+{
+	Blit(target.renderer_id_, target.spec_.width, target.spec_.height, (unsigned int)target.colors_.size(), mask, filter);
+}
+
+void Framebuffer::ResolveToDefault(unsigned int width, unsigned int height, unsigned int mask, unsigned int filter) const
+{
+	Blit(0, width, height, 1, mask, filter);
+}
+
+void Framebuffer::Invalidate(bool colors, bool depth) const
+{
+	if (!GLCapabilities::Get().invalidate_framebuffer)
+		return;
+
+	std::vector<GLenum> attachments;
+	if (colors)
+	{
+		for (unsigned int i = 0; i < colors_.size(); i++)
+			attachments.push_back(GL_COLOR_ATTACHMENT0 + i);
+	}
+	if (depth && depth_.renderer_id)
+		attachments.push_back(GetDepthAttachmentPoint(spec_.depth.internal_format));
+	if (attachments.empty())
+		return;
+
+	if (GLCapabilities::Get().direct_state_access)
+	{
+		GLCALL(glInvalidateNamedFramebufferData(renderer_id_, (GLsizei)attachments.size(), attachments.data()));
+		return;
+	}
+	GLCALL(glBindFramebuffer(GL_FRAMEBUFFER, renderer_id_));
+	GLCALL(glInvalidateFramebuffer(GL_FRAMEBUFFER, (GLsizei)attachments.size(), attachments.data()));
+}
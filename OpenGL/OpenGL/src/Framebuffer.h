@@ -0,0 +1,120 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "Texture.h"
+
+class DeletionQueue;
+
+enum class AttachmentType
+{
+	TEXTURE,        // can be sampled afterwards (multisampled ones through texelFetch only)
+	RENDERBUFFER    // only rendered to, blitted or read back, lets the driver pick the fastest layout
+};
+
+struct AttachmentSpec
+{
+	unsigned int internal_format;   // 0 means no attachment
+	AttachmentType type;
+};
+
+// Everything that defines a framebuffer, two equal specs give interchangeable framebuffers
+struct FramebufferSpec
+{
+	unsigned int width = 0;
+	unsigned int height = 0;
+	unsigned int samples = 0;   // 0 for a normal framebuffer, 2/4/8... for MSAA
+	std::vector<AttachmentSpec> colors;
+	AttachmentSpec depth = { 0, AttachmentType::RENDERBUFFER };
+
+	FramebufferSpec() = default;
+	FramebufferSpec(unsigned int width, unsigned int height, unsigned int samples = 0)
+		: width(width), height(height), samples(samples)
+	{
+	}
+
+	inline FramebufferSpec& AddColor(unsigned int internal_format, AttachmentType type = AttachmentType::TEXTURE)
+	{
+		colors.push_back({ internal_format, type });
+		return *this;
+	}
+
+	inline FramebufferSpec& SetDepth(unsigned int internal_format, AttachmentType type = AttachmentType::RENDERBUFFER)
+	{
+		depth = { internal_format, type };
+		return *this;
+	}
+
+	bool operator==(const FramebufferSpec& other) const;
+	inline bool operator!=(const FramebufferSpec& other) const { return !(*this == other); }
+};
+
+class Framebuffer
+{
+private:
+	struct Attachment
+	{
+		std::unique_ptr<Texture> texture;   // single sampled texture attachments
+		unsigned int renderer_id;
+		unsigned int target;                // GL_TEXTURE_2D, GL_TEXTURE_2D_MULTISAMPLE or GL_RENDERBUFFER
+	};
+
+	unsigned int renderer_id_;
+	FramebufferSpec spec_;
+	std::vector<Attachment> colors_;
+	Attachment depth_;
+	bool complete_;
+
+	Attachment CreateAttachment(const AttachmentSpec& spec, unsigned int attachment_point);
+	void DeleteAttachment(Attachment& attachment);
+	void ReleaseAttachment(Attachment& attachment, DeletionQueue& queue);
+
+	// Copy the attachments in mask to target (0 = default framebuffer), one color attachment at a time
+	void Blit(unsigned int target, unsigned int target_width, unsigned int target_height, unsigned int target_colors,
+		unsigned int mask, unsigned int filter) const;
+
+public:
+	explicit Framebuffer(const FramebufferSpec& spec);
+	~Framebuffer();
+
+	// Movable so framebuffers can live by value in a HandlePool, the moved from one owns nothing
+	Framebuffer(Framebuffer&& other) noexcept;
+	Framebuffer& operator=(Framebuffer&& other) noexcept;
+	Framebuffer(const Framebuffer&) = delete;
+	Framebuffer& operator=(const Framebuffer&) = delete;
+
+	// Hand the GL objects to queue to be deleted once the GPU is done with them, this owns nothing afterwards
+	void Release(DeletionQueue& queue);
+
+	// Bind for drawing and set the viewport to cover it
+	void Bind() const;
+
+	// Back to the window, width/height are the size of its framebuffer
+	static void BindDefault(unsigned int width, unsigned int height);
+
+	// Resolve (multisampled) or copy (single sampled) into target, color attachment i goes to color attachment i.
+	// Multisampled sources need a target of the same size. Framebuffer bindings are undefined afterwards, Bind() again before drawing.
+	void Resolve(const Framebuffer& target, unsigned int mask, unsigned int filter = 0x2600 /* GL_NEAREST */) const;
+
+	// Same but into the window, first color attachment only
+	void ResolveToDefault(unsigned int width, unsigned int height, unsigned int mask, unsigned int filter = 0x2600 /* GL_NEAREST */) const;
+
+	// Contents of the attachments are not needed anymore. Call it once they are resolved or before the first
+	// draw of a frame instead of clearing, so the driver doesn't have to keep (or load) them. No-op without the extension.
+	void Invalidate(bool colors = true, bool depth = true) const;
+
+	inline unsigned int GetRendererId() const { return renderer_id_; }
+	inline const FramebufferSpec& GetSpec() const { return spec_; }
+	inline unsigned int GetWidth() const { return spec_.width; }
+	inline unsigned int GetHeight() const { return spec_.height; }
+	inline bool IsComplete() const { return complete_; }
+
+	// GL object behind an attachment, a texture or a renderbuffer depending on the spec
+	inline unsigned int GetColorAttachment(unsigned int index) const { return colors_[index].renderer_id; }
+	inline unsigned int GetDepthAttachment() const { return depth_.renderer_id; }
+
+	// Attachment as a Texture to sample from, nullptr for renderbuffers and multisampled textures
+	inline Texture* GetColorTexture(unsigned int index) const { return colors_[index].texture.get(); }
+	inline Texture* GetDepthTexture() const { return depth_.texture.get(); }
+};
@@ -0,0 +1,82 @@
+#include "FramebufferPool.h"
+#include "Renderer.h"
+
+FramebufferPool::FramebufferPool(GpuResources& resources, unsigned int max_idle_frames)
+	: resources_(resources), frame_(0), max_idle_frames_(max_idle_frames)
+{
+}
+
+FramebufferPool::~FramebufferPool()
+{
+	for (const Entry& entry : entries_)
+		resources_.Destroy(entry.framebuffer);
+}
+
+void FramebufferPool::Evict(unsigned int i)
+{
+	resources_.Destroy(entries_[i].framebuffer);
+	entries_[i] = entries_.back();
+	entries_.pop_back();
+}
+
+FramebufferHandle FramebufferPool::Acquire(const FramebufferSpec& spec)
+{
+	// a handful of render targets at most, a linear search beats hashing the spec
+	for (Entry& entry : entries_)
+	{
+		if (!entry.in_use && resources_.Get(entry.framebuffer)->GetSpec() == spec)
+		{
+			entry.in_use = true;
+			entry.last_used = frame_;
+			return entry.framebuffer;
+		}
+	}
+
+	entries_.push_back({ resources_.Create<Framebuffer>(spec), true, frame_ });
+	return entries_.back().framebuffer;
+}
+
+void FramebufferPool::Release(FramebufferHandle framebuffer)
+{
+	for (Entry& entry : entries_)
+	{
+		if (entry.framebuffer == framebuffer)
+		{
+			ASSERT(entry.in_use);
+			entry.in_use = false;
+			return;
+		}
+	}
+	ASSERT(false);
+}
+
+void FramebufferPool::EndFrame()
+{
+	for (unsigned int i = 0; i < entries_.size();)
+	{
+		if (!entries_[i].in_use && frame_ - entries_[i].last_used > max_idle_frames_)
+		{
+			Evict(i);
+		}
+		else
+		{
+			i++;
+		}
+	}
+	frame_++;
+}
+
+void FramebufferPool::Clear()
+{
+	for (unsigned int i = 0; i < entries_.size();)
+	{
+		if (!entries_[i].in_use)
+		{
+			Evict(i);
+		}
+		else
+		{
+			i++;
+		}
+	}
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <vector>
+
+#include "GpuResources.h"
+
+// Keeps framebuffers alive between frames so a pass asking for the same spec every frame gets the same
+// one back instead of allocating VRAM again. Framebuffers nobody asked for in a few frames (old sizes
+// after a resize, passes that got turned off) are dropped in EndFrame(). The framebuffers live in
+// GpuResources, so the GL objects of a dropped one go through its DeletionQueue (the GPU may still be
+// rendering into them), and a handle kept past Release stops resolving instead of reaching a reused one.
+class FramebufferPool
+{
+private:
+	struct Entry
+	{
+		FramebufferHandle framebuffer;
+		bool in_use;
+		unsigned long long last_used;
+	};
+
+	std::vector<Entry> entries_;
+	GpuResources& resources_;
+	unsigned long long frame_;
+	unsigned int max_idle_frames_;
+
+	// Destroy the framebuffer of entry i and drop the entry
+	void Evict(unsigned int i);
+
+public:
+	explicit FramebufferPool(GpuResources& resources, unsigned int max_idle_frames = 3);
+
+	// Destroys every framebuffer, acquired or not
+	~FramebufferPool();
+
+	FramebufferPool(const FramebufferPool&) = delete;
+	FramebufferPool& operator=(const FramebufferPool&) = delete;
+
+	// Free framebuffer matching spec, created if there is none. Contents are whatever the last user left.
+	FramebufferHandle Acquire(const FramebufferSpec& spec);
+
+	// Give it back, it can be handed out again in the same frame
+	void Release(FramebufferHandle framebuffer);
+
+	// Only good until the next Acquire creates a framebuffer, look it up again instead of keeping it
+	inline Framebuffer* Get(FramebufferHandle framebuffer) const { return resources_.Get(framebuffer); }
+
+	// Once per frame, drops the framebuffers that sat unused for longer than max_idle_frames
+	void EndFrame();
+
+	// Drop every framebuffer that isn't acquired right now
+	void Clear();
+
+	inline unsigned int GetCount() const { return (unsigned int)entries_.size(); }
+};
@@ -0,0 +1,50 @@
+#include "Frustum.h"
+
+#include <cmath>
+
+Frustum Frustum::FromMatrix(const float* m)
+{
+	// row i of a column major matrix is (m[i], m[4 + i], m[8 + i], m[12 + i]), each plane is the last row
+	// plus or minus one of the others (Gribb & Hartmann)
+	Frustum frustum;
+	for (unsigned int plane = 0; plane < PLANE_COUNT; plane++)
+	{
+		unsigned int row = plane / 2;
+		float sign = (plane & 1) ? -1.0f : 1.0f;
+		for (unsigned int i = 0; i < 4; i++)
+			frustum.planes[plane][i] = m[i * 4 + 3] + sign * m[i * 4 + row];
+
+		float length = std::sqrt(frustum.planes[plane][0] * frustum.planes[plane][0] +
+			frustum.planes[plane][1] * frustum.planes[plane][1] + frustum.planes[plane][2] * frustum.planes[plane][2]);
+		if (length > 0.0f)
+		{
+			for (unsigned int i = 0; i < 4; i++)
+				frustum.planes[plane][i] /= length;
+		}
+	}
+	return frustum;
+}
+
+bool Frustum::IsSphereVisible(const float* center, float radius) const
+{
+	for (unsigned int plane = 0; plane < PLANE_COUNT; plane++)
+	{
+		const float* p = planes[plane];
+		if (p[0] * center[0] + p[1] * center[1] + p[2] * center[2] + p[3] < -radius)
+			return false;
+	}
+	return true;
+}
+
+bool Frustum::IsBoxVisible(const float* center, const float* extents) const
+{
+	for (unsigned int plane = 0; plane < PLANE_COUNT; plane++)
+	{
+		// how far the box reaches towards the plane normal
+		const float* p = planes[plane];
+		float radius = std::fabs(p[0]) * extents[0] + std::fabs(p[1]) * extents[1] + std::fabs(p[2]) * extents[2];
+		if (p[0] * center[0] + p[1] * center[1] + p[2] * center[2] + p[3] < -radius)
+			return false;
+	}
+	return true;
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+// The six planes of a camera's view volume, each stored as (a, b, c, d) with a normal pointing inside and
+// a unit length, so a * x + b * y + c * z + d is the signed distance of a point to the plane.
+struct Frustum
+{
+	enum Plane
+	{
+		// prefixed, windows.h defines NEAR and FAR
+		PLANE_LEFT = 0,
+		PLANE_RIGHT,
+		PLANE_BOTTOM,
+		PLANE_TOP,
+		PLANE_NEAR,
+		PLANE_FAR,
+		PLANE_COUNT
+	};
+
+	float planes[PLANE_COUNT][4];
+
+	// Planes of the clip volume of a column major view projection matrix (OpenGL convention, z in [-w, w]).
+	// With a projection only they are in view space, with view * projection in world space.
+	static Frustum FromMatrix(const float* view_projection);
+
+	// Scalar reference tests, the culler does the same thing for many objects at once
+	bool IsSphereVisible(const float* center, float radius) const;
+	bool IsBoxVisible(const float* center, const float* extents) const;
+};
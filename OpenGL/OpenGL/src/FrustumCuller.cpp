@@ -0,0 +1,132 @@
+#include "FrustumCuller.h"
+#include "Simd.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+
+// Bit i set if object begin + i is inside, for SIMD_WIDTH objects. Per plane the distance of the center is
+// compared with how far the object reaches towards the plane, the smaller of the sphere radius and the box
+// extents projected on the plane normal. Same as Frustum::IsBoxVisible && IsSphereVisible.
+static unsigned int CullBatch(const Frustum& frustum, const BoundingVolumes& bounds, unsigned int begin)
+{
+	SimdFloat center_x = SimdLoad(bounds.GetCenterX() + begin);
+	SimdFloat center_y = SimdLoad(bounds.GetCenterY() + begin);
+	SimdFloat center_z = SimdLoad(bounds.GetCenterZ() + begin);
+	SimdFloat extent_x = SimdLoad(bounds.GetExtentX() + begin);
+	SimdFloat extent_y = SimdLoad(bounds.GetExtentY() + begin);
+	SimdFloat extent_z = SimdLoad(bounds.GetExtentZ() + begin);
+	SimdFloat radius = SimdLoad(bounds.GetRadius() + begin);
+	SimdFloat zero = SimdSplat(0.0f);
+
+	unsigned int outside = 0;
+	for (unsigned int plane = 0; plane < Frustum::PLANE_COUNT; plane++)
+	{
+		const float* p = frustum.planes[plane];
+		SimdFloat distance = SimdMulAdd(SimdSplat(p[0]), center_x, SimdSplat(p[3]));
+		distance = SimdMulAdd(SimdSplat(p[1]), center_y, distance);
+		distance = SimdMulAdd(SimdSplat(p[2]), center_z, distance);
+
+		SimdFloat reach = SimdMul(SimdSplat(p[0] < 0.0f ? -p[0] : p[0]), extent_x);
+		reach = SimdMulAdd(SimdSplat(p[1] < 0.0f ? -p[1] : p[1]), extent_y, reach);
+		reach = SimdMulAdd(SimdSplat(p[2] < 0.0f ? -p[2] : p[2]), extent_z, reach);
+		reach = SimdMin(reach, radius);
+
+		// outside when distance < -reach
+		outside |= SimdLessMask(SimdAdd(distance, reach), zero);
+	}
+	return ~outside & ((1u << SIMD_WIDTH) - 1);
+}
+
+#if defined(SIMD_AVX)
+// Same as CullBatch for 8 objects
+SIMD_AVX_FUNCTION static unsigned int CullBatchAvx(const Frustum& frustum, const BoundingVolumes& bounds, unsigned int begin)
+{
+	__m256 center_x = _mm256_loadu_ps(bounds.GetCenterX() + begin);
+	__m256 center_y = _mm256_loadu_ps(bounds.GetCenterY() + begin);
+	__m256 center_z = _mm256_loadu_ps(bounds.GetCenterZ() + begin);
+	__m256 extent_x = _mm256_loadu_ps(bounds.GetExtentX() + begin);
+	__m256 extent_y = _mm256_loadu_ps(bounds.GetExtentY() + begin);
+	__m256 extent_z = _mm256_loadu_ps(bounds.GetExtentZ() + begin);
+	__m256 radius = _mm256_loadu_ps(bounds.GetRadius() + begin);
+	__m256 zero = _mm256_setzero_ps();
+
+	__m256 outside = _mm256_setzero_ps();
+	for (unsigned int plane = 0; plane < Frustum::PLANE_COUNT; plane++)
+	{
+		const float* p = frustum.planes[plane];
+		__m256 distance = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(p[0]), center_x), _mm256_set1_ps(p[3]));
+		distance = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(p[1]), center_y), distance);
+		distance = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(p[2]), center_z), distance);
+
+		__m256 reach = _mm256_mul_ps(_mm256_set1_ps(p[0] < 0.0f ? -p[0] : p[0]), extent_x);
+		reach = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(p[1] < 0.0f ? -p[1] : p[1]), extent_y), reach);
+		reach = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(p[2] < 0.0f ? -p[2] : p[2]), extent_z), reach);
+		reach = _mm256_min_ps(reach, radius);
+
+		outside = _mm256_or_ps(outside, _mm256_cmp_ps(_mm256_add_ps(distance, reach), zero, _CMP_LT_OQ));
+	}
+	return ~(unsigned int)_mm256_movemask_ps(outside) & 0xFF;
+}
+#endif
+
+FrustumCuller::FrustumCuller()
+	: use_avx_(SimdCpuHasAvx())
+{
+}
+
+void FrustumCuller::CullRange(const Frustum& frustum, const BoundingVolumes& bounds, unsigned int begin, unsigned int end,
+	std::vector<unsigned int>& visible) const
+{
+	// the arrays are padded to a whole batch, the padding is masked out of the last one
+	unsigned int count = bounds.GetCount();
+	for (unsigned int batch = begin; batch < end; batch += BoundingVolumes::BATCH)
+	{
+		unsigned int mask;
+#if defined(SIMD_AVX)
+		if (use_avx_)
+			mask = CullBatchAvx(frustum, bounds, batch);
+		else
+#endif
+			mask = CullBatch(frustum, bounds, batch) | (CullBatch(frustum, bounds, batch + SIMD_WIDTH) << SIMD_WIDTH);
+
+		if (count - batch < BoundingVolumes::BATCH)
+			mask &= (1u << (count - batch)) - 1;
+
+		while (mask)
+		{
+			unsigned int bit = SimdFirstBit(mask);
+			visible.push_back(batch + bit);
+			mask &= mask - 1;
+		}
+	}
+}
+
+void FrustumCuller::Cull(const Frustum& frustum, const BoundingVolumes& bounds, std::vector<unsigned int>& visible, ThreadPool* pool)
+{
+	visible.clear();
+	unsigned int count = bounds.GetCount();
+	if (!pool || count <= PARALLEL_CHUNK)
+	{
+		CullRange(frustum, bounds, 0, count, visible);
+		return;
+	}
+
+	// every chunk collects into its own list, putting them together in chunk order keeps the indices sorted
+	unsigned int chunk_count = (count + PARALLEL_CHUNK - 1) / PARALLEL_CHUNK;
+	if (chunk_visible_.size() < chunk_count)
+		chunk_visible_.resize(chunk_count);
+
+	pool->ParallelFor(chunk_count, 1, [&](size_t first_chunk, size_t last_chunk)
+	{
+		for (size_t chunk = first_chunk; chunk < last_chunk; chunk++)
+		{
+			unsigned int begin = (unsigned int)chunk * PARALLEL_CHUNK;
+			std::vector<unsigned int>& chunk_visible = chunk_visible_[chunk];
+			chunk_visible.clear();
+			CullRange(frustum, bounds, begin, std::min(begin + PARALLEL_CHUNK, count), chunk_visible);
+		}
+	});
+
+	for (unsigned int chunk = 0; chunk < chunk_count; chunk++)
+		visible.insert(visible.end(), chunk_visible_[chunk].begin(), chunk_visible_[chunk].end());
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <vector>
+
+#include "BoundingVolumes.h"
+#include "Frustum.h"
+
+class ThreadPool;
+
+// Finds the objects of a BoundingVolumes that are at least partly inside a frustum, several at a time:
+// 8 per instruction with AVX when the CPU has it, 4 with SSE or NEON otherwise. Long lists are split into
+// chunks that run on a ThreadPool. An object is only rejected when it is completely outside one plane,
+// so a few objects near the corners of the frustum get through, never the other way round.
+class FrustumCuller
+{
+private:
+	std::vector<std::vector<unsigned int>> chunk_visible_;   // reused from call to call, one per chunk
+	bool use_avx_;
+
+	// Append the visible objects of [begin, end) to visible, begin is a multiple of BoundingVolumes::BATCH
+	void CullRange(const Frustum& frustum, const BoundingVolumes& bounds, unsigned int begin, unsigned int end,
+		std::vector<unsigned int>& visible) const;
+
+public:
+	// objects per task when culling in parallel, below that the threads cost more than they save
+	static constexpr unsigned int PARALLEL_CHUNK = 4096;
+
+	FrustumCuller();
+
+	// Replace the contents of visible with the indices of the visible objects, in increasing order
+	void Cull(const Frustum& frustum, const BoundingVolumes& bounds, std::vector<unsigned int>& visible, ThreadPool* pool = nullptr);
+
+	inline bool IsUsingAvx() const { return use_avx_; }
+};
@@ -0,0 +1,34 @@
+#include "GLCapabilities.h"
+
+#include <GL/glew.h>
+
+static GLCapabilities capabilities;
+
+void GLCapabilities::Detect()
+{
+	capabilities = GLCapabilities();
+
+	// DSA is core in 4.5 but a lot of 3.3/4.x drivers expose it as an extension as well.
+	capabilities.direct_state_access = GLEW_VERSION_4_5 || GLEW_ARB_direct_state_access;
+	capabilities.texture_storage = GLEW_VERSION_4_2 || GLEW_ARB_texture_storage;
+
+	// S3TC is still an extension everywhere, the rest became core at some point.
+	capabilities.compression_s3tc = GLEW_EXT_texture_compression_s3tc;
+	capabilities.compression_rgtc = GLEW_VERSION_3_0 || GLEW_ARB_texture_compression_rgtc;
+	capabilities.compression_bptc = GLEW_VERSION_4_2 || GLEW_ARB_texture_compression_bptc;
+	capabilities.compression_etc2 = GLEW_VERSION_4_3 || GLEW_ARB_ES3_compatibility;
+	capabilities.shader_storage_buffer = GLEW_VERSION_4_3 || GLEW_ARB_shader_storage_buffer_object;
+	capabilities.bindless_texture = GLEW_ARB_bindless_texture;
+	capabilities.buffer_storage = GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage;
+	capabilities.invalidate_framebuffer = GLEW_VERSION_4_3 || GLEW_ARB_invalidate_subdata;
+	capabilities.parallel_shader_compile = GLEW_KHR_parallel_shader_compile || GLEW_ARB_parallel_shader_compile;
+	capabilities.program_interface_query = GLEW_VERSION_4_3 || GLEW_ARB_program_interface_query;
+	capabilities.gl_spirv = GLEW_VERSION_4_6 || GLEW_ARB_gl_spirv;
+	capabilities.compute_shader = GLEW_VERSION_4_3 || (GLEW_ARB_compute_shader && GLEW_ARB_shader_image_load_store);
+	capabilities.multi_draw_indirect = GLEW_VERSION_4_3 || GLEW_ARB_multi_draw_indirect;
+}
+
+const GLCapabilities& GLCapabilities::Get()
+{
+	return capabilities;
+}
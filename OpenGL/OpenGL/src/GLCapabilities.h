@@ -0,0 +1,51 @@
+#pragma once
+
+// Features of the current OpenGL context that change which code path the wrappers take.
+// Filled in once after glewInit() so the wrappers don't have to ask GLEW on every call.
+struct GLCapabilities
+{
+	// GL 4.5 or ARB_direct_state_access: buffers and vertex arrays can be edited without binding them
+	bool direct_state_access = false;
+
+	// GL 4.2 or ARB_texture_storage: immutable texture storage through glTexStorage2D
+	bool texture_storage = false;
+
+	// Block compressed formats the driver takes as-is, without decompressing them on the CPU
+	bool compression_s3tc = false;  // BC1-BC3
+	bool compression_rgtc = false;  // BC4-BC5
+	bool compression_bptc = false;  // BC6H-BC7
+	bool compression_etc2 = false;  // ETC2/EAC
+
+	// GL 4.3 or ARB_shader_storage_buffer_object: unbounded buffer blocks in shaders
+	bool shader_storage_buffer = false;
+
+	// ARB_bindless_texture: shaders can sample textures through 64 bit handles stored in buffers, no binding needed
+	bool bindless_texture = false;
+
+	// GL 4.4 or ARB_buffer_storage: buffers can stay mapped while the GPU uses them (persistent mapping)
+	bool buffer_storage = false;
+
+	// GL 4.3 or ARB_invalidate_subdata: tell the driver attachment contents are not needed anymore (tilers skip storing them)
+	bool invalidate_framebuffer = false;
+
+	// KHR/ARB_parallel_shader_compile: compiles and links run on driver threads, their status can be polled without blocking
+	bool parallel_shader_compile = false;
+
+	// GL 4.3 or ARB_program_interface_query: one query API for every kind of program resource (inputs, uniforms, blocks...)
+	bool program_interface_query = false;
+
+	// GL 4.6 or ARB_gl_spirv: shaders can be loaded as SPIR-V binaries compiled offline (glShaderBinary + glSpecializeShader)
+	bool gl_spirv = false;
+
+	// GL 4.3, or ARB_compute_shader with ARB_shader_image_load_store: compute dispatches that write images and buffers
+	bool compute_shader = false;
+
+	// GL 4.3 or ARB_multi_draw_indirect: many draws whose parameters come from a buffer, in one call
+	bool multi_draw_indirect = false;
+
+	// Query the current context, has to be called after glewInit()
+	static void Detect();
+
+	// Capabilities found by the last Detect(), everything is false before that
+	static const GLCapabilities& Get();
+};
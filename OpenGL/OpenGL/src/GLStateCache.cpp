@@ -0,0 +1,110 @@
+#include "GLStateCache.h"
+#include "GLCapabilities.h"
+#include "Renderer.h"
+
+#include <GL/glew.h>
+#include <atomic>
+#include <thread>
+
+struct TextureSlot
+{
+	unsigned int target;
+	unsigned int texture;
+};
+
+// only the render thread reads or writes these
+static TextureSlot texture_slots[GLStateCache::MAX_TEXTURE_SLOTS] = {};
+static unsigned int active_slot = 0;
+
+static std::thread::id render_thread;
+static std::atomic<bool> forget_all(false);   // set by other threads deleting textures
+
+static bool OnRenderThread()
+{
+	return std::this_thread::get_id() == render_thread;
+}
+
+// Drop everything when another thread deleted a texture, it can't touch the slots itself
+static void CheckForgotten()
+{
+	if (forget_all.exchange(false, std::memory_order_acquire))
+	{
+		for (TextureSlot& slot : texture_slots)
+			slot = {};
+	}
+}
+
+void GLStateCache::SetRenderThread()
+{
+	render_thread = std::this_thread::get_id();
+}
+
+void GLStateCache::BindTexture(unsigned int slot, unsigned int target, unsigned int texture)
+{
+	ASSERT(slot < MAX_TEXTURE_SLOTS);
+
+	// a loader thread's context isn't cached, bind straight away
+	if (!OnRenderThread())
+	{
+		if (GLCapabilities::Get().direct_state_access)
+		{
+			GLCALL(glBindTextureUnit(slot, texture));
+		}
+		else
+		{
+			GLCALL(glActiveTexture(GL_TEXTURE0 + slot));
+			GLCALL(glBindTexture(target, texture));
+		}
+		return;
+	}
+
+	CheckForgotten();
+	TextureSlot& bound = texture_slots[slot];
+	if (bound.texture == texture && bound.target == target)
+		return;
+
+	if (GLCapabilities::Get().direct_state_access)
+	{
+		// glBindTextureUnit picks the target from the texture itself and doesn't need glActiveTexture
+		GLCALL(glBindTextureUnit(slot, texture));
+	}
+	else
+	{
+		if (active_slot != slot)
+		{
+			GLCALL(glActiveTexture(GL_TEXTURE0 + slot));
+			active_slot = slot;
+		}
+		// a unit has one binding per target, clear the old one so the slot only holds one texture
+		if (bound.texture != 0 && bound.target != target)
+		{
+			GLCALL(glBindTexture(bound.target, 0));
+		}
+		GLCALL(glBindTexture(target, texture));
+	}
+
+	bound.target = target;
+	bound.texture = texture;
+}
+
+void GLStateCache::ForgetTexture(unsigned int texture)
+{
+	if (!OnRenderThread())
+	{
+		forget_all.store(true, std::memory_order_release);
+		return;
+	}
+
+	for (TextureSlot& slot : texture_slots)
+	{
+		if (slot.texture == texture)
+			slot = {};
+	}
+}
+
+unsigned int GLStateCache::GetBoundTexture(unsigned int slot)
+{
+	ASSERT(slot < MAX_TEXTURE_SLOTS && OnRenderThread());
+	CheckForgotten();
+	return texture_slots[slot].texture;
+}
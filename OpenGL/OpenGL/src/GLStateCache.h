@@ -0,0 +1,23 @@
+#pragma once
+
+// Remembers what is bound to each texture unit of the render thread's context so redundant binds never
+// reach the driver. Loader threads have contexts of their own: their binds go straight to GL, and a texture
+// they delete clears the whole cache, the name can come back for a new texture on the render thread.
+// Anything that binds textures has to go through here, otherwise the cache goes stale.
+class GLStateCache
+{
+public:
+	static constexpr unsigned int MAX_TEXTURE_SLOTS = 32;
+
+	// The calling thread's context is the one cached, call once after making the main context current
+	static void SetRenderThread();
+
+	// Bind texture to slot, does nothing if it is already bound there
+	static void BindTexture(unsigned int slot, unsigned int target, unsigned int texture);
+
+	// Has to be called when a texture is deleted (before the delete), GL unbinds it from every unit by itself
+	static void ForgetTexture(unsigned int texture);
+
+	// Texture currently bound to slot as far as the cache knows, render thread only
+	static unsigned int GetBoundTexture(unsigned int slot);
+};
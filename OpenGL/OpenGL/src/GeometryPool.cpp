@@ -0,0 +1,230 @@
+#include "GeometryPool.h"
+#include "GLCapabilities.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+
+// Copy bytes between two buffers on the GPU, without going through the CPU.
+static void CopyBuffer(unsigned int source, unsigned int destination, int source_offset, int destination_offset, int size)
+{
+	if (size == 0)
+		return;
+
+	if (GLCapabilities::Get().direct_state_access)
+	{
+		GLCALL(glCopyNamedBufferSubData(source, destination, source_offset, destination_offset, size));
+		return;
+	}
+
+	// the copy targets exist for exactly this, they don't disturb the array/element bindings
+	GLCALL(glBindBuffer(GL_COPY_READ_BUFFER, source));
+	GLCALL(glBindBuffer(GL_COPY_WRITE_BUFFER, destination));
+	GLCALL(glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, source_offset, destination_offset, size));
+	GLCALL(glBindBuffer(GL_COPY_READ_BUFFER, 0));
+	GLCALL(glBindBuffer(GL_COPY_WRITE_BUFFER, 0));
+}
+
+GeometryPool::GeometryPool(GpuResources& resources, const VertexBufferLayout& layout, unsigned int vertex_capacity, unsigned int index_capacity)
+	: resources_(resources), layout_(layout), vertex_allocator_(vertex_capacity), index_allocator_(index_capacity)
+{
+	vertex_buffer_ = resources_.Create<VertexBuffer>(nullptr, vertex_capacity * layout_.GetStride(), true);
+	index_buffer_ = resources_.Create<IndexBuffer>(nullptr, index_capacity, true);
+	vertex_array_ = resources_.Create<VertexArray>();
+	VertexArray* vertex_array = resources_.Get(vertex_array_);
+	vertex_array->AddBuffer(*resources_.Get(vertex_buffer_), layout_);
+	vertex_array->SetIndexBuffer(*resources_.Get(index_buffer_));
+}
+
+GeometryPool::~GeometryPool()
+{
+	resources_.Destroy(vertex_array_);
+	resources_.Destroy(vertex_buffer_);
+	resources_.Destroy(index_buffer_);
+}
+
+void GeometryPool::Relocate(unsigned int vertex_capacity, unsigned int index_capacity)
+{
+	unsigned int stride = layout_.GetStride();
+	VertexBufferHandle vertex_buffer = resources_.Create<VertexBuffer>(nullptr, vertex_capacity * stride, true);
+	IndexBufferHandle index_buffer = resources_.Create<IndexBuffer>(nullptr, index_capacity, true);
+
+	// looked up only once both exist, creating can move the other buffers of a pool
+	const VertexBuffer& old_vertices = *resources_.Get(vertex_buffer_);
+	const IndexBuffer& old_indices = *resources_.Get(index_buffer_);
+	unsigned int new_vertices = resources_.Get(vertex_buffer)->GetRendererId();
+	unsigned int new_indices = resources_.Get(index_buffer)->GetRendererId();
+
+	// walk the meshes in the order they sit in the buffer so the copies read front to back
+	std::vector<MeshId> order;
+	for (MeshId id = 0; id < ranges_.size(); id++)
+	{
+		if (live_[id])
+			order.push_back(id);
+	}
+	std::sort(order.begin(), order.end(), [this](MeshId a, MeshId b) { return ranges_[a].base_vertex < ranges_[b].base_vertex; });
+
+	unsigned int vertex_cursor = 0;
+	unsigned int index_cursor = 0;
+	for (MeshId id : order)
+	{
+		GeometryRange& range = ranges_[id];
+		CopyBuffer(old_vertices.GetRendererId(), new_vertices,
+			range.base_vertex * stride, vertex_cursor * stride, range.vertex_count * stride);
+		CopyBuffer(old_indices.GetRendererId(), new_indices,
+			range.first_index * sizeof(unsigned int), index_cursor * sizeof(unsigned int), range.index_count * sizeof(unsigned int));
+		range.base_vertex = vertex_cursor;
+		range.first_index = index_cursor;
+		vertex_cursor += range.vertex_count;
+		index_cursor += range.index_count;
+	}
+
+	vertex_allocator_.Grow(vertex_capacity);
+	index_allocator_.Grow(index_capacity);
+	vertex_allocator_.Reset(vertex_cursor);
+	index_allocator_.Reset(index_cursor);
+
+	resources_.Destroy(vertex_buffer_);
+	resources_.Destroy(index_buffer_);
+	vertex_buffer_ = vertex_buffer;
+	index_buffer_ = index_buffer;
+
+	// point the shared vertex array at the new buffers
+	VertexArray* vertex_array = resources_.Get(vertex_array_);
+	vertex_array->AddBuffer(*resources_.Get(vertex_buffer_), layout_);
+	vertex_array->SetIndexBuffer(*resources_.Get(index_buffer_));
+}
+
+GeometryPool::MeshId GeometryPool::Allocate(const void* vertices, unsigned int vertex_count, const unsigned int* indices, unsigned int index_count,
+	const MeshLod* lods, unsigned int lod_count)
+{
+	// the allocators have no empty ranges to give, and a mesh without triangles has nothing to draw anyway
+	if (vertex_count == 0 || index_count == 0)
+	{
+		std::cerr << "GeometryPool can't take an empty mesh (" << vertex_count << " vertices, " << index_count << " indices)" << std::endl;
+		return INVALID_MESH;
+	}
+	for (unsigned int level = 0; level < lod_count; level++)
+	{
+		if (lods[level].index_count == 0 || lods[level].first_index > index_count || lods[level].index_count > index_count - lods[level].first_index)
+		{
+			std::cerr << "GeometryPool mesh level of detail " << level << " is outside its " << index_count << " indices" << std::endl;
+			return INVALID_MESH;
+		}
+	}
+
+	unsigned int base_vertex = vertex_allocator_.Allocate(vertex_count);
+	unsigned int first_index = index_allocator_.Allocate(index_count);
+
+	if (base_vertex == RangeAllocator::INVALID_OFFSET || first_index == RangeAllocator::INVALID_OFFSET)
+	{
+		if (base_vertex != RangeAllocator::INVALID_OFFSET)
+			vertex_allocator_.Free(base_vertex, vertex_count);
+		if (first_index != RangeAllocator::INVALID_OFFSET)
+			index_allocator_.Free(first_index, index_count);
+
+		// if there is enough free space in total it's only fragmented, packing is enough.
+		// otherwise grow (at least doubling, so adding meshes one by one doesn't copy every time)
+		unsigned int vertex_capacity = vertex_allocator_.GetCapacity();
+		unsigned int index_capacity = index_allocator_.GetCapacity();
+		if (vertex_allocator_.GetFreeSpace() < vertex_count)
+			vertex_capacity = std::max(vertex_capacity * 2, vertex_capacity - vertex_allocator_.GetFreeSpace() + vertex_count);
+		if (index_allocator_.GetFreeSpace() < index_count)
+			index_capacity = std::max(index_capacity * 2, index_capacity - index_allocator_.GetFreeSpace() + index_count);
+		Relocate(vertex_capacity, index_capacity);
+
+		base_vertex = vertex_allocator_.Allocate(vertex_count);
+		first_index = index_allocator_.Allocate(index_count);
+		ASSERT(base_vertex != RangeAllocator::INVALID_OFFSET && first_index != RangeAllocator::INVALID_OFFSET);
+	}
+
+	resources_.Get(vertex_buffer_)->SubData(base_vertex * layout_.GetStride(), vertices, vertex_count * layout_.GetStride());
+	resources_.Get(index_buffer_)->SubData(first_index, indices, index_count);
+
+	MeshId id;
+	if (!free_ids_.empty())
+	{
+		id = free_ids_.back();
+		free_ids_.pop_back();
+	}
+	else
+	{
+		id = (MeshId)ranges_.size();
+		ranges_.push_back({});
+		lods_.push_back({});
+		live_.push_back(false);
+	}
+	ranges_[id] = { base_vertex, vertex_count, first_index, index_count };
+	if (lod_count)
+		lods_[id].assign(lods, lods + lod_count);
+	else
+		lods_[id].assign(1, { 0, index_count, 0.0f });
+	live_[id] = true;
+	return id;
+}
+
+void GeometryPool::Free(MeshId id)
+{
+	ASSERT(id < ranges_.size() && live_[id]);
+
+	const GeometryRange& range = ranges_[id];
+	vertex_allocator_.Free(range.base_vertex, range.vertex_count);
+	index_allocator_.Free(range.first_index, range.index_count);
+	live_[id] = false;
+	free_ids_.push_back(id);
+}
+
+void GeometryPool::Defragment()
+{
+	Relocate(vertex_allocator_.GetCapacity(), index_allocator_.GetCapacity());
+}
+
+const GeometryRange& GeometryPool::GetRange(MeshId id) const
+{
+	ASSERT(id < ranges_.size() && live_[id]);
+	return ranges_[id];
+}
+
+const MeshLod* GeometryPool::GetLods(MeshId id) const
+{
+	ASSERT(id < ranges_.size() && live_[id]);
+	return lods_[id].data();
+}
+
+unsigned int GeometryPool::GetLodCount(MeshId id) const
+{
+	ASSERT(id < ranges_.size() && live_[id]);
+	return (unsigned int)lods_[id].size();
+}
+
+void GeometryPool::Bind() const
+{
+	resources_.Get(vertex_array_)->Bind();
+}
+
+void GeometryPool::Draw(MeshId id, unsigned int level) const
+{
+	const GeometryRange& range = GetRange(id);
+	const MeshLod& lod = lods_[id][std::min(level, (unsigned int)lods_[id].size() - 1)];
+	GLCALL(glDrawElementsBaseVertex(GL_TRIANGLES, lod.index_count, GL_UNSIGNED_INT,
+		(void*)(uintptr_t)((range.first_index + lod.first_index) * sizeof(unsigned int)), range.base_vertex));
+}
+
+void GeometryPool::DrawBatch(const MeshId* ids, unsigned int count, const uint8_t* levels) const
+{
+	batch_counts_.resize(count);
+	batch_offsets_.resize(count);
+	batch_base_vertices_.resize(count);
+	for (unsigned int i = 0; i < count; i++)
+	{
+		const GeometryRange& range = GetRange(ids[i]);
+		const std::vector<MeshLod>& lods = lods_[ids[i]];
+		const MeshLod& lod = lods[levels ? std::min((unsigned int)levels[i], (unsigned int)lods.size() - 1) : 0];
+		batch_counts_[i] = lod.index_count;
+		batch_offsets_[i] = (void*)(uintptr_t)((range.first_index + lod.first_index) * sizeof(unsigned int));
+		batch_base_vertices_[i] = range.base_vertex;
+	}
+
+	GLCALL(glMultiDrawElementsBaseVertex(GL_TRIANGLES, batch_counts_.data(), GL_UNSIGNED_INT,
+		batch_offsets_.data(), count, batch_base_vertices_.data()));
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <vector>
+
+#include "GpuResources.h"
+#include "LodSelector.h"
+#include "RangeAllocator.h"
+
+// Where a mesh lives inside a GeometryPool. Ranges move when the pool grows or gets
+// defragmented, so keep the MeshId around and ask the pool instead of caching these.
+struct GeometryRange
+{
+	unsigned int base_vertex;
+	unsigned int vertex_count;
+	unsigned int first_index;
+	unsigned int index_count;
+};
+
+// One big vertex buffer, index buffer and vertex array shared by every mesh with the same layout.
+// Meshes get sub ranges of the buffers and are drawn with glDrawElementsBaseVertex, so their indices
+// stay local to the mesh and switching from one mesh to another needs no binding at all.
+class GeometryPool
+{
+public:
+	typedef unsigned int MeshId;
+	static constexpr MeshId INVALID_MESH = 0xFFFFFFFF;
+
+private:
+	GpuResources& resources_;
+	VertexBufferLayout layout_;
+	VertexBufferHandle vertex_buffer_;
+	IndexBufferHandle index_buffer_;
+	VertexArrayHandle vertex_array_;
+	RangeAllocator vertex_allocator_;
+	RangeAllocator index_allocator_;
+
+	std::vector<GeometryRange> ranges_;
+	std::vector<std::vector<MeshLod>> lods_;   // index ranges relative to the mesh's first index
+	std::vector<bool> live_;
+	std::vector<MeshId> free_ids_;
+
+	// scratch space for DrawBatch so drawing doesn't allocate every frame
+	mutable std::vector<int> batch_counts_;
+	mutable std::vector<void*> batch_offsets_;
+	mutable std::vector<int> batch_base_vertices_;
+
+	// Move everything into new buffers of the given capacity, packing the meshes to the front
+	void Relocate(unsigned int vertex_capacity, unsigned int index_capacity);
+
+public:
+	// Capacities are in vertices and indices, the pool grows by itself when it runs out. The buffers and
+	// the vertex array are created in resources, which has to outlive the pool.
+	GeometryPool(GpuResources& resources, const VertexBufferLayout& layout, unsigned int vertex_capacity, unsigned int index_capacity);
+	~GeometryPool();
+
+	GeometryPool(const GeometryPool&) = delete;
+	GeometryPool& operator=(const GeometryPool&) = delete;
+
+	// Copy a mesh into the pool, indices are relative to the first vertex of the mesh. lods split the
+	// indices into levels of detail, without them all the indices are a single level.
+	// INVALID_MESH (after printing why) for an empty mesh or levels outside the indices.
+	MeshId Allocate(const void* vertices, unsigned int vertex_count, const unsigned int* indices, unsigned int index_count,
+		const MeshLod* lods = nullptr, unsigned int lod_count = 0);
+
+	// Give the ranges of the mesh back to the pool
+	void Free(MeshId id);
+
+	// Pack every mesh to the start of the buffers so all the free space is in one piece again
+	void Defragment();
+
+	const GeometryRange& GetRange(MeshId id) const;
+
+	// Levels of detail of a mesh, for LodSelector
+	const MeshLod* GetLods(MeshId id) const;
+	unsigned int GetLodCount(MeshId id) const;
+
+	// Bind the shared vertex array, has to be done once before Draw/DrawBatch
+	void Bind() const;
+
+	// Draw one level of detail of a mesh of the pool
+	void Draw(MeshId id, unsigned int level = 0) const;
+
+	// Draw several meshes of the pool with a single glMultiDrawElementsBaseVertex call, levels gives the
+	// level of detail of each (all full detail when it is nullptr)
+	void DrawBatch(const MeshId* ids, unsigned int count, const uint8_t* levels = nullptr) const;
+
+	inline unsigned int GetVertexCapacity() const { return vertex_allocator_.GetCapacity(); }
+	inline unsigned int GetIndexCapacity() const { return index_allocator_.GetCapacity(); }
+};
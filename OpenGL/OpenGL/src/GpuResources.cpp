@@ -0,0 +1,18 @@
+#include "GpuResources.h"
+
+GpuResources::~GpuResources()
+{
+	Clear();
+}
+
+void GpuResources::Clear()
+{
+	GetPool<VertexArray>().Clear();
+	GetPool<Framebuffer>().Clear();
+	GetPool<ShaderProgram>().Clear();
+	GetPool<VertexBuffer>().Clear();
+	GetPool<IndexBuffer>().Clear();
+	GetPool<ShaderBuffer>().Clear();
+	GetPool<Texture>().Clear();
+	deletion_queue_.Flush();
+}
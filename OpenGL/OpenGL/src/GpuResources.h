@@ -0,0 +1,89 @@
+#pragma once
+
+#include <tuple>
+#include <utility>
+
+#include "DeletionQueue.h"
+#include "Framebuffer.h"
+#include "HandlePool.h"
+#include "Shader.h"
+#include "ShaderBuffer.h"
+#include "Texture.h"
+#include "VertexArray.h"
+
+typedef Handle<VertexBuffer> VertexBufferHandle;
+typedef Handle<IndexBuffer> IndexBufferHandle;
+typedef Handle<VertexArray> VertexArrayHandle;
+typedef Handle<ShaderProgram> ShaderProgramHandle;
+typedef Handle<Texture> TextureHandle;
+typedef Handle<Framebuffer> FramebufferHandle;
+typedef Handle<ShaderBuffer> ShaderBufferHandle;
+
+// Owner of the GL objects the renderer works with, one HandlePool per kind. Instead of a heap allocated
+// wrapper per buffer the objects sit packed in their pool and everything else holds 32 bit handles, which
+// fit in sort keys and render commands, and a handle to something already destroyed is caught at lookup
+// (Get returns nullptr) instead of reaching a deleted GL name. Destroying only retires the handle, the GL object
+// goes through a DeletionQueue and is deleted once the GPU finished the frame that may still use it.
+// Create/Get/Destroy work for any of the kinds:
+//     VertexBufferHandle buffer = resources.Create<VertexBuffer>(data, size);
+//     resources.Get(buffer)->Bind();
+class GpuResources
+{
+private:
+	std::tuple<HandlePool<VertexBuffer>, HandlePool<IndexBuffer>, HandlePool<VertexArray>,
+		HandlePool<ShaderProgram>, HandlePool<Texture>, HandlePool<Framebuffer>, HandlePool<ShaderBuffer>> pools_;
+	DeletionQueue deletion_queue_;
+
+	template<typename T>
+	inline HandlePool<T>& GetPool() { return std::get<HandlePool<T>>(pools_); }
+
+	template<typename T>
+	inline const HandlePool<T>& GetPool() const { return std::get<HandlePool<T>>(pools_); }
+
+public:
+	GpuResources() = default;
+	~GpuResources();
+
+	GpuResources(const GpuResources&) = delete;
+	GpuResources& operator=(const GpuResources&) = delete;
+
+	// New T made from args, with T's own constructor
+	template<typename T, typename... Args>
+	Handle<T> Create(Args&&... args)
+	{
+		return GetPool<T>().Create(std::forward<Args>(args)...);
+	}
+
+	// The handle and every copy of it go stale right away, the GL object is deleted a few frames later
+	template<typename T>
+	void Destroy(Handle<T> handle)
+	{
+		T* object = GetPool<T>().Get(handle);
+		ASSERT(object);
+		object->Release(deletion_queue_);
+		GetPool<T>().Destroy(handle);
+	}
+
+	// nullptr for a stale handle. The pointer is only good until the next Create/Destroy of the same kind.
+	template<typename T>
+	inline T* Get(Handle<T> handle) { return GetPool<T>().Get(handle); }
+
+	template<typename T>
+	inline const T* Get(Handle<T> handle) const { return GetPool<T>().Get(handle); }
+
+	template<typename T>
+	inline bool IsAlive(Handle<T> handle) const { return GetPool<T>().IsAlive(handle); }
+
+	template<typename T>
+	inline unsigned int GetCount() const { return GetPool<T>().GetCount(); }
+
+	// Once per frame after its last draw, deletes the objects destroyed in earlier frames the GPU is done with
+	inline void EndFrame() { deletion_queue_.EndFrame(); }
+
+	// Delete everything right away, live or waiting in the queue. Vertex arrays and framebuffers go before
+	// the buffers and textures they use.
+	void Clear();
+
+	// For objects that don't live in the pools but should be deleted the same way
+	inline DeletionQueue& GetDeletionQueue() { return deletion_queue_; }
+};
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "Renderer.h"
+
+// 32 bit reference to an object of a HandlePool<T>: the low 20 bits are a slot of the pool, the high 12 bits
+// the generation of that slot when the handle was made. Destroying the object bumps the generation, so a handle
+// that outlived its object is told apart from one to whatever reuses the slot later. Zero is never a live
+// handle, a zero initialized one is simply invalid. Handles compare and sort like the integers they are.
+template<typename T>
+struct Handle
+{
+	static constexpr unsigned int INDEX_BITS = 20;
+	static constexpr uint32_t INDEX_MASK = (1u << INDEX_BITS) - 1;
+	static constexpr uint32_t MAX_GENERATION = (1u << (32 - INDEX_BITS)) - 1;
+
+	uint32_t value = 0;
+
+	static constexpr Handle Make(uint32_t index, uint32_t generation) { return { (generation << INDEX_BITS) | index }; }
+
+	constexpr uint32_t GetIndex() const { return value & INDEX_MASK; }
+	constexpr uint32_t GetGeneration() const { return value >> INDEX_BITS; }
+	constexpr bool IsValid() const { return value != 0; }
+
+	constexpr bool operator==(Handle other) const { return value == other.value; }
+	constexpr bool operator!=(Handle other) const { return value != other.value; }
+	constexpr bool operator<(Handle other) const { return value < other.value; }
+};
+
+// Objects packed into one array, handed out by Handle. A lookup is two array reads and a generation compare,
+// destroying moves the last object into the hole so the array never has gaps and walking every object is a
+// plain loop. The price is that objects move: T has to be movable, and pointers from Get are only good until
+// the next Create or Destroy, keep the handle instead.
+template<typename T>
+class HandlePool
+{
+private:
+	std::vector<T> objects_;
+	std::vector<uint32_t> slot_of_object_;   // parallel to objects_
+	std::vector<uint32_t> object_of_slot_;   // by slot
+	std::vector<uint32_t> generations_;      // by slot, the generation of the live handle or the next one
+	std::vector<uint32_t> free_slots_;
+
+public:
+	HandlePool() = default;
+
+	HandlePool(const HandlePool&) = delete;
+	HandlePool& operator=(const HandlePool&) = delete;
+
+	// New object constructed from args
+	template<typename... Args>
+	Handle<T> Create(Args&&... args)
+	{
+		uint32_t slot;
+		if (!free_slots_.empty())
+		{
+			slot = free_slots_.back();
+			free_slots_.pop_back();
+		}
+		else
+		{
+			slot = (uint32_t)generations_.size();
+			ASSERT(slot <= Handle<T>::INDEX_MASK);
+			object_of_slot_.push_back(0);
+			generations_.push_back(1);
+		}
+
+		object_of_slot_[slot] = (uint32_t)objects_.size();
+		objects_.emplace_back(std::forward<Args>(args)...);
+		slot_of_object_.push_back(slot);
+		return Handle<T>::Make(slot, generations_[slot]);
+	}
+
+	void Destroy(Handle<T> handle)
+	{
+		ASSERT(IsAlive(handle));
+		uint32_t slot = handle.GetIndex();
+		uint32_t object = object_of_slot_[slot];
+		uint32_t last = (uint32_t)objects_.size() - 1;
+		if (object != last)
+		{
+			objects_[object] = std::move(objects_[last]);
+			slot_of_object_[object] = slot_of_object_[last];
+			object_of_slot_[slot_of_object_[object]] = object;
+		}
+		objects_.pop_back();
+		slot_of_object_.pop_back();
+
+		// a slot that went through every generation is retired, so its old handles stay stale for good
+		if (++generations_[slot] <= Handle<T>::MAX_GENERATION)
+			free_slots_.push_back(slot);
+	}
+
+	// Destroy every object, all handles handed out so far go stale
+	void Clear()
+	{
+		while (!objects_.empty())
+		{
+			uint32_t slot = slot_of_object_.back();
+			Destroy(Handle<T>::Make(slot, generations_[slot]));
+		}
+	}
+
+	inline bool IsAlive(Handle<T> handle) const
+	{
+		uint32_t slot = handle.GetIndex();
+		return handle.IsValid() && slot < generations_.size() && generations_[slot] == handle.GetGeneration();
+	}
+
+	// nullptr when the object of the handle was destroyed
+	inline T* Get(Handle<T> handle)
+	{
+		return IsAlive(handle) ? &objects_[object_of_slot_[handle.GetIndex()]] : nullptr;
+	}
+
+	inline const T* Get(Handle<T> handle) const
+	{
+		return IsAlive(handle) ? &objects_[object_of_slot_[handle.GetIndex()]] : nullptr;
+	}
+
+	// Every live object, in no particular order
+	inline T* GetObjects() { return objects_.data(); }
+	inline const T* GetObjects() const { return objects_.data(); }
+	inline unsigned int GetCount() const { return (unsigned int)objects_.size(); }
+};
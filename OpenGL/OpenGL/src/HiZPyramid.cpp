@@ -0,0 +1,72 @@
+#include "HiZPyramid.h"
+#include "Renderer.h"
+
+#include <GL/glew.h>
+
+// feature bit of HiZ.shader, set for the level copied from the depth buffer
+static constexpr uint64_t FIRST_LEVEL = 1;
+
+HiZPyramid::HiZPyramid(ShaderPreprocessor& preprocessor, GpuResources& resources)
+	: resources_(resources),
+	shader_(std::make_unique<ShaderVariantCache>("res/shaders/HiZ.shader", std::vector<std::string>{ "HIZ_FIRST_LEVEL" }, preprocessor, resources))
+{
+}
+
+HiZPyramid::~HiZPyramid()
+{
+	if (texture_.IsValid())
+		resources_.Destroy(texture_);
+}
+
+bool HiZPyramid::Build(const Texture& depth)
+{
+	unsigned int width = depth.GetWidth();
+	unsigned int height = depth.GetHeight();
+	Texture* texture = resources_.Get(texture_);
+	if (!texture || texture->GetWidth() != width || texture->GetHeight() != height)
+	{
+		// the culling of the last frame may still sample the old one
+		if (texture)
+			resources_.Destroy(texture_);
+		texture_ = resources_.Create<Texture>(width, height, GL_R32F, Texture::CountMipLevels(width, height));
+		texture = resources_.Get(texture_);
+		texture->SetFilter(GL_NEAREST_MIPMAP_NEAREST, GL_NEAREST);
+		texture->SetWrap(GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE);
+	}
+
+	unsigned int source_width = width;
+	unsigned int source_height = height;
+	for (unsigned int level = 0; level < texture->GetLevels(); level++)
+	{
+		uint64_t key = level == 0 ? FIRST_LEVEL : 0;
+		unsigned int program = shader_->GetProgram(key);
+		if (!program)
+			return false;
+		const ShaderReflection* reflection = shader_->GetReflection(key);
+		GLCALL(glUseProgram(program));
+
+		// a level reads the one below it through the sampler while it is written through the image,
+		// different levels of one texture so that's allowed
+		if (level == 0)
+		{
+			depth.Bind(0);
+		}
+		else
+		{
+			texture->Bind(0);
+			GLCALL(glUniform1i(reflection->GetUniformLocation("u_SourceLevel"), level - 1));
+			GLCALL(glUniform2i(reflection->GetUniformLocation("u_SourceSize"), source_width, source_height));
+		}
+
+		unsigned int level_width = width >> level ? width >> level : 1;
+		unsigned int level_height = height >> level ? height >> level : 1;
+		GLCALL(glBindImageTexture(0, texture->GetRendererId(), level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F));
+		GLCALL(glDispatchCompute((level_width + GROUP_SIZE - 1) / GROUP_SIZE, (level_height + GROUP_SIZE - 1) / GROUP_SIZE, 1));
+
+		// the next level reads this one
+		GLCALL(glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT));
+		source_width = level_width;
+		source_height = level_height;
+	}
+	return true;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <memory>
+
+#include "GpuResources.h"
+#include "ShaderVariantCache.h"
+
+// Mip chain of a depth buffer where every texel holds the farthest depth below it (hierarchical Z).
+// Whether a screen rectangle is hidden is then a few texel reads at the level where it is a texel wide,
+// whatever its size. Built with compute shaders, so it needs GLCapabilities::compute_shader.
+class HiZPyramid
+{
+private:
+	GpuResources& resources_;
+	std::unique_ptr<ShaderVariantCache> shader_;
+	TextureHandle texture_;
+
+public:
+	// threads per work group along x and y, has to match HiZ.shader
+	static constexpr unsigned int GROUP_SIZE = 8;
+
+	// the pyramid texture lives in resources, one replaced after a resize is deleted once the GPU is done with it
+	HiZPyramid(ShaderPreprocessor& preprocessor, GpuResources& resources);
+	~HiZPyramid();
+
+	HiZPyramid(const HiZPyramid&) = delete;
+	HiZPyramid& operator=(const HiZPyramid&) = delete;
+
+	// Rebuild from a single sampled depth texture, the pyramid is reallocated when its size changed.
+	// Leaves the last compute program bound. False if the shader didn't compile.
+	bool Build(const Texture& depth);
+
+	// nullptr until the first Build
+	inline const Texture* GetTexture() const { return resources_.Get(texture_); }
+};
@@ -0,0 +1,206 @@
+#include "ImageDecodePool.h"
+#include "MappedFile.h"
+#include "PngDecoder.h"
+#include "TextureFile.h"
+
+#include <GL/glew.h>
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+typedef std::chrono::steady_clock Clock;
+
+static double SecondsSince(Clock::time_point start)
+{
+	return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+ImageDecodePool::ImageDecodePool(ThreadPool& threads, GpuResources& resources, size_t staging_capacity)
+	: threads_(threads), resources_(resources), staging_(staging_capacity), pending_decodes_(0)
+{
+}
+
+ImageDecodePool::~ImageDecodePool()
+{
+	// workers can be waiting for staging space, which only comes back through Collect(), so keep recycling until they're done
+	while (true)
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			for (std::unique_ptr<DecodedImage>& decoded : decoded_)
+				staging_.Release(decoded->staging);
+			decoded_.clear();
+			if (pending_decodes_ == 0)
+				break;
+		}
+		staging_.Collect();
+		std::this_thread::yield();
+	}
+}
+
+std::unique_ptr<ImageDecodePool::DecodedImage> ImageDecodePool::Decode(const std::string& path)
+{
+	std::unique_ptr<DecodedImage> decoded = std::make_unique<DecodedImage>();
+
+	MappedFile file;
+	if (!file.Open(path))
+	{
+		std::cerr << "Error opening the image " << path << std::endl;
+		return nullptr;
+	}
+
+	const unsigned char* bytes = (const unsigned char*)file.GetData();
+	unsigned int width, height;
+	if (ReadPngSize(bytes, file.GetSize(), width, height))
+	{
+		// the scratch buffer lives as long as the worker thread, so decoding doesn't allocate once it's warm
+		static thread_local std::vector<unsigned char> scratch;
+
+		decoded->staging = staging_.Allocate((size_t)width * height * 4);
+		if (!DecodePng(bytes, file.GetSize(), decoded->staging.memory, scratch))
+		{
+			std::cerr << "Failed to decode the PNG " << path << std::endl;
+			staging_.Release(decoded->staging);
+			return nullptr;
+		}
+
+		decoded->image.internal_format = GL_RGBA8;
+		decoded->image.format = GL_RGBA;
+		decoded->image.type = GL_UNSIGNED_BYTE;
+		decoded->image.levels.push_back({ width, height, decoded->staging.memory, decoded->staging.size });
+		decoded->levels = Texture::CountMipLevels(width, height);
+		return decoded;
+	}
+
+	if (IsPng(bytes, file.GetSize()))
+	{
+		std::cerr << "Unsupported or corrupt PNG header (bit depth, color type or a size over " << PNG_MAX_DIMENSION << ") in " << path << std::endl;
+		return nullptr;
+	}
+
+	if (file.GetSize() >= 3 && bytes[0] == 0xFF && bytes[1] == 0xD8 && bytes[2] == 0xFF)
+	{
+		std::cerr << "JPEG decoding isn't built in, convert " << path << " to KTX2 or PNG offline" << std::endl;
+		return nullptr;
+	}
+
+	// containers hold data the GPU takes as it is, "decoding" is copying the levels into staging memory
+	file.Close();
+	TextureFile container;
+	if (!container.Open(path))
+		return nullptr;
+
+	const TextureImage& image = container.GetImage();
+	size_t total = 0;
+	for (const TextureLevel& level : image.levels)
+		total += level.size;
+
+	decoded->staging = staging_.Allocate(total);
+	decoded->image = image;
+	size_t offset = 0;
+	for (TextureLevel& level : decoded->image.levels)
+	{
+		std::memcpy(decoded->staging.memory + offset, level.data, level.size);
+		level.data = decoded->staging.memory + offset;
+		offset += level.size;
+	}
+	decoded->levels = image.levels.size() == 1 && !image.compressed
+		? Texture::CountMipLevels(image.levels[0].width, image.levels[0].height) : (unsigned int)image.levels.size();
+	return decoded;
+}
+
+void ImageDecodePool::Load(const std::string& path, TextureReadyFunction ready)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		pending_decodes_++;
+	}
+
+	threads_.Submit([this, path, ready]()
+	{
+		Clock::time_point start = Clock::now();
+		std::unique_ptr<DecodedImage> decoded = Decode(path);
+		double seconds = SecondsSince(start);
+
+		std::lock_guard<std::mutex> lock(mutex_);
+		pending_decodes_--;
+		stats_.decode_seconds += seconds;
+		if (!decoded)
+		{
+			stats_.images_failed++;
+			return;
+		}
+		stats_.images_decoded++;
+		stats_.decoded_bytes += decoded->staging.size;
+		decoded->ready = ready;
+		decoded_.push_back(std::move(decoded));
+	});
+}
+
+void ImageDecodePool::Poll(double budget_ms)
+{
+	staging_.Collect();
+
+	Clock::time_point start = Clock::now();
+	std::vector<StagingAllocation> uploaded;
+	std::vector<std::pair<TextureHandle, TextureReadyFunction>> finished;
+	uint64_t uploaded_bytes = 0;
+
+	// at least one image per call, so a budget smaller than one upload still makes progress
+	while (finished.empty() || SecondsSince(start) * 1000.0 < budget_ms)
+	{
+		std::unique_ptr<DecodedImage> decoded;
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			if (decoded_.empty())
+				break;
+			decoded = std::move(decoded_.front());
+			decoded_.pop_front();
+		}
+
+		const TextureImage& image = decoded->image;
+		TextureHandle handle = resources_.Create<Texture>(image.levels[0].width, image.levels[0].height,
+			image.internal_format, decoded->levels);
+		Texture* texture = resources_.Get(handle);
+
+		if (decoded->staging.in_buffer)
+		{
+			// with the staging buffer bound the level "pointers" are offsets into it
+			TextureImage offsets = image;
+			for (TextureLevel& level : offsets.levels)
+				level.data = (const void*)(decoded->staging.offset + ((const unsigned char*)level.data - decoded->staging.memory));
+			staging_.BindForUpload();
+			texture->Upload(offsets);
+			staging_.UnbindForUpload();
+		}
+		else
+		{
+			texture->Upload(image);
+		}
+
+		uploaded.push_back(decoded->staging);
+		uploaded_bytes += decoded->staging.size;
+		finished.emplace_back(handle, std::move(decoded->ready));
+	}
+
+	if (finished.empty())
+		return;
+
+	staging_.ReleaseAfterUpload(std::move(uploaded));
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		stats_.images_uploaded += (unsigned int)finished.size();
+		stats_.uploaded_bytes += uploaded_bytes;
+		stats_.upload_seconds += SecondsSince(start);
+	}
+
+	for (auto& texture : finished)
+		texture.second(texture.first);
+}
+
+ImageDecodeStats ImageDecodePool::GetStats()
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return stats_;
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "GpuResources.h"
+#include "StagingBuffer.h"
+#include "ThreadPool.h"
+
+// Throughput counters of an ImageDecodePool, decode time is summed over every worker thread
+struct ImageDecodeStats
+{
+	unsigned int images_decoded = 0;
+	unsigned int images_uploaded = 0;
+	unsigned int images_failed = 0;
+	uint64_t decoded_bytes = 0;
+	uint64_t uploaded_bytes = 0;
+	double decode_seconds = 0.0;
+	double upload_seconds = 0.0;
+
+	// MB per second of busy time, decode is per worker so multiply by the thread count for the pool total
+	inline double GetDecodeThroughput() const { return decode_seconds > 0.0 ? decoded_bytes / decode_seconds / (1024.0 * 1024.0) : 0.0; }
+	inline double GetUploadThroughput() const { return upload_seconds > 0.0 ? uploaded_bytes / upload_seconds / (1024.0 * 1024.0) : 0.0; }
+};
+
+// Decodes image files on a thread pool straight into staging memory, then uploads them on the render thread.
+// PNG is decoded on the workers, DDS/KTX2 levels are copied out as they are (compressed data stays compressed).
+class ImageDecodePool
+{
+public:
+	typedef std::function<void(TextureHandle)> TextureReadyFunction;
+
+private:
+	struct DecodedImage
+	{
+		TextureImage image;
+		StagingAllocation staging;
+		unsigned int levels;
+		TextureReadyFunction ready;
+	};
+
+	ThreadPool& threads_;
+	GpuResources& resources_;
+	StagingBuffer staging_;
+
+	std::mutex mutex_;
+	std::deque<std::unique_ptr<DecodedImage>> decoded_;
+	unsigned int pending_decodes_;
+	ImageDecodeStats stats_;
+
+	std::unique_ptr<DecodedImage> Decode(const std::string& path);
+
+public:
+	// Has to be created on the render thread, staging_capacity is the size of the pinned staging buffer in bytes.
+	// The textures are created in resources.
+	ImageDecodePool(ThreadPool& threads, GpuResources& resources, size_t staging_capacity = 64 * 1024 * 1024);
+
+	// Waits for the decodes still running, their images are dropped without being uploaded
+	~ImageDecodePool();
+
+	ImageDecodePool(const ImageDecodePool&) = delete;
+	ImageDecodePool& operator=(const ImageDecodePool&) = delete;
+
+	// Queue a PNG, DDS or KTX2 file for decoding, ready runs on the render thread in Poll() with the finished texture
+	void Load(const std::string& path, TextureReadyFunction ready);
+
+	// Render thread, once per frame. Uploads decoded images until budget_ms is used up and recycles staging memory.
+	void Poll(double budget_ms = 2.0);
+
+	ImageDecodeStats GetStats();
+};
@@ -1,20 +1,72 @@
 #include "Renderer.h"
 #include "GL/glew.h"
 #include "IndexBuffer.h"
+#include "GLCapabilities.h"
+#include "DeletionQueue.h"
 
-IndexBuffer::IndexBuffer(const unsigned int *indices, int count)
+#include <utility>
+
+IndexBuffer::IndexBuffer(const unsigned int *indices, int count, bool dynamic)
+	: count_(count)
 {
 	// Because unsigned int's can have different bytes in different operating systems.
 	ASSERT(sizeof(unsigned int) == sizeof(GLuint));
 
+	if (GLCapabilities::Get().direct_state_access)
+	{
+		// No binding needed, and unlike glBindBuffer below this can't accidentally
+		// attach the buffer to whichever vertex array happens to be bound.
+		GLCALL(glCreateBuffers(1, &renderer_id_));
+		GLCALL(glNamedBufferStorage(renderer_id_, count * sizeof(unsigned int), indices, dynamic ? GL_DYNAMIC_STORAGE_BIT : 0));
+		return;
+	}
+
 	GLCALL(glGenBuffers(1, &renderer_id_));
 	GLCALL(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, renderer_id_));
-	GLCALL(glBufferData(GL_ELEMENT_ARRAY_BUFFER, count * sizeof(unsigned int), indices, GL_STATIC_DRAW));
+	GLCALL(glBufferData(GL_ELEMENT_ARRAY_BUFFER, count * sizeof(unsigned int), indices, dynamic ? GL_DYNAMIC_DRAW : GL_STATIC_DRAW));
 }
 
 IndexBuffer::~IndexBuffer()
 {
+	if (renderer_id_ == 0)
+		return;
 	GLCALL(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0));
+	GLCALL(glDeleteBuffers(1, &renderer_id_));
+}
+
+IndexBuffer::IndexBuffer(IndexBuffer&& other) noexcept
+	: renderer_id_(std::exchange(other.renderer_id_, 0)), count_(std::exchange(other.count_, 0))
+{
+}
+
+IndexBuffer& IndexBuffer::operator=(IndexBuffer&& other) noexcept
+{
+	// the old objects go with other when it is destroyed
+	std::swap(renderer_id_, other.renderer_id_);
+	std::swap(count_, other.count_);
+	return *this;
+}
+
+void IndexBuffer::Release(DeletionQueue& queue)
+{
+	queue.Delete(GLObjectType::BUFFER, std::exchange(renderer_id_, 0));
+	count_ = 0;
+}
+
+void IndexBuffer::SubData(int first_index, const unsigned int* indices, int count)
+{
+	ASSERT(first_index + count <= count_);
+
+	if (GLCapabilities::Get().direct_state_access)
+	{
+		GLCALL(glNamedBufferSubData(renderer_id_, first_index * sizeof(unsigned int), count * sizeof(unsigned int), indices));
+		return;
+	}
+
+	// binding GL_ELEMENT_ARRAY_BUFFER here would change the bound vertex array, so use the copy-write target instead
+	GLCALL(glBindBuffer(GL_COPY_WRITE_BUFFER, renderer_id_));
+	GLCALL(glBufferSubData(GL_COPY_WRITE_BUFFER, first_index * sizeof(unsigned int), count * sizeof(unsigned int), indices));
+	GLCALL(glBindBuffer(GL_COPY_WRITE_BUFFER, 0));
 }
 
 void IndexBuffer::Bind()
@@ -1,20 +1,41 @@
 #pragma once
 
+class DeletionQueue;
+
 class IndexBuffer
 {
 private:
 	unsigned int renderer_id_;
+	int count_;
 
 public:
-	// Constructor 
-	IndexBuffer(const unsigned int* indices, int count);
+	// Constructor, dynamic buffers can be written to later through SubData
+	IndexBuffer(const unsigned int* indices, int count, bool dynamic = false);
 
 	// Destructor
 	~IndexBuffer();
 
+	// Movable so buffers can live by value in a HandlePool, the moved from one owns nothing
+	IndexBuffer(IndexBuffer&& other) noexcept;
+	IndexBuffer& operator=(IndexBuffer&& other) noexcept;
+	IndexBuffer(const IndexBuffer&) = delete;
+	IndexBuffer& operator=(const IndexBuffer&) = delete;
+
+	// Hand the GL object to queue to be deleted once the GPU is done with it, this owns nothing afterwards
+	void Release(DeletionQueue& queue);
+
 	// To bind the vertex buffer id of the object with OpenGL 
 	void Bind();
 
 	// To Unbind the vertex buffer id of the object with OpenGl
 	void Unbind();
+
+	// Overwrite count indices starting at first_index of a dynamic buffer
+	void SubData(int first_index, const unsigned int* indices, int count);
+
+	// OpenGL name of the buffer, used when attaching it to a vertex array without binding
+	inline unsigned int GetRendererId() const { return renderer_id_; }
+
+	// Number of indices stored in the buffer
+	inline int GetCount() const { return count_; }
 };
\ No newline at end of file
@@ -0,0 +1,97 @@
+#include "LodSelector.h"
+#include "BoundingVolumes.h"
+
+#include <algorithm>
+#include <cmath>
+
+// marks an object in SelectAll's levels that hasn't been drawn yet
+static constexpr uint8_t NO_LEVEL = 0xFF;
+
+// an object whose sphere contains the camera is as close as it gets, this keeps the division finite
+static constexpr float MIN_DISTANCE = 1e-3f;
+
+LodSelector::LodSelector(float threshold, float hysteresis)
+	: threshold_(threshold), hysteresis_(hysteresis), pixels_per_unit_(0.0f)
+{
+	// 60 degrees on a 720 pixel viewport until the application says otherwise
+	SetProjection(1.0471976f, 720.0f);
+}
+
+void LodSelector::SetProjection(float vertical_fov, float viewport_height)
+{
+	pixels_per_unit_ = viewport_height / (2.0f * std::tan(vertical_fov * 0.5f));
+}
+
+float LodSelector::ProjectError(float world_error, float distance) const
+{
+	return world_error * pixels_per_unit_ / std::max(distance, MIN_DISTANCE);
+}
+
+float LodSelector::SphereDistance(const float* camera_position, const float* center, float radius)
+{
+	float dx = center[0] - camera_position[0];
+	float dy = center[1] - camera_position[1];
+	float dz = center[2] - camera_position[2];
+	return std::max(std::sqrt(dx * dx + dy * dy + dz * dz) - radius, MIN_DISTANCE);
+}
+
+unsigned int LodSelector::Select(const MeshLod* lods, unsigned int lod_count, float distance, float scale, unsigned int current) const
+{
+	if (lod_count <= 1)
+		return 0;
+
+	// the coarsest level that passes, level 0 always does
+	unsigned int target = 0;
+	for (unsigned int level = lod_count - 1; level > 0; level--)
+	{
+		if (ProjectError(lods[level].error * scale, distance) <= threshold_)
+		{
+			target = level;
+			break;
+		}
+	}
+
+	// nothing to stick to, or the current level is too coarse now: switch right away
+	if (current >= lod_count || target <= current)
+		return target;
+
+	// going coarser has to clear the hysteresis band, otherwise the level stays
+	float coarser_threshold = threshold_ * (1.0f - hysteresis_);
+	for (unsigned int level = target; level > current; level--)
+	{
+		if (ProjectError(lods[level].error * scale, distance) <= coarser_threshold)
+			return level;
+	}
+	return current;
+}
+
+float LodSelector::GetContinuousLod(const MeshLod* lods, unsigned int lod_count, float distance, float scale) const
+{
+	unsigned int level = 0;
+	while (level + 1 < lod_count && ProjectError(lods[level + 1].error * scale, distance) <= threshold_)
+		level++;
+	if (level + 1 >= lod_count)
+		return (float)level;
+
+	// how far the threshold is from this level's error towards the next one's
+	float error = ProjectError(lods[level].error * scale, distance);
+	float next_error = ProjectError(lods[level + 1].error * scale, distance);
+	if (next_error <= error)
+		return (float)level;
+	// level 0 can already be over the threshold up close, that is still level 0
+	return (float)level + std::clamp((threshold_ - error) / (next_error - error), 0.0f, 0.999f);
+}
+
+void LodSelector::SelectAll(const BoundingVolumes& bounds, const std::vector<unsigned int>& objects, const float* camera_position,
+	const MeshLod* const* lods, const unsigned int* lod_counts, float scale, std::vector<uint8_t>& levels) const
+{
+	if (levels.size() < bounds.GetCount())
+		levels.resize(bounds.GetCount(), NO_LEVEL);
+
+	for (unsigned int object : objects)
+	{
+		float center[3] = { bounds.GetCenterX()[object], bounds.GetCenterY()[object], bounds.GetCenterZ()[object] };
+		float distance = SphereDistance(camera_position, center, bounds.GetRadius()[object]);
+		levels[object] = (uint8_t)Select(lods[object], lod_counts[object], distance, scale, levels[object]);
+	}
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+class BoundingVolumes;
+
+// One level of detail of a mesh: a range of the mesh's own indices, all levels share its vertices.
+// Level 0 is the full mesh, every further level has fewer triangles. error is how far (in object units)
+// the surface of the level is at most from the full mesh.
+struct MeshLod
+{
+	unsigned int first_index;
+	unsigned int index_count;
+	float error;
+};
+
+static constexpr unsigned int MAX_MESH_LODS = 8;
+
+// Picks a level of detail by how big its error looks on screen. The coarsest level whose error projects
+// to at most threshold pixels is used, so every object is drawn as coarse as it can be without the
+// difference being visible. Switching is discrete with a hysteresis band: a coarser level is only taken
+// once its error is well under the threshold, a finer one as soon as the current is over it, so an object
+// sitting at the boundary doesn't pop back and forth. GetContinuousLod gives the same choice as a fraction
+// for fading or morphing between two levels instead.
+class LodSelector
+{
+private:
+	float threshold_;
+	float hysteresis_;
+	float pixels_per_unit_;   // projected size of one unit at distance 1
+
+	// Distance from the camera to the nearest point of a bounding sphere, never less than a small positive value
+	static float SphereDistance(const float* camera_position, const float* center, float radius);
+
+public:
+	// threshold in pixels. hysteresis is the part of the threshold a coarser level has to be under to be
+	// switched to, 0.25 means its error has to project to 75% of the threshold or less.
+	LodSelector(float threshold = 1.0f, float hysteresis = 0.25f);
+
+	// Perspective projection the errors are measured in, vertical_fov in radians and the height of the
+	// viewport in pixels. Call it again when either changes.
+	void SetProjection(float vertical_fov, float viewport_height);
+
+	// Size in pixels of an error of world_error units at distance units from the camera
+	float ProjectError(float world_error, float distance) const;
+
+	// Level for an object at distance from the camera, scale is how much bigger the object is than its
+	// mesh. current is the level it was drawn with last frame (anything past the chain for none yet).
+	unsigned int Select(const MeshLod* lods, unsigned int lod_count, float distance, float scale, unsigned int current) const;
+
+	// Fractional level without hysteresis, 1.25 means a quarter of the way from level 1 to level 2
+	float GetContinuousLod(const MeshLod* lods, unsigned int lod_count, float distance, float scale) const;
+
+	// Select for the listed objects (indices into bounds) with the distance to their bounding sphere.
+	// lods and lod_counts give the chain of each object, levels the level of each object, kept from frame
+	// to frame and grown as needed (new objects have no level yet and get the one that fits right away).
+	void SelectAll(const BoundingVolumes& bounds, const std::vector<unsigned int>& objects, const float* camera_position,
+		const MeshLod* const* lods, const unsigned int* lod_counts, float scale, std::vector<uint8_t>& levels) const;
+
+	inline float GetThreshold() const { return threshold_; }
+	inline void SetThreshold(float threshold) { threshold_ = threshold; }
+};
@@ -0,0 +1,123 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile()
+	: data_(nullptr), size_(0)
+#ifdef _WIN32
+	, file_handle_(INVALID_HANDLE_VALUE), mapping_handle_(nullptr)
+#else
+	, file_descriptor_(-1)
+#endif
+{
+}
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+#ifdef _WIN32
+
+bool MappedFile::Open(const std::string& path)
+{
+	Close();
+
+	file_handle_ = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file_handle_ == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file_handle_, &size) || size.QuadPart == 0)
+	{
+		Close();
+		return false;
+	}
+
+	mapping_handle_ = CreateFileMappingA(file_handle_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!mapping_handle_)
+	{
+		Close();
+		return false;
+	}
+
+	data_ = MapViewOfFile(mapping_handle_, FILE_MAP_READ, 0, 0, 0);
+	if (!data_)
+	{
+		Close();
+		return false;
+	}
+	size_ = (size_t)size.QuadPart;
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (data_)
+		UnmapViewOfFile(data_);
+	if (mapping_handle_)
+		CloseHandle(mapping_handle_);
+	if (file_handle_ != INVALID_HANDLE_VALUE)
+		CloseHandle(file_handle_);
+
+	data_ = nullptr;
+	size_ = 0;
+	mapping_handle_ = nullptr;
+	file_handle_ = INVALID_HANDLE_VALUE;
+}
+
+#else
+
+bool MappedFile::Open(const std::string& path)
+{
+	Close();
+
+	file_descriptor_ = open(path.c_str(), O_RDONLY);
+	if (file_descriptor_ < 0)
+		return false;
+
+	struct stat info;
+	if (fstat(file_descriptor_, &info) != 0 || info.st_size == 0)
+	{
+		Close();
+		return false;
+	}
+
+	void* data = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, file_descriptor_, 0);
+	if (data == MAP_FAILED)
+	{
+		Close();
+		return false;
+	}
+
+	// the whole file is going to be read front to back for the upload, let the kernel read ahead
+	madvise(data, (size_t)info.st_size, MADV_SEQUENTIAL);
+
+	data_ = data;
+	size_ = (size_t)info.st_size;
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (data_)
+		munmap((void*)data_, size_);
+	if (file_descriptor_ >= 0)
+		close(file_descriptor_);
+
+	data_ = nullptr;
+	size_ = 0;
+	file_descriptor_ = -1;
+}
+
+#endif
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <string>
+
+// Read-only view of a whole file mapped into memory. Pages are only read from disk when they
+// are touched, and the data can be handed straight to OpenGL without copying it into a buffer first.
+class MappedFile
+{
+private:
+	const void* data_;
+	size_t size_;
+#ifdef _WIN32
+	void* file_handle_;
+	void* mapping_handle_;
+#else
+	int file_descriptor_;
+#endif
+
+public:
+	MappedFile();
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	// Map the file at path, any file mapped before is closed first. Returns false if the file can't be mapped.
+	bool Open(const std::string& path);
+
+	void Close();
+
+	inline bool IsOpen() const { return data_ != nullptr; }
+	inline const void* GetData() const { return data_; }
+	inline size_t GetSize() const { return size_; }
+};
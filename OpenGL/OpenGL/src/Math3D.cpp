@@ -0,0 +1,400 @@
+#include "Math3D.h"
+#include "Simd.h"
+
+#include <cmath>
+
+float Length(Vec3 a)
+{
+	return std::sqrt(Dot(a, a));
+}
+
+Vec3 Normalize(Vec3 a)
+{
+	float length = Length(a);
+	return length > 0.0f ? a * (1.0f / length) : a;
+}
+
+Quat QuatFromAxisAngle(Vec3 axis, float angle)
+{
+	float s = std::sin(angle * 0.5f);
+	return { axis.x * s, axis.y * s, axis.z * s, std::cos(angle * 0.5f) };
+}
+
+Quat Normalize(Quat q)
+{
+	float length = std::sqrt(q.x * q.x + q.y * q.y + q.z * q.z + q.w * q.w);
+	if (length <= 0.0f)
+		return Quat::Identity();
+	float scale = 1.0f / length;
+	return { q.x * scale, q.y * scale, q.z * scale, q.w * scale };
+}
+
+Vec3 Rotate(Quat q, Vec3 v)
+{
+	// v + 2 w (u x v) + 2 u x (u x v) with u the vector part, cheaper than q * v * q^-1
+	Vec3 u = { q.x, q.y, q.z };
+	Vec3 t = Cross(u, v) * 2.0f;
+	return v + t * q.w + Cross(u, t);
+}
+
+Quat Nlerp(Quat a, Quat b, float t)
+{
+	// q and -q are the same rotation, flip b to the side of a so the interpolation doesn't go the long way
+	float dot = a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w;
+	float sign = dot < 0.0f ? -1.0f : 1.0f;
+	return Normalize(Quat{
+		a.x + (b.x * sign - a.x) * t,
+		a.y + (b.y * sign - a.y) * t,
+		a.z + (b.z * sign - a.z) * t,
+		a.w + (b.w * sign - a.w) * t });
+}
+
+Quat Slerp(Quat a, Quat b, float t)
+{
+	float dot = a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w;
+	float sign = dot < 0.0f ? -1.0f : 1.0f;
+	dot *= sign;
+
+	// nearly the same rotation, the sine below would be 0
+	if (dot > 0.9995f)
+		return Nlerp(a, b, t);
+
+	float angle = std::acos(dot);
+	float inverse_sin = 1.0f / std::sin(angle);
+	float weight_a = std::sin((1.0f - t) * angle) * inverse_sin;
+	float weight_b = std::sin(t * angle) * inverse_sin * sign;
+	return {
+		a.x * weight_a + b.x * weight_b,
+		a.y * weight_a + b.y * weight_b,
+		a.z * weight_a + b.z * weight_b,
+		a.w * weight_a + b.w * weight_b };
+}
+
+Mat4 LookAt(Vec3 eye, Vec3 target, Vec3 up)
+{
+	Vec3 forward = Normalize(target - eye);
+	Vec3 side = Normalize(Cross(forward, up));
+	Vec3 camera_up = Cross(side, forward);
+	return { {
+		side.x, camera_up.x, -forward.x, 0,
+		side.y, camera_up.y, -forward.y, 0,
+		side.z, camera_up.z, -forward.z, 0,
+		-Dot(side, eye), -Dot(camera_up, eye), Dot(forward, eye), 1
+	} };
+}
+
+Mat4 Perspective(float vertical_fov, float aspect, float near_plane, float far_plane)
+{
+	float f = 1.0f / std::tan(vertical_fov * 0.5f);
+	float depth = near_plane - far_plane;
+	return { {
+		f / aspect, 0, 0, 0,
+		0, f, 0, 0,
+		0, 0, (far_plane + near_plane) / depth, -1,
+		0, 0, 2.0f * far_plane * near_plane / depth, 0
+	} };
+}
+
+Mat4 Orthographic(float left, float right, float bottom, float top, float near_plane, float far_plane)
+{
+	return { {
+		2.0f / (right - left), 0, 0, 0,
+		0, 2.0f / (top - bottom), 0, 0,
+		0, 0, -2.0f / (far_plane - near_plane), 0,
+		-(right + left) / (right - left), -(top + bottom) / (top - bottom), -(far_plane + near_plane) / (far_plane - near_plane), 1
+	} };
+}
+
+// one column of a * b: the columns of a weighted by the column of b
+static inline SimdFloat MultiplyColumn(SimdFloat a0, SimdFloat a1, SimdFloat a2, SimdFloat a3, const float* column)
+{
+	SimdFloat result = SimdMul(a0, SimdSplat(column[0]));
+	result = SimdMulAdd(a1, SimdSplat(column[1]), result);
+	result = SimdMulAdd(a2, SimdSplat(column[2]), result);
+	return SimdMulAdd(a3, SimdSplat(column[3]), result);
+}
+
+// the columns are loaded before anything is stored, so out can be a or b
+static inline void Multiply(const Mat4& a, const Mat4& b, Mat4& out)
+{
+	SimdFloat a0 = SimdLoad(a.m + 0);
+	SimdFloat a1 = SimdLoad(a.m + 4);
+	SimdFloat a2 = SimdLoad(a.m + 8);
+	SimdFloat a3 = SimdLoad(a.m + 12);
+	SimdFloat r0 = MultiplyColumn(a0, a1, a2, a3, b.m + 0);
+	SimdFloat r1 = MultiplyColumn(a0, a1, a2, a3, b.m + 4);
+	SimdFloat r2 = MultiplyColumn(a0, a1, a2, a3, b.m + 8);
+	SimdFloat r3 = MultiplyColumn(a0, a1, a2, a3, b.m + 12);
+	SimdStore(out.m + 0, r0);
+	SimdStore(out.m + 4, r1);
+	SimdStore(out.m + 8, r2);
+	SimdStore(out.m + 12, r3);
+}
+
+#if defined(SIMD_AVX)
+// Same as Multiply, two columns of the result per instruction: both halves of the register hold the
+// same column of a and each half is weighted by its own column of b
+SIMD_AVX_FUNCTION static void MultiplyAvx(const Mat4& a, const Mat4& b, Mat4& out)
+{
+	__m256 a0 = _mm256_broadcast_ps((const __m128*)(a.m + 0));
+	__m256 a1 = _mm256_broadcast_ps((const __m128*)(a.m + 4));
+	__m256 a2 = _mm256_broadcast_ps((const __m128*)(a.m + 8));
+	__m256 a3 = _mm256_broadcast_ps((const __m128*)(a.m + 12));
+	__m256 b01 = _mm256_loadu_ps(b.m + 0);
+	__m256 b23 = _mm256_loadu_ps(b.m + 8);
+
+	__m256 r01 = _mm256_mul_ps(a0, _mm256_permute_ps(b01, 0x00));
+	r01 = _mm256_add_ps(r01, _mm256_mul_ps(a1, _mm256_permute_ps(b01, 0x55)));
+	r01 = _mm256_add_ps(r01, _mm256_mul_ps(a2, _mm256_permute_ps(b01, 0xAA)));
+	r01 = _mm256_add_ps(r01, _mm256_mul_ps(a3, _mm256_permute_ps(b01, 0xFF)));
+
+	__m256 r23 = _mm256_mul_ps(a0, _mm256_permute_ps(b23, 0x00));
+	r23 = _mm256_add_ps(r23, _mm256_mul_ps(a1, _mm256_permute_ps(b23, 0x55)));
+	r23 = _mm256_add_ps(r23, _mm256_mul_ps(a2, _mm256_permute_ps(b23, 0xAA)));
+	r23 = _mm256_add_ps(r23, _mm256_mul_ps(a3, _mm256_permute_ps(b23, 0xFF)));
+
+	_mm256_storeu_ps(out.m + 0, r01);
+	_mm256_storeu_ps(out.m + 8, r23);
+}
+
+SIMD_AVX_FUNCTION static void MultiplyBatchAvx(const Mat4* a, const Mat4* b, Mat4* out, unsigned int count)
+{
+	for (unsigned int i = 0; i < count; i++)
+		MultiplyAvx(a[i], b[i], out[i]);
+}
+
+SIMD_AVX_FUNCTION static void MultiplyBatchAvx(const Mat4& parent, const Mat4* local, Mat4* out, unsigned int count)
+{
+	for (unsigned int i = 0; i < count; i++)
+		MultiplyAvx(parent, local[i], out[i]);
+}
+#endif
+
+Mat4 operator*(const Mat4& a, const Mat4& b)
+{
+	Mat4 result;
+	Multiply(a, b, result);
+	return result;
+}
+
+Vec4 operator*(const Mat4& a, Vec4 v)
+{
+	Vec4 result;
+	SimdStore(&result.x, MultiplyColumn(SimdLoad(a.m), SimdLoad(a.m + 4), SimdLoad(a.m + 8), SimdLoad(a.m + 12), &v.x));
+	return result;
+}
+
+Mat4 Inverse(const Mat4& a)
+{
+	// cofactors of the 2x2 minors of the upper and lower two rows
+	const float* m = a.m;
+	float s0 = m[0] * m[5] - m[4] * m[1];
+	float s1 = m[0] * m[9] - m[8] * m[1];
+	float s2 = m[0] * m[13] - m[12] * m[1];
+	float s3 = m[4] * m[9] - m[8] * m[5];
+	float s4 = m[4] * m[13] - m[12] * m[5];
+	float s5 = m[8] * m[13] - m[12] * m[9];
+	float c5 = m[10] * m[15] - m[14] * m[11];
+	float c4 = m[6] * m[15] - m[14] * m[7];
+	float c3 = m[6] * m[11] - m[10] * m[7];
+	float c2 = m[2] * m[15] - m[14] * m[3];
+	float c1 = m[2] * m[11] - m[10] * m[3];
+	float c0 = m[2] * m[7] - m[6] * m[3];
+
+	float determinant = s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;
+	if (determinant == 0.0f)
+		return Mat4::Identity();
+	float inverse = 1.0f / determinant;
+
+	// written with m[column * 4 + row] read as m[row][column], the formula gives the inverse directly
+	return { {
+		(m[5] * c5 - m[9] * c4 + m[13] * c3) * inverse,
+		(-m[1] * c5 + m[9] * c2 - m[13] * c1) * inverse,
+		(m[1] * c4 - m[5] * c2 + m[13] * c0) * inverse,
+		(-m[1] * c3 + m[5] * c1 - m[9] * c0) * inverse,
+
+		(-m[4] * c5 + m[8] * c4 - m[12] * c3) * inverse,
+		(m[0] * c5 - m[8] * c2 + m[12] * c1) * inverse,
+		(-m[0] * c4 + m[4] * c2 - m[12] * c0) * inverse,
+		(m[0] * c3 - m[4] * c1 + m[8] * c0) * inverse,
+
+		(m[7] * s5 - m[11] * s4 + m[15] * s3) * inverse,
+		(-m[3] * s5 + m[11] * s2 - m[15] * s1) * inverse,
+		(m[3] * s4 - m[7] * s2 + m[15] * s0) * inverse,
+		(-m[3] * s3 + m[7] * s1 - m[11] * s0) * inverse,
+
+		(-m[6] * s5 + m[10] * s4 - m[14] * s3) * inverse,
+		(m[2] * s5 - m[10] * s2 + m[14] * s1) * inverse,
+		(-m[2] * s4 + m[6] * s2 - m[14] * s0) * inverse,
+		(m[2] * s3 - m[6] * s1 + m[10] * s0) * inverse
+	} };
+}
+
+Mat4 InverseAffine(const Mat4& a)
+{
+	// the inverse of the 3x3 is the transpose of its inverse transpose, the translation moves back through it
+	Mat4 normal = InverseTranspose(a);
+	Mat4 result = Transpose(normal);
+	Vec3 translation = TransformVector(result, { a.m[12], a.m[13], a.m[14] });
+	result.m[12] = -translation.x;
+	result.m[13] = -translation.y;
+	result.m[14] = -translation.z;
+	return result;
+}
+
+static const float LAST_COLUMN[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+
+// The inverse transpose of the 3x3 has the cross products of the column pairs as its columns, divided
+// by the determinant. The cross products come out with 0 in lane 3 whatever the matrix had there.
+static inline void InverseTransposeColumns(const Mat4& a, Mat4& out)
+{
+	SimdFloat c0 = SimdLoad(a.m + 0);
+	SimdFloat c1 = SimdLoad(a.m + 4);
+	SimdFloat c2 = SimdLoad(a.m + 8);
+
+	// cross(a, b) = rotate(a * rotate(b) - rotate(a) * b)
+	SimdFloat c0r = SimdRotateXyz(c0);
+	SimdFloat c1r = SimdRotateXyz(c1);
+	SimdFloat c2r = SimdRotateXyz(c2);
+	SimdFloat r0 = SimdRotateXyz(SimdSub(SimdMul(c1, c2r), SimdMul(c1r, c2)));
+	SimdFloat r1 = SimdRotateXyz(SimdSub(SimdMul(c2, c0r), SimdMul(c2r, c0)));
+	SimdFloat r2 = SimdRotateXyz(SimdSub(SimdMul(c0, c1r), SimdMul(c0r, c1)));
+
+	float products[4];
+	SimdStore(products, SimdMul(c0, r0));
+	float determinant = products[0] + products[1] + products[2];
+	if (determinant == 0.0f)
+	{
+		out = Mat4::Identity();
+		return;
+	}
+
+	SimdFloat inverse = SimdSplat(1.0f / determinant);
+	SimdStore(out.m + 0, SimdMul(r0, inverse));
+	SimdStore(out.m + 4, SimdMul(r1, inverse));
+	SimdStore(out.m + 8, SimdMul(r2, inverse));
+	SimdStore(out.m + 12, SimdLoad(LAST_COLUMN));
+}
+
+Mat4 InverseTranspose(const Mat4& a)
+{
+	Mat4 result;
+	InverseTransposeColumns(a, result);
+	return result;
+}
+
+// center moves with the matrix, the extents are the absolute 3x3 times the old extents
+static inline void TransformBoxTo(const Mat4& a, const BoundingBox& box, BoundingBox& out)
+{
+	SimdFloat a0 = SimdLoad(a.m + 0);
+	SimdFloat a1 = SimdLoad(a.m + 4);
+	SimdFloat a2 = SimdLoad(a.m + 8);
+	SimdFloat center = SimdMulAdd(a0, SimdSplat(box.center[0]), SimdLoad(a.m + 12));
+	center = SimdMulAdd(a1, SimdSplat(box.center[1]), center);
+	center = SimdMulAdd(a2, SimdSplat(box.center[2]), center);
+	SimdFloat extents = SimdMul(SimdAbs(a0), SimdSplat(box.extents[0]));
+	extents = SimdMulAdd(SimdAbs(a1), SimdSplat(box.extents[1]), extents);
+	extents = SimdMulAdd(SimdAbs(a2), SimdSplat(box.extents[2]), extents);
+
+	// a box is 6 floats, the 4th lane would run into the extents (or past the end of out)
+	float lanes[8];
+	SimdStore(lanes, center);
+	SimdStore(lanes + 4, extents);
+	out = { { lanes[0], lanes[1], lanes[2] }, { lanes[4], lanes[5], lanes[6] } };
+}
+
+BoundingBox TransformBox(const Mat4& a, const BoundingBox& box)
+{
+	BoundingBox result;
+	TransformBoxTo(a, box, result);
+	return result;
+}
+
+void MultiplyBatch(const Mat4* a, const Mat4* b, Mat4* out, unsigned int count)
+{
+#if defined(SIMD_AVX)
+	if (SimdCpuHasAvx())
+	{
+		MultiplyBatchAvx(a, b, out, count);
+		return;
+	}
+#endif
+	for (unsigned int i = 0; i < count; i++)
+		Multiply(a[i], b[i], out[i]);
+}
+
+void MultiplyBatch(const Mat4& parent, const Mat4* local, Mat4* out, unsigned int count)
+{
+#if defined(SIMD_AVX)
+	if (SimdCpuHasAvx())
+	{
+		MultiplyBatchAvx(parent, local, out, count);
+		return;
+	}
+#endif
+	for (unsigned int i = 0; i < count; i++)
+		Multiply(parent, local[i], out[i]);
+}
+
+void TransformBoxBatch(const Mat4* matrices, const BoundingBox* boxes, BoundingBox* out, unsigned int count)
+{
+	for (unsigned int i = 0; i < count; i++)
+		TransformBoxTo(matrices[i], boxes[i], out[i]);
+}
+
+void InverseTransposeBatch(const Mat4* matrices, Mat4* out, unsigned int count)
+{
+	for (unsigned int i = 0; i < count; i++)
+		InverseTransposeColumns(matrices[i], out[i]);
+}
+
+Mat4 MultiplyScalar(const Mat4& a, const Mat4& b)
+{
+	Mat4 result = {};
+	for (unsigned int column = 0; column < 4; column++)
+	{
+		for (unsigned int row = 0; row < 4; row++)
+		{
+			float sum = 0.0f;
+			for (unsigned int k = 0; k < 4; k++)
+				sum += a.m[k * 4 + row] * b.m[column * 4 + k];
+			result.m[column * 4 + row] = sum;
+		}
+	}
+	return result;
+}
+
+Mat4 InverseTransposeScalar(const Mat4& a)
+{
+	Vec3 c0 = { a.m[0], a.m[1], a.m[2] };
+	Vec3 c1 = { a.m[4], a.m[5], a.m[6] };
+	Vec3 c2 = { a.m[8], a.m[9], a.m[10] };
+	Vec3 r0 = Cross(c1, c2);
+	Vec3 r1 = Cross(c2, c0);
+	Vec3 r2 = Cross(c0, c1);
+	float determinant = Dot(c0, r0);
+	if (determinant == 0.0f)
+		return Mat4::Identity();
+
+	float inverse = 1.0f / determinant;
+	r0 = r0 * inverse;
+	r1 = r1 * inverse;
+	r2 = r2 * inverse;
+	return { { r0.x, r0.y, r0.z, 0,  r1.x, r1.y, r1.z, 0,  r2.x, r2.y, r2.z, 0,  0, 0, 0, 1 } };
+}
+
+BoundingBox TransformBoxScalar(const Mat4& a, const BoundingBox& box)
+{
+	BoundingBox result;
+	for (unsigned int row = 0; row < 3; row++)
+	{
+		result.center[row] = a.m[12 + row];
+		result.extents[row] = 0.0f;
+		for (unsigned int column = 0; column < 3; column++)
+		{
+			result.center[row] += a.m[column * 4 + row] * box.center[column];
+			result.extents[row] += std::fabs(a.m[column * 4 + row]) * box.extents[column];
+		}
+	}
+	return result;
+}
@@ -0,0 +1,178 @@
+#pragma once
+
+#include "BoundingVolumes.h"
+
+// Vectors, quaternions and 4x4 matrices for transforms. Matrices are column major like OpenGL wants them,
+// m[column * 4 + row], and multiply column vectors: (a * b) * v == a * (b * v). The simple operations are
+// constexpr so constant transforms can be worked out by the compiler. The ones that run over whole scenes
+// every frame (matrix products, box transforms, normal matrices) go through Simd.h and have batch versions
+// that use AVX where the CPU has it. The ...Scalar functions are plain reference versions to compare against.
+
+struct Vec3
+{
+	float x, y, z;
+};
+
+struct alignas(16) Vec4
+{
+	float x, y, z, w;
+};
+
+// Rotation as a unit quaternion, (x, y, z) the axis times sin(angle / 2), w cos(angle / 2)
+struct alignas(16) Quat
+{
+	float x, y, z, w;
+
+	static constexpr Quat Identity() { return { 0.0f, 0.0f, 0.0f, 1.0f }; }
+};
+
+struct alignas(16) Mat4
+{
+	float m[16];
+
+	static constexpr Mat4 Identity()
+	{
+		return { { 1, 0, 0, 0,  0, 1, 0, 0,  0, 0, 1, 0,  0, 0, 0, 1 } };
+	}
+
+	constexpr float operator()(unsigned int row, unsigned int column) const { return m[column * 4 + row]; }
+	inline const float* Data() const { return m; }
+};
+
+constexpr Vec3 operator+(Vec3 a, Vec3 b) { return { a.x + b.x, a.y + b.y, a.z + b.z }; }
+constexpr Vec3 operator-(Vec3 a, Vec3 b) { return { a.x - b.x, a.y - b.y, a.z - b.z }; }
+constexpr Vec3 operator-(Vec3 a) { return { -a.x, -a.y, -a.z }; }
+constexpr Vec3 operator*(Vec3 a, float s) { return { a.x * s, a.y * s, a.z * s }; }
+constexpr Vec3 operator*(float s, Vec3 a) { return { a.x * s, a.y * s, a.z * s }; }
+constexpr Vec3 operator*(Vec3 a, Vec3 b) { return { a.x * b.x, a.y * b.y, a.z * b.z }; }
+constexpr float Dot(Vec3 a, Vec3 b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+constexpr Vec3 Cross(Vec3 a, Vec3 b) { return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x }; }
+constexpr Vec3 Lerp(Vec3 a, Vec3 b, float t) { return a + (b - a) * t; }
+float Length(Vec3 a);
+// a / Length(a), a zero vector stays zero
+Vec3 Normalize(Vec3 a);
+
+constexpr Quat operator*(Quat a, Quat b)
+{
+	return {
+		a.w * b.x + a.x * b.w + a.y * b.z - a.z * b.y,
+		a.w * b.y - a.x * b.z + a.y * b.w + a.z * b.x,
+		a.w * b.z + a.x * b.y - a.y * b.x + a.z * b.w,
+		a.w * b.w - a.x * b.x - a.y * b.y - a.z * b.z
+	};
+}
+constexpr Quat Conjugate(Quat q) { return { -q.x, -q.y, -q.z, q.w }; }
+// axis has to be unit length, angle in radians
+Quat QuatFromAxisAngle(Vec3 axis, float angle);
+Quat Normalize(Quat q);
+// Rotate v by the unit quaternion q
+Vec3 Rotate(Quat q, Vec3 v);
+// Normalized linear interpolation along the shorter way, close enough to slerp for animation steps
+Quat Nlerp(Quat a, Quat b, float t);
+Quat Slerp(Quat a, Quat b, float t);
+
+constexpr Mat4 Translation(Vec3 t)
+{
+	return { { 1, 0, 0, 0,  0, 1, 0, 0,  0, 0, 1, 0,  t.x, t.y, t.z, 1 } };
+}
+
+constexpr Mat4 Scaling(Vec3 s)
+{
+	return { { s.x, 0, 0, 0,  0, s.y, 0, 0,  0, 0, s.z, 0,  0, 0, 0, 1 } };
+}
+
+// Rotation matrix of a unit quaternion
+constexpr Mat4 Rotation(Quat q)
+{
+	return { {
+		1 - 2 * (q.y * q.y + q.z * q.z), 2 * (q.x * q.y + q.z * q.w), 2 * (q.x * q.z - q.y * q.w), 0,
+		2 * (q.x * q.y - q.z * q.w), 1 - 2 * (q.x * q.x + q.z * q.z), 2 * (q.y * q.z + q.x * q.w), 0,
+		2 * (q.x * q.z + q.y * q.w), 2 * (q.y * q.z - q.x * q.w), 1 - 2 * (q.x * q.x + q.y * q.y), 0,
+		0, 0, 0, 1
+	} };
+}
+
+// translation * rotation * scale without the two matrix products
+constexpr Mat4 Compose(Vec3 translation, Quat rotation, Vec3 scale)
+{
+	Mat4 result = Rotation(rotation);
+	for (unsigned int row = 0; row < 3; row++)
+	{
+		result.m[0 * 4 + row] *= scale.x;
+		result.m[1 * 4 + row] *= scale.y;
+		result.m[2 * 4 + row] *= scale.z;
+	}
+	result.m[12] = translation.x;
+	result.m[13] = translation.y;
+	result.m[14] = translation.z;
+	return result;
+}
+
+constexpr Mat4 Transpose(const Mat4& a)
+{
+	Mat4 result = {};
+	for (unsigned int column = 0; column < 4; column++)
+	{
+		for (unsigned int row = 0; row < 4; row++)
+			result.m[row * 4 + column] = a.m[column * 4 + row];
+	}
+	return result;
+}
+
+constexpr Vec3 TransformPoint(const Mat4& a, Vec3 p)
+{
+	return {
+		a.m[0] * p.x + a.m[4] * p.y + a.m[8] * p.z + a.m[12],
+		a.m[1] * p.x + a.m[5] * p.y + a.m[9] * p.z + a.m[13],
+		a.m[2] * p.x + a.m[6] * p.y + a.m[10] * p.z + a.m[14]
+	};
+}
+
+// Direction, the translation doesn't apply
+constexpr Vec3 TransformVector(const Mat4& a, Vec3 v)
+{
+	return {
+		a.m[0] * v.x + a.m[4] * v.y + a.m[8] * v.z,
+		a.m[1] * v.x + a.m[5] * v.y + a.m[9] * v.z,
+		a.m[2] * v.x + a.m[6] * v.y + a.m[10] * v.z
+	};
+}
+
+// Right handed view looking from eye at target, like gluLookAt
+Mat4 LookAt(Vec3 eye, Vec3 target, Vec3 up);
+// OpenGL clip space (z in [-w, w]), vertical_fov in radians
+Mat4 Perspective(float vertical_fov, float aspect, float near_plane, float far_plane);
+Mat4 Orthographic(float left, float right, float bottom, float top, float near_plane, float far_plane);
+
+Mat4 operator*(const Mat4& a, const Mat4& b);
+Vec4 operator*(const Mat4& a, Vec4 v);
+
+// General inverse, the identity if a can't be inverted
+Mat4 Inverse(const Mat4& a);
+
+// Inverse of a matrix without projection (last row 0, 0, 0, 1), cheaper than Inverse
+Mat4 InverseAffine(const Mat4& a);
+
+// Inverse transpose of the upper 3x3, what normals are transformed with so they stay perpendicular to
+// the surface under non uniform scale. No translation, the identity if the 3x3 can't be inverted.
+Mat4 InverseTranspose(const Mat4& a);
+
+// Box around the transformed corners of box, without transforming the 8 corners
+BoundingBox TransformBox(const Mat4& a, const BoundingBox& box);
+
+// out[i] = a[i] * b[i] for count matrices, out may be a or b
+void MultiplyBatch(const Mat4* a, const Mat4* b, Mat4* out, unsigned int count);
+
+// out[i] = parent * local[i], the same parent for all of them
+void MultiplyBatch(const Mat4& parent, const Mat4* local, Mat4* out, unsigned int count);
+
+// out[i] = TransformBox(matrices[i], boxes[i])
+void TransformBoxBatch(const Mat4* matrices, const BoundingBox* boxes, BoundingBox* out, unsigned int count);
+
+// out[i] = InverseTranspose(matrices[i])
+void InverseTransposeBatch(const Mat4* matrices, Mat4* out, unsigned int count);
+
+// Reference versions
+Mat4 MultiplyScalar(const Mat4& a, const Mat4& b);
+Mat4 InverseTransposeScalar(const Mat4& a);
+BoundingBox TransformBoxScalar(const Mat4& a, const BoundingBox& box);
@@ -0,0 +1,180 @@
+#include "MeshFile.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+static uint64_t AlignUp(uint64_t value, uint64_t alignment)
+{
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+MeshFile::MeshFile()
+	: header_(nullptr)
+{
+}
+
+bool MeshFile::Open(const std::string& path)
+{
+	header_ = nullptr;
+	layout_ = VertexBufferLayout();
+
+	if (!file_.Open(path))
+	{
+		std::cerr << "Error opening the mesh file " << path << std::endl;
+		return false;
+	}
+
+	const char* data = (const char*)file_.GetData();
+	size_t size = file_.GetSize();
+
+	const MeshFileHeader* header = (const MeshFileHeader*)data;
+	if (size < sizeof(MeshFileHeader) || header->magic != MESH_FILE_MAGIC || header->version != MESH_FILE_VERSION)
+	{
+		std::cerr << "Not a version " << MESH_FILE_VERSION << " mesh file: " << path << std::endl;
+		file_.Close();
+		return false;
+	}
+
+	// everything the header points at has to be inside the file, otherwise a truncated file would read out of the mapping
+	uint64_t elements_end = sizeof(MeshFileHeader) + (uint64_t)header->element_count * sizeof(MeshFileElement);
+	uint64_t lods_end = elements_end + (uint64_t)header->lod_count * sizeof(MeshFileLod);
+	uint64_t vertex_end = header->vertex_offset + (uint64_t)header->vertex_count * header->stride;
+	uint64_t index_end = header->index_offset + (uint64_t)header->index_count * sizeof(unsigned int);
+	if (lods_end > size || vertex_end > size || index_end > size || header->lod_count == 0 || header->lod_count > MAX_MESH_LODS
+		|| header->vertex_offset % MESH_FILE_ALIGNMENT != 0 || header->index_offset % MESH_FILE_ALIGNMENT != 0)
+	{
+		std::cerr << "Corrupt mesh file: " << path << std::endl;
+		file_.Close();
+		return false;
+	}
+
+	// an element of a type the layout doesn't know has size 0, it would shift every attribute after it
+	const MeshFileElement* elements = (const MeshFileElement*)(data + sizeof(MeshFileHeader));
+	for (uint32_t i = 0; i < header->element_count; i++)
+	{
+		if (VertexBufferElement::GetTypeOfSize(elements[i].type) == 0 || elements[i].count == 0 || elements[i].count > 4)
+		{
+			std::cerr << "Mesh file vertex element " << i << " has an unknown type or component count: " << path << std::endl;
+			file_.Close();
+			return false;
+		}
+		layout_.Push({ elements[i].type, elements[i].count, (unsigned char)elements[i].normalized });
+	}
+
+	if (layout_.GetStride() != header->stride)
+	{
+		std::cerr << "Mesh file vertex layout doesn't match its stride: " << path << std::endl;
+		file_.Close();
+		return false;
+	}
+
+	const MeshFileLod* lods = (const MeshFileLod*)(data + elements_end);
+	for (uint32_t i = 0; i < header->lod_count; i++)
+	{
+		if ((uint64_t)lods[i].first_index + lods[i].index_count > header->index_count)
+		{
+			std::cerr << "Mesh file level of detail " << i << " is outside the index data: " << path << std::endl;
+			file_.Close();
+			return false;
+		}
+	}
+
+	// an index past the vertices would make the GPU read outside the mesh's range of a shared vertex buffer
+	const uint32_t* indices = (const uint32_t*)(data + header->index_offset);
+	for (uint32_t i = 0; i < header->index_count; i++)
+	{
+		if (indices[i] >= header->vertex_count)
+		{
+			std::cerr << "Mesh file index " << i << " points past the " << header->vertex_count << " vertices: " << path << std::endl;
+			file_.Close();
+			return false;
+		}
+	}
+
+	header_ = header;
+	return true;
+}
+
+MeshLod MeshFile::GetLod(unsigned int level) const
+{
+	ASSERT(level < header_->lod_count);
+	const char* data = (const char*)file_.GetData() + sizeof(MeshFileHeader) + header_->element_count * sizeof(MeshFileElement);
+	const MeshFileLod& lod = ((const MeshFileLod*)data)[level];
+	return { lod.first_index, lod.index_count, lod.error };
+}
+
+bool MeshFile::Write(const std::string& path, const VertexBufferLayout& layout, const void* vertices, unsigned int vertex_count,
+	const unsigned int* indices, unsigned int index_count, const MeshLod* lods, unsigned int lod_count)
+{
+	const auto& elements = layout.GetElements();
+	if (elements.empty() || elements[0].type != GL_FLOAT)
+	{
+		std::cerr << "The first vertex element has to be a float position" << std::endl;
+		return false;
+	}
+	if (lod_count > MAX_MESH_LODS)
+	{
+		std::cerr << "A mesh can have at most " << MAX_MESH_LODS << " levels of detail" << std::endl;
+		return false;
+	}
+
+	std::vector<MeshFileLod> file_lods;
+	for (unsigned int i = 0; i < lod_count; i++)
+		file_lods.push_back({ lods[i].first_index, lods[i].index_count, lods[i].error });
+	if (file_lods.empty())
+		file_lods.push_back({ 0, index_count, 0.0f });
+
+	MeshFileHeader header = {};
+	header.magic = MESH_FILE_MAGIC;
+	header.version = MESH_FILE_VERSION;
+	header.element_count = (uint32_t)elements.size();
+	header.stride = layout.GetStride();
+	header.vertex_count = vertex_count;
+	header.index_count = index_count;
+	header.lod_count = (uint32_t)file_lods.size();
+	uint64_t tables_end = sizeof(MeshFileHeader) + elements.size() * sizeof(MeshFileElement) + file_lods.size() * sizeof(MeshFileLod);
+	header.vertex_offset = AlignUp(tables_end, MESH_FILE_ALIGNMENT);
+	header.index_offset = AlignUp(header.vertex_offset + (uint64_t)vertex_count * header.stride, MESH_FILE_ALIGNMENT);
+
+	// bounds of the position, so the loader doesn't have to walk the vertices for culling
+	unsigned int position_components = std::min(elements[0].count, 3u);
+	for (int axis = 0; axis < 3; axis++)
+	{
+		header.bounds_min[axis] = vertex_count && axis < (int)position_components ? FLT_MAX : 0.0f;
+		header.bounds_max[axis] = vertex_count && axis < (int)position_components ? -FLT_MAX : 0.0f;
+	}
+	for (unsigned int v = 0; v < vertex_count; v++)
+	{
+		const float* position = (const float*)((const char*)vertices + (size_t)v * header.stride);
+		for (unsigned int axis = 0; axis < position_components; axis++)
+		{
+			header.bounds_min[axis] = std::min(header.bounds_min[axis], position[axis]);
+			header.bounds_max[axis] = std::max(header.bounds_max[axis], position[axis]);
+		}
+	}
+
+	std::ofstream stream(path, std::ios::binary);
+	if (!stream.is_open())
+	{
+		std::cerr << "Error opening the file " << path << std::endl;
+		return false;
+	}
+
+	std::vector<MeshFileElement> file_elements;
+	for (const auto& element : elements)
+		file_elements.push_back({ element.type, element.count, element.normalized });
+
+	const char padding[MESH_FILE_ALIGNMENT] = {};
+	stream.write((const char*)&header, sizeof(header));
+	stream.write((const char*)file_elements.data(), file_elements.size() * sizeof(MeshFileElement));
+	stream.write((const char*)file_lods.data(), file_lods.size() * sizeof(MeshFileLod));
+	stream.write(padding, header.vertex_offset - tables_end);
+	stream.write((const char*)vertices, (size_t)vertex_count * header.stride);
+	stream.write(padding, header.index_offset - (header.vertex_offset + (uint64_t)vertex_count * header.stride));
+	stream.write((const char*)indices, (size_t)index_count * sizeof(unsigned int));
+
+	return stream.good();
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "LodSelector.h"
+#include "MappedFile.h"
+#include "VertexBufferLayout.h"
+
+// Layout of a .mesh file on disk (little endian, produced by the MeshConverter tool):
+//   MeshFileHeader
+//   MeshFileElement[element_count]    same elements as the VertexBufferLayout of the vertices
+//   MeshFileLod[lod_count]            levels of detail, ranges of the index data from the full mesh down
+//   vertex data at vertex_offset      vertex_count * stride bytes
+//   index data at index_offset        index_count 32 bit indices, every level one after the other
+// Both blobs start on a MESH_FILE_ALIGNMENT boundary so they can be used straight from the mapping.
+static const uint32_t MESH_FILE_MAGIC = 0x4853454D; // "MESH"
+static const uint32_t MESH_FILE_VERSION = 2;
+static const uint32_t MESH_FILE_ALIGNMENT = 16;
+
+struct MeshFileHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t element_count;
+	uint32_t stride;
+	uint32_t vertex_count;
+	uint32_t index_count;
+	uint32_t lod_count;   // at least 1, the first level is the full mesh
+	uint32_t reserved;
+	uint64_t vertex_offset;
+	uint64_t index_offset;
+	// object space bounding box of the positions
+	float bounds_min[3];
+	float bounds_max[3];
+};
+
+struct MeshFileElement
+{
+	uint32_t type;
+	uint32_t count;
+	uint32_t normalized;
+};
+
+struct MeshFileLod
+{
+	uint32_t first_index;
+	uint32_t index_count;
+	float error;   // object space distance to the full mesh
+};
+
+// A .mesh file mapped into memory. The vertex and index pointers point into the mapping, so they can go
+// directly into VertexBuffer/IndexBuffer and only stay valid while the MeshFile is open.
+class MeshFile
+{
+private:
+	MappedFile file_;
+	const MeshFileHeader* header_;
+	VertexBufferLayout layout_;
+
+public:
+	MeshFile();
+
+	// Map and validate the file, prints the reason and returns false if it isn't a usable mesh file
+	bool Open(const std::string& path);
+
+	inline const VertexBufferLayout& GetLayout() const { return layout_; }
+	inline const MeshFileHeader& GetHeader() const { return *header_; }
+
+	inline const void* GetVertexData() const { return (const char*)file_.GetData() + header_->vertex_offset; }
+	inline int GetVertexDataSize() const { return (int)(header_->vertex_count * header_->stride); }
+	inline unsigned int GetVertexCount() const { return header_->vertex_count; }
+
+	inline const unsigned int* GetIndices() const { return (const unsigned int*)((const char*)file_.GetData() + header_->index_offset); }
+	inline unsigned int GetIndexCount() const { return header_->index_count; }
+
+	inline unsigned int GetLodCount() const { return header_->lod_count; }
+	MeshLod GetLod(unsigned int level) const;
+
+	// Write a mesh file, the first element of the layout has to be the float position. Without levels of
+	// detail the whole index data is the only level.
+	static bool Write(const std::string& path, const VertexBufferLayout& layout, const void* vertices, unsigned int vertex_count,
+		const unsigned int* indices, unsigned int index_count, const MeshLod* lods = nullptr, unsigned int lod_count = 0);
+};
@@ -0,0 +1,276 @@
+#include "OcclusionCuller.h"
+#include "Frustum.h"
+#include "GLCapabilities.h"
+#include "Renderer.h"
+
+#include <GL/glew.h>
+#include <cstdint>
+#include <cstring>
+
+// threads per work group of OcclusionCull.shader
+static constexpr unsigned int CULL_GROUP_SIZE = 64;
+
+// feature bit of OcclusionCull.shader
+static constexpr uint64_t LATE_PHASE = 1;
+
+OcclusionCuller::OcclusionCuller(ShaderPreprocessor& preprocessor, GpuResources& resources)
+	: resources_(resources), late_phase_(false), view_projection_()
+{
+	const GLCapabilities& caps = GLCapabilities::Get();
+	gpu_driven_ = caps.compute_shader && caps.shader_storage_buffer && caps.multi_draw_indirect;
+
+	if (gpu_driven_)
+	{
+		cull_shader_ = std::make_unique<ShaderVariantCache>("res/shaders/OcclusionCull.shader", std::vector<std::string>{ "OCCLUSION_LATE_PHASE" }, preprocessor, resources);
+		pyramid_ = std::make_unique<HiZPyramid>(preprocessor, resources);
+		return;
+	}
+
+	box_shader_ = std::make_unique<ShaderVariantCache>("res/shaders/OcclusionBox.shader", std::vector<std::string>(), preprocessor, resources);
+
+	// unit cube, scaled and moved to each box in the vertex shader
+	float corners[] = {
+		-1, -1, -1,   1, -1, -1,   1, 1, -1,   -1, 1, -1,
+		-1, -1, 1,    1, -1, 1,    1, 1, 1,    -1, 1, 1
+	};
+	unsigned int faces[] = {
+		0, 2, 1, 0, 3, 2,   4, 5, 6, 4, 6, 7,
+		0, 1, 5, 0, 5, 4,   3, 6, 2, 3, 7, 6,
+		0, 4, 7, 0, 7, 3,   1, 2, 6, 1, 6, 5
+	};
+	box_vertex_array_ = resources_.Create<VertexArray>();
+	box_vertex_buffer_ = resources_.Create<VertexBuffer>(corners, (int)sizeof(corners));
+	box_index_buffer_ = resources_.Create<IndexBuffer>(faces, 36);
+	VertexBufferLayout layout;
+	layout.Push<float>(3);
+	VertexArray* vertex_array = resources_.Get(box_vertex_array_);
+	vertex_array->AddBuffer(*resources_.Get(box_vertex_buffer_), layout);
+	vertex_array->SetIndexBuffer(*resources_.Get(box_index_buffer_));
+}
+
+OcclusionCuller::~OcclusionCuller()
+{
+	for (ShaderBufferHandle buffer : { instance_buffer_, visibility_buffer_, command_buffer_ })
+	{
+		if (buffer.IsValid())
+			resources_.Destroy(buffer);
+	}
+	if (box_vertex_array_.IsValid())
+	{
+		resources_.Destroy(box_vertex_array_);
+		resources_.Destroy(box_vertex_buffer_);
+		resources_.Destroy(box_index_buffer_);
+	}
+
+	if (!queries_.empty())
+	{
+		GLCALL(glDeleteQueries((GLsizei)queries_.size(), queries_.data()));
+	}
+}
+
+void OcclusionCuller::SetInstances(const BoundingVolumes& bounds, const std::vector<OcclusionDraw>& draws)
+{
+	ASSERT(bounds.GetCount() == draws.size());
+	unsigned int count = bounds.GetCount();
+
+	draws_ = draws;
+	boxes_.resize(count);
+	for (unsigned int i = 0; i < count; i++)
+	{
+		boxes_[i] = { { bounds.GetCenterX()[i], bounds.GetCenterY()[i], bounds.GetCenterZ()[i] },
+			{ bounds.GetExtentX()[i], bounds.GetExtentY()[i], bounds.GetExtentZ()[i] } };
+	}
+	late_phase_ = false;
+
+	if (!gpu_driven_)
+	{
+		if (!queries_.empty())
+		{
+			GLCALL(glDeleteQueries((GLsizei)queries_.size(), queries_.data()));
+		}
+		queries_.assign(count, 0);
+		if (count)
+		{
+			GLCALL(glGenQueries((GLsizei)count, queries_.data()));
+		}
+		query_issued_.assign(count, false);
+		return;
+	}
+
+	std::vector<GpuInstance> instances(count);
+	std::vector<DrawCommand> commands(count);
+	for (unsigned int i = 0; i < count; i++)
+	{
+		std::memcpy(instances[i].center, boxes_[i].center, sizeof(boxes_[i].center));
+		std::memcpy(instances[i].extents, boxes_[i].extents, sizeof(boxes_[i].extents));
+		instances[i].center[3] = 1.0f;
+		instances[i].extents[3] = 0.0f;
+
+		// only the instance count is written by the shader, the rest stays as set here
+		commands[i] = { draws[i].index_count, 0, draws[i].first_index, draws[i].base_vertex, i };
+	}
+	std::vector<unsigned int> visibility(count, 1);
+
+	// the last frame's dispatch and indirect draw may still read the old buffers, Destroy waits them out
+	for (ShaderBufferHandle buffer : { instance_buffer_, visibility_buffer_, command_buffer_ })
+	{
+		if (buffer.IsValid())
+			resources_.Destroy(buffer);
+	}
+
+	// zero sized buffers aren't allowed, an empty set still gets one element
+	int element_count = count ? (int)count : 1;
+	instance_buffer_ = resources_.Create<ShaderBuffer>(count ? instances.data() : nullptr, element_count * (int)sizeof(GpuInstance));
+	visibility_buffer_ = resources_.Create<ShaderBuffer>(count ? visibility.data() : nullptr, element_count * (int)sizeof(unsigned int));
+	command_buffer_ = resources_.Create<ShaderBuffer>(count ? commands.data() : nullptr, element_count * (int)sizeof(DrawCommand));
+}
+
+bool OcclusionCuller::Dispatch(uint64_t key)
+{
+	unsigned int program = cull_shader_->GetProgram(key);
+	if (!program)
+		return false;
+	const ShaderReflection* reflection = cull_shader_->GetReflection(key);
+	GLCALL(glUseProgram(program));
+
+	Frustum frustum = Frustum::FromMatrix(view_projection_);
+	GLCALL(glUniform1ui(reflection->GetUniformLocation("u_InstanceCount"), (unsigned int)draws_.size()));
+	GLCALL(glUniform4fv(reflection->GetUniformLocation("u_Planes"), Frustum::PLANE_COUNT, &frustum.planes[0][0]));
+	if (key & LATE_PHASE)
+	{
+		GLCALL(glUniformMatrix4fv(reflection->GetUniformLocation("u_ViewProjection"), 1, GL_FALSE, view_projection_));
+		pyramid_->GetTexture()->Bind(0);
+	}
+
+	resources_.Get(instance_buffer_)->BindBase(GL_SHADER_STORAGE_BUFFER, 0);
+	resources_.Get(visibility_buffer_)->BindBase(GL_SHADER_STORAGE_BUFFER, 1);
+	resources_.Get(command_buffer_)->BindBase(GL_SHADER_STORAGE_BUFFER, 2);
+	GLCALL(glDispatchCompute(((unsigned int)draws_.size() + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE, 1, 1));
+
+	// the draw reads the commands the shader wrote, the next dispatch the visibility
+	GLCALL(glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT));
+	return true;
+}
+
+void OcclusionCuller::CullEarly(const float* view_projection)
+{
+	std::memcpy(view_projection_, view_projection, sizeof(view_projection_));
+	late_phase_ = false;
+	if (gpu_driven_ && !draws_.empty())
+		Dispatch(0);
+}
+
+void OcclusionCuller::CullLate(const Texture& depth, const float* camera_position)
+{
+	late_phase_ = true;
+	if (draws_.empty())
+		return;
+
+	if (!gpu_driven_)
+	{
+		IssueQueries(camera_position);
+		return;
+	}
+
+	// nothing to test against, draw nothing more rather than everything
+	if (!pyramid_->Build(depth) || !Dispatch(LATE_PHASE))
+	{
+		std::vector<DrawCommand> commands(draws_.size());
+		for (unsigned int i = 0; i < draws_.size(); i++)
+			commands[i] = { draws_[i].index_count, 0, draws_[i].first_index, draws_[i].base_vertex, i };
+		resources_.Get(command_buffer_)->SubData(0, commands.data(), (int)(commands.size() * sizeof(DrawCommand)));
+	}
+}
+
+void OcclusionCuller::DrawVisible() const
+{
+	if (draws_.empty())
+		return;
+
+	if (!gpu_driven_)
+	{
+		// the late phase only queries, everything that gets drawn is drawn early
+		if (!late_phase_)
+			DrawQueried();
+		return;
+	}
+
+	// every instance has a command, the hidden ones just have an instance count of 0
+	GLCALL(glBindBuffer(GL_DRAW_INDIRECT_BUFFER, resources_.Get(command_buffer_)->GetRendererId()));
+	GLCALL(glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, nullptr, (GLsizei)draws_.size(), 0));
+	GLCALL(glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0));
+}
+
+void OcclusionCuller::DrawQueried() const
+{
+	Frustum frustum = Frustum::FromMatrix(view_projection_);
+	for (unsigned int i = 0; i < draws_.size(); i++)
+	{
+		if (!frustum.IsBoxVisible(boxes_[i].center, boxes_[i].extents))
+			continue;
+
+		// NO_WAIT: if the result isn't back yet the instance is simply drawn, the CPU never waits for the GPU
+		const OcclusionDraw& draw = draws_[i];
+		if (query_issued_[i])
+		{
+			GLCALL(glBeginConditionalRender(queries_[i], GL_QUERY_NO_WAIT));
+		}
+		GLCALL(glDrawElementsBaseVertex(GL_TRIANGLES, draw.index_count, GL_UNSIGNED_INT,
+			(void*)(uintptr_t)(draw.first_index * sizeof(unsigned int)), draw.base_vertex));
+		if (query_issued_[i])
+		{
+			GLCALL(glEndConditionalRender());
+		}
+	}
+}
+
+void OcclusionCuller::IssueQueries(const float* camera_position)
+{
+	unsigned int program = box_shader_->GetProgram(0);
+	if (!program)
+		return;
+	const ShaderReflection* reflection = box_shader_->GetReflection(0);
+	int center_location = reflection->GetUniformLocation("u_Center");
+	int extents_location = reflection->GetUniformLocation("u_Extents");
+
+	GLCALL(glUseProgram(program));
+	GLCALL(glUniformMatrix4fv(reflection->GetUniformLocation("u_ViewProjection"), 1, GL_FALSE, view_projection_));
+	resources_.Get(box_vertex_array_)->Bind();
+
+	// the boxes are only tested against the depth buffer, they must not show up in it
+	GLCALL(glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE));
+	GLCALL(glDepthMask(GL_FALSE));
+
+	// a box face lying on the object's own surface rasterizes to the same depth, with GL_LESS it would fail
+	// and the object flicker between visible and hidden
+	int depth_func;
+	GLCALL(glGetIntegerv(GL_DEPTH_FUNC, &depth_func));
+	GLCALL(glDepthFunc(GL_LEQUAL));
+
+	Frustum frustum = Frustum::FromMatrix(view_projection_);
+	for (unsigned int i = 0; i < draws_.size(); i++)
+	{
+		const BoundingBox& box = boxes_[i];
+		query_issued_[i] = false;
+		if (!frustum.IsBoxVisible(box.center, box.extents))
+			continue;
+
+		// with the camera inside the box the near plane cuts its faces away and the query would say hidden
+		bool inside = true;
+		for (unsigned int axis = 0; axis < 3; axis++)
+			inside = inside && camera_position[axis] >= box.center[axis] - box.extents[axis] && camera_position[axis] <= box.center[axis] + box.extents[axis];
+		if (inside)
+			continue;
+
+		GLCALL(glUniform3fv(center_location, 1, box.center));
+		GLCALL(glUniform3fv(extents_location, 1, box.extents));
+		GLCALL(glBeginQuery(GL_ANY_SAMPLES_PASSED, queries_[i]));
+		GLCALL(glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, nullptr));
+		GLCALL(glEndQuery(GL_ANY_SAMPLES_PASSED));
+		query_issued_[i] = true;
+	}
+
+	GLCALL(glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE));
+	GLCALL(glDepthMask(GL_TRUE));
+	GLCALL(glDepthFunc(depth_func));
+}
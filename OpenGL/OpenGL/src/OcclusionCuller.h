@@ -0,0 +1,102 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "BoundingVolumes.h"
+#include "GpuResources.h"
+#include "HiZPyramid.h"
+#include "ShaderVariantCache.h"
+
+// What one instance draws from the index and vertex buffers bound by the caller (a GeometryRange of a
+// GeometryPool for example)
+struct OcclusionDraw
+{
+	unsigned int index_count;
+	unsigned int first_index;
+	int base_vertex;
+};
+
+// Draws a set of instances without the hidden ones, in two phases per frame:
+//   CullEarly + DrawVisible: what was visible last frame, which fills most of the depth buffer
+//   CullLate + DrawVisible:  everything tested against that depth, only what the early phase missed is drawn
+// With compute shaders and multi draw indirect the tests run on the GPU against a HiZPyramid of the early
+// depth and write the instance counts of an indirect command buffer, so nothing comes back to the CPU and
+// the instances are drawn with one glMultiDrawElementsIndirect per phase. Instance i is drawn with
+// base instance i. On GL 3.3 the late phase draws the bounding boxes in occlusion queries instead, and the
+// next frame's early phase draws each instance under conditional rendering on its query; an instance
+// that comes out from behind something then shows up a frame late.
+class OcclusionCuller
+{
+private:
+	// the layouts of OcclusionCull.shader
+	struct GpuInstance
+	{
+		float center[4];
+		float extents[4];
+	};
+
+	struct DrawCommand
+	{
+		unsigned int count;
+		unsigned int instance_count;
+		unsigned int first_index;
+		int base_vertex;
+		unsigned int base_instance;
+	};
+
+	GpuResources& resources_;
+	bool gpu_driven_;
+	bool late_phase_;
+	float view_projection_[16];
+	std::vector<BoundingBox> boxes_;
+	std::vector<OcclusionDraw> draws_;
+
+	// GPU path
+	std::unique_ptr<ShaderVariantCache> cull_shader_;
+	std::unique_ptr<HiZPyramid> pyramid_;
+	ShaderBufferHandle instance_buffer_;
+	ShaderBufferHandle visibility_buffer_;
+	ShaderBufferHandle command_buffer_;
+
+	// occlusion query path
+	std::unique_ptr<ShaderVariantCache> box_shader_;
+	VertexArrayHandle box_vertex_array_;
+	VertexBufferHandle box_vertex_buffer_;
+	IndexBufferHandle box_index_buffer_;
+	std::vector<unsigned int> queries_;
+	std::vector<bool> query_issued_;   // false when the last frame didn't query the instance, it is drawn unconditionally
+
+	// Run OcclusionCull.shader over every instance, false if it didn't compile
+	bool Dispatch(uint64_t key);
+
+	void DrawQueried() const;
+	void IssueQueries(const float* camera_position);
+
+public:
+	// the programs, buffers, box geometry and the Hi-Z pyramid live in resources
+	OcclusionCuller(ShaderPreprocessor& preprocessor, GpuResources& resources);
+	~OcclusionCuller();
+
+	OcclusionCuller(const OcclusionCuller&) = delete;
+	OcclusionCuller& operator=(const OcclusionCuller&) = delete;
+
+	// Replace the instances, bounds and draws are by instance index. Everything counts as visible until
+	// it has been tested once.
+	void SetInstances(const BoundingVolumes& bounds, const std::vector<OcclusionDraw>& draws);
+
+	// First phase of a frame, view_projection is column major. Changes the current program, bind the one
+	// to draw with afterwards.
+	void CullEarly(const float* view_projection);
+
+	// Second phase, once the early draws are in depth, which has to be the single sampled depth texture
+	// they went to. Changes the current program and vertex array, and on the query path the color and
+	// depth write masks for the duration of the call.
+	void CullLate(const Texture& depth, const float* camera_position);
+
+	// Draw the instances the last Cull call left visible, with the caller's program and vertex array
+	void DrawVisible() const;
+
+	inline bool IsGpuDriven() const { return gpu_driven_; }
+	inline unsigned int GetInstanceCount() const { return (unsigned int)draws_.size(); }
+};
@@ -0,0 +1,410 @@
+#include "OcclusionRasterizer.h"
+#include "Renderer.h"
+#include "Simd.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+
+// boxes are this much closer than they are when tested, so an occluder doesn't hide the object it was made from
+static constexpr float DEPTH_BIAS = 1e-5f;
+
+// value limited to [low, high] while still a float, a huge or NaN coordinate doesn't fit an int.
+// NaN fails both compares and ends up at low
+static inline float ClampCoordinate(float value, float low, float high)
+{
+	return std::min(std::max(low, value), high);
+}
+
+static const float identity[16] = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 };
+
+// result = a * b, all column major
+static void MultiplyMatrices(const float* a, const float* b, float* result)
+{
+	for (unsigned int column = 0; column < 4; column++)
+	{
+		for (unsigned int row = 0; row < 4; row++)
+		{
+			float sum = 0.0f;
+			for (unsigned int k = 0; k < 4; k++)
+				sum += a[k * 4 + row] * b[column * 4 + k];
+			result[column * 4 + row] = sum;
+		}
+	}
+}
+
+static void TransformPoint(const float* m, const float* point, float* clip)
+{
+	for (unsigned int row = 0; row < 4; row++)
+		clip[row] = m[row] * point[0] + m[4 + row] * point[1] + m[8 + row] * point[2] + m[12 + row];
+}
+
+// Cut a polygon of clip space points at the near plane (z >= -w), 3 points in, at most 4 out
+static unsigned int ClipNear(const float (*in)[4], unsigned int count, float (*out)[4])
+{
+	unsigned int out_count = 0;
+	for (unsigned int i = 0; i < count; i++)
+	{
+		const float* a = in[i];
+		const float* b = in[(i + 1) % count];
+		float da = a[2] + a[3];
+		float db = b[2] + b[3];
+		if (da >= 0.0f)
+		{
+			for (unsigned int c = 0; c < 4; c++)
+				out[out_count][c] = a[c];
+			out_count++;
+		}
+		if ((da >= 0.0f) != (db >= 0.0f))
+		{
+			float t = da / (da - db);
+			for (unsigned int c = 0; c < 4; c++)
+				out[out_count][c] = a[c] + (b[c] - a[c]) * t;
+			out_count++;
+		}
+	}
+	return out_count;
+}
+
+OcclusionRasterizer::OcclusionRasterizer(ThreadPool& pool, unsigned int width, unsigned int height)
+	: pool_(pool), width_(width), height_(height), tiles_x_((width + TILE_WIDTH - 1) / TILE_WIDTH),
+	tiles_y_((height + TILE_HEIGHT - 1) / TILE_HEIGHT), depth_(width * height, 1.0f), view_projection_()
+{
+	// rows are filled 4 pixels at a time and never straddle the end of a row
+	ASSERT(width % SIMD_WIDTH == 0);
+	tile_bins_.resize(tiles_x_ * tiles_y_);
+}
+
+OcclusionRasterizer::~OcclusionRasterizer()
+{
+	Finish();
+}
+
+OcclusionRasterizer::OccluderId OcclusionRasterizer::AddOccluder(const float* positions, unsigned int vertex_count,
+	const unsigned int* indices, unsigned int index_count)
+{
+	// the frame being rasterized reads the occluders
+	Finish();
+
+	OccluderId id;
+	if (!free_ids_.empty())
+	{
+		id = free_ids_.back();
+		free_ids_.pop_back();
+	}
+	else
+	{
+		id = (OccluderId)occluders_.size();
+		occluders_.emplace_back();
+	}
+
+	Occluder& occluder = occluders_[id];
+	occluder.positions.assign(positions, positions + vertex_count * 3);
+	occluder.indices.assign(indices, indices + index_count);
+	std::copy(identity, identity + 16, occluder.model);
+	occluder.live = true;
+	return id;
+}
+
+void OcclusionRasterizer::RemoveOccluder(OccluderId id)
+{
+	Finish();
+	ASSERT(id < occluders_.size() && occluders_[id].live);
+	Occluder& occluder = occluders_[id];
+	occluder.live = false;
+	occluder.positions = std::vector<float>();
+	occluder.indices = std::vector<unsigned int>();
+	free_ids_.push_back(id);
+}
+
+void OcclusionRasterizer::SetOccluderTransform(OccluderId id, const float* model)
+{
+	Finish();
+	ASSERT(id < occluders_.size() && occluders_[id].live);
+	std::copy(model, model + 16, occluders_[id].model);
+}
+
+void OcclusionRasterizer::BeginFrame(const float* view_projection)
+{
+	Finish();
+	std::copy(view_projection, view_projection + 16, view_projection_);
+
+	std::shared_ptr<std::promise<void>> done = std::make_shared<std::promise<void>>();
+	frame_ = done->get_future();
+	pool_.Submit([this, done]()
+	{
+		RasterizeFrame();
+		done->set_value();
+	});
+}
+
+void OcclusionRasterizer::Finish()
+{
+	if (frame_.valid())
+		frame_.get();
+}
+
+void OcclusionRasterizer::RasterizeFrame()
+{
+	SetupTriangles();
+
+	// every tile owns its pixels, so the tiles need no locking
+	pool_.ParallelFor(tile_bins_.size(), 1, [this](size_t begin, size_t end)
+	{
+		for (size_t tile = begin; tile < end; tile++)
+			RasterizeTile((unsigned int)tile);
+	});
+}
+
+void OcclusionRasterizer::SetupTriangles()
+{
+	triangles_.clear();
+	for (std::vector<unsigned int>& bin : tile_bins_)
+		bin.clear();
+
+	for (const Occluder& occluder : occluders_)
+	{
+		if (!occluder.live)
+			continue;
+
+		float model_view_projection[16];
+		MultiplyMatrices(view_projection_, occluder.model, model_view_projection);
+
+		unsigned int vertex_count = (unsigned int)occluder.positions.size() / 3;
+		clip_positions_.resize(vertex_count * 4);
+		for (unsigned int i = 0; i < vertex_count; i++)
+			TransformPoint(model_view_projection, &occluder.positions[i * 3], &clip_positions_[i * 4]);
+
+		for (unsigned int i = 0; i + 2 < occluder.indices.size(); i += 3)
+		{
+			float corners[3][4];
+			for (unsigned int corner = 0; corner < 3; corner++)
+				std::copy(&clip_positions_[occluder.indices[i + corner] * 4], &clip_positions_[occluder.indices[i + corner] * 4] + 4, corners[corner]);
+
+			// behind the near plane w goes to 0 and below, those parts are cut off before dividing by it;
+			// the other planes don't need clipping, the pixel loops stay inside the buffer anyway
+			float clipped[4][4];
+			unsigned int clipped_count = ClipNear(corners, 3, clipped);
+			if (clipped_count < 3)
+				continue;
+
+			float screen[4][3];
+			for (unsigned int corner = 0; corner < clipped_count; corner++)
+			{
+				float inverse_w = 1.0f / clipped[corner][3];
+				screen[corner][0] = (clipped[corner][0] * inverse_w * 0.5f + 0.5f) * width_;
+				screen[corner][1] = (clipped[corner][1] * inverse_w * 0.5f + 0.5f) * height_;
+				screen[corner][2] = clipped[corner][2] * inverse_w * 0.5f + 0.5f;
+			}
+
+			// the clipped polygon is convex, a fan splits it back into triangles
+			for (unsigned int corner = 1; corner + 1 < clipped_count; corner++)
+			{
+				ScreenTriangle triangle;
+				const unsigned int fan[3] = { 0, corner, corner + 1 };
+				for (unsigned int v = 0; v < 3; v++)
+				{
+					triangle.x[v] = screen[fan[v]][0];
+					triangle.y[v] = screen[fan[v]][1];
+					triangle.z[v] = screen[fan[v]][2];
+				}
+
+				// counter clockwise with y up has a positive area, anything else faces away or is a sliver
+				float area = (triangle.x[1] - triangle.x[0]) * (triangle.y[2] - triangle.y[0]) - (triangle.y[1] - triangle.y[0]) * (triangle.x[2] - triangle.x[0]);
+				if (area <= 0.0f)
+					continue;
+
+				float min_x = std::min({ triangle.x[0], triangle.x[1], triangle.x[2] });
+				float max_x = std::max({ triangle.x[0], triangle.x[1], triangle.x[2] });
+				float min_y = std::min({ triangle.y[0], triangle.y[1], triangle.y[2] });
+				float max_y = std::max({ triangle.y[0], triangle.y[1], triangle.y[2] });
+				if (max_x < 0.0f || max_y < 0.0f || min_x >= width_ || min_y >= height_)
+					continue;
+
+				unsigned int first_tile_x = (unsigned int)ClampCoordinate(min_x, 0.0f, (float)width_) / TILE_WIDTH;
+				unsigned int last_tile_x = std::min((unsigned int)ClampCoordinate(max_x, 0.0f, (float)width_) / TILE_WIDTH, tiles_x_ - 1);
+				unsigned int first_tile_y = (unsigned int)ClampCoordinate(min_y, 0.0f, (float)height_) / TILE_HEIGHT;
+				unsigned int last_tile_y = std::min((unsigned int)ClampCoordinate(max_y, 0.0f, (float)height_) / TILE_HEIGHT, tiles_y_ - 1);
+
+				unsigned int index = (unsigned int)triangles_.size();
+				triangles_.push_back(triangle);
+				for (unsigned int tile_y = first_tile_y; tile_y <= last_tile_y; tile_y++)
+				{
+					for (unsigned int tile_x = first_tile_x; tile_x <= last_tile_x; tile_x++)
+						tile_bins_[tile_y * tiles_x_ + tile_x].push_back(index);
+				}
+			}
+		}
+	}
+}
+
+void OcclusionRasterizer::RasterizeTile(unsigned int tile)
+{
+	unsigned int tile_x0 = (tile % tiles_x_) * TILE_WIDTH;
+	unsigned int tile_y0 = (tile / tiles_x_) * TILE_HEIGHT;
+	unsigned int tile_x1 = std::min(tile_x0 + TILE_WIDTH, width_);
+	unsigned int tile_y1 = std::min(tile_y0 + TILE_HEIGHT, height_);
+
+	for (unsigned int y = tile_y0; y < tile_y1; y++)
+		std::fill(&depth_[y * width_ + tile_x0], &depth_[y * width_ + tile_x0] + (tile_x1 - tile_x0), 1.0f);
+
+	static const float pixel_centers[4] = { 0.5f, 1.5f, 2.5f, 3.5f };
+	const SimdFloat lane_offsets = SimdLoad(pixel_centers);
+	const SimdFloat zero = SimdSplat(0.0f);
+
+	for (unsigned int index : tile_bins_[tile])
+	{
+		const ScreenTriangle& t = triangles_[index];
+
+		// edge functions a * x + b * y + c, positive inside. The edge opposite a corner, divided by the
+		// area, is that corner's barycentric weight.
+		float a[3], b[3], c[3];
+		for (unsigned int edge = 0; edge < 3; edge++)
+		{
+			unsigned int from = (edge + 1) % 3;
+			unsigned int to = (edge + 2) % 3;
+			a[edge] = t.y[from] - t.y[to];
+			b[edge] = t.x[to] - t.x[from];
+			c[edge] = -(a[edge] * t.x[from] + b[edge] * t.y[from]);
+		}
+		float area = a[0] * t.x[0] + b[0] * t.y[0] + c[0];
+		float inverse_area = 1.0f / area;
+
+		// depth is linear in screen space: z0 + w1 * (z1 - z0) + w2 * (z2 - z0)
+		float z_a = (a[1] * (t.z[1] - t.z[0]) + a[2] * (t.z[2] - t.z[0])) * inverse_area;
+		float z_b = (b[1] * (t.z[1] - t.z[0]) + b[2] * (t.z[2] - t.z[0])) * inverse_area;
+		float z_c = t.z[0] + (c[1] * (t.z[1] - t.z[0]) + c[2] * (t.z[2] - t.z[0])) * inverse_area;
+
+		// pixels whose centers can be inside, the start rounded down to a whole SIMD group
+		int min_x = (int)ClampCoordinate(std::floor(std::min({ t.x[0], t.x[1], t.x[2] })), (float)tile_x0, (float)tile_x1);
+		int max_x = std::min((int)tile_x1 - 1, (int)ClampCoordinate(std::ceil(std::max({ t.x[0], t.x[1], t.x[2] })), (float)tile_x0, (float)tile_x1));
+		int min_y = (int)ClampCoordinate(std::floor(std::min({ t.y[0], t.y[1], t.y[2] })), (float)tile_y0, (float)tile_y1);
+		int max_y = std::min((int)tile_y1 - 1, (int)ClampCoordinate(std::ceil(std::max({ t.y[0], t.y[1], t.y[2] })), (float)tile_y0, (float)tile_y1));
+		min_x &= ~(int)(SIMD_WIDTH - 1);
+
+		SimdFloat edge_a[3], step[3];
+		for (unsigned int edge = 0; edge < 3; edge++)
+		{
+			edge_a[edge] = SimdSplat(a[edge]);
+			step[edge] = SimdSplat(a[edge] * SIMD_WIDTH);
+		}
+		SimdFloat depth_a = SimdSplat(z_a);
+
+		for (int y = min_y; y <= max_y; y++)
+		{
+			float center_y = y + 0.5f;
+			SimdFloat x = SimdAdd(SimdSplat((float)min_x), lane_offsets);
+			SimdFloat e0 = SimdMulAdd(edge_a[0], x, SimdSplat(b[0] * center_y + c[0]));
+			SimdFloat e1 = SimdMulAdd(edge_a[1], x, SimdSplat(b[1] * center_y + c[1]));
+			SimdFloat e2 = SimdMulAdd(edge_a[2], x, SimdSplat(b[2] * center_y + c[2]));
+			SimdFloat z = SimdMulAdd(depth_a, x, SimdSplat(z_b * center_y + z_c));
+			SimdFloat z_step = SimdSplat(z_a * SIMD_WIDTH);
+
+			float* row = &depth_[y * width_];
+			for (int pixel = min_x; pixel <= max_x; pixel += SIMD_WIDTH)
+			{
+				SimdMask inside = SimdGreaterEqual(SimdMin(SimdMin(e0, e1), e2), zero);
+				SimdFloat depth = SimdLoad(row + pixel);
+				SimdStore(row + pixel, SimdSelect(inside, SimdMin(depth, z), depth));
+
+				e0 = SimdAdd(e0, step[0]);
+				e1 = SimdAdd(e1, step[1]);
+				e2 = SimdAdd(e2, step[2]);
+				z = SimdAdd(z, z_step);
+			}
+		}
+	}
+}
+
+bool OcclusionRasterizer::TestBox(const BoundingBox& box) const
+{
+	float min_x = (float)width_, max_x = -1.0f;
+	float min_y = (float)height_, max_y = -1.0f;
+	float nearest = 1.0f;
+	for (unsigned int corner = 0; corner < 8; corner++)
+	{
+		float point[3];
+		for (unsigned int axis = 0; axis < 3; axis++)
+			point[axis] = box.center[axis] + ((corner >> axis) & 1 ? box.extents[axis] : -box.extents[axis]);
+
+		// the box reaches around the camera, no rectangle on screen covers it
+		float clip[4];
+		TransformPoint(view_projection_, point, clip);
+		if (clip[2] < -clip[3] || clip[3] <= 0.0f)
+			return true;
+
+		float x = (clip[0] / clip[3] * 0.5f + 0.5f) * width_;
+		float y = (clip[1] / clip[3] * 0.5f + 0.5f) * height_;
+		min_x = std::min(min_x, x);
+		max_x = std::max(max_x, x);
+		min_y = std::min(min_y, y);
+		max_y = std::max(max_y, y);
+		nearest = std::min(nearest, clip[2] / clip[3] * 0.5f + 0.5f);
+	}
+
+	// off screen, nothing to see
+	if (max_x < 0.0f || max_y < 0.0f || min_x >= width_ || min_y >= height_)
+		return false;
+
+	int first_x = (int)ClampCoordinate(min_x, 0.0f, (float)width_);
+	int last_x = std::min((int)width_ - 1, (int)ClampCoordinate(max_x, 0.0f, (float)width_));
+	int first_y = (int)ClampCoordinate(min_y, 0.0f, (float)height_);
+	int last_y = std::min((int)height_ - 1, (int)ClampCoordinate(max_y, 0.0f, (float)height_));
+
+	// visible as soon as one covered pixel has nothing in front of the nearest point of the box
+	SimdFloat box_depth = SimdSplat(nearest - DEPTH_BIAS);
+	int group_start = first_x & ~(int)(SIMD_WIDTH - 1);
+	for (int y = first_y; y <= last_y; y++)
+	{
+		const float* row = &depth_[y * width_];
+		for (int x = group_start; x <= last_x; x += SIMD_WIDTH)
+		{
+			unsigned int lanes = (1u << SIMD_WIDTH) - 1;
+			if (x < first_x)
+				lanes &= ~0u << (first_x - x);
+			if (x + (int)SIMD_WIDTH - 1 > last_x)
+				lanes &= (1u << (last_x - x + 1)) - 1;
+
+			if (SimdMaskBits(SimdGreaterEqual(SimdLoad(row + x), box_depth)) & lanes)
+				return true;
+		}
+	}
+	return false;
+}
+
+bool OcclusionRasterizer::IsBoxVisible(const BoundingBox& box)
+{
+	Finish();
+	return TestBox(box);
+}
+
+void OcclusionRasterizer::TestBoxes(const BoundingVolumes& bounds, const std::vector<unsigned int>* candidates, std::vector<unsigned int>& visible)
+{
+	Finish();
+
+	unsigned int count = candidates ? (unsigned int)candidates->size() : bounds.GetCount();
+	std::vector<unsigned char> results(count);
+
+	// the depth buffer is only read now, any number of threads can test at once
+	pool_.ParallelFor(count, 256, [&](size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; i++)
+		{
+			unsigned int object = candidates ? (*candidates)[i] : (unsigned int)i;
+			BoundingBox box = { { bounds.GetCenterX()[object], bounds.GetCenterY()[object], bounds.GetCenterZ()[object] },
+				{ bounds.GetExtentX()[object], bounds.GetExtentY()[object], bounds.GetExtentZ()[object] } };
+			results[i] = TestBox(box) ? 1 : 0;
+		}
+	});
+
+	// candidates may be visible itself, so the result is put together on the side
+	std::vector<unsigned int> kept;
+	kept.reserve(count);
+	for (unsigned int i = 0; i < count; i++)
+	{
+		if (results[i])
+			kept.push_back(candidates ? (*candidates)[i] : i);
+	}
+	visible.swap(kept);
+}
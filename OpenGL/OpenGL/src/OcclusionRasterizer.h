@@ -0,0 +1,97 @@
+#pragma once
+
+#include <future>
+#include <vector>
+
+#include "BoundingVolumes.h"
+
+class ThreadPool;
+
+// Occlusion culling on the CPU, for contexts without compute shaders where GPU queries would only answer
+// a frame late. A few big occluder meshes (walls, terrain, buildings) are rasterized into a small depth
+// buffer and object boxes are tested against it. Triangles are binned into screen tiles which are filled
+// in parallel, 4 pixels per SIMD instruction. Rasterizing runs on the ThreadPool while the render thread
+// goes on submitting GL work, it only has to be finished before the first test.
+class OcclusionRasterizer
+{
+public:
+	typedef unsigned int OccluderId;
+
+private:
+	struct Occluder
+	{
+		std::vector<float> positions;         // x, y, z per vertex
+		std::vector<unsigned int> indices;    // counter clockwise triangles, back faces are skipped
+		float model[16];                      // column major
+		bool live;
+	};
+
+	// a triangle after projection, in pixels with y up and depth in [0, 1]
+	struct ScreenTriangle
+	{
+		float x[3];
+		float y[3];
+		float z[3];
+	};
+
+	ThreadPool& pool_;
+	unsigned int width_;
+	unsigned int height_;
+	unsigned int tiles_x_;
+	unsigned int tiles_y_;
+	std::vector<float> depth_;   // nearest occluder depth per pixel, row by row from the bottom
+	std::vector<Occluder> occluders_;
+	std::vector<OccluderId> free_ids_;
+	std::vector<float> clip_positions_;   // scratch, x, y, z, w per vertex of the occluder being set up
+	std::vector<ScreenTriangle> triangles_;
+	std::vector<std::vector<unsigned int>> tile_bins_;   // triangles touching each tile
+	float view_projection_[16];
+	std::future<void> frame_;
+
+	// Clip, project and bin every occluder triangle
+	void SetupTriangles();
+	void RasterizeTile(unsigned int tile);
+	void RasterizeFrame();
+
+	// The test itself, the frame has to be finished
+	bool TestBox(const BoundingBox& box) const;
+
+public:
+	// pixels of a tile, a tile is filled by one thread at a time
+	static constexpr unsigned int TILE_WIDTH = 64;
+	static constexpr unsigned int TILE_HEIGHT = 32;
+
+	// The depth buffer is width x height pixels, width a multiple of 4. It doesn't need the window's
+	// aspect ratio, the view projection maps to it whatever its size.
+	OcclusionRasterizer(ThreadPool& pool, unsigned int width = 256, unsigned int height = 128);
+	~OcclusionRasterizer();
+
+	OcclusionRasterizer(const OcclusionRasterizer&) = delete;
+	OcclusionRasterizer& operator=(const OcclusionRasterizer&) = delete;
+
+	// Copy an occluder mesh, it is kept until RemoveOccluder. Keep them low poly, every triangle costs.
+	OccluderId AddOccluder(const float* positions, unsigned int vertex_count, const unsigned int* indices, unsigned int index_count);
+	void RemoveOccluder(OccluderId id);
+
+	// Place an occluder in the world, identity until set
+	void SetOccluderTransform(OccluderId id, const float* model);
+
+	// Start rasterizing every occluder for a column major view projection and return right away.
+	// Waits for the previous frame first if that is still running.
+	void BeginFrame(const float* view_projection);
+
+	// Wait until the frame started by BeginFrame is rasterized, the tests do it by themselves
+	void Finish();
+
+	// false only if every pixel the box covers has an occluder in front of the whole box
+	bool IsBoxVisible(const BoundingBox& box);
+
+	// Keep the visible ones of the objects listed in candidates (all of them if it is nullptr), in order.
+	// Spread over the pool for long lists. candidates can be &visible.
+	void TestBoxes(const BoundingVolumes& bounds, const std::vector<unsigned int>* candidates, std::vector<unsigned int>& visible);
+
+	inline unsigned int GetWidth() const { return width_; }
+	inline unsigned int GetHeight() const { return height_; }
+	// Only valid after Finish
+	inline const float* GetDepth() const { return depth_.data(); }
+};
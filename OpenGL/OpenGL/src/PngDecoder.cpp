@@ -0,0 +1,470 @@
+#include "PngDecoder.h"
+
+#include <cstdint>
+#include <cstring>
+
+// Inflate (RFC 1951), in the style of zlib's puff: canonical Huffman decoding one bit at a time
+// with a lookup of the first 9 bits for the common short codes.
+
+struct BitReader
+{
+	const uint8_t* data;
+	size_t size;
+	size_t position;
+	uint32_t buffer;
+	int count;
+	bool overrun;
+
+	inline uint32_t Bits(int needed)
+	{
+		while (count < needed)
+		{
+			uint32_t byte = 0;
+			if (position < size)
+				byte = data[position++];
+			else
+				overrun = true;
+			buffer |= byte << count;
+			count += 8;
+		}
+		uint32_t value = buffer & ((1u << needed) - 1);
+		buffer >>= needed;
+		count -= needed;
+		return value;
+	}
+};
+
+static const int MAX_BITS = 15;
+static const int FAST_BITS = 9;
+
+struct Huffman
+{
+	uint16_t counts[MAX_BITS + 1];
+	uint16_t symbols[288];
+	// (length << 9 | symbol) for codes of at most FAST_BITS bits, indexed by the next FAST_BITS bits reversed, 0 if longer
+	uint16_t fast[1 << FAST_BITS];
+};
+
+static bool BuildHuffman(Huffman& huffman, const uint8_t* lengths, int symbol_count)
+{
+	std::memset(huffman.counts, 0, sizeof(huffman.counts));
+	std::memset(huffman.fast, 0, sizeof(huffman.fast));
+	for (int symbol = 0; symbol < symbol_count; symbol++)
+		huffman.counts[lengths[symbol]]++;
+	huffman.counts[0] = 0;
+
+	uint16_t offsets[MAX_BITS + 2];
+	offsets[1] = 0;
+	int left = 1;
+	for (int length = 1; length <= MAX_BITS; length++)
+	{
+		left = (left << 1) - huffman.counts[length];
+		if (left < 0)
+			return false;
+		offsets[length + 1] = offsets[length] + huffman.counts[length];
+	}
+	for (int symbol = 0; symbol < symbol_count; symbol++)
+	{
+		if (lengths[symbol])
+			huffman.symbols[offsets[lengths[symbol]]++] = (uint16_t)symbol;
+	}
+
+	// fill the fast table by walking the canonical codes in order
+	int code = 0;
+	int index = 0;
+	for (int length = 1; length <= FAST_BITS; length++)
+	{
+		for (int i = 0; i < huffman.counts[length]; i++, index++, code++)
+		{
+			// deflate sends codes most significant bit first, the bit reader hands them out reversed
+			int reversed = 0;
+			for (int bit = 0; bit < length; bit++)
+				reversed |= ((code >> bit) & 1) << (length - 1 - bit);
+			for (int fill = reversed; fill < (1 << FAST_BITS); fill += 1 << length)
+				huffman.fast[fill] = (uint16_t)((length << 9) | huffman.symbols[index]);
+		}
+		code <<= 1;
+	}
+	return true;
+}
+
+static int DecodeSymbol(BitReader& reader, const Huffman& huffman)
+{
+	// the fast table needs FAST_BITS buffered, past the end of the data fall through to the slow walk
+	if (reader.count < FAST_BITS && reader.size - reader.position >= 2)
+	{
+		reader.buffer |= (uint32_t)reader.data[reader.position] << reader.count;
+		reader.buffer |= (uint32_t)reader.data[reader.position + 1] << (reader.count + 8);
+		reader.position += 2;
+		reader.count += 16;
+	}
+	if (reader.count >= FAST_BITS)
+	{
+		uint16_t entry = huffman.fast[reader.buffer & ((1 << FAST_BITS) - 1)];
+		if (entry)
+		{
+			int length = entry >> 9;
+			reader.buffer >>= length;
+			reader.count -= length;
+			return entry & 0x1FF;
+		}
+	}
+
+	int code = 0, first = 0, index = 0;
+	for (int length = 1; length <= MAX_BITS; length++)
+	{
+		code |= (int)reader.Bits(1);
+		int count = huffman.counts[length];
+		if (code - count < first)
+			return huffman.symbols[index + (code - first)];
+		index += count;
+		first += count;
+		first <<= 1;
+		code <<= 1;
+	}
+	return -1;
+}
+
+static const uint16_t LENGTH_BASE[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+static const uint8_t LENGTH_EXTRA[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+static const uint16_t DISTANCE_BASE[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+static const uint8_t DISTANCE_EXTRA[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+static bool InflateBlock(BitReader& reader, const Huffman& lengths, const Huffman& distances, uint8_t* out, size_t out_size, size_t& written)
+{
+	while (true)
+	{
+		int symbol = DecodeSymbol(reader, lengths);
+		if (symbol < 0 || reader.overrun)
+			return false;
+		if (symbol < 256)
+		{
+			if (written >= out_size)
+				return false;
+			out[written++] = (uint8_t)symbol;
+		}
+		else if (symbol == 256)
+		{
+			return true;
+		}
+		else
+		{
+			symbol -= 257;
+			if (symbol >= 29)
+				return false;
+			size_t length = LENGTH_BASE[symbol] + reader.Bits(LENGTH_EXTRA[symbol]);
+			int distance_symbol = DecodeSymbol(reader, distances);
+			if (distance_symbol < 0 || distance_symbol >= 30)
+				return false;
+			size_t distance = DISTANCE_BASE[distance_symbol] + reader.Bits(DISTANCE_EXTRA[distance_symbol]);
+			if (distance > written || written + length > out_size)
+				return false;
+			// the copy can overlap itself (distance < length), so byte by byte
+			const uint8_t* from = out + written - distance;
+			for (size_t i = 0; i < length; i++)
+				out[written + i] = from[i];
+			written += length;
+		}
+	}
+}
+
+// Inflate a zlib stream into exactly out_size bytes
+static bool ZlibInflate(const uint8_t* data, size_t size, uint8_t* out, size_t out_size)
+{
+	if (size < 2 || (data[0] & 0x0F) != 8 || ((data[0] << 8) | data[1]) % 31 != 0 || (data[1] & 0x20))
+		return false;
+
+	BitReader reader = { data, size, 2, 0, 0, false };
+	size_t written = 0;
+	bool last = false;
+
+	static Huffman fixed_lengths, fixed_distances;
+	static bool fixed_built = []()
+	{
+		uint8_t lengths[288];
+		for (int i = 0; i < 144; i++) lengths[i] = 8;
+		for (int i = 144; i < 256; i++) lengths[i] = 9;
+		for (int i = 256; i < 280; i++) lengths[i] = 7;
+		for (int i = 280; i < 288; i++) lengths[i] = 8;
+		BuildHuffman(fixed_lengths, lengths, 288);
+		for (int i = 0; i < 30; i++) lengths[i] = 5;
+		BuildHuffman(fixed_distances, lengths, 30);
+		return true;
+	}();
+	(void)fixed_built;
+
+	while (!last)
+	{
+		last = reader.Bits(1) != 0;
+		uint32_t type = reader.Bits(2);
+
+		if (type == 0)
+		{
+			// stored block, starts on a byte boundary. Whole bytes still in the bit buffer go back to the stream
+			reader.position -= reader.count / 8;
+			reader.buffer = 0;
+			reader.count = 0;
+			if (reader.position + 4 > size)
+				return false;
+			size_t length = data[reader.position] | (data[reader.position + 1] << 8);
+			reader.position += 4;
+			if (reader.position + length > size || written + length > out_size)
+				return false;
+			std::memcpy(out + written, data + reader.position, length);
+			reader.position += length;
+			written += length;
+		}
+		else if (type == 1)
+		{
+			if (!InflateBlock(reader, fixed_lengths, fixed_distances, out, out_size, written))
+				return false;
+		}
+		else if (type == 2)
+		{
+			static const uint8_t ORDER[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+			int literal_count = reader.Bits(5) + 257;
+			int distance_count = reader.Bits(5) + 1;
+			int code_count = reader.Bits(4) + 4;
+			if (literal_count > 286 || distance_count > 30)
+				return false;
+
+			uint8_t lengths[320] = {};
+			for (int i = 0; i < code_count; i++)
+				lengths[ORDER[i]] = (uint8_t)reader.Bits(3);
+			Huffman code_lengths;
+			if (!BuildHuffman(code_lengths, lengths, 19))
+				return false;
+
+			int index = 0;
+			std::memset(lengths, 0, sizeof(lengths));
+			while (index < literal_count + distance_count)
+			{
+				int symbol = DecodeSymbol(reader, code_lengths);
+				if (symbol < 0 || reader.overrun)
+					return false;
+				if (symbol < 16)
+				{
+					lengths[index++] = (uint8_t)symbol;
+					continue;
+				}
+				uint8_t repeat_value = 0;
+				int repeat;
+				if (symbol == 16)
+				{
+					if (index == 0)
+						return false;
+					repeat_value = lengths[index - 1];
+					repeat = 3 + reader.Bits(2);
+				}
+				else if (symbol == 17)
+					repeat = 3 + reader.Bits(3);
+				else
+					repeat = 11 + reader.Bits(7);
+				if (index + repeat > literal_count + distance_count)
+					return false;
+				while (repeat--)
+					lengths[index++] = repeat_value;
+			}
+
+			Huffman literal_huffman, distance_huffman;
+			if (!BuildHuffman(literal_huffman, lengths, literal_count) || !BuildHuffman(distance_huffman, lengths + literal_count, distance_count))
+				return false;
+			if (!InflateBlock(reader, literal_huffman, distance_huffman, out, out_size, written))
+				return false;
+		}
+		else
+		{
+			return false;
+		}
+	}
+	return written == out_size;
+}
+
+// PNG (https://www.w3.org/TR/png/)
+
+static const uint8_t PNG_SIGNATURE[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+
+static uint32_t ReadBigEndian(const uint8_t* data)
+{
+	return ((uint32_t)data[0] << 24) | ((uint32_t)data[1] << 16) | ((uint32_t)data[2] << 8) | data[3];
+}
+
+// Bit depths the spec allows for a color type, everything else would break the sample unpacking below
+static bool IsValidBitDepth(int color_type, int bit_depth)
+{
+	switch (color_type)
+	{
+		case 0: return bit_depth == 1 || bit_depth == 2 || bit_depth == 4 || bit_depth == 8 || bit_depth == 16;
+		case 3: return bit_depth == 1 || bit_depth == 2 || bit_depth == 4 || bit_depth == 8;
+		case 2:
+		case 4:
+		case 6: return bit_depth == 8 || bit_depth == 16;
+	}
+	return false;
+}
+
+bool IsPng(const void* data, size_t size)
+{
+	return size >= 8 && std::memcmp(data, PNG_SIGNATURE, 8) == 0;
+}
+
+bool ReadPngSize(const void* data, size_t size, unsigned int& width, unsigned int& height)
+{
+	const uint8_t* bytes = (const uint8_t*)data;
+	if (size < 33 || !IsPng(data, size) || std::memcmp(bytes + 12, "IHDR", 4) != 0)
+		return false;
+	width = ReadBigEndian(bytes + 16);
+	height = ReadBigEndian(bytes + 20);
+	return width > 0 && height > 0 && width <= PNG_MAX_DIMENSION && height <= PNG_MAX_DIMENSION
+		&& IsValidBitDepth(bytes[25], bytes[24]);
+}
+
+static uint8_t Paeth(int a, int b, int c)
+{
+	int p = a + b - c;
+	int pa = p > a ? p - a : a - p;
+	int pb = p > b ? p - b : b - p;
+	int pc = p > c ? p - c : c - p;
+	if (pa <= pb && pa <= pc)
+		return (uint8_t)a;
+	return (uint8_t)(pb <= pc ? b : c);
+}
+
+bool DecodePng(const void* data, size_t size, void* rgba_pixels, std::vector<unsigned char>& scratch)
+{
+	unsigned int width, height;
+	if (!ReadPngSize(data, size, width, height))
+		return false;
+
+	const uint8_t* bytes = (const uint8_t*)data;
+	int bit_depth = bytes[24];
+	int color_type = bytes[25];
+	if (bytes[28] != 0)
+		return false; // interlaced images aren't supported
+
+	int channels;
+	switch (color_type)
+	{
+		case 0: channels = 1; break;
+		case 2: channels = 3; break;
+		case 3: channels = 1; break;
+		case 4: channels = 2; break;
+		case 6: channels = 4; break;
+		default: return false;
+	}
+
+	uint8_t palette[256 * 4];
+	std::memset(palette, 0xFF, sizeof(palette));
+
+	// gather every IDAT chunk into the front of scratch, the inflated rows go after it
+	scratch.clear();
+	size_t position = 8;
+	while (position + 12 <= size)
+	{
+		uint32_t length = ReadBigEndian(bytes + position);
+		const uint8_t* type = bytes + position + 4;
+		const uint8_t* chunk = bytes + position + 8;
+		if (position + 12 + (size_t)length > size)
+			return false;
+
+		if (std::memcmp(type, "IDAT", 4) == 0)
+			scratch.insert(scratch.end(), chunk, chunk + length);
+		else if (std::memcmp(type, "PLTE", 4) == 0)
+		{
+			for (uint32_t i = 0; i < length / 3 && i < 256; i++)
+			{
+				palette[i * 4 + 0] = chunk[i * 3 + 0];
+				palette[i * 4 + 1] = chunk[i * 3 + 1];
+				palette[i * 4 + 2] = chunk[i * 3 + 2];
+			}
+		}
+		else if (std::memcmp(type, "tRNS", 4) == 0 && color_type == 3)
+		{
+			for (uint32_t i = 0; i < length && i < 256; i++)
+				palette[i * 4 + 3] = chunk[i];
+		}
+		else if (std::memcmp(type, "IEND", 4) == 0)
+			break;
+
+		position += 12 + length;
+	}
+
+	size_t compressed_size = scratch.size();
+	size_t bits_per_pixel = (size_t)channels * bit_depth;
+	size_t row_bytes = (width * bits_per_pixel + 7) / 8;
+	size_t pixel_bytes = (bits_per_pixel + 7) / 8;
+	size_t inflated_size = (row_bytes + 1) * height;
+
+	scratch.resize(compressed_size + inflated_size);
+	uint8_t* rows = scratch.data() + compressed_size;
+	if (!ZlibInflate(scratch.data(), compressed_size, rows, inflated_size))
+		return false;
+
+	// undo the per row filters in place, each row starts with its filter type byte
+	for (unsigned int y = 0; y < height; y++)
+	{
+		uint8_t* row = rows + y * (row_bytes + 1) + 1;
+		const uint8_t* previous = y > 0 ? row - (row_bytes + 1) : nullptr;
+		uint8_t filter = row[-1];
+		for (size_t i = 0; i < row_bytes; i++)
+		{
+			int left = i >= pixel_bytes ? row[i - pixel_bytes] : 0;
+			int up = previous ? previous[i] : 0;
+			int up_left = previous && i >= pixel_bytes ? previous[i - pixel_bytes] : 0;
+			switch (filter)
+			{
+				case 0: break;
+				case 1: row[i] = (uint8_t)(row[i] + left); break;
+				case 2: row[i] = (uint8_t)(row[i] + up); break;
+				case 3: row[i] = (uint8_t)(row[i] + ((left + up) >> 1)); break;
+				case 4: row[i] = (uint8_t)(row[i] + Paeth(left, up, up_left)); break;
+				default: return false;
+			}
+		}
+	}
+
+	// expand whatever the image has into RGBA8
+	uint8_t* out = (uint8_t*)rgba_pixels;
+	int max_value = (1 << (bit_depth < 8 ? bit_depth : 8)) - 1;
+	for (unsigned int y = 0; y < height; y++)
+	{
+		const uint8_t* row = rows + y * (row_bytes + 1) + 1;
+		for (unsigned int x = 0; x < width; x++, out += 4)
+		{
+			// read sample c of this pixel as an 8 bit value (16 bit samples keep their high byte)
+			auto sample = [&](int c) -> int
+			{
+				if (bit_depth == 8)
+					return row[x * channels + c];
+				if (bit_depth == 16)
+					return row[(x * channels + c) * 2];
+				size_t bit = ((size_t)x * channels + c) * bit_depth;
+				return (row[bit / 8] >> (8 - bit_depth - bit % 8)) & max_value;
+			};
+
+			switch (color_type)
+			{
+				case 0:
+				{
+					int gray = bit_depth < 8 ? sample(0) * 255 / max_value : sample(0);
+					out[0] = out[1] = out[2] = (uint8_t)gray;
+					out[3] = 255;
+					break;
+				}
+				case 2:
+					out[0] = (uint8_t)sample(0); out[1] = (uint8_t)sample(1); out[2] = (uint8_t)sample(2); out[3] = 255;
+					break;
+				case 3:
+					std::memcpy(out, &palette[sample(0) * 4], 4);
+					break;
+				case 4:
+					out[0] = out[1] = out[2] = (uint8_t)sample(0); out[3] = (uint8_t)sample(1);
+					break;
+				case 6:
+					out[0] = (uint8_t)sample(0); out[1] = (uint8_t)sample(1); out[2] = (uint8_t)sample(2); out[3] = (uint8_t)sample(3);
+					break;
+			}
+		}
+	}
+	return true;
+}
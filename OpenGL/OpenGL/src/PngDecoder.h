@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// Small self contained PNG decoder (zlib inflate + unfiltering) that writes RGBA8 straight into memory
+// the caller owns, so decoded pixels can land directly in staging memory. Handles every color type and
+// bit depth of non-interlaced images, 16 bit channels are cut down to 8 bits.
+
+// Larger images are refused before anything is allocated for them, no GPU takes textures that big anyway
+static const unsigned int PNG_MAX_DIMENSION = 16384;
+
+// Whether data starts with the PNG signature
+bool IsPng(const void* data, size_t size);
+
+// Read the size from the header without decoding anything. False for anything but a supported header:
+// a color type/bit depth pair the spec allows, and both sizes between 1 and PNG_MAX_DIMENSION.
+bool ReadPngSize(const void* data, size_t size, unsigned int& width, unsigned int& height);
+
+// Decode into rgba_pixels (width * height * 4 bytes). scratch is reused between calls to avoid reallocating.
+bool DecodePng(const void* data, size_t size, void* rgba_pixels, std::vector<unsigned char>& scratch);
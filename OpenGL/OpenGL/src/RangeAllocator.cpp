@@ -0,0 +1,106 @@
+#include "RangeAllocator.h"
+#include "Renderer.h"
+
+RangeAllocator::RangeAllocator(unsigned int capacity)
+	: capacity_(0), free_space_(0)
+{
+	Grow(capacity);
+}
+
+void RangeAllocator::InsertFree(unsigned int offset, unsigned int size)
+{
+	free_by_offset_[offset] = size;
+	free_by_size_.insert({ size, offset });
+	free_space_ += size;
+}
+
+void RangeAllocator::EraseFree(std::map<unsigned int, unsigned int>::iterator it)
+{
+	// there can be several free ranges with the same size, find the one starting at this offset
+	auto range = free_by_size_.equal_range(it->second);
+	for (auto size_it = range.first; size_it != range.second; ++size_it)
+	{
+		if (size_it->second == it->first)
+		{
+			free_by_size_.erase(size_it);
+			break;
+		}
+	}
+	free_space_ -= it->second;
+	free_by_offset_.erase(it);
+}
+
+unsigned int RangeAllocator::Allocate(unsigned int size)
+{
+	if (size == 0)
+		return INVALID_OFFSET;
+
+	// smallest free range that still fits, keeps the big ranges around for big meshes
+	auto best = free_by_size_.lower_bound(size);
+	if (best == free_by_size_.end())
+		return INVALID_OFFSET;
+
+	unsigned int offset = best->second;
+	unsigned int free_size = best->first;
+	EraseFree(free_by_offset_.find(offset));
+
+	// whatever is left over after the allocation stays free
+	if (free_size > size)
+		InsertFree(offset + size, free_size - size);
+
+	return offset;
+}
+
+void RangeAllocator::Free(unsigned int offset, unsigned int size)
+{
+	ASSERT(offset + size <= capacity_);
+
+	// merge with the free range right after this one
+	auto next = free_by_offset_.find(offset + size);
+	if (next != free_by_offset_.end())
+	{
+		size += next->second;
+		EraseFree(next);
+	}
+
+	// and with the one right before it
+	auto prev = free_by_offset_.lower_bound(offset);
+	if (prev != free_by_offset_.begin())
+	{
+		--prev;
+		if (prev->first + prev->second == offset)
+		{
+			offset = prev->first;
+			size += prev->second;
+			EraseFree(prev);
+		}
+	}
+
+	InsertFree(offset, size);
+}
+
+void RangeAllocator::Grow(unsigned int new_capacity)
+{
+	if (new_capacity <= capacity_)
+		return;
+
+	unsigned int old_capacity = capacity_;
+	capacity_ = new_capacity;
+	Free(old_capacity, new_capacity - old_capacity);
+}
+
+void RangeAllocator::Reset(unsigned int used)
+{
+	ASSERT(used <= capacity_);
+
+	free_by_offset_.clear();
+	free_by_size_.clear();
+	free_space_ = 0;
+	if (used < capacity_)
+		InsertFree(used, capacity_ - used);
+}
+
+unsigned int RangeAllocator::GetLargestFreeRange() const
+{
+	return free_by_size_.empty() ? 0 : free_by_size_.rbegin()->first;
+}
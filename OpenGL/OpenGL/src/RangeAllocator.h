@@ -0,0 +1,39 @@
+#pragma once
+
+#include <map>
+
+// Hands out [offset, offset + size) ranges of a linear space (vertices, indices, bytes...).
+// Free ranges are kept twice, once by offset so neighbours can be merged back together
+// when a range is freed, and once by size so an allocation finds the best fit in O(log n).
+class RangeAllocator
+{
+private:
+	unsigned int capacity_;
+	unsigned int free_space_;
+	std::map<unsigned int, unsigned int> free_by_offset_;
+	std::multimap<unsigned int, unsigned int> free_by_size_;
+
+	void InsertFree(unsigned int offset, unsigned int size);
+	void EraseFree(std::map<unsigned int, unsigned int>::iterator it);
+
+public:
+	static constexpr unsigned int INVALID_OFFSET = 0xFFFFFFFF;
+
+	explicit RangeAllocator(unsigned int capacity);
+
+	// Offset of a free range of the given size, or INVALID_OFFSET when no free range is big enough
+	unsigned int Allocate(unsigned int size);
+
+	// Give back a range returned by Allocate, it gets merged with the free ranges around it
+	void Free(unsigned int offset, unsigned int size);
+
+	// Make the space bigger, the new part at the end becomes free
+	void Grow(unsigned int new_capacity);
+
+	// Forget every allocation and mark [0, used) as taken, used after everything was packed to the front
+	void Reset(unsigned int used);
+
+	inline unsigned int GetCapacity() const { return capacity_; }
+	inline unsigned int GetFreeSpace() const { return free_space_; }
+	unsigned int GetLargestFreeRange() const;
+};
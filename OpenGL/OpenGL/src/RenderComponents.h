@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+
+#include "BoundingVolumes.h"
+#include "GeometryPool.h"
+#include "Math3D.h"
+#include "TransformHierarchy.h"
+
+// Components of renderable entities in an EntityWorld, laid out for the renderer to read as they are
+
+// What to draw: a mesh of the renderer's GeometryPool and the level of detail picked for it
+struct MeshComponent
+{
+	GeometryPool::MeshId mesh;
+	uint8_t lod;
+};
+
+// Where: the node in the TransformHierarchy and a copy of its world matrix, refreshed after every
+// TransformHierarchy::Update that changed it
+struct TransformComponent
+{
+	TransformHierarchy::NodeId node;
+	Mat4 world;
+};
+
+// World space box, for culling, and where the renderer's BoundingVolumes keeps it
+struct BoundsComponent
+{
+	BoundingBox box;
+	unsigned int volume;
+};
+
+// How: the shader variant and its parameters
+struct MaterialComponent
+{
+	uint64_t shader_features;
+	float color[4];
+};
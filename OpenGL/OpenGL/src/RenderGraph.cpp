@@ -0,0 +1,318 @@
+#include "RenderGraph.h"
+#include "FramebufferPool.h"
+#include "Renderer.h"
+
+#include <GL/glew.h>
+#include <algorithm>
+#include <functional>
+#include <iostream>
+#include <queue>
+
+static const unsigned int UNUSED = 0xFFFFFFFF;
+
+RenderPassBuilder& RenderPassBuilder::Read(RenderResource resource)
+{
+	ASSERT(resource < graph_.resources_.size());
+	graph_.passes_[pass_].reads.push_back(resource);
+	return *this;
+}
+
+RenderPassBuilder& RenderPassBuilder::Write(RenderResource resource)
+{
+	ASSERT(resource < graph_.resources_.size());
+	graph_.passes_[pass_].writes.push_back(resource);
+	graph_.resources_[resource].writers.push_back(pass_);
+	return *this;
+}
+
+RenderPassBuilder& RenderPassBuilder::SetSideEffect()
+{
+	graph_.passes_[pass_].side_effect = true;
+	return *this;
+}
+
+RenderGraph::RenderGraph(FramebufferPool& pool)
+	: pool_(pool), backbuffer_width_(0), backbuffer_height_(0), physical_targets_(0), compiled_(false)
+{
+}
+
+void RenderGraph::Reset()
+{
+	resources_.clear();
+	passes_.clear();
+	order_.clear();
+	physical_targets_ = 0;
+	compiled_ = false;
+}
+
+RenderResource RenderGraph::AddResource(const std::string& name, RenderResourceType type)
+{
+	Resource resource;
+	resource.name = name;
+	resource.type = type;
+	resource.framebuffer = nullptr;
+	resource.buffer = nullptr;
+	resource.first_use = UNUSED;
+	resource.last_use = UNUSED;
+	resources_.push_back(resource);
+	return (RenderResource)(resources_.size() - 1);
+}
+
+RenderResource RenderGraph::CreateTarget(const std::string& name, const FramebufferSpec& spec)
+{
+	RenderResource resource = AddResource(name, RenderResourceType::TRANSIENT_TARGET);
+	resources_[resource].spec = spec;
+	return resource;
+}
+
+RenderResource RenderGraph::ImportTarget(const std::string& name, Framebuffer* framebuffer)
+{
+	RenderResource resource = AddResource(name, RenderResourceType::IMPORTED_TARGET);
+	resources_[resource].framebuffer = framebuffer;
+	resources_[resource].spec = framebuffer->GetSpec();
+	return resource;
+}
+
+RenderResource RenderGraph::ImportBackbuffer(const std::string& name, unsigned int width, unsigned int height)
+{
+	backbuffer_width_ = width;
+	backbuffer_height_ = height;
+	return AddResource(name, RenderResourceType::BACKBUFFER);
+}
+
+RenderResource RenderGraph::ImportBuffer(const std::string& name, ShaderBuffer* buffer)
+{
+	RenderResource resource = AddResource(name, RenderResourceType::IMPORTED_BUFFER);
+	resources_[resource].buffer = buffer;
+	return resource;
+}
+
+RenderPassBuilder RenderGraph::AddPass(const std::string& name, ExecuteFunction execute)
+{
+	Pass pass;
+	pass.name = name;
+	pass.execute = std::move(execute);
+	pass.side_effect = false;
+	pass.alive = false;
+	passes_.push_back(std::move(pass));
+	compiled_ = false;
+	return RenderPassBuilder(*this, (unsigned int)(passes_.size() - 1));
+}
+
+bool RenderGraph::Writes(const Pass& pass, RenderResource resource) const
+{
+	return std::find(pass.writes.begin(), pass.writes.end(), resource) != pass.writes.end();
+}
+
+bool RenderGraph::Compile()
+{
+	order_.clear();
+	compiled_ = false;
+
+	// dependencies: writers of a resource run in the order they were declared, a pass that only reads
+	// a resource runs after all of its writers (it sees the final contents)
+	for (unsigned int p = 0; p < passes_.size(); p++)
+	{
+		Pass& pass = passes_[p];
+		pass.dependencies.clear();
+		pass.alive = false;
+
+		for (RenderResource r : pass.reads)
+		{
+			const Resource& resource = resources_[r];
+			if (Writes(pass, r))
+				continue;
+			if (resource.writers.empty())
+			{
+				if (resource.type == RenderResourceType::TRANSIENT_TARGET)
+				{
+					std::cerr << "Render pass " << pass.name << " reads " << resource.name << " which no pass writes" << std::endl;
+					return false;
+				}
+				continue;
+			}
+			pass.dependencies.push_back(resource.writers.back());
+		}
+
+		for (RenderResource r : pass.writes)
+		{
+			const std::vector<unsigned int>& writers = resources_[r].writers;
+			std::vector<unsigned int>::const_iterator it = std::find(writers.begin(), writers.end(), p);
+			if (it != writers.begin())
+				pass.dependencies.push_back(*(it - 1));
+		}
+	}
+
+	// culling: only what leads to something visible outside the graph survives
+	std::vector<unsigned int> stack;
+	for (unsigned int p = 0; p < passes_.size(); p++)
+	{
+		bool root = passes_[p].side_effect;
+		for (RenderResource r : passes_[p].writes)
+			root = root || resources_[r].type != RenderResourceType::TRANSIENT_TARGET;
+		if (root)
+		{
+			passes_[p].alive = true;
+			stack.push_back(p);
+		}
+	}
+	while (!stack.empty())
+	{
+		unsigned int p = stack.back();
+		stack.pop_back();
+		for (unsigned int dependency : passes_[p].dependencies)
+		{
+			if (!passes_[dependency].alive)
+			{
+				passes_[dependency].alive = true;
+				stack.push_back(dependency);
+			}
+		}
+	}
+
+	// ordering: Kahn's algorithm, passes that are ready at the same time go in declaration order
+	std::vector<unsigned int> waiting(passes_.size(), 0);
+	std::vector<std::vector<unsigned int>> dependents(passes_.size());
+	unsigned int alive_count = 0;
+	for (unsigned int p = 0; p < passes_.size(); p++)
+	{
+		if (!passes_[p].alive)
+			continue;
+		alive_count++;
+		for (unsigned int dependency : passes_[p].dependencies)
+		{
+			waiting[p]++;
+			dependents[dependency].push_back(p);
+		}
+	}
+
+	std::priority_queue<unsigned int, std::vector<unsigned int>, std::greater<unsigned int>> ready;
+	for (unsigned int p = 0; p < passes_.size(); p++)
+	{
+		if (passes_[p].alive && waiting[p] == 0)
+			ready.push(p);
+	}
+	while (!ready.empty())
+	{
+		unsigned int p = ready.top();
+		ready.pop();
+		order_.push_back(p);
+		for (unsigned int dependent : dependents[p])
+		{
+			if (--waiting[dependent] == 0)
+				ready.push(dependent);
+		}
+	}
+
+	if (order_.size() != alive_count)
+	{
+		std::cerr << "Render graph has a dependency cycle, passes involved:";
+		for (unsigned int p = 0; p < passes_.size(); p++)
+		{
+			if (passes_[p].alive && waiting[p] > 0)
+				std::cerr << " " << passes_[p].name;
+		}
+		std::cerr << std::endl;
+		order_.clear();
+		return false;
+	}
+
+	// lifetimes, as positions in the execution order
+	for (Resource& resource : resources_)
+	{
+		resource.first_use = UNUSED;
+		resource.last_use = UNUSED;
+	}
+	for (unsigned int i = 0; i < order_.size(); i++)
+	{
+		const Pass& pass = passes_[order_[i]];
+		for (const std::vector<RenderResource>* list : { &pass.reads, &pass.writes })
+		{
+			for (RenderResource r : *list)
+			{
+				Resource& resource = resources_[r];
+				if (resource.first_use == UNUSED)
+					resource.first_use = i;
+				resource.last_use = i;
+			}
+		}
+	}
+
+	compiled_ = true;
+	return true;
+}
+
+void RenderGraph::Execute()
+{
+	ASSERT(compiled_);
+
+	std::vector<FramebufferHandle> used;
+	for (unsigned int i = 0; i < order_.size(); i++)
+	{
+		// transient targets get a framebuffer right before their first use...
+		for (Resource& resource : resources_)
+		{
+			if (resource.type != RenderResourceType::TRANSIENT_TARGET || resource.first_use != i)
+				continue;
+			resource.pooled = pool_.Acquire(resource.spec);
+			if (std::find(used.begin(), used.end(), resource.pooled) == used.end())
+				used.push_back(resource.pooled);
+		}
+
+		passes_[order_[i]].execute(*this);
+
+		// ...and give it back after the last one, the next target with the same spec reuses it
+		for (Resource& resource : resources_)
+		{
+			if (resource.type != RenderResourceType::TRANSIENT_TARGET || resource.last_use != i)
+				continue;
+			pool_.Get(resource.pooled)->Invalidate();
+			pool_.Release(resource.pooled);
+			resource.pooled = FramebufferHandle();
+		}
+	}
+	physical_targets_ = (unsigned int)used.size();
+}
+
+Framebuffer* RenderGraph::GetFramebuffer(RenderResource resource) const
+{
+	const Resource& target = resources_[resource];
+	return target.pooled.IsValid() ? pool_.Get(target.pooled) : target.framebuffer;
+}
+
+ShaderBuffer* RenderGraph::GetBuffer(RenderResource resource) const
+{
+	return resources_[resource].buffer;
+}
+
+void RenderGraph::BindTarget(RenderResource resource) const
+{
+	const Resource& target = resources_[resource];
+	if (target.type == RenderResourceType::BACKBUFFER)
+	{
+		Framebuffer::BindDefault(backbuffer_width_, backbuffer_height_);
+		return;
+	}
+	Framebuffer* framebuffer = GetFramebuffer(resource);
+	ASSERT(framebuffer);
+	framebuffer->Bind();
+}
+
+unsigned int RenderGraph::GetTransientTargetCount() const
+{
+	unsigned int count = 0;
+	for (const Resource& resource : resources_)
+	{
+		if (resource.type == RenderResourceType::TRANSIENT_TARGET)
+			count++;
+	}
+	return count;
+}
+
+std::vector<std::string> RenderGraph::GetExecutionOrder() const
+{
+	std::vector<std::string> names;
+	for (unsigned int p : order_)
+		names.push_back(passes_[p].name);
+	return names;
+}
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "Framebuffer.h"
+#include "GpuResources.h"
+
+class FramebufferPool;
+class ShaderBuffer;
+class RenderGraph;
+
+// Index of a resource in the graph it was declared in, only valid until the graph is Reset()
+typedef unsigned int RenderResource;
+
+enum class RenderResourceType
+{
+	TRANSIENT_TARGET,   // created by the graph for the frame, physical framebuffers are shared between targets that don't overlap
+	IMPORTED_TARGET,    // framebuffer owned by someone else, lives across frames
+	BACKBUFFER,         // the window
+	IMPORTED_BUFFER     // buffer owned by someone else (storage buffers written by compute passes...)
+};
+
+// Returned by AddPass to declare what the pass touches
+class RenderPassBuilder
+{
+private:
+	RenderGraph& graph_;
+	unsigned int pass_;
+
+public:
+	RenderPassBuilder(RenderGraph& graph, unsigned int pass)
+		: graph_(graph), pass_(pass)
+	{
+	}
+
+	// The pass samples/reads the resource as the passes before it left it
+	RenderPassBuilder& Read(RenderResource resource);
+
+	// The pass renders into/writes the resource. Reading and writing the same resource is a read-modify-write
+	RenderPassBuilder& Write(RenderResource resource);
+
+	// Never culled, even if nothing reads what it writes (readbacks, queries, debug output...)
+	RenderPassBuilder& SetSideEffect();
+};
+
+// Frame graph: passes declare the resources they read and write and the graph works out the rest.
+// Passes are run in dependency order (declaration order when they are independent), passes whose output
+// nobody uses are culled, and transient targets are only backed by a framebuffer between their first and
+// last use, so targets with the same spec and disjoint lifetimes end up on the same framebuffer.
+// Meant to be rebuilt every frame: Reset, declare, Compile, Execute.
+class RenderGraph
+{
+public:
+	typedef std::function<void(const RenderGraph&)> ExecuteFunction;
+
+private:
+	friend class RenderPassBuilder;
+
+	struct Resource
+	{
+		std::string name;
+		RenderResourceType type;
+		FramebufferSpec spec;
+		Framebuffer* framebuffer;      // imported targets
+		FramebufferHandle pooled;      // transient targets, from the pool while they are in use
+		ShaderBuffer* buffer;
+		std::vector<unsigned int> writers;   // passes writing it, in declaration order
+		unsigned int first_use;
+		unsigned int last_use;
+	};
+
+	struct Pass
+	{
+		std::string name;
+		ExecuteFunction execute;
+		std::vector<RenderResource> reads;
+		std::vector<RenderResource> writes;
+		std::vector<unsigned int> dependencies;
+		bool side_effect;
+		bool alive;
+	};
+
+	FramebufferPool& pool_;
+	std::vector<Resource> resources_;
+	std::vector<Pass> passes_;
+	std::vector<unsigned int> order_;
+	unsigned int backbuffer_width_;
+	unsigned int backbuffer_height_;
+	unsigned int physical_targets_;
+	bool compiled_;
+
+	RenderResource AddResource(const std::string& name, RenderResourceType type);
+	bool Writes(const Pass& pass, RenderResource resource) const;
+
+public:
+	// Transient targets are taken from pool and given back to it once their last reader is done
+	explicit RenderGraph(FramebufferPool& pool);
+
+	RenderGraph(const RenderGraph&) = delete;
+	RenderGraph& operator=(const RenderGraph&) = delete;
+
+	// Drop every pass and resource to declare the next frame
+	void Reset();
+
+	RenderResource CreateTarget(const std::string& name, const FramebufferSpec& spec);
+	RenderResource ImportTarget(const std::string& name, Framebuffer* framebuffer);
+	RenderResource ImportBackbuffer(const std::string& name, unsigned int width, unsigned int height);
+	RenderResource ImportBuffer(const std::string& name, ShaderBuffer* buffer);
+
+	RenderPassBuilder AddPass(const std::string& name, ExecuteFunction execute);
+
+	// Work out dependencies, cull, order and lifetimes. Prints what is wrong and returns false on a cycle
+	// or a transient target read before anything writes it.
+	bool Compile();
+
+	// Run the surviving passes, Compile() has to have succeeded
+	void Execute();
+
+	// For use inside a pass: the framebuffer behind a target (nullptr for the backbuffer) and its buffer
+	Framebuffer* GetFramebuffer(RenderResource resource) const;
+	ShaderBuffer* GetBuffer(RenderResource resource) const;
+
+	// For use inside a pass: bind a target for drawing, viewport included
+	void BindTarget(RenderResource resource) const;
+
+	inline unsigned int GetPassCount() const { return (unsigned int)passes_.size(); }
+	inline unsigned int GetCulledPassCount() const { return (unsigned int)(passes_.size() - order_.size()); }
+
+	// Transient targets declared and framebuffers actually used for them by the last Execute()
+	unsigned int GetTransientTargetCount() const;
+	inline unsigned int GetPhysicalTargetCount() const { return physical_targets_; }
+
+	// Names of the passes in the order they run, for debugging
+	std::vector<std::string> GetExecutionOrder() const;
+};
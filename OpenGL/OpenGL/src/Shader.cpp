@@ -1,7 +1,7 @@
 #include "Shader.h"
-#include <fstream>
+#include <algorithm>
 #include <string>
-#include <sstream>
+#include <utility>
 
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
@@ -9,70 +9,42 @@
 #include <iostream>
 
 #include "Renderer.h"
+#include "GLCapabilities.h"
+#include "DeletionQueue.h"
 
-// we will get the file we want to parse shaders from
-ShaderSourceString Shader::ParseShader(std::string path)
+const char* Shader::GetStageName(ShaderStage stage)
 {
-	// read the file
-	std::ifstream stream(path);
-	// error checking
-	if (!stream.is_open())
-	{
-		std::cerr << "Error opening the file " << path;
-	}
-
-	// as we have 2 shader types in the shader file, so having an array of stringstream
-	std::stringstream ss[2];
-
-	// making an enum class so that we can cast it to int later for the index of stringstream
-	enum class SourceType
-	{
-		NONE = -1,
-		VERTEX = 0,
-		FRAGMENT = 1
-	};
-
-	// initially it is set to nun
-	SourceType current_source_type = SourceType::NONE;
+	return ShaderSource::GetStageName(stage);
+}
 
-	// now we will start by reading from the file and first do the checking if #shader word is found or not
-	std::string line;
-	while (std::getline(stream, line))
+unsigned int Shader::GetStageType(ShaderStage stage)
+{
+	switch (stage)
 	{
-		// line has the line stored from the file.
-
-		// This is just like how you would do for maps/sets, finding a word from the given string (line)
-		if (line.find("#shader") != std::string::npos)
-		{
-			// now we want to set the stringstream accordingly for reading.
-			if (line.find("vertex") != std::string::npos)
-			{
-				// set the source type to vertex as we want it's int value as ss's index now
-				current_source_type = SourceType::VERTEX;
-			}
-			else if (line.find("fragment") != std::string::npos)
-			{
-				// set the source type to fragment now
-				current_source_type = SourceType::FRAGMENT;
-			}
-		}
-		else
-		{
-			// now we have the required source stored, use that to put line in corresponding stream.
-			ss[(int)current_source_type] << line << '\n';
-		}
+		case ShaderStage::VERTEX: return GL_VERTEX_SHADER;
+		case ShaderStage::FRAGMENT: return GL_FRAGMENT_SHADER;
+		case ShaderStage::GEOMETRY: return GL_GEOMETRY_SHADER;
+		case ShaderStage::TESS_CONTROL: return GL_TESS_CONTROL_SHADER;
+		case ShaderStage::TESS_EVALUATION: return GL_TESS_EVALUATION_SHADER;
+		case ShaderStage::COMPUTE: return GL_COMPUTE_SHADER;
+		default: return 0;
 	}
-	// now we have more than 1 string we want to return, so making a struct for that purpose.
-	return { ss[0].str(), ss[1].str() };
+}
 
+// we will get the file we want to parse shaders from
+ShaderSource Shader::ParseShader(const std::string& path)
+{
+	return ShaderSource::Parse(path);
 }
 
 
-unsigned int Shader::CompileShader(unsigned int type, const std::string& source)
+unsigned int Shader::CompileShader(unsigned int type, std::string_view source)
 {
-	unsigned int id = GLCALL(glCreateShader(type));
-	const char* src = source.c_str();
-	GLCALL(glShaderSource(id, 1, &src, nullptr));
+	GLCALL(unsigned int id = glCreateShader(type));
+	// the view isn't null terminated, so the length goes along with it
+	const char* src = source.data();
+	int source_length = (int)source.size();
+	GLCALL(glShaderSource(id, 1, &src, &source_length));
 	GLCALL(glCompileShader(id));
 
 	// Error handling
@@ -84,8 +56,8 @@ unsigned int Shader::CompileShader(unsigned int type, const std::string& source)
 		int length;
 		GLCALL(glGetShaderiv(id, GL_INFO_LOG_LENGTH, &length));
 		char* error_message = (char*)alloca(length * sizeof(char));
-		GLCALL(glGetShaderInfoLog(id, length, &length, error_message)));
-		std::cout << "Failed to compile shader: " << source.c_str() << std::endl;
+		GLCALL(glGetShaderInfoLog(id, length, &length, error_message));
+		std::cout << "Failed to compile shader: " << source << std::endl;
 		std::cout << error_message << std::endl;
 
 		// delete the shader as it failed anyways
@@ -97,24 +69,245 @@ unsigned int Shader::CompileShader(unsigned int type, const std::string& source)
 	return id;
 }
 
-unsigned int Shader::CreateShader(const std::string& vertex_shader, const std::string& fragment_shader)
+unsigned int Shader::CreateShader(std::string_view vertex_shader, std::string_view fragment_shader)
 {
-	unsigned int program = glCreateProgram();
-	unsigned int vs = CompileShader(GL_VERTEX_SHADER, vertex_shader);
-	unsigned int fs = CompileShader(GL_FRAGMENT_SHADER, fragment_shader);
+	ShaderStageSources sources;
+	sources[(unsigned int)ShaderStage::VERTEX] = vertex_shader;
+	sources[(unsigned int)ShaderStage::FRAGMENT] = fragment_shader;
+	return CreateProgram(sources);
+}
 
-	GLCALL(glAttachShader(program, vs));
-	GLCALL(glAttachShader(program, fs));
+unsigned int Shader::CreateProgram(const ShaderStageSources& sources)
+{
+	PendingProgram pending = BeginProgram(sources);
+	return FinishProgram(pending);
+}
 
-	GLCALL(glLinkProgram(program));
+PendingProgram Shader::BeginProgram(const ShaderStageSources& sources)
+{
+	PendingProgram pending;
+	bool any = false;
+	for (unsigned int stage = 0; stage < SHADER_STAGE_COUNT; stage++)
+		any = any || !sources[stage].empty();
+	if (!any)
+		return pending;
 
-	GLCALL(glValidateProgram(program));
+	// nothing here asks for a status, so none of it waits for the compiler
+	GLCALL(pending.program = glCreateProgram());
+	for (unsigned int stage = 0; stage < SHADER_STAGE_COUNT; stage++)
+	{
+		if (sources[stage].empty())
+			continue;
+		GLCALL(unsigned int id = glCreateShader(GetStageType((ShaderStage)stage)));
+		const char* src = sources[stage].data();
+		int source_length = (int)sources[stage].size();
+		GLCALL(glShaderSource(id, 1, &src, &source_length));
+		GLCALL(glCompileShader(id));
+		GLCALL(glAttachShader(pending.program, id));
+		pending.shaders[stage] = id;
+	}
+	GLCALL(glLinkProgram(pending.program));
+	return pending;
+}
+
+std::vector<unsigned int> Shader::GetSpecializationIds(std::string_view binary)
+{
+	// a module is 32 bit words: a 5 word header, then instructions with their word count in the upper
+	// 16 bits of the first word and the opcode in the lower 16. Spec ids are OpDecorate <id> SpecId <value>.
+	static const unsigned int SPIRV_MAGIC = 0x07230203;
+	static const unsigned int OP_DECORATE = 71;
+	static const unsigned int DECORATION_SPEC_ID = 1;
 
+	std::vector<unsigned int> ids;
+	const unsigned int* words = (const unsigned int*)binary.data();
+	size_t count = binary.size() / 4;
+	if (count < 5 || words[0] != SPIRV_MAGIC)
+		return ids;
+
+	for (size_t i = 5; i < count;)
+	{
+		unsigned int word_count = words[i] >> 16;
+		unsigned int opcode = words[i] & 0xFFFF;
+		if (word_count == 0 || i + word_count > count)
+			break;
+		if (opcode == OP_DECORATE && word_count >= 4 && words[i + 2] == DECORATION_SPEC_ID)
+			ids.push_back(words[i + 3]);
+		i += word_count;
+	}
+	return ids;
+}
+
+unsigned int Shader::CreateProgramSpirv(const ShaderStageSources& binaries, const std::vector<unsigned int>& constant_ids,
+	const std::vector<unsigned int>& constant_values)
+{
+	PendingProgram pending = BeginProgramSpirv(binaries, constant_ids, constant_values);
+	return FinishProgram(pending);
+}
+
+PendingProgram Shader::BeginProgramSpirv(const ShaderStageSources& binaries, const std::vector<unsigned int>& constant_ids,
+	const std::vector<unsigned int>& constant_values)
+{
+	PendingProgram pending;
+	bool any = false;
+	for (unsigned int stage = 0; stage < SHADER_STAGE_COUNT; stage++)
+		any = any || !binaries[stage].empty();
+	if (!any)
+		return pending;
+
+	GLCALL(pending.program = glCreateProgram());
+	for (unsigned int stage = 0; stage < SHADER_STAGE_COUNT; stage++)
+	{
+		if (binaries[stage].empty())
+			continue;
+		GLCALL(unsigned int id = glCreateShader(GetStageType((ShaderStage)stage)));
+		pending.shaders[stage] = id;
+
+		// a binary the driver refuses is expected (stale cache, other compiler version), not a bug: no GLCALL,
+		// the errors are checked here and the caller falls back to the GLSL
+		GLClearErrors();
+		glShaderBinary(1, &id, GL_SHADER_BINARY_FORMAT_SPIR_V, binaries[stage].data(), (GLsizei)binaries[stage].size());
+
+		// a constant the module doesn't declare fails the specialization, so every stage only gets its own
+		std::vector<unsigned int> declared = GetSpecializationIds(binaries[stage]);
+		std::vector<GLuint> ids, values;
+		for (unsigned int i = 0; i < constant_ids.size(); i++)
+		{
+			if (std::find(declared.begin(), declared.end(), constant_ids[i]) != declared.end())
+			{
+				ids.push_back(constant_ids[i]);
+				values.push_back(constant_values[i]);
+			}
+		}
+
+		// specializing is what compiles a SPIR-V shader, COMPILE_STATUS is set by it
+		if (glGetError() == GL_NO_ERROR)
+		{
+			if (GLEW_VERSION_4_6)
+				glSpecializeShader(id, "main", (GLuint)ids.size(), ids.data(), values.data());
+			else
+				glSpecializeShaderARB(id, "main", (GLuint)ids.size(), ids.data(), values.data());
+		}
+
+		int compiled = GL_FALSE;
+		if (glGetError() == GL_NO_ERROR)
+		{
+			GLCALL(glGetShaderiv(id, GL_COMPILE_STATUS, &compiled));
+		}
+		if (compiled == GL_FALSE)
+		{
+			std::cout << "Failed to load the SPIR-V " << GetStageName((ShaderStage)stage) << " shader" << std::endl;
+			GLClearErrors();
+			for (unsigned int& shader : pending.shaders)
+			{
+				GLCALL(glDeleteShader(shader));
+				shader = 0;
+			}
+			GLCALL(glDeleteProgram(pending.program));
+			pending.program = 0;
+			return pending;
+		}
+		GLCALL(glAttachShader(pending.program, id));
+	}
+	GLCALL(glLinkProgram(pending.program));
+	return pending;
+}
+
+bool Shader::IsProgramReady(const PendingProgram& pending)
+{
+	// without the extension there is no way to ask, the next status query just blocks
+	if (pending.program == 0 || !GLCapabilities::Get().parallel_shader_compile)
+		return true;
+
+	int done;
+	GLCALL(glGetProgramiv(pending.program, GL_COMPLETION_STATUS_KHR, &done));
+	return done == GL_TRUE;
+}
+
+unsigned int Shader::FinishProgram(PendingProgram& pending)
+{
+	unsigned int program = pending.program;
+	if (program == 0)
+		return 0;
+
+	int result;
+	GLCALL(glGetProgramiv(program, GL_LINK_STATUS, &result));
+	if (result == GL_FALSE)
+	{
+		// find out whether a stage didn't compile or the stages didn't link together (mismatched in/out variables...)
+		for (unsigned int stage = 0; stage < SHADER_STAGE_COUNT; stage++)
+		{
+			unsigned int id = pending.shaders[stage];
+			if (id == 0)
+				continue;
+			int compiled;
+			GLCALL(glGetShaderiv(id, GL_COMPILE_STATUS, &compiled));
+			if (compiled == GL_TRUE)
+				continue;
+			int length;
+			GLCALL(glGetShaderiv(id, GL_INFO_LOG_LENGTH, &length));
+			std::string error_message(length, '\0');
+			GLCALL(glGetShaderInfoLog(id, length, &length, &error_message[0]));
+			std::cout << "Failed to compile " << GetStageName((ShaderStage)stage) << " shader" << std::endl;
+			std::cout << error_message << std::endl;
+		}
+
+		int length;
+		GLCALL(glGetProgramiv(program, GL_INFO_LOG_LENGTH, &length));
+		std::string error_message(length, '\0');
+		GLCALL(glGetProgramInfoLog(program, length, &length, &error_message[0]));
+		std::cout << "Failed to link program" << std::endl;
+		std::cout << error_message << std::endl;
+
+		GLCALL(glDeleteProgram(program));
+		program = 0;
+	}
 
 	// now the program has all the shader linked so we can dleete the shader intermediary files
-	GLCALL(glDeleteShader(vs));
-	GLCALL(glDeleteShader(fs));
+	for (unsigned int& shader : pending.shaders)
+	{
+		GLCALL(glDeleteShader(shader));
+		shader = 0;
+	}
+	pending.program = 0;
 
+	if (program)
+	{
+		GLCALL(glValidateProgram(program));
+	}
 	return program;
+}
 
-}
\ No newline at end of file
+ShaderProgram::ShaderProgram(unsigned int program)
+	: renderer_id_(program)
+{
+}
+
+ShaderProgram::~ShaderProgram()
+{
+	if (renderer_id_ != 0)
+	{
+		GLCALL(glDeleteProgram(renderer_id_));
+	}
+}
+
+ShaderProgram::ShaderProgram(ShaderProgram&& other) noexcept
+	: renderer_id_(std::exchange(other.renderer_id_, 0))
+{
+}
+
+ShaderProgram& ShaderProgram::operator=(ShaderProgram&& other) noexcept
+{
+	// the old program goes with other when it is destroyed
+	std::swap(renderer_id_, other.renderer_id_);
+	return *this;
+}
+
+void ShaderProgram::Release(DeletionQueue& queue)
+{
+	queue.Delete(GLObjectType::PROGRAM, std::exchange(renderer_id_, 0));
+}
+
+void ShaderProgram::Bind() const
+{
+	GLCALL(glUseProgram(renderer_id_));
+}
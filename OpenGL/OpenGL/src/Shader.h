@@ -1,11 +1,21 @@
 #pragma once
 
+#include <array>
 #include <string>
+#include <string_view>
+#include <vector>
 
-struct ShaderSourceString
+#include "ShaderSource.h"
+
+class DeletionQueue;
+
+// Program whose stages were handed to the driver but not checked yet. With parallel shader compile the
+// driver works on it in the background until FinishProgram, which is the first call that has to wait.
+struct PendingProgram
 {
-	std::string vertex_source;
-	std::string fragment_source;
+	unsigned int program = 0;
+	std::array<unsigned int, SHADER_STAGE_COUNT> shaders = {};
+	std::vector<std::string> explicit_binding_blocks;   // for ShaderReflection::AssignBlockBindings, filled in by the caller
 };
 
 class Shader
@@ -14,9 +24,56 @@ private:
 	unsigned int renderer_id;
 
 public:
-	unsigned int CreateShader(const std::string& vertex_shader, const std::string& fragment_shader);
-	unsigned int CompileShader(unsigned int type, const std::string& source);
-	ShaderSourceString ParseShader(std::string path);
+	unsigned int CreateShader(std::string_view vertex_shader, std::string_view fragment_shader);
+
+	// Compile and link every stage that has source, 0 if anything fails
+	unsigned int CreateProgram(const ShaderStageSources& sources);
+
+	// CreateProgram in two steps: queue the compiles and the link, and check them later.
+	// IsProgramReady never blocks, FinishProgram returns the program or 0 (after printing why) and blocks if it isn't ready.
+	PendingProgram BeginProgram(const ShaderStageSources& sources);
+	static bool IsProgramReady(const PendingProgram& pending);
+	unsigned int FinishProgram(PendingProgram& pending);
 
+	// Same from SPIR-V modules (the .spv files ShaderCompiler writes) instead of GLSL, needs gl_spirv.
+	// Every stage is specialized with the constant_ids/values pairs its module declares, the others are skipped.
+	unsigned int CreateProgramSpirv(const ShaderStageSources& binaries, const std::vector<unsigned int>& constant_ids,
+		const std::vector<unsigned int>& constant_values);
+	PendingProgram BeginProgramSpirv(const ShaderStageSources& binaries, const std::vector<unsigned int>& constant_ids,
+		const std::vector<unsigned int>& constant_values);
+
+	// constant_id of every specialization constant a SPIR-V module declares
+	static std::vector<unsigned int> GetSpecializationIds(std::string_view binary);
+
+	unsigned int CompileShader(unsigned int type, std::string_view source);
+	ShaderSource ParseShader(const std::string& path);
+
+	// GL_VERTEX_SHADER... for a stage, and the name used after #shader
+	static unsigned int GetStageType(ShaderStage stage);
+	static const char* GetStageName(ShaderStage stage);
 };
 
+// Owns a linked program (from Shader::CreateProgram...) and deletes it when it goes away. Movable so
+// programs can live by value in a HandlePool, the moved from one owns nothing.
+class ShaderProgram
+{
+private:
+	unsigned int renderer_id_;
+
+public:
+	explicit ShaderProgram(unsigned int program = 0);
+	~ShaderProgram();
+
+	ShaderProgram(ShaderProgram&& other) noexcept;
+	ShaderProgram& operator=(ShaderProgram&& other) noexcept;
+	ShaderProgram(const ShaderProgram&) = delete;
+	ShaderProgram& operator=(const ShaderProgram&) = delete;
+
+	// Hand the GL object to queue to be deleted once the GPU is done with it, this owns nothing afterwards
+	void Release(DeletionQueue& queue);
+
+	void Bind() const;
+
+	inline unsigned int GetRendererId() const { return renderer_id_; }
+	inline bool IsValid() const { return renderer_id_ != 0; }
+};
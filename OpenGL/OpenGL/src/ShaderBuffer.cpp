@@ -0,0 +1,82 @@
+#include "ShaderBuffer.h"
+#include "DeletionQueue.h"
+#include "GLCapabilities.h"
+#include "Renderer.h"
+
+#include <GL/glew.h>
+#include <utility>
+
+ShaderBuffer::ShaderBuffer(const void* data, int size)
+	: renderer_id_(0), size_(size)
+{
+	Create(data);
+}
+
+ShaderBuffer::~ShaderBuffer()
+{
+	if (renderer_id_ == 0)
+		return;
+	GLCALL(glDeleteBuffers(1, &renderer_id_));
+}
+
+ShaderBuffer::ShaderBuffer(ShaderBuffer&& other) noexcept
+	: renderer_id_(std::exchange(other.renderer_id_, 0)), size_(std::exchange(other.size_, 0))
+{
+}
+
+ShaderBuffer& ShaderBuffer::operator=(ShaderBuffer&& other) noexcept
+{
+	// the old objects go with other when it is destroyed
+	std::swap(renderer_id_, other.renderer_id_);
+	std::swap(size_, other.size_);
+	return *this;
+}
+
+void ShaderBuffer::Release(DeletionQueue& queue)
+{
+	queue.Delete(GLObjectType::BUFFER, std::exchange(renderer_id_, 0));
+	size_ = 0;
+}
+
+void ShaderBuffer::Create(const void* data)
+{
+	if (GLCapabilities::Get().direct_state_access)
+	{
+		GLCALL(glCreateBuffers(1, &renderer_id_));
+		GLCALL(glNamedBufferStorage(renderer_id_, size_, data, GL_DYNAMIC_STORAGE_BIT));
+		return;
+	}
+
+	// the copy-write target isn't tied to any shader binding point, so creating the buffer disturbs nothing
+	GLCALL(glGenBuffers(1, &renderer_id_));
+	GLCALL(glBindBuffer(GL_COPY_WRITE_BUFFER, renderer_id_));
+	GLCALL(glBufferData(GL_COPY_WRITE_BUFFER, size_, data, GL_DYNAMIC_DRAW));
+	GLCALL(glBindBuffer(GL_COPY_WRITE_BUFFER, 0));
+}
+
+void ShaderBuffer::SubData(int offset, const void* data, int size)
+{
+	ASSERT(offset + size <= size_);
+
+	if (GLCapabilities::Get().direct_state_access)
+	{
+		GLCALL(glNamedBufferSubData(renderer_id_, offset, size, data));
+		return;
+	}
+
+	GLCALL(glBindBuffer(GL_COPY_WRITE_BUFFER, renderer_id_));
+	GLCALL(glBufferSubData(GL_COPY_WRITE_BUFFER, offset, size, data));
+	GLCALL(glBindBuffer(GL_COPY_WRITE_BUFFER, 0));
+}
+
+void ShaderBuffer::Resize(int size, DeletionQueue& queue)
+{
+	queue.Delete(GLObjectType::BUFFER, renderer_id_);
+	size_ = size;
+	Create(nullptr);
+}
+
+void ShaderBuffer::BindBase(unsigned int target, unsigned int index) const
+{
+	GLCALL(glBindBufferBase(target, index, renderer_id_));
+}
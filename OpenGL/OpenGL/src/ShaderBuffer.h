@@ -0,0 +1,41 @@
+#pragma once
+
+class DeletionQueue;
+
+// Buffer read (or written) by shaders through an indexed binding point: uniform blocks,
+// storage blocks, atomic counters... Always dynamic, the contents are expected to change.
+class ShaderBuffer
+{
+private:
+	unsigned int renderer_id_;
+	int size_;
+
+	void Create(const void* data);
+
+public:
+	ShaderBuffer(const void* data, int size);
+	~ShaderBuffer();
+
+	// Movable so buffers can live by value in a HandlePool, the moved from one owns nothing
+	ShaderBuffer(ShaderBuffer&& other) noexcept;
+	ShaderBuffer& operator=(ShaderBuffer&& other) noexcept;
+	ShaderBuffer(const ShaderBuffer&) = delete;
+	ShaderBuffer& operator=(const ShaderBuffer&) = delete;
+
+	// Hand the GL object to queue to be deleted once the GPU is done with it, this owns nothing afterwards
+	void Release(DeletionQueue& queue);
+
+	// Overwrite part of the buffer, offset and size are in bytes
+	void SubData(int offset, const void* data, int size);
+
+	// Replace the buffer with a new one of a different size, the old contents are dropped. The old buffer
+	// goes to queue, draws and dispatches already issued may still read it. Bindings made with BindBase
+	// still point at the old buffer, bind again.
+	void Resize(int size, DeletionQueue& queue);
+
+	// Bind the whole buffer to binding point index of target (GL_UNIFORM_BUFFER, GL_SHADER_STORAGE_BUFFER...)
+	void BindBase(unsigned int target, unsigned int index) const;
+
+	inline unsigned int GetRendererId() const { return renderer_id_; }
+	inline int GetSize() const { return size_; }
+};
@@ -0,0 +1,92 @@
+#include "ShaderHotReload.h"
+#include "ShaderVariantCache.h"
+#include "GLCapabilities.h"
+#include "Renderer.h"
+
+#include <GL/glew.h>
+#include <algorithm>
+
+// editors write a file in several steps, wait until it has been quiet for this long before reading it
+static const std::chrono::milliseconds SETTLE_TIME(100);
+
+ShaderHotReload::ShaderHotReload()
+{
+	if (GLCapabilities::Get().parallel_shader_compile)
+	{
+		// 0xFFFFFFFF lets the driver pick the number of threads
+		if (GLEW_KHR_parallel_shader_compile)
+		{
+			GLCALL(glMaxShaderCompilerThreadsKHR(0xFFFFFFFF));
+		}
+		else
+		{
+			GLCALL(glMaxShaderCompilerThreadsARB(0xFFFFFFFF));
+		}
+	}
+}
+
+void ShaderHotReload::WatchDependencies(unsigned int i)
+{
+	// dependencies are only ever appended to
+	const std::vector<std::string>& dependencies = shaders_[i]->GetDependencies();
+	for (size_t file = watched_counts_[i]; file < dependencies.size(); file++)
+		watcher_.Watch(dependencies[file]);
+	watched_counts_[i] = dependencies.size();
+}
+
+void ShaderHotReload::Add(ShaderVariantCache& shader)
+{
+	if (std::find(shaders_.begin(), shaders_.end(), &shader) != shaders_.end())
+		return;
+	shaders_.push_back(&shader);
+	watched_counts_.push_back(0);
+	WatchDependencies((unsigned int)shaders_.size() - 1);
+}
+
+void ShaderHotReload::Remove(ShaderVariantCache& shader)
+{
+	std::vector<ShaderVariantCache*>::iterator found = std::find(shaders_.begin(), shaders_.end(), &shader);
+	if (found == shaders_.end())
+		return;
+	watched_counts_.erase(watched_counts_.begin() + (found - shaders_.begin()));
+	shaders_.erase(found);
+}
+
+void ShaderHotReload::Poll()
+{
+	// polled into a list of its own, a file that is already waiting and changes again still restarts the delay
+	polled_.clear();
+	watcher_.Poll(polled_);
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	if (!polled_.empty())
+		last_change_ = now;
+	for (const std::string& file : polled_)
+	{
+		if (std::find(changed_.begin(), changed_.end(), file) == changed_.end())
+			changed_.push_back(file);
+	}
+
+	if (!changed_.empty() && now - last_change_ >= SETTLE_TIME)
+	{
+		for (ShaderVariantCache* shader : shaders_)
+		{
+			const std::vector<std::string>& dependencies = shader->GetDependencies();
+			bool affected = false;
+			for (const std::string& file : changed_)
+				affected = affected || std::find(dependencies.begin(), dependencies.end(), file) != dependencies.end();
+			if (affected)
+				shader->BeginReload();
+		}
+		changed_.clear();
+	}
+
+	for (unsigned int i = 0; i < shaders_.size(); i++)
+	{
+		if (shaders_[i]->IsReloading())
+			shaders_[i]->UpdateReload();
+
+		// includes show up when a variant is first compiled or an edit adds them, they are watched from then on
+		if (shaders_[i]->GetDependencies().size() != watched_counts_[i])
+			WatchDependencies(i);
+	}
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "FileWatcher.h"
+
+class ShaderVariantCache;
+
+// Recompiles shaders when their files change on disk. The compile is queued without waiting for it (with
+// parallel shader compile the driver does it on its own threads), and the new programs only replace the old
+// ones once they all linked, so a typo in a shader leaves the last working version on screen.
+class ShaderHotReload
+{
+private:
+	FileWatcher watcher_;
+	std::vector<ShaderVariantCache*> shaders_;
+	std::vector<size_t> watched_counts_;   // parallel to shaders_, how many of its dependencies are watched
+	std::vector<std::string> changed_;
+	std::vector<std::string> polled_;   // scratch for the files of one Poll
+	std::chrono::steady_clock::time_point last_change_;
+
+	// Watch the dependencies of shaders_[i] that were added since the last call
+	void WatchDependencies(unsigned int i);
+
+public:
+	// Lets the driver use as many compiler threads as it likes, when it supports parallel compiles
+	ShaderHotReload();
+
+	ShaderHotReload(const ShaderHotReload&) = delete;
+	ShaderHotReload& operator=(const ShaderHotReload&) = delete;
+
+	// Watch the file of shader and everything it includes, shader has to outlive this or be removed.
+	// Includes are only known once a variant was compiled, Poll picks them up as they show up.
+	void Add(ShaderVariantCache& shader);
+	void Remove(ShaderVariantCache& shader);
+
+	// Once per frame: starts reloading shaders whose files changed and swaps in the ones that are done.
+	// Never waits for the compiler.
+	void Poll();
+};
@@ -0,0 +1,234 @@
+#include "ShaderPreprocessor.h"
+#include "MappedFile.h"
+
+#include <filesystem>
+#include <iostream>
+
+static std::string GetDirectory(const std::string& path)
+{
+	size_t slash = path.find_last_of("/\\");
+	return slash == std::string::npos ? std::string() : path.substr(0, slash + 1);
+}
+
+// Only asks the file system, an empty include is still found (mapping it would fail)
+static bool FileExists(const std::string& path)
+{
+	std::error_code error;
+	return std::filesystem::is_regular_file(path, error);
+}
+
+// "a/./b/../c.glsl" -> "a/c.glsl", so the same file reached through different relative paths is only included once
+static std::string NormalizePath(const std::string& path)
+{
+	std::vector<std::string> parts;
+	size_t start = 0;
+	while (start <= path.size())
+	{
+		size_t end = path.find_first_of("/\\", start);
+		if (end == std::string::npos)
+			end = path.size();
+		std::string part = path.substr(start, end - start);
+		if (part == "..")
+		{
+			if (!parts.empty() && parts.back() != "..")
+				parts.pop_back();
+			else
+				parts.push_back(part);
+		}
+		else if (!part.empty() && part != ".")
+		{
+			parts.push_back(part);
+		}
+		start = end + 1;
+	}
+
+	std::string normalized = !path.empty() && (path[0] == '/' || path[0] == '\\') ? "/" : "";
+	for (unsigned int i = 0; i < parts.size(); i++)
+	{
+		if (i > 0)
+			normalized += '/';
+		normalized += parts[i];
+	}
+	return normalized;
+}
+
+ShaderPreprocessor::ShaderPreprocessor()
+	: pending_defines_(nullptr)
+{
+}
+
+void ShaderPreprocessor::AddIncludeDirectory(const std::string& directory)
+{
+	std::string normalized = directory;
+	if (!normalized.empty() && normalized.back() != '/' && normalized.back() != '\\')
+		normalized += '/';
+	include_directories_.push_back(normalized);
+}
+
+void ShaderPreprocessor::SetDefine(const std::string& name, const std::string& value)
+{
+	for (ShaderDefine& define : defines_)
+	{
+		if (define.name == name)
+		{
+			define.value = value;
+			return;
+		}
+	}
+	defines_.push_back({ name, value });
+}
+
+void ShaderPreprocessor::ClearCache()
+{
+	file_cache_.clear();
+}
+
+const std::string* ShaderPreprocessor::LoadFile(const std::string& path)
+{
+	std::unordered_map<std::string, std::string>::const_iterator cached = file_cache_.find(path);
+	if (cached != file_cache_.end())
+		return &cached->second;
+
+	MappedFile file;
+	if (!file.Open(path))
+	{
+		// an empty file can't be mapped, it still is a valid include that expands to nothing
+		std::error_code error;
+		if (FileExists(path) && std::filesystem::file_size(path, error) == 0 && !error)
+			return &file_cache_[path];
+		return nullptr;
+	}
+	std::string& contents = file_cache_[path];
+	contents.assign((const char*)file.GetData(), file.GetSize());
+	return &contents;
+}
+
+std::string ShaderPreprocessor::ResolveInclude(const std::string& name, bool quoted, const std::string& including_path)
+{
+	if (quoted)
+	{
+		std::string candidate = NormalizePath(GetDirectory(including_path) + name);
+		if (file_cache_.count(candidate) || FileExists(candidate))
+			return candidate;
+	}
+	for (const std::string& directory : include_directories_)
+	{
+		std::string candidate = NormalizePath(directory + name);
+		if (file_cache_.count(candidate) || FileExists(candidate))
+			return candidate;
+	}
+	return std::string();
+}
+
+void ShaderPreprocessor::WriteDefines(const std::vector<ShaderDefine>& defines, std::string& output) const
+{
+	for (const ShaderDefine& define : defines_)
+		output += "#define " + define.name + " " + define.value + "\n";
+	for (const ShaderDefine& define : defines)
+		output += "#define " + define.name + " " + define.value + "\n";
+}
+
+bool ShaderPreprocessor::Expand(std::string_view source, const std::string& path, unsigned int file_index, unsigned int first_line, PreprocessedSource& output)
+{
+	unsigned int line_number = first_line - 1;
+	size_t start = 0;
+	while (start < source.size())
+	{
+		size_t end = source.find('\n', start);
+		if (end == std::string_view::npos)
+			end = source.size();
+		line_number++;
+
+		size_t first = source.find_first_not_of(" \t", start);
+		bool directive = first != std::string_view::npos && first < end && source[first] == '#';
+		// the keyword has to end there, #includes or #include_foo are left to the compiler
+		bool include = directive && source.compare(first, 8, "#include") == 0 && first + 8 < end
+			&& (source[first + 8] == ' ' || source[first + 8] == '\t' || source[first + 8] == '"' || source[first + 8] == '<');
+		if (include)
+		{
+			size_t open = source.find_first_of("\"<", first + 8);
+			char close_char = open < end && source[open] == '<' ? '>' : '"';
+			size_t close = open < end ? source.find(close_char, open + 1) : std::string_view::npos;
+			if (close == std::string_view::npos || close >= end)
+			{
+				std::cerr << path << "(" << line_number << "): malformed #include" << std::endl;
+				return false;
+			}
+
+			std::string name(source.substr(open + 1, close - open - 1));
+			std::string resolved = ResolveInclude(name, close_char == '"', path);
+			if (resolved.empty())
+			{
+				std::cerr << path << "(" << line_number << "): can't find include " << name << std::endl;
+				return false;
+			}
+
+			// included once per stage, the second #include of a file expands to nothing
+			bool included = false;
+			for (const std::string& file : output.files)
+				included = included || file == resolved;
+			if (!included)
+			{
+				const std::string* contents = LoadFile(resolved);
+				if (!contents)
+				{
+					std::cerr << path << "(" << line_number << "): can't read include " << resolved << std::endl;
+					return false;
+				}
+				unsigned int index = (unsigned int)output.files.size();
+				output.files.push_back(resolved);
+
+				output.code += "#line 1 " + std::to_string(index) + "\n";
+				if (!Expand(*contents, resolved, index, 1, output))
+					return false;
+				if (!output.code.empty() && output.code.back() != '\n')
+					output.code += '\n';
+			}
+			output.code += "#line " + std::to_string(line_number + 1) + " " + std::to_string(file_index) + "\n";
+		}
+		else if (directive && source.compare(first, 12, "#pragma once") == 0)
+		{
+			// every file is included once anyway, keep the line so numbering stays right
+			output.code += '\n';
+		}
+		else
+		{
+			output.code.append(source.data() + start, end - start);
+			if (end < source.size())
+				output.code += '\n';
+
+			// GLSL wants #version first, the defines go right after it and #line puts the numbering back
+			if (directive && pending_defines_ && source.compare(first, 8, "#version") == 0)
+			{
+				if (end == source.size())
+					output.code += '\n';
+				WriteDefines(*pending_defines_, output.code);
+				output.code += "#line " + std::to_string(line_number + 1) + " " + std::to_string(file_index) + "\n";
+				pending_defines_ = nullptr;
+			}
+		}
+		start = end + 1;
+	}
+	return true;
+}
+
+bool ShaderPreprocessor::Process(std::string_view source, const std::string& path, const std::vector<ShaderDefine>& defines,
+	PreprocessedSource& output, unsigned int first_line)
+{
+	output.code.clear();
+	output.files.clear();
+	output.files.push_back(NormalizePath(path));
+
+	pending_defines_ = &defines;
+	bool expanded = Expand(source, output.files[0], 0, first_line, output);
+	if (expanded && pending_defines_)
+	{
+		// no #version line, the defines can go first
+		std::string code;
+		WriteDefines(defines, code);
+		code += "#line " + std::to_string(first_line) + " 0\n";
+		output.code = code + output.code;
+	}
+	pending_defines_ = nullptr;
+	return expanded;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+struct ShaderDefine
+{
+	std::string name;
+	std::string value;
+};
+
+// Result of expanding a stage: the code to hand to the compiler and the files it was put together from.
+// Compile errors come back as "<file index>(<line>)", files[index] is the file they are in.
+struct PreprocessedSource
+{
+	std::string code;
+	std::vector<std::string> files;
+};
+
+// Text stage before GLSL sees a shader: #include "file" / #include <file> and defines injected after #version.
+// Every file is included once per stage no matter how often it is asked for (as if they all had include
+// guards), which also makes include cycles harmless. #line directives keep compiler errors pointing at the
+// right line of the right file.
+class ShaderPreprocessor
+{
+private:
+	std::vector<std::string> include_directories_;
+	std::vector<ShaderDefine> defines_;
+	std::unordered_map<std::string, std::string> file_cache_;
+	const std::vector<ShaderDefine>* pending_defines_;   // written after the #version line of the stage being expanded
+
+	// Contents of a file, read from disk the first time and from the cache after that
+	const std::string* LoadFile(const std::string& path);
+
+	// Where an include resolves to, "" if it doesn't exist. Quoted includes look next to the including file first.
+	std::string ResolveInclude(const std::string& name, bool quoted, const std::string& including_path);
+
+	bool Expand(std::string_view source, const std::string& path, unsigned int file_index, unsigned int first_line, PreprocessedSource& output);
+
+	void WriteDefines(const std::vector<ShaderDefine>& defines, std::string& output) const;
+
+public:
+	ShaderPreprocessor();
+
+	// Searched for <file> includes, and for "file" includes not found next to the including file
+	void AddIncludeDirectory(const std::string& directory);
+
+	// Defined in every stage this preprocessor expands, on top of the per call defines
+	void SetDefine(const std::string& name, const std::string& value = "1");
+
+	// Expand the includes of source, which was read from path starting at line first_line (a stage of a
+	// .shader file), and add the defines after its #version line. Prints the problem and returns false
+	// when an include can't be found.
+	bool Process(std::string_view source, const std::string& path, const std::vector<ShaderDefine>& defines,
+		PreprocessedSource& output, unsigned int first_line = 1);
+
+	// Forget the included files read so far, so changes on disk are picked up
+	void ClearCache();
+
+};
@@ -0,0 +1,460 @@
+#include "ShaderReflection.h"
+#include "GLCapabilities.h"
+#include "VertexBufferLayout.h"
+#include "Renderer.h"
+
+#include <GL/glew.h>
+#include <algorithm>
+#include <iostream>
+#include <unordered_map>
+
+// "u_Lights[0]" -> "u_Lights", arrays are looked up by their plain name
+static std::string StripArraySuffix(std::string name)
+{
+	if (name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0)
+		name.resize(name.size() - 3);
+	return name;
+}
+
+unsigned int ShaderReflection::GetTypeComponents(unsigned int type)
+{
+	switch (type)
+	{
+		case GL_FLOAT_VEC2: case GL_INT_VEC2: case GL_UNSIGNED_INT_VEC2: case GL_BOOL_VEC2: case GL_DOUBLE_VEC2:
+		case GL_FLOAT_MAT2: case GL_FLOAT_MAT3x2: case GL_FLOAT_MAT4x2:
+			return 2;
+		case GL_FLOAT_VEC3: case GL_INT_VEC3: case GL_UNSIGNED_INT_VEC3: case GL_BOOL_VEC3: case GL_DOUBLE_VEC3:
+		case GL_FLOAT_MAT3: case GL_FLOAT_MAT2x3: case GL_FLOAT_MAT4x3:
+			return 3;
+		case GL_FLOAT_VEC4: case GL_INT_VEC4: case GL_UNSIGNED_INT_VEC4: case GL_BOOL_VEC4: case GL_DOUBLE_VEC4:
+		case GL_FLOAT_MAT4: case GL_FLOAT_MAT2x4: case GL_FLOAT_MAT3x4:
+			return 4;
+	}
+	return 1;
+}
+
+unsigned int ShaderReflection::GetTypeLocations(unsigned int type)
+{
+	switch (type)
+	{
+		case GL_FLOAT_MAT2: case GL_FLOAT_MAT2x3: case GL_FLOAT_MAT2x4:
+			return 2;
+		case GL_FLOAT_MAT3: case GL_FLOAT_MAT3x2: case GL_FLOAT_MAT3x4:
+			return 3;
+		case GL_FLOAT_MAT4: case GL_FLOAT_MAT4x2: case GL_FLOAT_MAT4x3:
+			return 4;
+	}
+	return 1;
+}
+
+bool ShaderReflection::IsIntegerType(unsigned int type)
+{
+	switch (type)
+	{
+		case GL_INT: case GL_INT_VEC2: case GL_INT_VEC3: case GL_INT_VEC4:
+		case GL_UNSIGNED_INT: case GL_UNSIGNED_INT_VEC2: case GL_UNSIGNED_INT_VEC3: case GL_UNSIGNED_INT_VEC4:
+		case GL_BOOL: case GL_BOOL_VEC2: case GL_BOOL_VEC3: case GL_BOOL_VEC4:
+			return true;
+	}
+	return false;
+}
+
+const char* ShaderReflection::GetTypeName(unsigned int type)
+{
+	switch (type)
+	{
+		case GL_FLOAT: return "float";
+		case GL_FLOAT_VEC2: return "vec2";
+		case GL_FLOAT_VEC3: return "vec3";
+		case GL_FLOAT_VEC4: return "vec4";
+		case GL_INT: return "int";
+		case GL_INT_VEC2: return "ivec2";
+		case GL_INT_VEC3: return "ivec3";
+		case GL_INT_VEC4: return "ivec4";
+		case GL_UNSIGNED_INT: return "uint";
+		case GL_UNSIGNED_INT_VEC2: return "uvec2";
+		case GL_UNSIGNED_INT_VEC3: return "uvec3";
+		case GL_UNSIGNED_INT_VEC4: return "uvec4";
+		case GL_BOOL: return "bool";
+		case GL_FLOAT_MAT2: return "mat2";
+		case GL_FLOAT_MAT3: return "mat3";
+		case GL_FLOAT_MAT4: return "mat4";
+		case GL_SAMPLER_2D: return "sampler2D";
+		case GL_SAMPLER_2D_ARRAY: return "sampler2DArray";
+		case GL_SAMPLER_CUBE: return "samplerCube";
+	}
+	return "other";
+}
+
+ShaderReflection::ShaderReflection(unsigned int program)
+	: program_(program)
+{
+	if (GLCapabilities::Get().program_interface_query)
+		ReflectInterfaceQuery();
+	else
+		ReflectLegacy();
+}
+
+void ShaderReflection::ReflectInterfaceQuery()
+{
+	std::vector<char> name;
+
+	int count;
+	GLCALL(glGetProgramInterfaceiv(program_, GL_PROGRAM_INPUT, GL_ACTIVE_RESOURCES, &count));
+	for (int i = 0; i < count; i++)
+	{
+		const GLenum properties[] = { GL_NAME_LENGTH, GL_TYPE, GL_ARRAY_SIZE, GL_LOCATION };
+		int values[4];
+		GLCALL(glGetProgramResourceiv(program_, GL_PROGRAM_INPUT, i, 4, properties, 4, nullptr, values));
+		name.resize(values[0] + 1);
+		GLCALL(glGetProgramResourceName(program_, GL_PROGRAM_INPUT, i, (GLsizei)name.size(), nullptr, name.data()));
+		attributes_.push_back({ StripArraySuffix(name.data()), values[3], (unsigned int)values[1], values[2] });
+	}
+
+	// blocks first so members can point at them
+	const GLenum block_interfaces[] = { GL_UNIFORM_BLOCK, GL_SHADER_STORAGE_BLOCK };
+	for (GLenum block_interface : block_interfaces)
+	{
+		bool storage = block_interface == GL_SHADER_STORAGE_BLOCK;
+		if (storage && !GLCapabilities::Get().shader_storage_buffer)
+			continue;
+		GLCALL(glGetProgramInterfaceiv(program_, block_interface, GL_ACTIVE_RESOURCES, &count));
+		for (int i = 0; i < count; i++)
+		{
+			const GLenum properties[] = { GL_NAME_LENGTH, GL_BUFFER_DATA_SIZE, GL_BUFFER_BINDING };
+			int values[3];
+			GLCALL(glGetProgramResourceiv(program_, block_interface, i, 3, properties, 3, nullptr, values));
+			name.resize(values[0] + 1);
+			GLCALL(glGetProgramResourceName(program_, block_interface, i, (GLsizei)name.size(), nullptr, name.data()));
+			ShaderBlock block = { StripArraySuffix(name.data()), (unsigned int)i, values[1], (unsigned int)values[2], storage };
+			(storage ? storage_blocks_ : uniform_blocks_).push_back(block);
+		}
+	}
+
+	GLCALL(glGetProgramInterfaceiv(program_, GL_UNIFORM, GL_ACTIVE_RESOURCES, &count));
+	for (int i = 0; i < count; i++)
+	{
+		const GLenum properties[] = { GL_NAME_LENGTH, GL_TYPE, GL_ARRAY_SIZE, GL_LOCATION, GL_BLOCK_INDEX, GL_OFFSET, GL_ARRAY_STRIDE, GL_MATRIX_STRIDE };
+		int values[8];
+		GLCALL(glGetProgramResourceiv(program_, GL_UNIFORM, i, 8, properties, 8, nullptr, values));
+		name.resize(values[0] + 1);
+		GLCALL(glGetProgramResourceName(program_, GL_UNIFORM, i, (GLsizei)name.size(), nullptr, name.data()));
+		uniforms_.push_back({ StripArraySuffix(name.data()), values[3], (unsigned int)values[1], values[2], values[4], false, values[5], values[6], values[7] });
+	}
+
+	// storage block members are buffer variables, not uniforms
+	if (!GLCapabilities::Get().shader_storage_buffer)
+		return;
+	GLCALL(glGetProgramInterfaceiv(program_, GL_BUFFER_VARIABLE, GL_ACTIVE_RESOURCES, &count));
+	for (int i = 0; i < count; i++)
+	{
+		const GLenum properties[] = { GL_NAME_LENGTH, GL_TYPE, GL_ARRAY_SIZE, GL_BLOCK_INDEX, GL_OFFSET, GL_ARRAY_STRIDE, GL_MATRIX_STRIDE };
+		int values[7];
+		GLCALL(glGetProgramResourceiv(program_, GL_BUFFER_VARIABLE, i, 7, properties, 7, nullptr, values));
+		name.resize(values[0] + 1);
+		GLCALL(glGetProgramResourceName(program_, GL_BUFFER_VARIABLE, i, (GLsizei)name.size(), nullptr, name.data()));
+		uniforms_.push_back({ StripArraySuffix(name.data()), -1, (unsigned int)values[1], values[2], values[3], true, values[4], values[5], values[6] });
+	}
+}
+
+void ShaderReflection::ReflectLegacy()
+{
+	std::vector<char> name;
+
+	int count, max_length;
+	GLCALL(glGetProgramiv(program_, GL_ACTIVE_ATTRIBUTES, &count));
+	GLCALL(glGetProgramiv(program_, GL_ACTIVE_ATTRIBUTE_MAX_LENGTH, &max_length));
+	name.resize(max_length + 1);
+	for (int i = 0; i < count; i++)
+	{
+		int size;
+		GLenum type;
+		GLCALL(glGetActiveAttrib(program_, i, (GLsizei)name.size(), nullptr, &size, &type, name.data()));
+		GLCALL(int location = glGetAttribLocation(program_, name.data()));
+		attributes_.push_back({ StripArraySuffix(name.data()), location, type, size });
+	}
+
+	GLCALL(glGetProgramiv(program_, GL_ACTIVE_UNIFORM_BLOCKS, &count));
+	GLCALL(glGetProgramiv(program_, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH, &max_length));
+	name.resize(max_length + 1);
+	for (int i = 0; i < count; i++)
+	{
+		int size, binding;
+		GLCALL(glGetActiveUniformBlockName(program_, i, (GLsizei)name.size(), nullptr, name.data()));
+		GLCALL(glGetActiveUniformBlockiv(program_, i, GL_UNIFORM_BLOCK_DATA_SIZE, &size));
+		GLCALL(glGetActiveUniformBlockiv(program_, i, GL_UNIFORM_BLOCK_BINDING, &binding));
+		uniform_blocks_.push_back({ StripArraySuffix(name.data()), (unsigned int)i, size, (unsigned int)binding, false });
+	}
+
+	GLCALL(glGetProgramiv(program_, GL_ACTIVE_UNIFORMS, &count));
+	GLCALL(glGetProgramiv(program_, GL_ACTIVE_UNIFORM_MAX_LENGTH, &max_length));
+	name.resize(max_length + 1);
+	for (int i = 0; i < count; i++)
+	{
+		int size;
+		GLenum type;
+		GLCALL(glGetActiveUniform(program_, i, (GLsizei)name.size(), nullptr, &size, &type, name.data()));
+
+		// block layout of one uniform, -1 for the ones in the default block
+		GLuint index = i;
+		int block_index, offset, array_stride, matrix_stride;
+		GLCALL(glGetActiveUniformsiv(program_, 1, &index, GL_UNIFORM_BLOCK_INDEX, &block_index));
+		GLCALL(glGetActiveUniformsiv(program_, 1, &index, GL_UNIFORM_OFFSET, &offset));
+		GLCALL(glGetActiveUniformsiv(program_, 1, &index, GL_UNIFORM_ARRAY_STRIDE, &array_stride));
+		GLCALL(glGetActiveUniformsiv(program_, 1, &index, GL_UNIFORM_MATRIX_STRIDE, &matrix_stride));
+
+		int location = -1;
+		if (block_index < 0)
+		{
+			GLCALL(location = glGetUniformLocation(program_, name.data()));
+		}
+		uniforms_.push_back({ StripArraySuffix(name.data()), location, type, size, block_index, false, offset, array_stride, matrix_stride });
+	}
+}
+
+bool ShaderReflection::ValidateLayout(const VertexBufferLayout& layout) const
+{
+	const std::vector<VertexBufferElement>& elements = layout.GetElements();
+	bool valid = true;
+
+	for (const ShaderAttribute& attribute : attributes_)
+	{
+		// built-ins (gl_VertexID...) have no location and don't come from buffers
+		if (attribute.location < 0)
+			continue;
+
+		unsigned int locations = GetTypeLocations(attribute.type) * attribute.array_size;
+		for (unsigned int location = attribute.location; location < attribute.location + locations; location++)
+		{
+			if (location >= elements.size())
+			{
+				std::cerr << "Attribute " << GetTypeName(attribute.type) << " " << attribute.name << " (location " << location
+					<< ") isn't in the vertex layout, it has " << elements.size() << " elements" << std::endl;
+				valid = false;
+				continue;
+			}
+
+			// VertexArray sets every attribute up with glVertexAttribPointer, which hands floats to the shader
+			const VertexBufferElement& element = elements[location];
+			if (IsIntegerType(attribute.type))
+			{
+				std::cerr << "Attribute " << GetTypeName(attribute.type) << " " << attribute.name
+					<< " is an integer type but the vertex layout provides it as floats" << std::endl;
+				valid = false;
+			}
+
+			// fewer components is fine (the rest defaults to 0,0,0,1), more means data uploaded for nothing
+			if (element.count > GetTypeComponents(attribute.type))
+			{
+				std::cerr << "Attribute " << GetTypeName(attribute.type) << " " << attribute.name << " reads "
+					<< GetTypeComponents(attribute.type) << " components but the vertex layout has " << element.count << std::endl;
+			}
+		}
+	}
+
+	for (unsigned int i = 0; i < elements.size(); i++)
+	{
+		bool read = false;
+		for (const ShaderAttribute& attribute : attributes_)
+		{
+			unsigned int locations = GetTypeLocations(attribute.type) * attribute.array_size;
+			read = read || (attribute.location >= 0 && i >= (unsigned int)attribute.location && i < attribute.location + locations);
+		}
+		if (!read)
+			std::cerr << "Vertex layout element " << i << " isn't read by the shader" << std::endl;
+	}
+	return valid;
+}
+
+// binding point of every block name seen so far, and the name holding each binding point (empty while free).
+// uniform and storage blocks have separate sets of binding points
+static std::unordered_map<std::string, unsigned int> block_bindings[2];
+static std::vector<std::string> binding_owners[2];
+
+static unsigned int RegisterBinding(const std::string& name, bool storage, int explicit_binding)
+{
+	std::unordered_map<std::string, unsigned int>& bindings = block_bindings[storage];
+	std::vector<std::string>& owners = binding_owners[storage];
+
+	std::unordered_map<std::string, unsigned int>::const_iterator found = bindings.find(name);
+	if (found != bindings.end())
+		return found->second;
+
+	unsigned int binding = 0;
+	if (explicit_binding >= 0)
+	{
+		binding = explicit_binding;
+		if (binding < owners.size() && !owners[binding].empty())
+		{
+			std::cerr << "Block " << name << " has layout(binding = " << binding << ") but block " << owners[binding]
+				<< " already uses that binding point, they will overwrite each other's buffers" << std::endl;
+		}
+	}
+	else
+	{
+		while (binding < owners.size() && !owners[binding].empty())
+			binding++;
+	}
+	if (binding >= owners.size())
+		owners.resize(binding + 1);
+	if (owners[binding].empty())
+		owners[binding] = name;
+	bindings[name] = binding;
+	return binding;
+}
+
+unsigned int ShaderReflection::GetBlockBinding(const std::string& name, bool storage)
+{
+	return RegisterBinding(name, storage, -1);
+}
+
+static bool IsIdentifierChar(char c)
+{
+	return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+}
+
+static void SkipSpaces(const std::string& source, size_t& position)
+{
+	while (position < source.size() && (source[position] == ' ' || source[position] == '\t' || source[position] == '\r' || source[position] == '\n'))
+		position++;
+}
+
+static std::string ReadIdentifier(const std::string& source, size_t& position)
+{
+	SkipSpaces(source, position);
+	size_t start = position;
+	while (position < source.size() && IsIdentifierChar(source[position]))
+		position++;
+	return source.substr(start, position - start);
+}
+
+void ShaderReflection::FindExplicitBindings(const std::string& source, std::vector<std::string>& blocks)
+{
+	// layout(... binding = N ...) [memory qualifiers] uniform|buffer Name {
+	for (size_t position = source.find("layout"); position != std::string::npos; position = source.find("layout", position))
+	{
+		if (position > 0 && IsIdentifierChar(source[position - 1]))
+		{
+			position += 6;
+			continue;
+		}
+
+		// a declaration can have several layout() qualifiers in a row
+		bool binding = false;
+		std::string word = ReadIdentifier(source, position);
+		while (word == "layout")
+		{
+			SkipSpaces(source, position);
+			if (position >= source.size() || source[position] != '(')
+				break;
+			size_t close = source.find(')', position);
+			if (close == std::string::npos)
+				return;
+			std::string qualifiers = source.substr(position + 1, close - position - 1);
+			for (size_t found = qualifiers.find("binding"); found != std::string::npos; found = qualifiers.find("binding", found + 7))
+			{
+				size_t after = found + 7;
+				SkipSpaces(qualifiers, after);
+				bool whole_word = (found == 0 || !IsIdentifierChar(qualifiers[found - 1]));
+				binding = binding || (whole_word && after < qualifiers.size() && qualifiers[after] == '=');
+			}
+			position = close + 1;
+			word = ReadIdentifier(source, position);
+		}
+
+		while (word == "readonly" || word == "writeonly" || word == "restrict" || word == "coherent" || word == "volatile")
+			word = ReadIdentifier(source, position);
+		if (!binding || (word != "uniform" && word != "buffer"))
+			continue;
+
+		std::string name = ReadIdentifier(source, position);
+		SkipSpaces(source, position);
+		if (!name.empty() && position < source.size() && source[position] == '{')
+			blocks.push_back(name);
+	}
+}
+
+void ShaderReflection::AssignBlockBindings(const std::vector<std::string>& explicit_blocks)
+{
+	for (std::vector<ShaderBlock>* blocks : { &uniform_blocks_, &storage_blocks_ })
+	{
+		for (ShaderBlock& block : *blocks)
+			block.explicit_binding = std::find(explicit_blocks.begin(), explicit_blocks.end(), block.name) != explicit_blocks.end();
+	}
+
+	// explicit bindings first, so a block given a binding point by this program doesn't pick one of them
+	for (bool explicit_pass : { true, false })
+	{
+		for (std::vector<ShaderBlock>* blocks : { &uniform_blocks_, &storage_blocks_ })
+		{
+			for (ShaderBlock& block : *blocks)
+			{
+				if (block.explicit_binding != explicit_pass)
+					continue;
+
+				unsigned int binding = RegisterBinding(block.name, block.storage, block.explicit_binding ? (int)block.binding : -1);
+				if (binding != block.binding && block.explicit_binding)
+				{
+					std::cerr << "Block " << block.name << " has layout(binding = " << block.binding << ") but other programs use "
+						<< binding << " for it, using " << binding << std::endl;
+				}
+				block.binding = binding;
+
+				if (block.storage)
+				{
+					GLCALL(glShaderStorageBlockBinding(program_, block.index, binding));
+				}
+				else
+				{
+					GLCALL(glUniformBlockBinding(program_, block.index, binding));
+				}
+			}
+		}
+	}
+}
+
+const ShaderAttribute* ShaderReflection::FindAttribute(const std::string& name) const
+{
+	for (const ShaderAttribute& attribute : attributes_)
+	{
+		if (attribute.name == name)
+			return &attribute;
+	}
+	return nullptr;
+}
+
+const ShaderUniform* ShaderReflection::FindUniform(const std::string& name) const
+{
+	for (const ShaderUniform& uniform : uniforms_)
+	{
+		if (uniform.name == name)
+			return &uniform;
+	}
+	return nullptr;
+}
+
+const ShaderBlock* ShaderReflection::FindUniformBlock(const std::string& name) const
+{
+	for (const ShaderBlock& block : uniform_blocks_)
+	{
+		if (block.name == name)
+			return &block;
+	}
+	return nullptr;
+}
+
+const ShaderBlock* ShaderReflection::FindStorageBlock(const std::string& name) const
+{
+	for (const ShaderBlock& block : storage_blocks_)
+	{
+		if (block.name == name)
+			return &block;
+	}
+	return nullptr;
+}
+
+int ShaderReflection::GetUniformLocation(const std::string& name) const
+{
+	const ShaderUniform* uniform = FindUniform(name);
+	return uniform ? uniform->location : -1;
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+class VertexBufferLayout;
+
+struct ShaderAttribute
+{
+	std::string name;
+	int location;
+	unsigned int type;   // GL_FLOAT_VEC4...
+	int array_size;
+};
+
+struct ShaderUniform
+{
+	std::string name;       // "[0]" of arrays is dropped, "u_Lights[0]" is just "u_Lights"
+	int location;           // -1 for block members, they are set through the block's buffer
+	unsigned int type;
+	int array_size;
+	int block_index;        // index into the uniform or storage blocks, -1 for the default block
+	bool storage;           // member of a storage block rather than a uniform block
+	int offset;             // byte offset in the block, -1 outside of blocks
+	int array_stride;
+	int matrix_stride;
+};
+
+struct ShaderBlock
+{
+	std::string name;
+	unsigned int index;     // block index in the program
+	int size;               // minimum buffer size in bytes
+	unsigned int binding;
+	bool storage;
+	bool explicit_binding = false;   // the source gives it a layout(binding = N), set by AssignBlockBindings
+};
+
+// What a linked program actually uses, asked from the driver once after linking so nothing has to be
+// looked up by name every frame. Names, types, locations, block offsets and block sizes of the active
+// attributes, uniforms, uniform blocks and storage blocks (storage blocks need GL 4.3).
+class ShaderReflection
+{
+private:
+	unsigned int program_;
+	std::vector<ShaderAttribute> attributes_;
+	std::vector<ShaderUniform> uniforms_;
+	std::vector<ShaderBlock> uniform_blocks_;
+	std::vector<ShaderBlock> storage_blocks_;
+
+	void ReflectInterfaceQuery();
+	void ReflectLegacy();
+
+public:
+	explicit ShaderReflection(unsigned int program);
+
+	// Check the attributes the program reads against what layout provides (attribute i comes from element i,
+	// like VertexArray::AddBuffer sets them up). Prints every mismatch, false if the draw would read garbage.
+	bool ValidateLayout(const VertexBufferLayout& layout) const;
+
+	// Give every block the binding point used for its name by every other program, so a buffer bound for a
+	// block once serves all programs. Blocks named in explicit_blocks keep their layout(binding = N), they
+	// reserve their binding points before the others get one. A binding point already taken by a different
+	// block is reported, the two would overwrite each other's buffers.
+	void AssignBlockBindings(const std::vector<std::string>& explicit_blocks = {});
+
+	// Add the names of the blocks GLSL source declares with layout(binding = N) to blocks. The driver reports
+	// the same binding 0 for "binding = 0" and for no binding at all, only the source tells them apart.
+	static void FindExplicitBindings(const std::string& source, std::vector<std::string>& blocks);
+
+	// Binding point of a block name, the same in every program that went through AssignBlockBindings
+	static unsigned int GetBlockBinding(const std::string& name, bool storage);
+
+	const ShaderAttribute* FindAttribute(const std::string& name) const;
+	const ShaderUniform* FindUniform(const std::string& name) const;
+	const ShaderBlock* FindUniformBlock(const std::string& name) const;
+	const ShaderBlock* FindStorageBlock(const std::string& name) const;
+
+	// Location of a default block uniform, -1 if the program doesn't use it
+	int GetUniformLocation(const std::string& name) const;
+
+	inline unsigned int GetProgram() const { return program_; }
+	inline const std::vector<ShaderAttribute>& GetAttributes() const { return attributes_; }
+	inline const std::vector<ShaderUniform>& GetUniforms() const { return uniforms_; }
+	inline const std::vector<ShaderBlock>& GetUniformBlocks() const { return uniform_blocks_; }
+	inline const std::vector<ShaderBlock>& GetStorageBlocks() const { return storage_blocks_; }
+
+	// Components of one column of a GLSL type (vec3 -> 3, mat4 -> 4), locations it takes as an attribute
+	// (mat4 -> 4), and whether it is read as integers
+	static unsigned int GetTypeComponents(unsigned int type);
+	static unsigned int GetTypeLocations(unsigned int type);
+	static bool IsIntegerType(unsigned int type);
+	static const char* GetTypeName(unsigned int type);
+};
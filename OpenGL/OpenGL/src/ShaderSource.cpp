@@ -0,0 +1,78 @@
+#include "ShaderSource.h"
+
+#include <iostream>
+
+static const char* stage_names[SHADER_STAGE_COUNT] = { "vertex", "fragment", "geometry", "tess_control", "tess_evaluation", "compute" };
+
+const char* ShaderSource::GetStageName(ShaderStage stage)
+{
+	return stage_names[(unsigned int)stage];
+}
+
+ShaderSource ShaderSource::Parse(const std::string& path)
+{
+	ShaderSource source;
+
+	// the file is mapped once and every stage is a slice of it, nothing gets copied
+	std::unique_ptr<MappedFile> file = std::make_unique<MappedFile>();
+	if (!file->Open(path))
+	{
+		std::cerr << "Error opening the file " << path << std::endl;
+		return source;
+	}
+	std::string_view text((const char*)file->GetData(), file->GetSize());
+
+	// stage being read, COUNT until the first #shader line (and after an unknown one), its text is skipped
+	ShaderStage current = ShaderStage::COUNT;
+	size_t stage_start = 0;
+	unsigned int line_number = 0;
+
+	size_t start = 0;
+	while (start <= text.size())
+	{
+		size_t end = text.find('\n', start);
+		if (end == std::string_view::npos)
+			end = text.size();
+		line_number++;
+
+		std::string_view line = text.substr(start, end - start);
+		size_t first = line.find_first_not_of(" \t");
+		if (first != std::string_view::npos && line.compare(first, 7, "#shader") == 0)
+		{
+			// close the stage before this line
+			if (current != ShaderStage::COUNT)
+				source.stages[(unsigned int)current] = text.substr(stage_start, start - stage_start);
+
+			// the stage name is the next word
+			std::string_view rest = line.substr(first + 7);
+			size_t name_start = rest.find_first_not_of(" \t");
+			size_t name_end = name_start == std::string_view::npos ? name_start : rest.find_first_of(" \t\r", name_start);
+			std::string_view name = name_start == std::string_view::npos ? std::string_view() : rest.substr(name_start, name_end - name_start);
+
+			current = ShaderStage::COUNT;
+			for (unsigned int stage = 0; stage < SHADER_STAGE_COUNT; stage++)
+			{
+				if (name == stage_names[stage])
+					current = (ShaderStage)stage;
+			}
+			if (current == ShaderStage::COUNT)
+				std::cerr << path << "(" << line_number << "): unknown shader stage " << std::string(name) << ", skipping it" << std::endl;
+			else if (source.Has(current))
+				std::cerr << path << "(" << line_number << "): second " << std::string(name) << " stage replaces the first one" << std::endl;
+
+			stage_start = end + 1 < text.size() ? end + 1 : text.size();
+			if (current != ShaderStage::COUNT)
+				source.first_lines[(unsigned int)current] = line_number + 1;
+		}
+		else if (current == ShaderStage::COUNT && first != std::string_view::npos && line[first] != '\r' && line.compare(first, 2, "//") != 0)
+		{
+			std::cerr << path << "(" << line_number << "): text outside of a #shader stage is ignored" << std::endl;
+		}
+		start = end + 1;
+	}
+	if (current != ShaderStage::COUNT)
+		source.stages[(unsigned int)current] = text.substr(stage_start);
+
+	source.file = std::move(file);
+	return source;
+}
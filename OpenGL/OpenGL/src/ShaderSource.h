@@ -0,0 +1,44 @@
+#pragma once
+
+#include <array>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "MappedFile.h"
+
+enum class ShaderStage
+{
+	VERTEX = 0,
+	FRAGMENT,
+	GEOMETRY,
+	TESS_CONTROL,
+	TESS_EVALUATION,
+	COMPUTE,
+	COUNT
+};
+
+static constexpr unsigned int SHADER_STAGE_COUNT = (unsigned int)ShaderStage::COUNT;
+
+// Source of every stage of a program, empty for stages it doesn't have
+typedef std::array<std::string_view, SHADER_STAGE_COUNT> ShaderStageSources;
+
+// A .shader file split at its "#shader <stage>" lines. The file is read once and kept here, the stages
+// are views into it, so they are only valid as long as this is alive.
+struct ShaderSource
+{
+	std::unique_ptr<MappedFile> file;
+	ShaderStageSources stages;
+	std::array<unsigned int, SHADER_STAGE_COUNT> first_lines = {};   // line of the file each stage starts at
+
+	inline std::string_view Get(ShaderStage stage) const { return stages[(unsigned int)stage]; }
+	inline unsigned int GetFirstLine(ShaderStage stage) const { return first_lines[(unsigned int)stage]; }
+	inline bool Has(ShaderStage stage) const { return !stages[(unsigned int)stage].empty(); }
+	inline bool IsLoaded() const { return file != nullptr; }
+
+	// Split the file at path into its stages, IsLoaded() is false if it can't be read
+	static ShaderSource Parse(const std::string& path);
+
+	// Name used after #shader: "vertex", "fragment"...
+	static const char* GetStageName(ShaderStage stage);
+};
@@ -0,0 +1,307 @@
+#include "ShaderVariantCache.h"
+#include "GLCapabilities.h"
+#include "Renderer.h"
+
+#include <GL/glew.h>
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
+
+ShaderVariantCache::ShaderVariantCache(const std::string& path, const std::vector<std::string>& features, ShaderPreprocessor& preprocessor,
+	GpuResources& resources)
+	: path_(path), features_(features), preprocessor_(preprocessor), resources_(resources), reloading_(false), spirv_before_reload_(false), use_spirv_(false)
+{
+	ASSERT(features_.size() <= 64);
+
+	dependencies_.push_back(path_);
+	Shader parser;
+	source_ = parser.ParseShader(path_);
+	LoadSpirv();
+}
+
+void ShaderVariantCache::LoadSpirv()
+{
+	use_spirv_ = false;
+	if (!GLCapabilities::Get().gl_spirv || !source_.IsLoaded())
+		return;
+
+	std::error_code error;
+	std::filesystem::file_time_type source_time = std::filesystem::last_write_time(path_, error);
+
+	for (unsigned int stage = 0; stage < SHADER_STAGE_COUNT; stage++)
+	{
+		spirv_files_[stage].reset();
+		spirv_[stage] = std::string_view();
+		if (!source_.Has((ShaderStage)stage))
+			continue;
+
+		// binaries older than the shader were compiled from a previous version of it
+		std::string spirv_path = path_ + "." + Shader::GetStageName((ShaderStage)stage) + ".spv";
+		std::filesystem::file_time_type spirv_time = std::filesystem::last_write_time(spirv_path, error);
+		if (error)
+			return;
+		if (spirv_time < source_time)
+		{
+			std::cout << spirv_path << " is older than " << path_ << ", compiling the GLSL instead" << std::endl;
+			return;
+		}
+
+		spirv_files_[stage] = std::make_unique<MappedFile>();
+		if (!spirv_files_[stage]->Open(spirv_path))
+			return;
+		spirv_[stage] = std::string_view((const char*)spirv_files_[stage]->GetData(), spirv_files_[stage]->GetSize());
+	}
+	use_spirv_ = true;
+}
+
+ShaderVariantCache::~ShaderVariantCache()
+{
+	CancelReload();
+	for (const std::pair<const uint64_t, ShaderProgramHandle>& variant : programs_)
+	{
+		if (variant.second.IsValid())
+			resources_.Destroy(variant.second);
+	}
+}
+
+bool ShaderVariantCache::BeginVariant(const ShaderSource& source, uint64_t key, PendingProgram& pending)
+{
+	if (!source.IsLoaded())
+		return false;
+
+	std::vector<ShaderDefine> defines;
+	for (unsigned int i = 0; i < features_.size(); i++)
+	{
+		if (key & (1ull << i))
+			defines.push_back({ features_[i], "1" });
+	}
+
+	// every stage is expanded on its own, each has its own #include-once set and line numbering
+	PreprocessedSource stages[SHADER_STAGE_COUNT];
+	ShaderStageSources sources;
+	std::vector<std::string> explicit_blocks;
+	std::string& file_table = file_tables_[key];
+	file_table.clear();
+	for (unsigned int stage = 0; stage < SHADER_STAGE_COUNT; stage++)
+	{
+		if (!source.Has((ShaderStage)stage))
+			continue;
+		if (!preprocessor_.Process(source.stages[stage], path_, defines, stages[stage], source.first_lines[stage]))
+			return false;
+		sources[stage] = stages[stage].code;
+		ShaderReflection::FindExplicitBindings(stages[stage].code, explicit_blocks);
+
+		// errors come back as "<file>(<line>)", remember which file each number is
+		file_table += std::string(file_table.empty() ? "" : ", ") + Shader::GetStageName((ShaderStage)stage) + " files:";
+		for (unsigned int i = 0; i < stages[stage].files.size(); i++)
+			file_table += " " + std::to_string(i) + "=" + stages[stage].files[i];
+
+		for (const std::string& file : stages[stage].files)
+		{
+			if (std::find(dependencies_.begin(), dependencies_.end(), file) == dependencies_.end())
+				dependencies_.push_back(file);
+		}
+	}
+
+	Shader compiler;
+	if (use_spirv_)
+	{
+		// the key goes in as specialization constants instead of defines
+		std::vector<unsigned int> ids, values;
+		for (unsigned int i = 0; i < features_.size(); i++)
+		{
+			ids.push_back(i);
+			values.push_back((key >> i) & 1);
+		}
+		file_table += ", from SPIR-V";
+		pending = compiler.BeginProgramSpirv(spirv_, ids, values);
+	}
+	else
+	{
+		pending = compiler.BeginProgram(sources);
+	}
+	pending.explicit_binding_blocks = std::move(explicit_blocks);
+	return true;
+}
+
+unsigned int ShaderVariantCache::GetProgram(uint64_t key)
+{
+	std::unordered_map<uint64_t, ShaderProgramHandle>::const_iterator found = programs_.find(key);
+	if (found != programs_.end())
+		return found->second.IsValid() ? resources_.Get(found->second)->GetRendererId() : 0;
+
+	unsigned int program = 0;
+	PendingProgram pending;
+	if (BeginVariant(source_, key, pending))
+	{
+		Shader compiler;
+		program = compiler.FinishProgram(pending);
+		if (program == 0)
+			std::cerr << path_ << " variant 0x" << std::hex << key << std::dec << " failed to build, " << file_tables_[key] << std::endl;
+
+		// binaries from another compiler version or a driver that doesn't like them, the GLSL still works
+		if (program == 0 && use_spirv_)
+		{
+			std::cerr << "Falling back to GLSL for " << path_ << std::endl;
+			use_spirv_ = false;
+			if (BeginVariant(source_, key, pending))
+				program = compiler.FinishProgram(pending);
+		}
+	}
+
+	programs_[key] = program ? resources_.Create<ShaderProgram>(program) : ShaderProgramHandle();
+	reflections_[key] = Reflect(program, pending.explicit_binding_blocks);
+	return program;
+}
+
+std::unique_ptr<ShaderReflection> ShaderVariantCache::Reflect(unsigned int program, const std::vector<std::string>& explicit_blocks) const
+{
+	if (program == 0)
+		return nullptr;
+	std::unique_ptr<ShaderReflection> reflection = std::make_unique<ShaderReflection>(program);
+	reflection->AssignBlockBindings(explicit_blocks);
+	return reflection;
+}
+
+const ShaderReflection* ShaderVariantCache::GetReflection(uint64_t key)
+{
+	GetProgram(key);
+	return reflections_[key].get();
+}
+
+uint64_t ShaderVariantCache::GetFeatureBit(const std::string& feature) const
+{
+	for (unsigned int i = 0; i < features_.size(); i++)
+	{
+		if (features_[i] == feature)
+			return 1ull << i;
+	}
+	return 0;
+}
+
+uint64_t ShaderVariantCache::MakeKey(const std::vector<std::string>& enabled) const
+{
+	uint64_t key = 0;
+	for (const std::string& feature : enabled)
+		key |= GetFeatureBit(feature);
+	return key;
+}
+
+void ShaderVariantCache::CancelReload()
+{
+	Shader compiler;
+	for (std::pair<const uint64_t, PendingProgram>& variant : pending_programs_)
+	{
+		GLCALL(glDeleteProgram(compiler.FinishProgram(variant.second)));
+	}
+	pending_programs_.clear();
+	pending_source_ = ShaderSource();
+	if (reloading_)
+		use_spirv_ = spirv_before_reload_;
+	reloading_ = false;
+}
+
+bool ShaderVariantCache::BeginReload()
+{
+	CancelReload();
+
+	// the binaries were compiled from the old file, from now on the GLSL is compiled (unless the reload fails)
+	spirv_before_reload_ = use_spirv_;
+	use_spirv_ = false;
+	preprocessor_.ClearCache();
+	Shader parser;
+	pending_source_ = parser.ParseShader(path_);
+	if (!pending_source_.IsLoaded())
+	{
+		std::cerr << "Can't reload " << path_ << ", keeping the current programs" << std::endl;
+		pending_source_ = ShaderSource();
+		use_spirv_ = spirv_before_reload_;
+		return false;
+	}
+
+	// every key asked for so far is rebuilt, the ones that failed before included
+	for (const std::pair<const uint64_t, ShaderProgramHandle>& variant : programs_)
+	{
+		PendingProgram pending;
+		if (!BeginVariant(pending_source_, variant.first, pending))
+		{
+			std::cerr << "Can't preprocess " << path_ << ", keeping the current programs" << std::endl;
+			CancelReload();
+			use_spirv_ = spirv_before_reload_;
+			return false;
+		}
+		pending_programs_[variant.first] = pending;
+	}
+
+	reloading_ = true;
+	return true;
+}
+
+bool ShaderVariantCache::UpdateReload(bool wait)
+{
+	if (!reloading_)
+		return true;
+
+	if (!wait)
+	{
+		for (const std::pair<const uint64_t, PendingProgram>& variant : pending_programs_)
+		{
+			if (!Shader::IsProgramReady(variant.second))
+				return false;
+		}
+	}
+
+	Shader compiler;
+	std::unordered_map<uint64_t, unsigned int> programs;
+	std::unordered_map<uint64_t, std::vector<std::string>> explicit_blocks;
+	bool linked = true;
+	for (std::pair<const uint64_t, PendingProgram>& variant : pending_programs_)
+	{
+		unsigned int program = compiler.FinishProgram(variant.second);
+		if (program == 0)
+			std::cerr << path_ << " variant 0x" << std::hex << variant.first << std::dec << " failed to build, " << file_tables_[variant.first] << std::endl;
+		// a variant that is broken right now can only get better, it doesn't hold up the others
+		linked = linked && (program != 0 || !programs_[variant.first].IsValid());
+		programs[variant.first] = program;
+		explicit_blocks[variant.first] = std::move(variant.second.explicit_binding_blocks);
+	}
+	pending_programs_.clear();
+
+	// all or nothing, so variants of one file never come from different versions of it. The old programs
+	// may still be in use by draws the GPU hasn't run, they go through the deletion queue; the new ones
+	// that lost were never used and go right away
+	if (linked)
+	{
+		for (const std::pair<const uint64_t, ShaderProgramHandle>& variant : programs_)
+		{
+			if (variant.second.IsValid())
+				resources_.Destroy(variant.second);
+		}
+		programs_.clear();
+		for (const std::pair<const uint64_t, unsigned int>& variant : programs)
+		{
+			programs_[variant.first] = variant.second ? resources_.Create<ShaderProgram>(variant.second) : ShaderProgramHandle();
+			reflections_[variant.first] = Reflect(variant.second, explicit_blocks[variant.first]);
+		}
+		source_ = std::move(pending_source_);
+		std::cout << "Reloaded " << path_ << std::endl;
+	}
+	else
+	{
+		for (const std::pair<const uint64_t, unsigned int>& variant : programs)
+		{
+			GLCALL(glDeleteProgram(variant.second));
+		}
+		std::cerr << "Reloading " << path_ << " failed, keeping the current programs" << std::endl;
+		use_spirv_ = spirv_before_reload_;
+	}
+	pending_source_ = ShaderSource();
+	reloading_ = false;
+	return true;
+}
+
+void ShaderVariantCache::Reload()
+{
+	if (BeginReload())
+		UpdateReload(true);
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "GpuResources.h"
+#include "Shader.h"
+#include "ShaderPreprocessor.h"
+#include "ShaderReflection.h"
+
+// Permutations of one shader file. Every feature is a bit of the key and a define in the code
+// (bit i set -> "#define <features[i]> 1"), so a single file covers every combination of features
+// and only the keys actually asked for get compiled, each once.
+//
+// When the context has gl_spirv and ShaderCompiler left up to date "<path>.<stage>.spv" files next to the
+// shader, those are loaded instead of compiling GLSL, and feature i becomes specialization constant i
+// (1 or 0). A shader supporting both paths declares its features like this and tests them with if ():
+//   #ifdef GL_SPIRV
+//   layout(constant_id = 0) const bool USE_FOG = false;
+//   #elif !defined(USE_FOG)
+//   #define USE_FOG 0
+//   #endif
+class ShaderVariantCache
+{
+private:
+	std::string path_;
+	ShaderSource source_;
+	std::vector<std::string> features_;
+	ShaderPreprocessor& preprocessor_;
+	GpuResources& resources_;
+	std::unordered_map<uint64_t, ShaderProgramHandle> programs_;   // invalid for keys that failed
+	std::unordered_map<uint64_t, std::unique_ptr<ShaderReflection>> reflections_;
+	std::vector<std::string> dependencies_;
+	std::unordered_map<uint64_t, std::string> file_tables_;   // "vertex files: 0=a 1=b..." of every key, for error messages
+
+	// reload in flight: the new file and a new program for every key compiled so far
+	ShaderSource pending_source_;
+	std::unordered_map<uint64_t, PendingProgram> pending_programs_;
+	bool reloading_;
+	bool spirv_before_reload_;   // use_spirv_ goes back to this when the reload fails
+
+	// offline compiled modules of every stage, only used while use_spirv_ is set
+	std::array<std::unique_ptr<MappedFile>, SHADER_STAGE_COUNT> spirv_files_;
+	ShaderStageSources spirv_;
+	bool use_spirv_;
+
+	// Map the .spv files of every stage, use_spirv_ is only set if they are all there and newer than the shader
+	void LoadSpirv();
+
+	// Preprocess every stage of source for key and queue the compile, false if the preprocessor fails
+	bool BeginVariant(const ShaderSource& source, uint64_t key, PendingProgram& pending);
+
+	void CancelReload();
+
+	// Reflect a freshly linked program and give its blocks their shared binding points, explicit_blocks are
+	// the ones its source gives a layout(binding = N)
+	std::unique_ptr<ShaderReflection> Reflect(unsigned int program, const std::vector<std::string>& explicit_blocks) const;
+
+public:
+	// Up to 64 features. The file is read once here, variants are compiled later on demand. The programs
+	// live in resources, the ones a reload replaces are deleted once the GPU is done with them.
+	ShaderVariantCache(const std::string& path, const std::vector<std::string>& features, ShaderPreprocessor& preprocessor,
+		GpuResources& resources);
+	~ShaderVariantCache();
+
+	ShaderVariantCache(const ShaderVariantCache&) = delete;
+	ShaderVariantCache& operator=(const ShaderVariantCache&) = delete;
+
+	// Program for the features set in key, compiled the first time the key is seen.
+	// 0 if it fails to compile, failures are remembered too so a broken variant isn't recompiled every frame.
+	// The program of a key changes when a reload goes through, so don't keep it across frames.
+	unsigned int GetProgram(uint64_t key);
+
+	// What the program of key uses (attributes, uniforms with locations and offsets, blocks), nullptr if it failed.
+	// Replaced along with the program on reload.
+	const ShaderReflection* GetReflection(uint64_t key);
+
+	// Bit of a feature, 0 for names that aren't features of this shader
+	uint64_t GetFeatureBit(const std::string& feature) const;
+
+	// Key with the named features enabled
+	uint64_t MakeKey(const std::vector<std::string>& enabled) const;
+
+	// Read the file again and queue a recompile of every variant, without waiting for the driver.
+	// Returns false (and keeps the current programs) if the file can't be read or preprocessed.
+	bool BeginReload();
+
+	// Once the recompile of BeginReload has finished: if every variant linked they all replace the
+	// current ones at once, otherwise the new ones are dropped and the old ones stay. Variants that were
+	// already broken don't count, so one that never compiled can't block every later reload. Doesn't block
+	// unless wait is set, returns true once the reload is over (swapped or not).
+	bool UpdateReload(bool wait = false);
+
+	// BeginReload and wait for it
+	void Reload();
+
+	inline bool IsReloading() const { return reloading_; }
+	inline bool IsUsingSpirv() const { return use_spirv_; }
+	inline unsigned int GetVariantCount() const { return (unsigned int)programs_.size(); }
+	inline const std::string& GetPath() const { return path_; }
+
+	// Files the compiled variants were put together from, the shader file and everything it includes
+	inline const std::vector<std::string>& GetDependencies() const { return dependencies_; }
+};
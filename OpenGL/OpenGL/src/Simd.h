@@ -0,0 +1,300 @@
+#pragma once
+
+#include <cstdint>
+
+// Thin 4 wide float vector over whatever the target has: SSE on x86/x64, NEON on ARM, plain floats
+// otherwise. Code written against these functions runs unchanged on all of them, anything wider (AVX)
+// is a separate path next to the code that uses it.
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define SIMD_SSE 1
+#include <immintrin.h>
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#define SIMD_NEON 1
+#include <arm_neon.h>
+#else
+#define SIMD_SCALAR 1
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// AVX can't be assumed on x86, code using it checks SimdCpuHasAvx at run time and marks its functions
+// with SIMD_AVX_FUNCTION: MSVC lets any function use AVX intrinsics, GCC and Clang want them marked
+#if defined(SIMD_SSE)
+#define SIMD_AVX 1
+#if defined(_MSC_VER)
+#define SIMD_AVX_FUNCTION
+#else
+#define SIMD_AVX_FUNCTION __attribute__((target("avx")))
+#endif
+#endif
+
+#if defined(SIMD_SSE)
+typedef __m128 SimdFloat;
+typedef __m128 SimdMask;
+#elif defined(SIMD_NEON)
+typedef float32x4_t SimdFloat;
+typedef uint32x4_t SimdMask;
+#else
+struct SimdFloat
+{
+	float lane[4];
+};
+
+// every bit of a lane set where a comparison was true, none where it was false
+struct SimdMask
+{
+	uint32_t lane[4];
+};
+#endif
+
+static constexpr unsigned int SIMD_WIDTH = 4;
+
+// Loads and stores don't need aligned pointers
+inline SimdFloat SimdLoad(const float* values)
+{
+#if defined(SIMD_SSE)
+	return _mm_loadu_ps(values);
+#elif defined(SIMD_NEON)
+	return vld1q_f32(values);
+#else
+	return { { values[0], values[1], values[2], values[3] } };
+#endif
+}
+
+inline void SimdStore(float* values, SimdFloat a)
+{
+#if defined(SIMD_SSE)
+	_mm_storeu_ps(values, a);
+#elif defined(SIMD_NEON)
+	vst1q_f32(values, a);
+#else
+	for (unsigned int i = 0; i < 4; i++)
+		values[i] = a.lane[i];
+#endif
+}
+
+// Same value in every lane
+inline SimdFloat SimdSplat(float value)
+{
+#if defined(SIMD_SSE)
+	return _mm_set1_ps(value);
+#elif defined(SIMD_NEON)
+	return vdupq_n_f32(value);
+#else
+	return { { value, value, value, value } };
+#endif
+}
+
+inline SimdFloat SimdAdd(SimdFloat a, SimdFloat b)
+{
+#if defined(SIMD_SSE)
+	return _mm_add_ps(a, b);
+#elif defined(SIMD_NEON)
+	return vaddq_f32(a, b);
+#else
+	return { { a.lane[0] + b.lane[0], a.lane[1] + b.lane[1], a.lane[2] + b.lane[2], a.lane[3] + b.lane[3] } };
+#endif
+}
+
+inline SimdFloat SimdSub(SimdFloat a, SimdFloat b)
+{
+#if defined(SIMD_SSE)
+	return _mm_sub_ps(a, b);
+#elif defined(SIMD_NEON)
+	return vsubq_f32(a, b);
+#else
+	return { { a.lane[0] - b.lane[0], a.lane[1] - b.lane[1], a.lane[2] - b.lane[2], a.lane[3] - b.lane[3] } };
+#endif
+}
+
+inline SimdFloat SimdMul(SimdFloat a, SimdFloat b)
+{
+#if defined(SIMD_SSE)
+	return _mm_mul_ps(a, b);
+#elif defined(SIMD_NEON)
+	return vmulq_f32(a, b);
+#else
+	return { { a.lane[0] * b.lane[0], a.lane[1] * b.lane[1], a.lane[2] * b.lane[2], a.lane[3] * b.lane[3] } };
+#endif
+}
+
+// a * b + c, fused where the instruction exists
+inline SimdFloat SimdMulAdd(SimdFloat a, SimdFloat b, SimdFloat c)
+{
+#if defined(SIMD_NEON)
+	return vfmaq_f32(c, a, b);
+#else
+	return SimdAdd(SimdMul(a, b), c);
+#endif
+}
+
+inline SimdFloat SimdMin(SimdFloat a, SimdFloat b)
+{
+#if defined(SIMD_SSE)
+	return _mm_min_ps(a, b);
+#elif defined(SIMD_NEON)
+	return vminq_f32(a, b);
+#else
+	SimdFloat result;
+	for (unsigned int i = 0; i < 4; i++)
+		result.lane[i] = a.lane[i] < b.lane[i] ? a.lane[i] : b.lane[i];
+	return result;
+#endif
+}
+
+inline SimdFloat SimdMax(SimdFloat a, SimdFloat b)
+{
+#if defined(SIMD_SSE)
+	return _mm_max_ps(a, b);
+#elif defined(SIMD_NEON)
+	return vmaxq_f32(a, b);
+#else
+	SimdFloat result;
+	for (unsigned int i = 0; i < 4; i++)
+		result.lane[i] = a.lane[i] > b.lane[i] ? a.lane[i] : b.lane[i];
+	return result;
+#endif
+}
+
+inline SimdMask SimdLess(SimdFloat a, SimdFloat b)
+{
+#if defined(SIMD_SSE)
+	return _mm_cmplt_ps(a, b);
+#elif defined(SIMD_NEON)
+	return vcltq_f32(a, b);
+#else
+	SimdMask result;
+	for (unsigned int i = 0; i < 4; i++)
+		result.lane[i] = a.lane[i] < b.lane[i] ? 0xFFFFFFFFu : 0u;
+	return result;
+#endif
+}
+
+inline SimdMask SimdGreaterEqual(SimdFloat a, SimdFloat b)
+{
+#if defined(SIMD_SSE)
+	return _mm_cmpge_ps(a, b);
+#elif defined(SIMD_NEON)
+	return vcgeq_f32(a, b);
+#else
+	SimdMask result;
+	for (unsigned int i = 0; i < 4; i++)
+		result.lane[i] = a.lane[i] >= b.lane[i] ? 0xFFFFFFFFu : 0u;
+	return result;
+#endif
+}
+
+// Lanes of if_true where mask is set, of if_false elsewhere
+inline SimdFloat SimdSelect(SimdMask mask, SimdFloat if_true, SimdFloat if_false)
+{
+#if defined(SIMD_SSE)
+	return _mm_or_ps(_mm_and_ps(mask, if_true), _mm_andnot_ps(mask, if_false));
+#elif defined(SIMD_NEON)
+	return vbslq_f32(mask, if_true, if_false);
+#else
+	SimdFloat result;
+	for (unsigned int i = 0; i < 4; i++)
+		result.lane[i] = mask.lane[i] ? if_true.lane[i] : if_false.lane[i];
+	return result;
+#endif
+}
+
+// Lanes without their sign
+inline SimdFloat SimdAbs(SimdFloat a)
+{
+#if defined(SIMD_SSE)
+	return _mm_andnot_ps(_mm_set1_ps(-0.0f), a);
+#elif defined(SIMD_NEON)
+	return vabsq_f32(a);
+#else
+	SimdFloat result;
+	for (unsigned int i = 0; i < 4; i++)
+		result.lane[i] = a.lane[i] < 0.0f ? -a.lane[i] : a.lane[i];
+	return result;
+#endif
+}
+
+// (y, z, x, w) of (x, y, z, w), the rotation a cross product needs
+inline SimdFloat SimdRotateXyz(SimdFloat a)
+{
+#if defined(SIMD_SSE)
+	return _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 0, 2, 1));
+#elif defined(SIMD_NEON)
+	// (y, z, w, x) with the last two lanes swapped back
+	float32x4_t yzwx = vextq_f32(a, a, 1);
+	return vcopyq_laneq_f32(vcopyq_laneq_f32(yzwx, 2, a, 0), 3, a, 3);
+#else
+	return { { a.lane[1], a.lane[2], a.lane[0], a.lane[3] } };
+#endif
+}
+
+// Lane 0
+inline float SimdGetX(SimdFloat a)
+{
+#if defined(SIMD_SSE)
+	return _mm_cvtss_f32(a);
+#elif defined(SIMD_NEON)
+	return vgetq_lane_f32(a, 0);
+#else
+	return a.lane[0];
+#endif
+}
+
+// Bit i set when lane i of mask is set
+inline unsigned int SimdMaskBits(SimdMask mask)
+{
+#if defined(SIMD_SSE)
+	return (unsigned int)_mm_movemask_ps(mask);
+#elif defined(SIMD_NEON)
+	// NEON has no movemask, weight every lane with its bit and add them up
+	static const uint32_t lane_bits[4] = { 1, 2, 4, 8 };
+	return (unsigned int)vaddvq_u32(vandq_u32(mask, vld1q_u32(lane_bits)));
+#else
+	unsigned int bits = 0;
+	for (unsigned int i = 0; i < 4; i++)
+		bits |= (mask.lane[i] ? 1u : 0u) << i;
+	return bits;
+#endif
+}
+
+// Bit i set when a < b in lane i
+inline unsigned int SimdLessMask(SimdFloat a, SimdFloat b)
+{
+	return SimdMaskBits(SimdLess(a, b));
+}
+
+// Index of the lowest set bit, mask must not be 0
+inline unsigned int SimdFirstBit(uint32_t mask)
+{
+#if defined(_MSC_VER)
+	unsigned long index;
+	_BitScanForward(&index, mask);
+	return (unsigned int)index;
+#else
+	return (unsigned int)__builtin_ctz(mask);
+#endif
+}
+
+// Whether AVX instructions can run, checked once
+inline bool SimdCpuHasAvx()
+{
+#if defined(SIMD_AVX) && defined(_MSC_VER)
+	// the CPU has to support it and the OS has to save the wide registers on a context switch
+	static const bool has_avx = []()
+	{
+		int info[4];
+		__cpuid(info, 1);
+		bool osxsave = (info[2] & (1 << 27)) != 0;
+		bool avx = (info[2] & (1 << 28)) != 0;
+		return osxsave && avx && (_xgetbv(0) & 6) == 6;
+	}();
+	return has_avx;
+#elif defined(SIMD_AVX)
+	static const bool has_avx = __builtin_cpu_supports("avx");
+	return has_avx;
+#else
+	return false;
+#endif
+}
@@ -0,0 +1,142 @@
+#include "StagingBuffer.h"
+#include "GLCapabilities.h"
+#include "Renderer.h"
+
+#include <GL/glew.h>
+
+StagingBuffer::StagingBuffer(size_t capacity)
+	: renderer_id_(0), mapped_(nullptr), capacity_(capacity), allocator_((unsigned int)(capacity / ALIGNMENT)), outstanding_(0)
+{
+	const GLCapabilities& caps = GLCapabilities::Get();
+	if (!caps.buffer_storage)
+		return;
+
+	// coherent + persistent: the mapping stays valid while the GPU reads the buffer and writes from
+	// the workers are visible without flushing. Client storage asks for the memory to live on the CPU side.
+	GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	if (caps.direct_state_access)
+	{
+		GLCALL(glCreateBuffers(1, &renderer_id_));
+		GLCALL(glNamedBufferStorage(renderer_id_, capacity_, nullptr, flags | GL_CLIENT_STORAGE_BIT));
+		GLCALL(mapped_ = (unsigned char*)glMapNamedBufferRange(renderer_id_, 0, capacity_, flags));
+	}
+	else
+	{
+		GLCALL(glGenBuffers(1, &renderer_id_));
+		GLCALL(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, renderer_id_));
+		GLCALL(glBufferStorage(GL_PIXEL_UNPACK_BUFFER, capacity_, nullptr, flags | GL_CLIENT_STORAGE_BIT));
+		GLCALL(mapped_ = (unsigned char*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, capacity_, flags));
+		GLCALL(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0));
+	}
+}
+
+StagingBuffer::~StagingBuffer()
+{
+	for (PendingRelease& pending : pending_)
+	{
+		glDeleteSync(pending.fence);
+		for (const StagingAllocation& allocation : pending.allocations)
+			Free(allocation);
+	}
+
+	if (renderer_id_)
+	{
+		// deleting a buffer unmaps it
+		GLCALL(glDeleteBuffers(1, &renderer_id_));
+	}
+}
+
+StagingAllocation StagingBuffer::Allocate(size_t size)
+{
+	StagingAllocation allocation;
+	allocation.size = size;
+
+	unsigned int blocks = (unsigned int)((size + ALIGNMENT - 1) / ALIGNMENT);
+	if (mapped_ && blocks <= allocator_.GetCapacity())
+	{
+		std::unique_lock<std::mutex> lock(mutex_);
+		unsigned int block;
+		// while other allocations are alive the space will come back eventually, wait for it
+		while ((block = allocator_.Allocate(blocks)) == RangeAllocator::INVALID_OFFSET && outstanding_ > 0)
+			space_freed_.wait(lock);
+
+		if (block != RangeAllocator::INVALID_OFFSET)
+		{
+			outstanding_++;
+			allocation.offset = (size_t)block * ALIGNMENT;
+			allocation.memory = mapped_ + allocation.offset;
+			allocation.in_buffer = true;
+			return allocation;
+		}
+	}
+
+	allocation.memory = new unsigned char[size];
+	return allocation;
+}
+
+void StagingBuffer::Free(const StagingAllocation& allocation)
+{
+	if (!allocation.in_buffer)
+	{
+		delete[] allocation.memory;
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		allocator_.Free((unsigned int)(allocation.offset / ALIGNMENT), (unsigned int)((allocation.size + ALIGNMENT - 1) / ALIGNMENT));
+		outstanding_--;
+	}
+	space_freed_.notify_all();
+}
+
+void StagingBuffer::Release(const StagingAllocation& allocation)
+{
+	Free(allocation);
+}
+
+void StagingBuffer::ReleaseAfterUpload(std::vector<StagingAllocation> allocations)
+{
+	if (allocations.empty())
+		return;
+
+	// heap memory was copied by the driver during the upload call, only buffer ranges have to wait for the GPU
+	std::vector<StagingAllocation> in_buffer;
+	for (const StagingAllocation& allocation : allocations)
+	{
+		if (allocation.in_buffer)
+			in_buffer.push_back(allocation);
+		else
+			Free(allocation);
+	}
+
+	if (!in_buffer.empty())
+	{
+		GLCALL(GLsync fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+		pending_.push_back({ fence, std::move(in_buffer) });
+	}
+}
+
+void StagingBuffer::Collect()
+{
+	while (!pending_.empty())
+	{
+		GLenum state = glClientWaitSync(pending_.front().fence, 0, 0);
+		if (state != GL_ALREADY_SIGNALED && state != GL_CONDITION_SATISFIED)
+			break;
+		glDeleteSync(pending_.front().fence);
+		for (const StagingAllocation& allocation : pending_.front().allocations)
+			Free(allocation);
+		pending_.pop_front();
+	}
+}
+
+void StagingBuffer::BindForUpload() const
+{
+	GLCALL(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, renderer_id_));
+}
+
+void StagingBuffer::UnbindForUpload() const
+{
+	GLCALL(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0));
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+#include "RangeAllocator.h"
+
+typedef struct __GLsync* GLsync;
+
+// Memory a worker thread writes pixels into before they are uploaded
+struct StagingAllocation
+{
+	unsigned char* memory = nullptr;
+	size_t offset = 0;      // offset in the staging pixel unpack buffer, when in_buffer is set
+	size_t size = 0;
+	bool in_buffer = false; // false: plain heap memory, uploaded from client memory
+};
+
+// Persistently mapped GL_PIXEL_UNPACK_BUFFER that worker threads decode straight into. Uploads then come
+// from GPU visible (pinned) memory, so the driver doesn't make its own copy and the transfer can be asynchronous.
+// A range is reused only after the fence of the upload that read it has signaled.
+// Without ARB_buffer_storage, or for images bigger than the whole buffer, allocations come from the heap instead.
+class StagingBuffer
+{
+private:
+	struct PendingRelease
+	{
+		GLsync fence;
+		std::vector<StagingAllocation> allocations;
+	};
+
+	unsigned int renderer_id_;
+	unsigned char* mapped_;
+	size_t capacity_;
+	RangeAllocator allocator_;
+	unsigned int outstanding_;
+	std::mutex mutex_;
+	std::condition_variable space_freed_;
+	std::deque<PendingRelease> pending_;
+
+	void Free(const StagingAllocation& allocation);
+
+public:
+	static const size_t ALIGNMENT = 256;
+
+	// Has to be created on the render thread
+	explicit StagingBuffer(size_t capacity);
+	~StagingBuffer();
+
+	StagingBuffer(const StagingBuffer&) = delete;
+	StagingBuffer& operator=(const StagingBuffer&) = delete;
+
+	// Any thread. Waits for the render thread to recycle space when the buffer is full.
+	StagingAllocation Allocate(size_t size);
+
+	// Any thread. Give back memory the GPU never read from (failed decodes, heap allocations after upload)
+	void Release(const StagingAllocation& allocation);
+
+	// Render thread, after issuing uploads that read from these allocations
+	void ReleaseAfterUpload(std::vector<StagingAllocation> allocations);
+
+	// Render thread, recycle the ranges whose uploads are finished on the GPU
+	void Collect();
+
+	// Bind/unbind as GL_PIXEL_UNPACK_BUFFER, texture uploads then take offsets instead of pointers
+	void BindForUpload() const;
+	void UnbindForUpload() const;
+
+	inline bool IsPersistent() const { return mapped_ != nullptr; }
+};
@@ -0,0 +1,249 @@
+#include "Texture.h"
+#include "GLCapabilities.h"
+#include "DeletionQueue.h"
+#include "GLStateCache.h"
+#include "Renderer.h"
+
+#include <GL/glew.h>
+#include <utility>
+
+// Format/type to pass along with an internal format when allocating mutable storage with glTexImage2D
+static void GetAllocationFormat(unsigned int internal_format, unsigned int& format, unsigned int& type)
+{
+	switch (internal_format)
+	{
+		case GL_DEPTH_COMPONENT16:
+		case GL_DEPTH_COMPONENT24:
+		case GL_DEPTH_COMPONENT32:
+			format = GL_DEPTH_COMPONENT; type = GL_UNSIGNED_INT; return;
+		case GL_DEPTH_COMPONENT32F:
+			format = GL_DEPTH_COMPONENT; type = GL_FLOAT; return;
+		case GL_DEPTH24_STENCIL8:
+			format = GL_DEPTH_STENCIL; type = GL_UNSIGNED_INT_24_8; return;
+		case GL_R8:
+		case GL_R16F:
+		case GL_R32F:
+			format = GL_RED; type = GL_FLOAT; return;
+		case GL_RG8:
+		case GL_RG16F:
+		case GL_RG32F:
+			format = GL_RG; type = GL_FLOAT; return;
+		case GL_R11F_G11F_B10F:
+		case GL_RGB8:
+		case GL_RGB16F:
+			format = GL_RGB; type = GL_FLOAT; return;
+	}
+	format = GL_RGBA;
+	type = GL_UNSIGNED_BYTE;
+}
+
+unsigned int Texture::CountMipLevels(unsigned int width, unsigned int height)
+{
+	unsigned int levels = 1;
+	unsigned int size = width > height ? width : height;
+	while (size > 1)
+	{
+		size /= 2;
+		levels++;
+	}
+	return levels;
+}
+
+void Texture::Allocate()
+{
+	const GLCapabilities& caps = GLCapabilities::Get();
+
+	if (caps.direct_state_access)
+	{
+		GLCALL(glCreateTextures(GL_TEXTURE_2D, 1, &renderer_id_));
+		GLCALL(glTextureStorage2D(renderer_id_, levels_, internal_format_, width_, height_));
+	}
+	else
+	{
+		GLCALL(glGenTextures(1, &renderer_id_));
+		Bind(0);
+		if (caps.texture_storage)
+		{
+			// immutable storage: size and format can't change later, so the driver never has to re-validate the texture
+			GLCALL(glTexStorage2D(GL_TEXTURE_2D, levels_, internal_format_, width_, height_));
+		}
+		else
+		{
+			// GL 3.3 without the extension, allocate every level by hand and cap the chain so the texture is complete
+			unsigned int width = width_;
+			unsigned int height = height_;
+			for (unsigned int level = 0; level < levels_; level++)
+			{
+				if (GetCompressedBlockSize(internal_format_))
+				{
+					GLsizei size = ((width + 3) / 4) * ((height + 3) / 4) * GetCompressedBlockSize(internal_format_);
+					GLCALL(glCompressedTexImage2D(GL_TEXTURE_2D, level, internal_format_, width, height, 0, size, nullptr));
+				}
+				else
+				{
+					unsigned int format, type;
+					GetAllocationFormat(internal_format_, format, type);
+					GLCALL(glTexImage2D(GL_TEXTURE_2D, level, internal_format_, width, height, 0, format, type, nullptr));
+				}
+				width = width > 1 ? width / 2 : 1;
+				height = height > 1 ? height / 2 : 1;
+			}
+			GLCALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels_ - 1));
+		}
+	}
+
+	SetFilter(levels_ > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR, GL_LINEAR);
+	SetWrap(GL_REPEAT, GL_REPEAT);
+}
+
+Texture::Texture(unsigned int width, unsigned int height, unsigned int internal_format, unsigned int levels)
+	: renderer_id_(0), width_(width), height_(height), levels_(levels), internal_format_(internal_format)
+{
+	Allocate();
+}
+
+Texture::Texture(unsigned int width, unsigned int height, const void* rgba_pixels, bool generate_mipmaps)
+	: renderer_id_(0), width_(width), height_(height), levels_(generate_mipmaps ? CountMipLevels(width, height) : 1),
+	internal_format_(GL_RGBA8)
+{
+	Allocate();
+	SubImage(0, 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, rgba_pixels);
+	if (levels_ > 1)
+		GenerateMipmaps();
+}
+
+Texture::Texture(const TextureImage& image, bool generate_mipmaps)
+	: renderer_id_(0), width_(0), height_(0), levels_(0), internal_format_(image.internal_format)
+{
+	ASSERT(!image.levels.empty());
+
+	width_ = image.levels[0].width;
+	height_ = image.levels[0].height;
+	levels_ = (unsigned int)image.levels.size();
+
+	// compressed formats can't be rendered to, so glGenerateMipmap doesn't work on them, they keep what the file has
+	bool generate = generate_mipmaps && levels_ == 1 && !image.compressed;
+	if (generate)
+		levels_ = CountMipLevels(width_, height_);
+
+	Allocate();
+	Upload(image);
+}
+
+Texture::~Texture()
+{
+	if (renderer_id_ == 0)
+		return;
+	GLStateCache::ForgetTexture(renderer_id_);
+	GLCALL(glDeleteTextures(1, &renderer_id_));
+}
+
+Texture::Texture(Texture&& other) noexcept
+	: renderer_id_(std::exchange(other.renderer_id_, 0)), width_(other.width_), height_(other.height_),
+	levels_(other.levels_), internal_format_(other.internal_format_)
+{
+}
+
+Texture& Texture::operator=(Texture&& other) noexcept
+{
+	// the old objects go with other when it is destroyed
+	std::swap(renderer_id_, other.renderer_id_);
+	std::swap(width_, other.width_);
+	std::swap(height_, other.height_);
+	std::swap(levels_, other.levels_);
+	std::swap(internal_format_, other.internal_format_);
+	return *this;
+}
+
+void Texture::Release(DeletionQueue& queue)
+{
+	queue.Delete(GLObjectType::TEXTURE, std::exchange(renderer_id_, 0));
+}
+
+void Texture::Upload(const TextureImage& image)
+{
+	ASSERT(!image.levels.empty() && image.levels.size() <= levels_);
+
+	for (unsigned int level = 0; level < image.levels.size(); level++)
+		UploadLevel(level, image.levels[level], image);
+
+	if (image.levels.size() == 1 && levels_ > 1 && !image.compressed)
+		GenerateMipmaps();
+}
+
+void Texture::UploadLevel(unsigned int level, const TextureLevel& data, const TextureImage& image)
+{
+	if (!image.compressed)
+	{
+		SubImage(level, 0, 0, data.width, data.height, image.format, image.type, data.data);
+		return;
+	}
+
+	// compressed blocks go to the driver exactly as they are stored in the file
+	if (GLCapabilities::Get().direct_state_access)
+	{
+		GLCALL(glCompressedTextureSubImage2D(renderer_id_, level, 0, 0, data.width, data.height,
+			image.internal_format, (GLsizei)data.size, data.data));
+		return;
+	}
+	Bind(0);
+	GLCALL(glCompressedTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, data.width, data.height,
+		image.internal_format, (GLsizei)data.size, data.data));
+}
+
+void Texture::SubImage(unsigned int level, unsigned int x, unsigned int y, unsigned int width, unsigned int height,
+	unsigned int format, unsigned int type, const void* pixels)
+{
+	// rows are tightly packed in memory, the default alignment of 4 would skew 1/2/3 byte per pixel formats
+	GLCALL(glPixelStorei(GL_UNPACK_ALIGNMENT, 1));
+
+	if (GLCapabilities::Get().direct_state_access)
+	{
+		GLCALL(glTextureSubImage2D(renderer_id_, level, x, y, width, height, format, type, pixels));
+		return;
+	}
+	Bind(0);
+	GLCALL(glTexSubImage2D(GL_TEXTURE_2D, level, x, y, width, height, format, type, pixels));
+}
+
+void Texture::GenerateMipmaps()
+{
+	if (GLCapabilities::Get().direct_state_access)
+	{
+		GLCALL(glGenerateTextureMipmap(renderer_id_));
+		return;
+	}
+	Bind(0);
+	GLCALL(glGenerateMipmap(GL_TEXTURE_2D));
+}
+
+void Texture::SetFilter(unsigned int min_filter, unsigned int mag_filter)
+{
+	if (GLCapabilities::Get().direct_state_access)
+	{
+		GLCALL(glTextureParameteri(renderer_id_, GL_TEXTURE_MIN_FILTER, min_filter));
+		GLCALL(glTextureParameteri(renderer_id_, GL_TEXTURE_MAG_FILTER, mag_filter));
+		return;
+	}
+	Bind(0);
+	GLCALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, min_filter));
+	GLCALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, mag_filter));
+}
+
+void Texture::SetWrap(unsigned int wrap_s, unsigned int wrap_t)
+{
+	if (GLCapabilities::Get().direct_state_access)
+	{
+		GLCALL(glTextureParameteri(renderer_id_, GL_TEXTURE_WRAP_S, wrap_s));
+		GLCALL(glTextureParameteri(renderer_id_, GL_TEXTURE_WRAP_T, wrap_t));
+		return;
+	}
+	Bind(0);
+	GLCALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrap_s));
+	GLCALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrap_t));
+}
+
+void Texture::Bind(unsigned int slot) const
+{
+	GLStateCache::BindTexture(slot, GL_TEXTURE_2D, renderer_id_);
+}
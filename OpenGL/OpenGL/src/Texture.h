@@ -0,0 +1,70 @@
+#pragma once
+
+#include "TextureFile.h"
+
+class DeletionQueue;
+
+class Texture
+{
+private:
+	unsigned int renderer_id_;
+	unsigned int width_;
+	unsigned int height_;
+	unsigned int levels_;
+	unsigned int internal_format_;
+
+	// Create the texture object and give it storage for all levels
+	void Allocate();
+
+	void UploadLevel(unsigned int level, const TextureLevel& data, const TextureImage& image);
+
+public:
+	// Empty texture with storage for levels mips (render targets, atlases filled later...)
+	Texture(unsigned int width, unsigned int height, unsigned int internal_format, unsigned int levels = 1);
+
+	// RGBA8 pixels, the rest of the mip chain is generated on the GPU if asked for
+	Texture(unsigned int width, unsigned int height, const void* rgba_pixels, bool generate_mipmaps = true);
+
+	// Image from a TextureFile. Mips stored in the file are uploaded as they are, an uncompressed
+	// image without mips gets them generated on the GPU. Compressed data is never decompressed.
+	explicit Texture(const TextureImage& image, bool generate_mipmaps = true);
+
+	~Texture();
+
+	// Movable so textures can live by value in a HandlePool, the moved from one owns nothing
+	Texture(Texture&& other) noexcept;
+	Texture& operator=(Texture&& other) noexcept;
+	Texture(const Texture&) = delete;
+	Texture& operator=(const Texture&) = delete;
+
+	// Hand the GL object to queue to be deleted once the GPU is done with it, this owns nothing afterwards
+	void Release(DeletionQueue& queue);
+
+	// Bind to a texture unit, through the state cache so binding an already bound texture is free
+	void Bind(unsigned int slot = 0) const;
+
+	// Upload every level of image, which has to match the size and format of the texture. If the image
+	// only has the first level and the texture has more, the rest are generated on the GPU.
+	// Level data can also be offsets into a bound GL_PIXEL_UNPACK_BUFFER.
+	void Upload(const TextureImage& image);
+
+	// Overwrite a rectangle of one level with uncompressed pixels
+	void SubImage(unsigned int level, unsigned int x, unsigned int y, unsigned int width, unsigned int height,
+		unsigned int format, unsigned int type, const void* pixels);
+
+	// Regenerate every level below the first one from it
+	void GenerateMipmaps();
+
+	// Sampling state, filters/wrap modes are the GL enums
+	void SetFilter(unsigned int min_filter, unsigned int mag_filter);
+	void SetWrap(unsigned int wrap_s, unsigned int wrap_t);
+
+	inline unsigned int GetRendererId() const { return renderer_id_; }
+	inline unsigned int GetWidth() const { return width_; }
+	inline unsigned int GetHeight() const { return height_; }
+	inline unsigned int GetLevels() const { return levels_; }
+	inline unsigned int GetInternalFormat() const { return internal_format_; }
+
+	// Number of levels in a full mip chain down to 1x1
+	static unsigned int CountMipLevels(unsigned int width, unsigned int height);
+};
@@ -0,0 +1,93 @@
+#include "TextureArray.h"
+#include "GLCapabilities.h"
+#include "GLStateCache.h"
+#include "Renderer.h"
+
+#include <GL/glew.h>
+
+TextureArray::TextureArray(unsigned int width, unsigned int height, unsigned int layers, unsigned int internal_format, unsigned int levels)
+	: renderer_id_(0), width_(width), height_(height), layers_(layers), levels_(levels), internal_format_(internal_format)
+{
+	const GLCapabilities& caps = GLCapabilities::Get();
+
+	if (caps.direct_state_access)
+	{
+		GLCALL(glCreateTextures(GL_TEXTURE_2D_ARRAY, 1, &renderer_id_));
+		GLCALL(glTextureStorage3D(renderer_id_, levels_, internal_format_, width_, height_, layers_));
+	}
+	else
+	{
+		GLCALL(glGenTextures(1, &renderer_id_));
+		Bind(0);
+		if (caps.texture_storage)
+		{
+			GLCALL(glTexStorage3D(GL_TEXTURE_2D_ARRAY, levels_, internal_format_, width_, height_, layers_));
+		}
+		else
+		{
+			// every level of an array texture keeps the full layer count, only width/height shrink
+			unsigned int level_width = width_;
+			unsigned int level_height = height_;
+			for (unsigned int level = 0; level < levels_; level++)
+			{
+				GLCALL(glTexImage3D(GL_TEXTURE_2D_ARRAY, level, internal_format_, level_width, level_height, layers_, 0,
+					GL_RGBA, GL_UNSIGNED_BYTE, nullptr));
+				level_width = level_width > 1 ? level_width / 2 : 1;
+				level_height = level_height > 1 ? level_height / 2 : 1;
+			}
+			GLCALL(glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, levels_ - 1));
+		}
+	}
+
+	SetFilter(levels_ > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR, GL_LINEAR);
+}
+
+TextureArray::~TextureArray()
+{
+	GLStateCache::ForgetTexture(renderer_id_);
+	GLCALL(glDeleteTextures(1, &renderer_id_));
+}
+
+void TextureArray::Bind(unsigned int slot) const
+{
+	GLStateCache::BindTexture(slot, GL_TEXTURE_2D_ARRAY, renderer_id_);
+}
+
+void TextureArray::SubImage(unsigned int layer, unsigned int level, unsigned int x, unsigned int y, unsigned int width, unsigned int height,
+	unsigned int format, unsigned int type, const void* pixels)
+{
+	ASSERT(layer < layers_ && level < levels_);
+	GLCALL(glPixelStorei(GL_UNPACK_ALIGNMENT, 1));
+
+	if (GLCapabilities::Get().direct_state_access)
+	{
+		GLCALL(glTextureSubImage3D(renderer_id_, level, x, y, layer, width, height, 1, format, type, pixels));
+		return;
+	}
+	Bind(0);
+	GLCALL(glTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, x, y, layer, width, height, 1, format, type, pixels));
+}
+
+void TextureArray::GenerateMipmaps()
+{
+	if (GLCapabilities::Get().direct_state_access)
+	{
+		GLCALL(glGenerateTextureMipmap(renderer_id_));
+		return;
+	}
+	Bind(0);
+	GLCALL(glGenerateMipmap(GL_TEXTURE_2D_ARRAY));
+}
+
+void TextureArray::SetFilter(unsigned int min_filter, unsigned int mag_filter)
+{
+	if (GLCapabilities::Get().direct_state_access)
+	{
+		GLCALL(glTextureParameteri(renderer_id_, GL_TEXTURE_MIN_FILTER, min_filter));
+		GLCALL(glTextureParameteri(renderer_id_, GL_TEXTURE_MAG_FILTER, mag_filter));
+		return;
+	}
+	Bind(0);
+	GLCALL(glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, min_filter));
+	GLCALL(glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, mag_filter));
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+// GL_TEXTURE_2D_ARRAY: layers of the same size and format behind one binding. Draws that use different
+// layers only differ by an index (vertex attribute, uniform...) and can be batched together.
+class TextureArray
+{
+private:
+	unsigned int renderer_id_;
+	unsigned int width_;
+	unsigned int height_;
+	unsigned int layers_;
+	unsigned int levels_;
+	unsigned int internal_format_;
+
+public:
+	TextureArray(unsigned int width, unsigned int height, unsigned int layers, unsigned int internal_format, unsigned int levels = 1);
+	~TextureArray();
+
+	TextureArray(const TextureArray&) = delete;
+	TextureArray& operator=(const TextureArray&) = delete;
+
+	// Bind to a texture unit through the state cache
+	void Bind(unsigned int slot = 0) const;
+
+	// Overwrite a rectangle of one level of one layer with uncompressed pixels
+	void SubImage(unsigned int layer, unsigned int level, unsigned int x, unsigned int y, unsigned int width, unsigned int height,
+		unsigned int format, unsigned int type, const void* pixels);
+
+	// Regenerate the lower levels of every layer from the first level
+	void GenerateMipmaps();
+
+	void SetFilter(unsigned int min_filter, unsigned int mag_filter);
+
+	inline unsigned int GetRendererId() const { return renderer_id_; }
+	inline unsigned int GetWidth() const { return width_; }
+	inline unsigned int GetHeight() const { return height_; }
+	inline unsigned int GetLayers() const { return layers_; }
+	inline unsigned int GetLevels() const { return levels_; }
+};
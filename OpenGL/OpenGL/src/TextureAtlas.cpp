@@ -0,0 +1,171 @@
+#include "TextureAtlas.h"
+#include "Texture.h"
+#include "Renderer.h"
+
+#include <GL/glew.h>
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+
+SkylinePacker::SkylinePacker(unsigned int width, unsigned int height)
+	: width_(width), height_(height)
+{
+	Reset();
+}
+
+void SkylinePacker::Reset()
+{
+	skyline_.clear();
+	skyline_.push_back({ 0, 0, width_ });
+}
+
+bool SkylinePacker::Fits(size_t index, unsigned int width, unsigned int height, unsigned int& y) const
+{
+	unsigned int x = skyline_[index].x;
+	if (x + width > width_)
+		return false;
+
+	// the rectangle rests on the highest segment under it
+	y = 0;
+	unsigned int remaining = width;
+	for (size_t i = index; remaining > 0; i++)
+	{
+		y = std::max(y, skyline_[i].y);
+		if (y + height > height_)
+			return false;
+		remaining -= std::min(remaining, skyline_[i].width);
+	}
+	return true;
+}
+
+bool SkylinePacker::Pack(unsigned int width, unsigned int height, unsigned int& x, unsigned int& y)
+{
+	size_t best_index = skyline_.size();
+	unsigned int best_top = UINT_MAX;
+	unsigned int best_width = UINT_MAX;
+
+	for (size_t i = 0; i < skyline_.size(); i++)
+	{
+		unsigned int fit_y;
+		if (!Fits(i, width, height, fit_y))
+			continue;
+
+		// lowest top edge wins, on a tie the narrower segment so wide gaps stay open for wide images
+		if (fit_y + height < best_top || (fit_y + height == best_top && skyline_[i].width < best_width))
+		{
+			best_index = i;
+			best_top = fit_y + height;
+			best_width = skyline_[i].width;
+		}
+	}
+
+	if (best_index == skyline_.size())
+		return false;
+
+	x = skyline_[best_index].x;
+	y = best_top - height;
+
+	// the rectangle's top becomes a new segment, the segments under it get cut away
+	skyline_.insert(skyline_.begin() + best_index, { x, best_top, width });
+	unsigned int right = x + width;
+	size_t next = best_index + 1;
+	while (next < skyline_.size() && skyline_[next].x < right)
+	{
+		unsigned int overlap = right - skyline_[next].x;
+		if (skyline_[next].width <= overlap)
+		{
+			skyline_.erase(skyline_.begin() + next);
+			continue;
+		}
+		skyline_[next].x += overlap;
+		skyline_[next].width -= overlap;
+		break;
+	}
+
+	// neighbours at the same height are one segment
+	for (size_t i = 0; i + 1 < skyline_.size();)
+	{
+		if (skyline_[i].y == skyline_[i + 1].y)
+		{
+			skyline_[i].width += skyline_[i + 1].width;
+			skyline_.erase(skyline_.begin() + i + 1);
+		}
+		else
+		{
+			i++;
+		}
+	}
+	return true;
+}
+
+TextureAtlas::TextureAtlas(unsigned int page_size, unsigned int page_count, unsigned int padding, bool mipmaps)
+	: pages_(page_size, page_size, page_count, GL_RGBA8, mipmaps ? Texture::CountMipLevels(page_size, page_size) : 1),
+	padding_(padding), mipmaps_dirty_(false)
+{
+	packers_.assign(page_count, SkylinePacker(page_size, page_size));
+}
+
+bool TextureAtlas::Add(unsigned int width, unsigned int height, const void* rgba_pixels, AtlasRegion& region)
+{
+	// there is no edge pixel to repeat into the padding of an empty image
+	if (width == 0 || height == 0)
+		return false;
+
+	unsigned int padded_width = width + padding_ * 2;
+	unsigned int padded_height = height + padding_ * 2;
+
+	unsigned int x = 0, y = 0;
+	unsigned int layer = 0;
+	while (layer < packers_.size() && !packers_[layer].Pack(padded_width, padded_height, x, y))
+		layer++;
+	if (layer == packers_.size())
+		return false;
+
+	// copy the image with its edge pixels repeated into the padding, then upload it in one go
+	const unsigned char* source = (const unsigned char*)rgba_pixels;
+	padded_.resize((size_t)padded_width * padded_height * 4);
+	for (unsigned int row = 0; row < padded_height; row++)
+	{
+		unsigned int source_row = std::min(row > padding_ ? row - padding_ : 0, height - 1);
+		for (unsigned int column = 0; column < padded_width; column++)
+		{
+			unsigned int source_column = std::min(column > padding_ ? column - padding_ : 0, width - 1);
+			std::memcpy(&padded_[((size_t)row * padded_width + column) * 4], &source[((size_t)source_row * width + source_column) * 4], 4);
+		}
+	}
+	pages_.SubImage(layer, 0, x, y, padded_width, padded_height, GL_RGBA, GL_UNSIGNED_BYTE, padded_.data());
+	mipmaps_dirty_ = pages_.GetLevels() > 1;
+
+	float page_width = (float)pages_.GetWidth();
+	float page_height = (float)pages_.GetHeight();
+	region.layer = layer;
+	region.x = x + padding_;
+	region.y = y + padding_;
+	region.width = width;
+	region.height = height;
+	region.u0 = region.x / page_width;
+	region.v0 = region.y / page_height;
+	region.u1 = (region.x + width) / page_width;
+	region.v1 = (region.y + height) / page_height;
+	return true;
+}
+
+void TextureAtlas::Update()
+{
+	if (!mipmaps_dirty_)
+		return;
+	pages_.GenerateMipmaps();
+	mipmaps_dirty_ = false;
+}
+
+void TextureAtlas::Reset()
+{
+	for (SkylinePacker& packer : packers_)
+		packer.Reset();
+}
+
+void TextureAtlas::Bind(unsigned int slot) const
+{
+	pages_.Bind(slot);
+}
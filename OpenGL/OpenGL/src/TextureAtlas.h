@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "TextureArray.h"
+
+// Where an image ended up in a TextureAtlas, the layer goes to the shader along with the uvs
+struct AtlasRegion
+{
+	unsigned int layer;
+	unsigned int x, y, width, height;
+	float u0, v0, u1, v1;
+};
+
+// Skyline bottom-left rectangle packer. The skyline is the top edge of everything packed so far,
+// stored as horizontal segments; a rectangle goes where its top ends up lowest.
+class SkylinePacker
+{
+private:
+	struct Segment
+	{
+		unsigned int x;
+		unsigned int y;
+		unsigned int width;
+	};
+
+	unsigned int width_;
+	unsigned int height_;
+	std::vector<Segment> skyline_;
+
+	// y a width x height rectangle would sit at when its left edge is at segment index, false if it doesn't fit there
+	bool Fits(size_t index, unsigned int width, unsigned int height, unsigned int& y) const;
+
+public:
+	SkylinePacker(unsigned int width, unsigned int height);
+
+	// Find a spot for the rectangle, false if the area is too full
+	bool Pack(unsigned int width, unsigned int height, unsigned int& x, unsigned int& y);
+
+	void Reset();
+};
+
+// Packs many small RGBA8 images into the layers of one texture array at runtime, so sprites with different
+// images can be drawn in one batch and only differ by their uvs and layer.
+class TextureAtlas
+{
+private:
+	TextureArray pages_;
+	std::vector<SkylinePacker> packers_;
+	std::vector<unsigned char> padded_;
+	unsigned int padding_;
+	bool mipmaps_dirty_;
+
+public:
+	// padding is the border repeated around every image so linear filtering doesn't bleed the neighbours in
+	TextureAtlas(unsigned int page_size, unsigned int page_count, unsigned int padding = 1, bool mipmaps = true);
+
+	// Pack and upload an image, false if it is empty or no page has room left for it
+	bool Add(unsigned int width, unsigned int height, const void* rgba_pixels, AtlasRegion& region);
+
+	// Regenerate the mips if images were added since the last call, do it once after a batch of Add()
+	void Update();
+
+	// Forget every image, the pixels stay in the texture until they are overwritten
+	void Reset();
+
+	void Bind(unsigned int slot = 0) const;
+
+	inline const TextureArray& GetPages() const { return pages_; }
+};
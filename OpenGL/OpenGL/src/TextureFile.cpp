@@ -0,0 +1,450 @@
+#include "TextureFile.h"
+#include "GLCapabilities.h"
+#include "Texture.h"
+
+#include <GL/glew.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+unsigned int GetCompressedBlockSize(unsigned int internal_format)
+{
+	switch (internal_format)
+	{
+		case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+		case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT:
+		case GL_COMPRESSED_SRGB_S3TC_DXT1_EXT:
+		case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT:
+		case GL_COMPRESSED_RED_RGTC1:
+		case GL_COMPRESSED_SIGNED_RED_RGTC1:
+		case GL_COMPRESSED_RGB8_ETC2:
+		case GL_COMPRESSED_SRGB8_ETC2:
+		case GL_COMPRESSED_RGB8_PUNCHTHROUGH_ALPHA1_ETC2:
+		case GL_COMPRESSED_SRGB8_PUNCHTHROUGH_ALPHA1_ETC2:
+			return 8;
+		case GL_COMPRESSED_RGBA_S3TC_DXT3_EXT:
+		case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+		case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT:
+		case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT:
+		case GL_COMPRESSED_RG_RGTC2:
+		case GL_COMPRESSED_SIGNED_RG_RGTC2:
+		case GL_COMPRESSED_RGBA_BPTC_UNORM:
+		case GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM:
+		case GL_COMPRESSED_RGB_BPTC_SIGNED_FLOAT:
+		case GL_COMPRESSED_RGB_BPTC_UNSIGNED_FLOAT:
+		case GL_COMPRESSED_RGBA8_ETC2_EAC:
+		case GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC:
+			return 16;
+	}
+	return 0;
+}
+
+bool IsCompressedFormatSupported(unsigned int internal_format)
+{
+	const GLCapabilities& caps = GLCapabilities::Get();
+	switch (internal_format)
+	{
+		case GL_COMPRESSED_RED_RGTC1:
+		case GL_COMPRESSED_SIGNED_RED_RGTC1:
+		case GL_COMPRESSED_RG_RGTC2:
+		case GL_COMPRESSED_SIGNED_RG_RGTC2:
+			return caps.compression_rgtc;
+		case GL_COMPRESSED_RGBA_BPTC_UNORM:
+		case GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM:
+		case GL_COMPRESSED_RGB_BPTC_SIGNED_FLOAT:
+		case GL_COMPRESSED_RGB_BPTC_UNSIGNED_FLOAT:
+			return caps.compression_bptc;
+		case GL_COMPRESSED_RGB8_ETC2:
+		case GL_COMPRESSED_SRGB8_ETC2:
+		case GL_COMPRESSED_RGB8_PUNCHTHROUGH_ALPHA1_ETC2:
+		case GL_COMPRESSED_SRGB8_PUNCHTHROUGH_ALPHA1_ETC2:
+		case GL_COMPRESSED_RGBA8_ETC2_EAC:
+		case GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC:
+			return caps.compression_etc2;
+	}
+	// everything else with a block size is S3TC
+	return GetCompressedBlockSize(internal_format) != 0 && caps.compression_s3tc;
+}
+
+// Bytes a level takes up, compressed levels are stored as whole 4x4 blocks
+static size_t GetLevelSize(const TextureImage& image, unsigned int width, unsigned int height, unsigned int pixel_size)
+{
+	if (image.compressed)
+		return (size_t)((width + 3) / 4) * ((height + 3) / 4) * GetCompressedBlockSize(image.internal_format);
+	return (size_t)width * height * pixel_size;
+}
+
+// The uncompressed formats both containers can hold: internal format, format, type and bytes per pixel
+struct UncompressedFormat
+{
+	unsigned int internal_format;
+	unsigned int format;
+	unsigned int type;
+	unsigned int pixel_size;
+};
+
+static const UncompressedFormat RGBA8 = { GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, 4 };
+static const UncompressedFormat BGRA8 = { GL_RGBA8, GL_BGRA, GL_UNSIGNED_BYTE, 4 };
+static const UncompressedFormat SRGB8_ALPHA8 = { GL_SRGB8_ALPHA8, GL_RGBA, GL_UNSIGNED_BYTE, 4 };
+static const UncompressedFormat R8 = { GL_R8, GL_RED, GL_UNSIGNED_BYTE, 1 };
+static const UncompressedFormat RG8 = { GL_RG8, GL_RG, GL_UNSIGNED_BYTE, 2 };
+static const UncompressedFormat RGBA16F = { GL_RGBA16F, GL_RGBA, GL_HALF_FLOAT, 8 };
+static const UncompressedFormat RGBA32F = { GL_RGBA32F, GL_RGBA, GL_FLOAT, 16 };
+
+static void SetUncompressed(TextureImage& image, const UncompressedFormat& format)
+{
+	image.internal_format = format.internal_format;
+	image.format = format.format;
+	image.type = format.type;
+	image.compressed = false;
+}
+
+// Fill in levels laid out back to back from data, largest first (how DDS stores them)
+static bool AddPackedLevels(TextureImage& image, const char* data, size_t size, unsigned int width, unsigned int height,
+	unsigned int level_count, unsigned int pixel_size)
+{
+	size_t offset = 0;
+	for (unsigned int level = 0; level < level_count && width && height; level++)
+	{
+		size_t level_size = GetLevelSize(image, width, height, pixel_size);
+		if (offset + level_size > size)
+			return false;
+		image.levels.push_back({ width, height, data + offset, level_size });
+		offset += level_size;
+		width = width > 1 ? width / 2 : 1;
+		height = height > 1 ? height / 2 : 1;
+	}
+	return !image.levels.empty();
+}
+
+bool TextureFile::Open(const std::string& path)
+{
+	image_ = TextureImage();
+
+	if (!file_.Open(path))
+	{
+		std::cerr << "Error opening the texture file " << path << std::endl;
+		return false;
+	}
+
+	static const unsigned char KTX2_IDENTIFIER[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+	const char* data = (const char*)file_.GetData();
+	bool ok;
+	if (file_.GetSize() >= 4 && std::memcmp(data, "DDS ", 4) == 0)
+		ok = ParseDds(path);
+	else if (file_.GetSize() >= sizeof(KTX2_IDENTIFIER) && std::memcmp(data, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) == 0)
+		ok = ParseKtx2(path);
+	else
+	{
+		std::cerr << "Unknown texture container (only DDS and KTX2 are supported): " << path << std::endl;
+		ok = false;
+	}
+
+	if (ok && image_.compressed && !IsCompressedFormatSupported(image_.internal_format))
+	{
+		// by design there is no CPU decompression fallback, convert the asset for this platform instead
+		std::cerr << "The driver doesn't support the compressed format of " << path << std::endl;
+		ok = false;
+	}
+
+	if (!ok)
+	{
+		image_ = TextureImage();
+		file_.Close();
+	}
+	return ok;
+}
+
+// DDS (https://learn.microsoft.com/en-us/windows/win32/direct3ddds/dds-header)
+
+struct DdsPixelFormat
+{
+	uint32_t size;
+	uint32_t flags;
+	uint32_t four_cc;
+	uint32_t rgb_bit_count;
+	uint32_t r_mask;
+	uint32_t g_mask;
+	uint32_t b_mask;
+	uint32_t a_mask;
+};
+
+struct DdsHeader
+{
+	uint32_t size;
+	uint32_t flags;
+	uint32_t height;
+	uint32_t width;
+	uint32_t pitch_or_linear_size;
+	uint32_t depth;
+	uint32_t mip_map_count;
+	uint32_t reserved1[11];
+	DdsPixelFormat pixel_format;
+	uint32_t caps;
+	uint32_t caps2;
+	uint32_t caps3;
+	uint32_t caps4;
+	uint32_t reserved2;
+};
+
+struct DdsHeaderDx10
+{
+	uint32_t dxgi_format;
+	uint32_t resource_dimension;
+	uint32_t misc_flag;
+	uint32_t array_size;
+	uint32_t misc_flags2;
+};
+
+static constexpr uint32_t FourCC(char a, char b, char c, char d)
+{
+	return (uint32_t)a | ((uint32_t)b << 8) | ((uint32_t)c << 16) | ((uint32_t)d << 24);
+}
+
+static const uint32_t DDSD_MIPMAPCOUNT = 0x20000;
+static const uint32_t DDPF_FOURCC = 0x4;
+static const uint32_t DDPF_RGB = 0x40;
+static const uint32_t DDS_CUBEMAP = 0x200;
+static const uint32_t DDS_VOLUME = 0x200000;
+
+bool TextureFile::ParseDds(const std::string& path)
+{
+	const char* data = (const char*)file_.GetData();
+	size_t size = file_.GetSize();
+	if (size < 4 + sizeof(DdsHeader))
+	{
+		std::cerr << "Truncated DDS file: " << path << std::endl;
+		return false;
+	}
+
+	const DdsHeader* header = (const DdsHeader*)(data + 4);
+	size_t data_offset = 4 + sizeof(DdsHeader);
+	if (header->caps2 & (DDS_CUBEMAP | DDS_VOLUME))
+	{
+		std::cerr << "Only 2D DDS textures are supported: " << path << std::endl;
+		return false;
+	}
+
+	unsigned int pixel_size = 0;
+	const DdsPixelFormat& pf = header->pixel_format;
+	if ((pf.flags & DDPF_FOURCC) && pf.four_cc == FourCC('D', 'X', '1', '0'))
+	{
+		if (size < data_offset + sizeof(DdsHeaderDx10))
+		{
+			std::cerr << "Truncated DDS file: " << path << std::endl;
+			return false;
+		}
+		const DdsHeaderDx10* dx10 = (const DdsHeaderDx10*)(data + data_offset);
+		data_offset += sizeof(DdsHeaderDx10);
+		if (dx10->array_size > 1)
+		{
+			std::cerr << "DDS texture arrays are not supported: " << path << std::endl;
+			return false;
+		}
+
+		// DXGI_FORMAT values
+		image_.compressed = true;
+		switch (dx10->dxgi_format)
+		{
+			case 71: image_.internal_format = GL_COMPRESSED_RGBA_S3TC_DXT1_EXT; break;
+			case 72: image_.internal_format = GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT; break;
+			case 74: image_.internal_format = GL_COMPRESSED_RGBA_S3TC_DXT3_EXT; break;
+			case 75: image_.internal_format = GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT; break;
+			case 77: image_.internal_format = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT; break;
+			case 78: image_.internal_format = GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT; break;
+			case 80: image_.internal_format = GL_COMPRESSED_RED_RGTC1; break;
+			case 81: image_.internal_format = GL_COMPRESSED_SIGNED_RED_RGTC1; break;
+			case 83: image_.internal_format = GL_COMPRESSED_RG_RGTC2; break;
+			case 84: image_.internal_format = GL_COMPRESSED_SIGNED_RG_RGTC2; break;
+			case 95: image_.internal_format = GL_COMPRESSED_RGB_BPTC_UNSIGNED_FLOAT; break;
+			case 96: image_.internal_format = GL_COMPRESSED_RGB_BPTC_SIGNED_FLOAT; break;
+			case 98: image_.internal_format = GL_COMPRESSED_RGBA_BPTC_UNORM; break;
+			case 99: image_.internal_format = GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM; break;
+			case 28: SetUncompressed(image_, RGBA8); pixel_size = 4; break;
+			case 29: SetUncompressed(image_, SRGB8_ALPHA8); pixel_size = 4; break;
+			case 87: SetUncompressed(image_, BGRA8); pixel_size = 4; break;
+			case 10: SetUncompressed(image_, RGBA16F); pixel_size = 8; break;
+			case 2: SetUncompressed(image_, RGBA32F); pixel_size = 16; break;
+			default:
+				std::cerr << "Unsupported DXGI format " << dx10->dxgi_format << " in " << path << std::endl;
+				return false;
+		}
+	}
+	else if (pf.flags & DDPF_FOURCC)
+	{
+		image_.compressed = true;
+		switch (pf.four_cc)
+		{
+			case FourCC('D', 'X', 'T', '1'): image_.internal_format = GL_COMPRESSED_RGBA_S3TC_DXT1_EXT; break;
+			case FourCC('D', 'X', 'T', '3'): image_.internal_format = GL_COMPRESSED_RGBA_S3TC_DXT3_EXT; break;
+			case FourCC('D', 'X', 'T', '5'): image_.internal_format = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT; break;
+			case FourCC('A', 'T', 'I', '1'):
+			case FourCC('B', 'C', '4', 'U'): image_.internal_format = GL_COMPRESSED_RED_RGTC1; break;
+			case FourCC('A', 'T', 'I', '2'):
+			case FourCC('B', 'C', '5', 'U'): image_.internal_format = GL_COMPRESSED_RG_RGTC2; break;
+			default:
+				std::cerr << "Unsupported DDS FourCC in " << path << std::endl;
+				return false;
+		}
+	}
+	else if ((pf.flags & DDPF_RGB) && pf.rgb_bit_count == 32 && pf.g_mask == 0x0000FF00)
+	{
+		// the two 32 bit layouts that exist in practice, RGBA and BGRA
+		if (pf.r_mask == 0x000000FF)
+			SetUncompressed(image_, RGBA8);
+		else if (pf.r_mask == 0x00FF0000)
+			SetUncompressed(image_, BGRA8);
+		else
+		{
+			std::cerr << "Unsupported DDS pixel layout in " << path << std::endl;
+			return false;
+		}
+		pixel_size = 4;
+	}
+	else
+	{
+		std::cerr << "Unsupported DDS pixel format in " << path << std::endl;
+		return false;
+	}
+
+	// more levels than a full mip chain would make the texture storage call fail, and a huge count would
+	// overflow the size checks
+	unsigned int level_count = (header->flags & DDSD_MIPMAPCOUNT) && header->mip_map_count ? header->mip_map_count : 1;
+	level_count = std::min(level_count, Texture::CountMipLevels(header->width, header->height));
+	if (!AddPackedLevels(image_, data + data_offset, size - data_offset, header->width, header->height, level_count, pixel_size))
+	{
+		std::cerr << "Truncated DDS file: " << path << std::endl;
+		return false;
+	}
+	return true;
+}
+
+// KTX2 (https://registry.khronos.org/KTX/specs/2.0/ktxspec.v2.html)
+
+struct Ktx2Header
+{
+	unsigned char identifier[12];
+	uint32_t vk_format;
+	uint32_t type_size;
+	uint32_t pixel_width;
+	uint32_t pixel_height;
+	uint32_t pixel_depth;
+	uint32_t layer_count;
+	uint32_t face_count;
+	uint32_t level_count;
+	uint32_t supercompression_scheme;
+	uint32_t dfd_byte_offset;
+	uint32_t dfd_byte_length;
+	uint32_t kvd_byte_offset;
+	uint32_t kvd_byte_length;
+	uint64_t sgd_byte_offset;
+	uint64_t sgd_byte_length;
+};
+
+struct Ktx2LevelIndex
+{
+	uint64_t byte_offset;
+	uint64_t byte_length;
+	uint64_t uncompressed_byte_length;
+};
+
+bool TextureFile::ParseKtx2(const std::string& path)
+{
+	const char* data = (const char*)file_.GetData();
+	size_t size = file_.GetSize();
+	if (size < sizeof(Ktx2Header))
+	{
+		std::cerr << "Truncated KTX2 file: " << path << std::endl;
+		return false;
+	}
+
+	const Ktx2Header* header = (const Ktx2Header*)data;
+	if (header->pixel_depth > 1 || header->layer_count > 1 || header->face_count != 1)
+	{
+		std::cerr << "Only 2D KTX2 textures are supported: " << path << std::endl;
+		return false;
+	}
+	if (header->supercompression_scheme != 0)
+	{
+		// BasisLZ/UASTC would need a transcoder and zstd a decompressor, neither is in the tree
+		std::cerr << "Supercompressed KTX2 files are not supported: " << path << std::endl;
+		return false;
+	}
+
+	unsigned int pixel_size = 0;
+	image_.compressed = true;
+	// VkFormat values
+	switch (header->vk_format)
+	{
+		case 131: image_.internal_format = GL_COMPRESSED_RGB_S3TC_DXT1_EXT; break;
+		case 132: image_.internal_format = GL_COMPRESSED_SRGB_S3TC_DXT1_EXT; break;
+		case 133: image_.internal_format = GL_COMPRESSED_RGBA_S3TC_DXT1_EXT; break;
+		case 134: image_.internal_format = GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT; break;
+		case 135: image_.internal_format = GL_COMPRESSED_RGBA_S3TC_DXT3_EXT; break;
+		case 136: image_.internal_format = GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT; break;
+		case 137: image_.internal_format = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT; break;
+		case 138: image_.internal_format = GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT; break;
+		case 139: image_.internal_format = GL_COMPRESSED_RED_RGTC1; break;
+		case 140: image_.internal_format = GL_COMPRESSED_SIGNED_RED_RGTC1; break;
+		case 141: image_.internal_format = GL_COMPRESSED_RG_RGTC2; break;
+		case 142: image_.internal_format = GL_COMPRESSED_SIGNED_RG_RGTC2; break;
+		case 143: image_.internal_format = GL_COMPRESSED_RGB_BPTC_UNSIGNED_FLOAT; break;
+		case 144: image_.internal_format = GL_COMPRESSED_RGB_BPTC_SIGNED_FLOAT; break;
+		case 145: image_.internal_format = GL_COMPRESSED_RGBA_BPTC_UNORM; break;
+		case 146: image_.internal_format = GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM; break;
+		case 147: image_.internal_format = GL_COMPRESSED_RGB8_ETC2; break;
+		case 148: image_.internal_format = GL_COMPRESSED_SRGB8_ETC2; break;
+		case 149: image_.internal_format = GL_COMPRESSED_RGB8_PUNCHTHROUGH_ALPHA1_ETC2; break;
+		case 150: image_.internal_format = GL_COMPRESSED_SRGB8_PUNCHTHROUGH_ALPHA1_ETC2; break;
+		case 151: image_.internal_format = GL_COMPRESSED_RGBA8_ETC2_EAC; break;
+		case 152: image_.internal_format = GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC; break;
+		case 9: SetUncompressed(image_, R8); pixel_size = 1; break;
+		case 16: SetUncompressed(image_, RG8); pixel_size = 2; break;
+		case 37: SetUncompressed(image_, RGBA8); pixel_size = 4; break;
+		case 43: SetUncompressed(image_, SRGB8_ALPHA8); pixel_size = 4; break;
+		case 44: SetUncompressed(image_, BGRA8); pixel_size = 4; break;
+		case 97: SetUncompressed(image_, RGBA16F); pixel_size = 8; break;
+		case 109: SetUncompressed(image_, RGBA32F); pixel_size = 16; break;
+		default:
+			std::cerr << "Unsupported VkFormat " << header->vk_format << " in " << path << std::endl;
+			return false;
+	}
+
+	if (header->pixel_width == 0)
+	{
+		std::cerr << "KTX2 file with a width of 0: " << path << std::endl;
+		return false;
+	}
+
+	// a level count of 0 means the file wants the mips generated at load time, it still stores level 0.
+	// more than a full mip chain is cut off like for DDS
+	unsigned int level_count = header->level_count ? header->level_count : 1;
+	level_count = std::min(level_count, Texture::CountMipLevels(header->pixel_width, header->pixel_height));
+	if (size < sizeof(Ktx2Header) + level_count * sizeof(Ktx2LevelIndex))
+	{
+		std::cerr << "Truncated KTX2 file: " << path << std::endl;
+		return false;
+	}
+
+	// unlike DDS, the level index gives every level its own offset (the data itself is stored smallest first)
+	const Ktx2LevelIndex* levels = (const Ktx2LevelIndex*)(data + sizeof(Ktx2Header));
+	unsigned int width = header->pixel_width;
+	unsigned int height = header->pixel_height ? header->pixel_height : 1;
+	for (unsigned int level = 0; level < level_count; level++)
+	{
+		size_t level_size = GetLevelSize(image_, width, height, pixel_size);
+		// offset + length could wrap around, compare each against what is left instead
+		if (levels[level].byte_offset > size || levels[level].byte_length > size - levels[level].byte_offset
+			|| levels[level].byte_length < level_size)
+		{
+			std::cerr << "Truncated KTX2 file: " << path << std::endl;
+			return false;
+		}
+		image_.levels.push_back({ width, height, data + levels[level].byte_offset, level_size });
+		width = width > 1 ? width / 2 : 1;
+		height = height > 1 ? height / 2 : 1;
+	}
+	return true;
+}
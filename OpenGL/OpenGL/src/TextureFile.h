@@ -0,0 +1,51 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "MappedFile.h"
+
+// One mip level of an image, data points into memory owned by whoever produced the image
+struct TextureLevel
+{
+	unsigned int width;
+	unsigned int height;
+	const void* data;
+	size_t size;
+};
+
+// Pixels ready to go to OpenGL as they are. Compressed images only have the internal format,
+// uncompressed ones also carry the format/type pair glTexSubImage2D needs.
+struct TextureImage
+{
+	unsigned int internal_format = 0;
+	unsigned int format = 0;
+	unsigned int type = 0;
+	bool compressed = false;
+	std::vector<TextureLevel> levels;
+};
+
+// A DDS or KTX2 file mapped into memory. Block compressed data (BC1-7, ETC2) is handed to the driver
+// without ever being decompressed on the CPU, and the levels point straight into the mapping.
+class TextureFile
+{
+private:
+	MappedFile file_;
+	TextureImage image_;
+
+	bool ParseDds(const std::string& path);
+	bool ParseKtx2(const std::string& path);
+
+public:
+	// Map and parse the file, the container is picked from its magic number, not the extension.
+	// Fails for formats the current context can't sample, so has to be called after GLCapabilities::Detect().
+	bool Open(const std::string& path);
+
+	inline const TextureImage& GetImage() const { return image_; }
+};
+
+// Size in bytes of one compressed block (4x4 pixels), 0 if the format isn't block compressed
+unsigned int GetCompressedBlockSize(unsigned int internal_format);
+
+// Whether the current context can take data in this compressed format
+bool IsCompressedFormatSupported(unsigned int internal_format);
@@ -0,0 +1,128 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+ThreadPool::ThreadPool(unsigned int thread_count)
+	: busy_(0), stopping_(false)
+{
+	if (thread_count == 0)
+	{
+		unsigned int cores = std::thread::hardware_concurrency();
+		thread_count = cores > 1 ? cores - 1 : 1;
+	}
+
+	for (unsigned int i = 0; i < thread_count; i++)
+		workers_.emplace_back(&ThreadPool::WorkerLoop, this);
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		stopping_ = true;
+	}
+	wake_worker_.notify_all();
+	for (std::thread& worker : workers_)
+		worker.join();
+}
+
+void ThreadPool::WorkerLoop()
+{
+	while (true)
+	{
+		std::function<void()> task;
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+			wake_worker_.wait(lock, [this] { return stopping_ || !tasks_.empty(); });
+			if (tasks_.empty())
+				return;
+			task = std::move(tasks_.front());
+			tasks_.pop_front();
+			busy_++;
+		}
+
+		task();
+
+		std::lock_guard<std::mutex> lock(mutex_);
+		busy_--;
+		if (busy_ == 0 && tasks_.empty())
+			idle_.notify_all();
+	}
+}
+
+void ThreadPool::Submit(std::function<void()> task)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		tasks_.push_back(std::move(task));
+	}
+	wake_worker_.notify_one();
+}
+
+void ThreadPool::ParallelFor(size_t count, size_t min_chunk, const std::function<void(size_t, size_t)>& function)
+{
+	if (count == 0)
+		return;
+
+	// a few chunks per thread so a slow chunk doesn't leave the others idle at the end
+	size_t threads = workers_.size() + 1;
+	size_t chunk = std::max(min_chunk, (count + threads * 4 - 1) / (threads * 4));
+	size_t chunk_count = (count + chunk - 1) / chunk;
+
+	if (chunk_count == 1)
+	{
+		function(0, count);
+		return;
+	}
+
+	// the helpers may only get to run after this call returned, so what they touch lives in a shared state
+	struct ForState
+	{
+		std::atomic<size_t> next_chunk{ 0 };
+		std::atomic<size_t> done_chunks{ 0 };
+		std::mutex mutex;
+		std::condition_variable done;
+		const std::function<void(size_t, size_t)>* function;
+		size_t count;
+		size_t chunk;
+		size_t chunk_count;
+	};
+	std::shared_ptr<ForState> state = std::make_shared<ForState>();
+	state->function = &function;
+	state->count = count;
+	state->chunk = chunk;
+	state->chunk_count = chunk_count;
+
+	auto run_chunks = [](ForState& s)
+	{
+		size_t index;
+		while ((index = s.next_chunk.fetch_add(1)) < s.chunk_count)
+		{
+			size_t begin = index * s.chunk;
+			(*s.function)(begin, std::min(begin + s.chunk, s.count));
+			if (s.done_chunks.fetch_add(1) + 1 == s.chunk_count)
+			{
+				std::lock_guard<std::mutex> lock(s.mutex);
+				s.done.notify_all();
+			}
+		}
+	};
+
+	size_t helpers = std::min(workers_.size(), chunk_count - 1);
+	for (size_t i = 0; i < helpers; i++)
+		Submit([state, run_chunks]() { run_chunks(*state); });
+
+	// the calling thread works too, so this finishes even if every worker is busy with something else
+	run_chunks(*state);
+
+	std::unique_lock<std::mutex> lock(state->mutex);
+	state->done.wait(lock, [&state] { return state->done_chunks.load() == state->chunk_count; });
+}
+
+void ThreadPool::WaitIdle()
+{
+	std::unique_lock<std::mutex> lock(mutex_);
+	idle_.wait(lock, [this] { return busy_ == 0 && tasks_.empty(); });
+}
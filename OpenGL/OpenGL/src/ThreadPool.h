@@ -0,0 +1,46 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads pulling tasks from one queue. Shared by everything that wants
+// to spread CPU work over cores (decoding, culling, transform updates...).
+class ThreadPool
+{
+private:
+	std::vector<std::thread> workers_;
+	std::deque<std::function<void()>> tasks_;
+	std::mutex mutex_;
+	std::condition_variable wake_worker_;
+	std::condition_variable idle_;
+	unsigned int busy_;
+	bool stopping_;
+
+	void WorkerLoop();
+
+public:
+	// 0 threads means one per core minus one, the render thread keeps a core to itself
+	explicit ThreadPool(unsigned int thread_count = 0);
+
+	// Finishes the tasks that are already queued before the threads exit
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	void Submit(std::function<void()> task);
+
+	// Run function(begin, end) over [0, count) in chunks of at least min_chunk items on the workers and the
+	// calling thread, returns once every chunk is done. Safe to call from inside a task.
+	void ParallelFor(size_t count, size_t min_chunk, const std::function<void(size_t, size_t)>& function);
+
+	// Block until the queue is empty and no task is running
+	void WaitIdle();
+
+	inline unsigned int GetThreadCount() const { return (unsigned int)workers_.size(); }
+};
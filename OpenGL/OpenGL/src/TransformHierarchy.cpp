@@ -0,0 +1,300 @@
+#include "TransformHierarchy.h"
+#include "Renderer.h"
+#include "ThreadPool.h"
+
+#include <iostream>
+
+static constexpr unsigned int NO_SLOT = 0xFFFFFFFF;
+
+TransformHierarchy::TransformHierarchy()
+	: order_stale_(false)
+{
+}
+
+TransformHierarchy::NodeId TransformHierarchy::Create(const Mat4& local, NodeId parent)
+{
+	ASSERT(parent == INVALID_NODE || IsAlive(parent));
+
+	NodeId node;
+	if (!free_ids_.empty())
+	{
+		node = free_ids_.back();
+		free_ids_.pop_back();
+	}
+	else
+	{
+		node = (NodeId)slot_of_node_.size();
+		slot_of_node_.push_back(NO_SLOT);
+		parent_of_node_.push_back(INVALID_NODE);
+		alive_.push_back(false);
+	}
+
+	// goes to the end for now, the next Update sorts it in under its parent
+	slot_of_node_[node] = (unsigned int)local_.size();
+	parent_of_node_[node] = parent;
+	alive_[node] = true;
+	local_.push_back(local);
+	world_.push_back(local);
+	parent_slot_.push_back(NO_PARENT);
+	dirty_.push_back(1);
+	node_of_slot_.push_back(node);
+	range_of_slot_.push_back(NO_SLOT);
+	order_stale_ = true;
+	return node;
+}
+
+void TransformHierarchy::Destroy(NodeId node)
+{
+	ASSERT(IsAlive(node));
+
+	// the subtree goes with the rebuild, which finds it by not reaching it from any root. The ids are
+	// only reused after that, so nothing can end up under a new node with an old id in between.
+	alive_[node] = false;
+	order_stale_ = true;
+}
+
+bool TransformHierarchy::SetParent(NodeId node, NodeId parent)
+{
+	ASSERT(IsAlive(node) && (parent == INVALID_NODE || IsAlive(parent)));
+
+	for (NodeId ancestor = parent; ancestor != INVALID_NODE; ancestor = parent_of_node_[ancestor])
+	{
+		if (ancestor == node)
+		{
+			std::cerr << "Transform node " << node << " can't go under " << parent << ", that is inside its own subtree" << std::endl;
+			return false;
+		}
+	}
+
+	parent_of_node_[node] = parent;
+	MarkDirty(slot_of_node_[node]);
+	order_stale_ = true;
+	return true;
+}
+
+void TransformHierarchy::SetLocal(NodeId node, const Mat4& local)
+{
+	ASSERT(IsAlive(node));
+	unsigned int slot = slot_of_node_[node];
+	local_[slot] = local;
+	MarkDirty(slot);
+}
+
+void TransformHierarchy::MarkDirty(unsigned int slot)
+{
+	dirty_[slot] = 1;
+	if (range_of_slot_[slot] != NO_SLOT)
+		ranges_[range_of_slot_[slot]].dirty = true;
+}
+
+TransformHierarchy::NodeId TransformHierarchy::GetParent(NodeId node) const
+{
+	ASSERT(IsAlive(node));
+	return parent_of_node_[node];
+}
+
+const Mat4& TransformHierarchy::GetLocal(NodeId node) const
+{
+	ASSERT(IsAlive(node));
+	return local_[slot_of_node_[node]];
+}
+
+const Mat4& TransformHierarchy::GetWorld(NodeId node) const
+{
+	ASSERT(IsAlive(node));
+	return world_[slot_of_node_[node]];
+}
+
+void TransformHierarchy::Rebuild()
+{
+	unsigned int node_capacity = (unsigned int)slot_of_node_.size();
+	unsigned int old_count = (unsigned int)local_.size();
+
+	// children of every node as one list, walked in slot order so siblings keep their order
+	std::vector<unsigned int> first_child(node_capacity + 1, 0);
+	for (unsigned int slot = 0; slot < old_count; slot++)
+	{
+		NodeId node = node_of_slot_[slot];
+		if (alive_[node] && parent_of_node_[node] != INVALID_NODE)
+			first_child[parent_of_node_[node] + 1]++;
+	}
+	for (unsigned int node = 0; node < node_capacity; node++)
+		first_child[node + 1] += first_child[node];
+	std::vector<NodeId> children(first_child[node_capacity]);
+	std::vector<unsigned int> cursor(first_child.begin(), first_child.end() - 1);
+	for (unsigned int slot = 0; slot < old_count; slot++)
+	{
+		NodeId node = node_of_slot_[slot];
+		if (alive_[node] && parent_of_node_[node] != INVALID_NODE)
+			children[cursor[parent_of_node_[node]]++] = node;
+	}
+
+	// breadth first from every root, the order array doubles as the queue. A destroyed node's children are
+	// never reached, neither is anything below them.
+	std::vector<NodeId> order;
+	order.reserve(old_count);
+	ranges_.clear();
+	level_starts_.clear();
+	for (unsigned int slot = 0; slot < old_count; slot++)
+	{
+		NodeId root = node_of_slot_[slot];
+		if (!alive_[root] || parent_of_node_[root] != INVALID_NODE)
+			continue;
+
+		Range range = { (unsigned int)order.size(), 0, (unsigned int)level_starts_.size(), 0, false };
+		order.push_back(root);
+		unsigned int level_begin = range.begin;
+		while (level_begin < order.size())
+		{
+			unsigned int level_end = (unsigned int)order.size();
+			level_starts_.push_back(level_begin);
+			range.level_count++;
+			for (unsigned int i = level_begin; i < level_end; i++)
+			{
+				NodeId parent = order[i];
+				for (unsigned int child = first_child[parent]; child < first_child[parent + 1]; child++)
+					order.push_back(children[child]);
+			}
+			level_begin = level_end;
+		}
+		range.end = (unsigned int)order.size();
+		ranges_.push_back(range);
+	}
+
+	std::vector<unsigned int> new_slot_of_node(node_capacity, NO_SLOT);
+	for (unsigned int slot = 0; slot < order.size(); slot++)
+		new_slot_of_node[order[slot]] = slot;
+
+	// whatever wasn't reached is gone, its id can be handed out again
+	for (unsigned int slot = 0; slot < old_count; slot++)
+	{
+		NodeId node = node_of_slot_[slot];
+		if (new_slot_of_node[node] == NO_SLOT)
+		{
+			alive_[node] = false;
+			parent_of_node_[node] = INVALID_NODE;
+			free_ids_.push_back(node);
+		}
+	}
+
+	unsigned int count = (unsigned int)order.size();
+	std::vector<Mat4> local(count);
+	std::vector<Mat4> world(count);
+	std::vector<unsigned int> parent_slot(count);
+	std::vector<uint8_t> dirty(count);
+	std::vector<unsigned int> range_of_slot(count);
+	for (unsigned int range = 0; range < ranges_.size(); range++)
+	{
+		for (unsigned int slot = ranges_[range].begin; slot < ranges_[range].end; slot++)
+		{
+			NodeId node = order[slot];
+			unsigned int old_slot = slot_of_node_[node];
+			local[slot] = local_[old_slot];
+			world[slot] = world_[old_slot];
+			dirty[slot] = dirty_[old_slot];
+			NodeId parent = parent_of_node_[node];
+			parent_slot[slot] = parent == INVALID_NODE ? NO_PARENT : new_slot_of_node[parent];
+			range_of_slot[slot] = range;
+			ranges_[range].dirty = ranges_[range].dirty || dirty[slot];
+		}
+	}
+
+	local_ = std::move(local);
+	world_ = std::move(world);
+	parent_slot_ = std::move(parent_slot);
+	dirty_ = std::move(dirty);
+	range_of_slot_ = std::move(range_of_slot);
+	node_of_slot_ = std::move(order);
+	slot_of_node_ = std::move(new_slot_of_node);
+	order_stale_ = false;
+}
+
+void TransformHierarchy::UpdateSlots(unsigned int begin, unsigned int end)
+{
+	// parents come first, so by the time a node is reached its parent is final and says whether it changed
+	for (unsigned int slot = begin; slot < end; slot++)
+	{
+		unsigned int parent = parent_slot_[slot];
+		if (parent == NO_PARENT)
+		{
+			if (dirty_[slot])
+				world_[slot] = local_[slot];
+		}
+		else if (dirty_[slot] || dirty_[parent])
+		{
+			world_[slot] = world_[parent] * local_[slot];
+			dirty_[slot] = 1;
+		}
+	}
+}
+
+void TransformHierarchy::UpdateRange(const Range& range, ThreadPool* pool)
+{
+	if (!pool || range.end - range.begin <= PARALLEL_CHUNK)
+	{
+		UpdateSlots(range.begin, range.end);
+		return;
+	}
+
+	// one big subtree: the nodes of a level only read the level before, so each level is split among threads
+	for (unsigned int level = 0; level < range.level_count; level++)
+	{
+		unsigned int begin = level_starts_[range.first_level + level];
+		unsigned int end = level + 1 < range.level_count ? level_starts_[range.first_level + level + 1] : range.end;
+		if (end - begin <= PARALLEL_CHUNK)
+		{
+			UpdateSlots(begin, end);
+			continue;
+		}
+		pool->ParallelFor(end - begin, PARALLEL_CHUNK, [this, begin](size_t first, size_t last)
+		{
+			UpdateSlots(begin + (unsigned int)first, begin + (unsigned int)last);
+		});
+	}
+}
+
+void TransformHierarchy::Update(ThreadPool* pool)
+{
+	if (order_stale_)
+		Rebuild();
+
+	changed_.clear();
+	dirty_ranges_.clear();
+	unsigned int dirty_nodes = 0;
+	for (unsigned int range = 0; range < ranges_.size(); range++)
+	{
+		if (ranges_[range].dirty)
+		{
+			dirty_ranges_.push_back(range);
+			dirty_nodes += ranges_[range].end - ranges_[range].begin;
+		}
+	}
+
+	if (pool && dirty_nodes > PARALLEL_CHUNK && dirty_ranges_.size() > 1)
+	{
+		pool->ParallelFor(dirty_ranges_.size(), 1, [this, pool](size_t first, size_t last)
+		{
+			for (size_t i = first; i < last; i++)
+				UpdateRange(ranges_[dirty_ranges_[i]], pool);
+		});
+	}
+	else
+	{
+		for (unsigned int range : dirty_ranges_)
+			UpdateRange(ranges_[range], pool);
+	}
+
+	// the flags that are still set are exactly the nodes that got a new world matrix
+	for (unsigned int range : dirty_ranges_)
+	{
+		for (unsigned int slot = ranges_[range].begin; slot < ranges_[range].end; slot++)
+		{
+			if (dirty_[slot])
+			{
+				changed_.push_back(node_of_slot_[slot]);
+				dirty_[slot] = 0;
+			}
+		}
+		ranges_[range].dirty = false;
+	}
+}
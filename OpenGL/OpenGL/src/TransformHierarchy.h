@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "Math3D.h"
+
+class ThreadPool;
+
+// Parent/child transforms of the scene, kept as flat arrays instead of a tree of nodes. Every root owns a
+// contiguous range of the arrays holding its whole subtree sorted by depth, so a parent always comes before
+// its children and one front to back pass over a range brings every world matrix in it up to date: a node
+// is recomputed when it or its parent changed, and then counts as changed for its own children. Only the
+// ranges with something changed are walked, and different ranges run in parallel on a ThreadPool (a single
+// huge range goes level by level instead, the nodes of one depth don't depend on each other).
+// Adding, removing or reparenting nodes only marks the order stale, it is rebuilt once in the next Update.
+class TransformHierarchy
+{
+public:
+	typedef unsigned int NodeId;
+	static constexpr NodeId INVALID_NODE = 0xFFFFFFFF;
+
+private:
+	// a root and its subtree, [begin, end) of the sorted arrays
+	struct Range
+	{
+		unsigned int begin;
+		unsigned int end;
+		unsigned int first_level;   // into level_starts_, the starts of each depth inside the range
+		unsigned int level_count;
+		bool dirty;
+	};
+
+	static constexpr unsigned int NO_PARENT = 0xFFFFFFFF;
+
+	// sorted by range and depth, indexed by slot
+	std::vector<Mat4> local_;
+	std::vector<Mat4> world_;
+	std::vector<unsigned int> parent_slot_;
+	std::vector<uint8_t> dirty_;
+	std::vector<NodeId> node_of_slot_;
+	std::vector<unsigned int> range_of_slot_;
+	std::vector<Range> ranges_;
+	std::vector<unsigned int> level_starts_;
+
+	// by node id
+	std::vector<unsigned int> slot_of_node_;
+	std::vector<NodeId> parent_of_node_;
+	std::vector<bool> alive_;
+	std::vector<NodeId> free_ids_;
+
+	bool order_stale_;
+	std::vector<NodeId> changed_;
+	std::vector<unsigned int> dirty_ranges_;   // scratch for Update
+
+	// Sort the nodes into ranges again after nodes were added, removed or reparented
+	void Rebuild();
+
+	void UpdateSlots(unsigned int begin, unsigned int end);
+	void UpdateRange(const Range& range, ThreadPool* pool);
+
+	void MarkDirty(unsigned int slot);
+
+public:
+	// nodes per task when updating in parallel
+	static constexpr unsigned int PARALLEL_CHUNK = 2048;
+
+	TransformHierarchy();
+
+	// New node under parent (a root for INVALID_NODE), its world matrix is ready after the next Update
+	NodeId Create(const Mat4& local = Mat4::Identity(), NodeId parent = INVALID_NODE);
+
+	// Remove a node together with everything under it. The nodes under it are only removed by the next
+	// Update, until then they still count as alive.
+	void Destroy(NodeId node);
+
+	// Move a node (with its subtree) under another parent, its local matrix stays. Prints an error and
+	// returns false if parent is inside the node's own subtree.
+	bool SetParent(NodeId node, NodeId parent);
+
+	void SetLocal(NodeId node, const Mat4& local);
+
+	// Bring every world matrix up to date, walking only the subtrees where something changed
+	void Update(ThreadPool* pool = nullptr);
+
+	inline bool IsAlive(NodeId node) const { return node < alive_.size() && alive_[node]; }
+	NodeId GetParent(NodeId node) const;
+	const Mat4& GetLocal(NodeId node) const;
+
+	// As of the last Update
+	const Mat4& GetWorld(NodeId node) const;
+
+	// Nodes whose world matrix the last Update changed, for updating bounds or GPU copies of only those
+	inline const std::vector<NodeId>& GetChanged() const { return changed_; }
+
+	inline unsigned int GetNodeCount() const { return (unsigned int)local_.size(); }
+};
@@ -1,21 +1,69 @@
 #include "VertexArray.h"
+#include "GLCapabilities.h"
+#include "DeletionQueue.h"
+
+#include <utility>
 
 VertexArray::VertexArray()
 {
+	if (GLCapabilities::Get().direct_state_access)
+	{
+		// glCreateVertexArrays gives back an initialized object, so it can be edited without ever binding it.
+		GLCALL(glCreateVertexArrays(1, &renderer_id_));
+		return;
+	}
 	GLCALL(glGenVertexArrays(1, &renderer_id_));
 }
 
 VertexArray::~VertexArray()
 {
+	if (renderer_id_ == 0)
+		return;
 	GLCALL(glDeleteVertexArrays(1, &renderer_id_));
 }
 
+VertexArray::VertexArray(VertexArray&& other) noexcept
+	: renderer_id_(std::exchange(other.renderer_id_, 0)), layout_(std::move(other.layout_))
+{
+}
+
+VertexArray& VertexArray::operator=(VertexArray&& other) noexcept
+{
+	// the old objects go with other when it is destroyed
+	std::swap(renderer_id_, other.renderer_id_);
+	std::swap(layout_, other.layout_);
+	return *this;
+}
+
+void VertexArray::Release(DeletionQueue& queue)
+{
+	queue.Delete(GLObjectType::VERTEX_ARRAY, std::exchange(renderer_id_, 0));
+}
+
 void VertexArray::AddBuffer(const VertexBuffer& vb, const VertexBufferLayout& layout)
 {
-	Bind();
-	vb.Bind();
+	layout_ = layout;
 	const auto& elements = layout.GetElements();
 	unsigned int offset = 0;
+
+	if (GLCapabilities::Get().direct_state_access)
+	{
+		// with DSA the buffer goes on a binding point (0 here) and every attribute
+		// just says which binding point it reads from, nothing gets bound globally.
+		GLCALL(glVertexArrayVertexBuffer(renderer_id_, 0, vb.GetRendererId(), 0, layout.GetStride()));
+		for (unsigned int i = 0; i < elements.size(); i++)
+		{
+			const auto& element = elements[i];
+			GLCALL(glEnableVertexArrayAttrib(renderer_id_, i));
+			GLCALL(glVertexArrayAttribFormat(renderer_id_, i, element.count, element.type, element.normalized, offset));
+			GLCALL(glVertexArrayAttribBinding(renderer_id_, i, 0));
+			offset += element.count * VertexBufferElement::GetTypeOfSize(element.type);
+		}
+		return;
+	}
+
+	Bind();
+	vb.Bind();
 	for (unsigned int i = 0; i < elements.size(); i++)
 	{
 		const auto& element = elements[i];
@@ -31,6 +79,20 @@ void VertexArray::AddBuffer(const VertexBuffer& vb, const VertexBufferLayout& la
 
 }
 
+void VertexArray::SetIndexBuffer(const IndexBuffer& ib)
+{
+	if (GLCapabilities::Get().direct_state_access)
+	{
+		GLCALL(glVertexArrayElementBuffer(renderer_id_, ib.GetRendererId()));
+		return;
+	}
+
+	// the element array binding is part of the vertex array state, so binding it while
+	// the array is bound stores it in the array.
+	Bind();
+	GLCALL(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ib.GetRendererId()));
+}
+
 void VertexArray::Bind() const
 {
 	GLCALL(glBindVertexArray(renderer_id_));
@@ -1,18 +1,37 @@
 #pragma once
 
 #include "VertexBuffer.h"
+#include "IndexBuffer.h"
 #include "VertexBufferLayout.h"
 
+class DeletionQueue;
+
 class VertexArray
 {
 private:
 	unsigned int renderer_id_;
+	VertexBufferLayout layout_;
 
 public:
 	VertexArray();
 	~VertexArray();
 
+	// Movable so vertex arrays can live by value in a HandlePool, the moved from one owns nothing
+	VertexArray(VertexArray&& other) noexcept;
+	VertexArray& operator=(VertexArray&& other) noexcept;
+	VertexArray(const VertexArray&) = delete;
+	VertexArray& operator=(const VertexArray&) = delete;
+
+	// Hand the GL object to queue to be deleted once the GPU is done with it, this owns nothing afterwards
+	void Release(DeletionQueue& queue);
+
 	void Bind() const;
 	void Unbind() const;
 	void AddBuffer(const VertexBuffer& vb, const VertexBufferLayout& layout);
+
+	// Attach the index buffer to the vertex array so binding the array is enough before drawing
+	void SetIndexBuffer(const IndexBuffer& ib);
+
+	// Layout of the last buffer added, attribute i reads element i
+	inline const VertexBufferLayout& GetLayout() const { return layout_; }
 };
\ No newline at end of file
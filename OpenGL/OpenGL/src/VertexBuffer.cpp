@@ -1,9 +1,23 @@
 #include "Renderer.h"
 #include "GL/glew.h"
 #include "VertexBuffer.h"
+#include "GLCapabilities.h"
+#include "DeletionQueue.h"
 
-VertexBuffer::VertexBuffer(const void* data, int size)
+#include <utility>
+
+VertexBuffer::VertexBuffer(const void* data, int size, bool dynamic)
+	: size_(size)
 {
+	if (GLCapabilities::Get().direct_state_access)
+	{
+		// Create the buffer and give it immutable storage directly, this never touches
+		// the GL_ARRAY_BUFFER binding so whatever is bound right now stays bound.
+		GLCALL(glCreateBuffers(1, &renderer_id_));
+		GLCALL(glNamedBufferStorage(renderer_id_, size, data, dynamic ? GL_DYNAMIC_STORAGE_BIT : 0));
+		return;
+	}
+
 	GLCALL(glGenBuffers(1, &renderer_id_));
 
 	// Selecting which buffer to use, here selecting buffer.
@@ -12,13 +26,51 @@ VertexBuffer::VertexBuffer(const void* data, int size)
 	// Tell OpenGL about the data contained in the buffer.
 	// This tells opengl that the data is array buffer, with 6 floats and draw it statically
 	// meaning it will contain information once but should be drawed multiple times. 
-	GLCALL(glBufferData(GL_ARRAY_BUFFER, size, data, GL_STATIC_DRAW));
+	GLCALL(glBufferData(GL_ARRAY_BUFFER, size, data, dynamic ? GL_DYNAMIC_DRAW : GL_STATIC_DRAW));
 
 }
 
 VertexBuffer::~VertexBuffer()
 {
+	if (renderer_id_ == 0)
+		return;
 	GLCALL(glBindBuffer(GL_ARRAY_BUFFER, 0));
+	GLCALL(glDeleteBuffers(1, &renderer_id_));
+}
+
+VertexBuffer::VertexBuffer(VertexBuffer&& other) noexcept
+	: renderer_id_(std::exchange(other.renderer_id_, 0)), size_(std::exchange(other.size_, 0))
+{
+}
+
+VertexBuffer& VertexBuffer::operator=(VertexBuffer&& other) noexcept
+{
+	// the old objects go with other when it is destroyed
+	std::swap(renderer_id_, other.renderer_id_);
+	std::swap(size_, other.size_);
+	return *this;
+}
+
+void VertexBuffer::Release(DeletionQueue& queue)
+{
+	queue.Delete(GLObjectType::BUFFER, std::exchange(renderer_id_, 0));
+	size_ = 0;
+}
+
+void VertexBuffer::SubData(int offset, const void* data, int size)
+{
+	ASSERT(offset + size <= size_);
+
+	if (GLCapabilities::Get().direct_state_access)
+	{
+		GLCALL(glNamedBufferSubData(renderer_id_, offset, size, data));
+		return;
+	}
+
+	// going through the copy-write target so the GL_ARRAY_BUFFER binding is left alone
+	GLCALL(glBindBuffer(GL_COPY_WRITE_BUFFER, renderer_id_));
+	GLCALL(glBufferSubData(GL_COPY_WRITE_BUFFER, offset, size, data));
+	GLCALL(glBindBuffer(GL_COPY_WRITE_BUFFER, 0));
 }
 
 void VertexBuffer::Bind() const
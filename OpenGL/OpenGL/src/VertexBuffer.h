@@ -1,20 +1,41 @@
 #pragma once
 
+class DeletionQueue;
+
 class VertexBuffer
 {
 private:
 	unsigned int renderer_id_;
+	int size_;
 
 public:
-	// Constructor 
-	VertexBuffer(const void* data, int size);
+	// Constructor, dynamic buffers can be written to later through SubData
+	VertexBuffer(const void* data, int size, bool dynamic = false);
 
 	// Destructor
 	~VertexBuffer();
 
+	// Movable so buffers can live by value in a HandlePool, the moved from one owns nothing
+	VertexBuffer(VertexBuffer&& other) noexcept;
+	VertexBuffer& operator=(VertexBuffer&& other) noexcept;
+	VertexBuffer(const VertexBuffer&) = delete;
+	VertexBuffer& operator=(const VertexBuffer&) = delete;
+
+	// Hand the GL object to queue to be deleted once the GPU is done with it, this owns nothing afterwards
+	void Release(DeletionQueue& queue);
+
 	// To bind the vertex buffer id of the object with OpenGL 
 	void Bind() const;
 
 	// To Unbind the vertex buffer id of the object with OpenGl
 	void Unbind() const;
+
+	// Overwrite part of a dynamic buffer, offset and size are in bytes
+	void SubData(int offset, const void* data, int size);
+
+	// Size of the buffer in bytes
+	inline int GetSize() const { return size_; }
+
+	// OpenGL name of the buffer, used when attaching it to a vertex array without binding
+	inline unsigned int GetRendererId() const { return renderer_id_; }
 };
\ No newline at end of file
@@ -1,5 +1,6 @@
 #include "VertexBufferLayout.h"
 
 VertexBufferLayout::VertexBufferLayout()
+	: stride_(0)
 {
 }
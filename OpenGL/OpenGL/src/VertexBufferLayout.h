@@ -54,7 +54,14 @@ public:
 		stride_ += count * VertexBufferElement::GetTypeOfSize(GL_FLOAT);
 	}
 
+	// for layouts that come from data (mesh files) instead of code
+	void Push(const VertexBufferElement& element)
+	{
+		elements_.push_back(element);
+		stride_ += element.count * VertexBufferElement::GetTypeOfSize(element.type);
+	}
+
 	// getters	
-	inline const std::vector<VertexBufferElement> GetElements() const { return elements_; }
+	inline const std::vector<VertexBufferElement>& GetElements() const { return elements_; }
 	inline const unsigned int GetStride() const { return stride_; }
 };
\ No newline at end of file
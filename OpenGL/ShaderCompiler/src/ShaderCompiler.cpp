@@ -0,0 +1,163 @@
+// Offline compiler from .shader files to the SPIR-V modules ShaderVariantCache loads on GL 4.6 / ARB_gl_spirv.
+// usage: ShaderCompiler [-I <include dir>]... [--no-opt] <input.shader>...
+// Writes "<input>.<stage>.spv" for every stage of every input. Includes are expanded by the same preprocessor
+// the runtime uses, then glslangValidator (and spirv-opt unless --no-opt) from the PATH or %VULKAN_SDK%\Bin
+// turn the result into SPIR-V. Features are left as specialization constants, so one module per stage
+// covers every permutation.
+
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "ShaderPreprocessor.h"
+#include "ShaderSource.h"
+
+// stage names glslangValidator expects after -S
+static const char* glslang_stages[SHADER_STAGE_COUNT] = { "vert", "frag", "geom", "tesc", "tese", "comp" };
+
+// Tool from the Vulkan SDK if it is installed, otherwise left to the PATH
+static std::string FindTool(const char* name)
+{
+	const char* sdk = std::getenv("VULKAN_SDK");
+	if (sdk)
+	{
+		std::filesystem::path path = std::filesystem::path(sdk) / "Bin" / name;
+		std::error_code error;
+#ifdef _WIN32
+		path += ".exe";
+#endif
+		if (std::filesystem::exists(path, error))
+			return path.string();
+	}
+	return name;
+}
+
+static std::string Quote(const std::string& argument)
+{
+	return "\"" + argument + "\"";
+}
+
+static bool RunTool(const std::string& command)
+{
+#ifdef _WIN32
+	// cmd strips the outermost quotes, without the extra pair a quoted tool path breaks the whole line
+	int result = std::system(("\"" + command + "\"").c_str());
+#else
+	int result = std::system(command.c_str());
+#endif
+	return result == 0;
+}
+
+static bool WriteText(const std::string& path, const std::string& text)
+{
+	std::ofstream stream(path, std::ios::binary);
+	if (!stream)
+		return false;
+	stream.write(text.data(), text.size());
+	return (bool)stream;
+}
+
+static bool CompileStage(const std::string& path, ShaderStage stage, const PreprocessedSource& code, bool optimize,
+	const std::string& glslang, const std::string& spirv_opt)
+{
+	std::string stage_name = ShaderSource::GetStageName(stage);
+	std::string glsl_path = path + "." + stage_name + ".glsl";
+	std::string unoptimized_path = path + "." + stage_name + ".tmp.spv";
+	std::string output_path = path + "." + stage_name + ".spv";
+
+	if (!WriteText(glsl_path, code.code))
+	{
+		std::cerr << "Failed to write " << glsl_path << std::endl;
+		return false;
+	}
+
+	// -G targets OpenGL rather than Vulkan and defines GL_SPIRV, the auto-map flags give the plain uniforms
+	// and varyings the explicit locations SPIR-V needs so old shaders compile unchanged
+	std::string compile = Quote(glslang) + " -G --auto-map-locations --auto-map-bindings -S " +
+		glslang_stages[(unsigned int)stage] + " -o " + Quote(optimize ? unoptimized_path : output_path) + " " + Quote(glsl_path);
+	bool compiled = RunTool(compile);
+	if (!compiled)
+	{
+		// glslang reports "<file index>:<line>", same numbering as the runtime compile errors
+		std::cerr << path << " (" << stage_name << "): compile failed, files:" << std::endl;
+		for (unsigned int i = 0; i < code.files.size(); i++)
+			std::cerr << "  " << i << ": " << code.files[i] << std::endl;
+	}
+	else if (optimize)
+	{
+		compiled = RunTool(Quote(spirv_opt) + " -O " + Quote(unoptimized_path) + " -o " + Quote(output_path));
+		if (!compiled)
+			std::cerr << path << " (" << stage_name << "): spirv-opt failed" << std::endl;
+	}
+
+	std::remove(glsl_path.c_str());
+	std::remove(unoptimized_path.c_str());
+	if (!compiled)
+		std::remove(output_path.c_str());
+	return compiled;
+}
+
+static bool CompileShader(const std::string& path, ShaderPreprocessor& preprocessor, bool optimize,
+	const std::string& glslang, const std::string& spirv_opt)
+{
+	ShaderSource source = ShaderSource::Parse(path);
+	if (!source.IsLoaded())
+		return false;
+
+	unsigned int stage_count = 0;
+	for (unsigned int stage = 0; stage < SHADER_STAGE_COUNT; stage++)
+	{
+		if (!source.Has((ShaderStage)stage))
+			continue;
+
+		// no defines, the features stay specialization constants and get set when the program is created
+		PreprocessedSource code;
+		if (!preprocessor.Process(source.Get((ShaderStage)stage), path, {}, code, source.GetFirstLine((ShaderStage)stage)))
+			return false;
+		if (!CompileStage(path, (ShaderStage)stage, code, optimize, glslang, spirv_opt))
+			return false;
+		stage_count++;
+	}
+
+	std::cout << path << ": " << stage_count << " stages" << std::endl;
+	return true;
+}
+
+int main(int argc, char** argv)
+{
+	ShaderPreprocessor preprocessor;
+	std::vector<std::string> inputs;
+	bool optimize = true;
+
+	for (int i = 1; i < argc; i++)
+	{
+		std::string argument = argv[i];
+		if (argument == "-I" && i + 1 < argc)
+			preprocessor.AddIncludeDirectory(argv[++i]);
+		else if (argument == "--no-opt")
+			optimize = false;
+		else
+			inputs.push_back(argument);
+	}
+
+	if (inputs.empty())
+	{
+		std::cerr << "usage: ShaderCompiler [-I <include dir>]... [--no-opt] <input.shader>..." << std::endl;
+		return 1;
+	}
+
+	std::string glslang = FindTool("glslangValidator");
+	std::string spirv_opt = FindTool("spirv-opt");
+
+	int failed = 0;
+	for (const std::string& input : inputs)
+	{
+		if (!CompileShader(input, preprocessor, optimize, glslang, spirv_opt))
+			failed++;
+	}
+	return failed ? 1 : 0;
+}